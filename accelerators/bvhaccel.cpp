@@ -62,17 +62,41 @@ BVHAccel::BVHAccel(const vector<boost::shared_ptr<Primitive> > &p, u_int treetyp
 	for (u_int i = 0; i < nPrims; ++i)
 		new (&prims[i]) boost::shared_ptr<Primitive>(vPrims[i]);
 
+	// Find the motion interval covered by moving primitives
+	vector<MotionBBox> primMotionBounds;
+	primMotionBounds.reserve(nPrims);
+	u_int nMovingPrims = 0;
+	float startTime = INFINITY, endTime = -INFINITY;
+	for (u_int i = 0; i < nPrims; ++i) {
+		primMotionBounds.push_back(prims[i]->WorldMotionBound());
+		const MotionBBox &mb(primMotionBounds.back());
+		if (!mb.IsStatic()) {
+			++nMovingPrims;
+			startTime = min(startTime, mb.StartTime());
+			endTime = max(endTime, mb.EndTime());
+		}
+	}
+	const bool hasMotion = nMovingPrims > 0 && endTime > startTime;
+
 	vector<boost::shared_ptr<BVHAccelTreeNode> > bvList;
 	for (u_int i = 0; i < nPrims; ++i) {
 		boost::shared_ptr<BVHAccelTreeNode> ptr(new BVHAccelTreeNode());
 		ptr->bbox = prims[i]->WorldBound();
 		// NOTE - Ratow - Expand bbox a little to make sure rays collide
 		ptr->bbox.Expand(MachineEpsilon::E(ptr->bbox));
+		if (hasMotion) {
+			primMotionBounds[i].Linearize(startTime, endTime,
+				&ptr->motionBBox[0], &ptr->motionBBox[1]);
+			ptr->motionBBox[0].Expand(MachineEpsilon::E(ptr->motionBBox[0]));
+			ptr->motionBBox[1].Expand(MachineEpsilon::E(ptr->motionBBox[1]));
+		}
 		ptr->primitive = prims[i].get();
 		bvList.push_back(ptr);
 	}
 
 	LOG(LUX_INFO, LUX_NOERROR)<< "Building Bounding Volume Hierarchy, primitives: " << nPrims;
+	if (hasMotion)
+		LOG(LUX_INFO, LUX_NOERROR) << "Bounding Volume Hierarchy with time varying bounds, moving primitives: " << nMovingPrims;
 
 	nNodes = 0;
 	boost::shared_ptr<BVHAccelTreeNode> rootNode(BuildHierarchy(bvList, 0,
@@ -81,6 +105,15 @@ BVHAccel::BVHAccel(const vector<boost::shared_ptr<Primitive> > &p, u_int treetyp
 	LOG(LUX_INFO, LUX_NOERROR)<<  "Pre-processing Bounding Volume Hierarchy, total nodes: " << nNodes;
 
 	bvhTree = AllocAligned<BVHAccelArrayNode>(nNodes);
+	if (hasMotion) {
+		motionStart = startTime;
+		motionInvDuration = 1.f / (endTime - startTime);
+		motionBounds = AllocAligned<BBox>(2 * nNodes);
+	} else {
+		motionStart = 0.f;
+		motionInvDuration = 0.f;
+		motionBounds = NULL;
+	}
 	BuildArray(rootNode, 0);
 
 	LOG(LUX_INFO, LUX_NOERROR)<<  "Finished building Bounding Volume Hierarchy array";
@@ -91,6 +124,8 @@ BVHAccel::~BVHAccel() {
 		prims[i].~shared_ptr();
     FreeAligned(prims);
     FreeAligned(bvhTree);
+	if (motionBounds)
+		FreeAligned(motionBounds);
 }
 
 // Build an array of comparators for each axis
@@ -158,6 +193,8 @@ boost::shared_ptr<BVHAccelTreeNode> BVHAccel::BuildHierarchy(vector<boost::share
 	boost::shared_ptr<BVHAccelTreeNode> lchild(child);
 	parent->leftChild = lchild;
 	parent->bbox = Union(parent->bbox, child->bbox);
+	parent->motionBBox[0] = Union(parent->motionBBox[0], child->motionBBox[0]);
+	parent->motionBBox[1] = Union(parent->motionBBox[1], child->motionBBox[1]);
 	boost::shared_ptr<BVHAccelTreeNode> lastChild(child);
 
 	// Add remaining children
@@ -166,6 +203,8 @@ boost::shared_ptr<BVHAccelTreeNode> BVHAccel::BuildHierarchy(vector<boost::share
 		boost::shared_ptr<BVHAccelTreeNode> rchild(child);
 		lastChild->rightSibling = rchild;
 		parent->bbox = Union(parent->bbox, child->bbox);
+		parent->motionBBox[0] = Union(parent->motionBBox[0], child->motionBBox[0]);
+		parent->motionBBox[1] = Union(parent->motionBBox[1], child->motionBBox[1]);
 		lastChild = child;
 	}
 
@@ -251,6 +290,10 @@ u_int BVHAccel::BuildArray(boost::shared_ptr<BVHAccelTreeNode> &n, u_int offset)
 		BVHAccelArrayNode* p = &bvhTree[offset];
 
 		p->bbox = node->bbox;
+		if (motionBounds) {
+			motionBounds[2 * offset] = node->motionBBox[0];
+			motionBounds[2 * offset + 1] = node->motionBBox[1];
+		}
 		p->primitive = node->primitive;
 		offset = BuildArray(node->leftChild, offset+1);
 		p->skipIndex = offset;
@@ -271,7 +314,7 @@ bool BVHAccel::Intersect(const Ray &ray, Intersection *isect) const {
 	bool hit = false;
 
 	while(currentNode < stopNode) {
-		if(bvhTree[currentNode].bbox.IntersectP(ray)) {
+		if(IntersectNode(currentNode, ray)) {
 			if(bvhTree[currentNode].primitive != NULL)
 				if(bvhTree[currentNode].primitive->Intersect(ray, isect))
 					hit = true; // Continue testing for closer intersections
@@ -289,7 +332,7 @@ bool BVHAccel::IntersectP(const Ray &ray) const {
 	u_int stopNode = bvhTree[0].skipIndex; // Non-existent
 
 	while(currentNode < stopNode) {
-		if(bvhTree[currentNode].bbox.IntersectP(ray)) {
+		if(IntersectNode(currentNode, ray)) {
 			if(bvhTree[currentNode].primitive != NULL)
 				if(bvhTree[currentNode].primitive->IntersectP(ray))
 					return true;
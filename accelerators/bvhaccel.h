@@ -30,6 +30,8 @@ namespace lux
 
 struct BVHAccelTreeNode {
 	BBox bbox;
+	// Bounds at start and end of the motion interval
+	BBox motionBBox[2];
 	Primitive* primitive;
 	boost::shared_ptr<BVHAccelTreeNode> leftChild;
 	boost::shared_ptr<BVHAccelTreeNode> rightSibling;
@@ -65,6 +67,22 @@ private:
 	boost::shared_ptr<BVHAccelTreeNode> BuildHierarchy(vector<boost::shared_ptr<BVHAccelTreeNode> > &list, u_int begin, u_int end, u_int axis);
 	void FindBestSplit(vector<boost::shared_ptr<BVHAccelTreeNode> > &list, u_int begin, u_int end, float *splitValue, u_int *bestAxis);
 	u_int BuildArray(boost::shared_ptr<BVHAccelTreeNode> &node, u_int offset);
+	bool IntersectNode(u_int node, const Ray &ray) const {
+		if (!motionBounds)
+			return bvhTree[node].bbox.IntersectP(ray);
+		// Linear interpolation of the node bounds at ray time
+		const float u = Clamp((ray.time - motionStart) *
+			motionInvDuration, 0.f, 1.f);
+		const BBox &b0(motionBounds[2 * node]);
+		const BBox &b1(motionBounds[2 * node + 1]);
+		const BBox bbox(Point(Lerp(u, b0.pMin.x, b1.pMin.x),
+			Lerp(u, b0.pMin.y, b1.pMin.y),
+			Lerp(u, b0.pMin.z, b1.pMin.z)),
+			Point(Lerp(u, b0.pMax.x, b1.pMax.x),
+			Lerp(u, b0.pMax.y, b1.pMax.y),
+			Lerp(u, b0.pMax.z, b1.pMax.z)));
+		return bbox.IntersectP(ray);
+	}
 
 	// BVHAccel Private Data
 	u_int treeType;
@@ -74,6 +92,9 @@ private:
 	boost::shared_ptr<Primitive> *prims;
 	u_int nNodes;
 	BVHAccelArrayNode *bvhTree;
+	// Time varying node bounds, NULL if no primitive is moving
+	float motionStart, motionInvDuration;
+	BBox *motionBounds;
 };
 
 }//namespace lux
@@ -24,10 +24,25 @@
 #include "paramset.h"
 #include "dynload.h"
 #include "error.h"
+#include "context.h"
+#include "acceleratorcache.h"
+#include "osfunc.h"
 
 namespace lux
 {
 
+// Accelerator cache entry of a QBVH, the header is followed by the nodes
+// before pre-swizzling and the primitive indexes
+struct QBVHCacheHeader {
+	char magic[4];
+	boost::uint32_t version, nPrims, nNodes, nQuads;
+	// Keeps the nodes aligned in the mapped entry
+	boost::uint32_t padding[11];
+};
+static const boost::uint32_t qbvhCacheVersion = 1;
+// Smaller trees are built faster than an entry is mapped
+static const u_int qbvhCacheMinPrimitives = 4096;
+
 #if defined(WIN32) && !defined(__CYGWIN__)
 class __declspec(align(16)) QuadRay {
 #else 
@@ -321,11 +336,32 @@ QBVHAccel::QBVHAccel(const vector<boost::shared_ptr<Primitive> > &p,
 	primsIndexes[nPrims + 1] = nPrims - 1;
 	primsIndexes[nPrims + 2] = nPrims - 1;
 
-	// Recursively build the tree
-	LOG(LUX_DEBUG,LUX_NOERROR) << "Building QBVH, primitives: " << nPrims << ", initial nodes: " << maxNodes;
+	// The tree only depends on the bounding boxes and the build parameters
+	AcceleratorCache *cache = Context::GetActive() ?
+		Context::GetActiveAcceleratorCache() : NULL;
+	const bool useCache = cache && cache->IsEnabled() &&
+		nPrims >= qbvhCacheMinPrimitives;
+	tigerhash::digest_type cacheKey;
+	if (useCache) {
+		tigerhash hash;
+		const boost::uint32_t params[5] = { qbvhCacheVersion, maxPrimsPerLeaf,
+			fullSweepThreshold, skipFactor, nPrims };
+		hash.update(reinterpret_cast<const char *>(params), sizeof(params));
+		hash.update(reinterpret_cast<const char *>(primsBboxes),
+			sizeof(BBox) * nPrims);
+		cacheKey = hash.end_message();
+	}
+
 	nQuads = 0;
-	BuildTree(0, nPrims, primsIndexes, primsBboxes, primsCentroids,
-		worldBound, centroidsBbox, -1, 0, 0);
+	if (!useCache || !LoadFromCache(*cache, cacheKey, primsIndexes)) {
+		// Recursively build the tree
+		LOG(LUX_DEBUG,LUX_NOERROR) << "Building QBVH, primitives: " << nPrims << ", initial nodes: " << maxNodes;
+		BuildTree(0, nPrims, primsIndexes, primsBboxes, primsCentroids,
+			worldBound, centroidsBbox, -1, 0, 0);
+
+		if (useCache)
+			StoreToCache(*cache, cacheKey, primsIndexes);
+	}
 
 	prims = AllocAligned<boost::shared_ptr<QuadPrimitive> >(nQuads);
 	nQuads = 0;
@@ -356,6 +392,112 @@ QBVHAccel::QBVHAccel(const vector<boost::shared_ptr<Primitive> > &p,
 	delete[] primsIndexes;
 }
 
+// Checks that a cached tree only references existing nodes and primitive
+// indexes, and holds exactly nQuads quads, before it is pre-swizzled
+static bool ValidCachedTree(const QBVHNode *nodes, u_int nNodes, u_int nPrims,
+	u_int nQuads, const u_int *primsIndexes)
+{
+	u_int quads = 0;
+	for (u_int n = 0; n < nNodes; ++n) {
+		for (int i = 0; i < 4; ++i) {
+			if (!nodes[n].ChildIsLeaf(i)) {
+				// Children are always allocated after their parent
+				const int32_t child = nodes[n].children[i];
+				if (static_cast<u_int>(child) <= n ||
+					static_cast<u_int>(child) >= nNodes)
+					return false;
+			} else if (!nodes[n].LeafIsEmpty(i)) {
+				const u_int nbQuads = nodes[n].NbQuadsInLeaf(i);
+				// Before pre-swizzling, the leaf holds a primitive offset
+				const u_int offset = nodes[n].FirstQuadIndexForLeaf(i);
+				if (offset > nPrims || 4 * nbQuads > nPrims + 3 - offset)
+					return false;
+				quads += nbQuads;
+				if (quads > nQuads)
+					return false;
+			}
+		}
+	}
+	if (quads != nQuads)
+		return false;
+	for (u_int i = 0; i < nPrims + 3; ++i) {
+		if (primsIndexes[i] >= nPrims)
+			return false;
+	}
+	return true;
+}
+
+bool QBVHAccel::LoadFromCache(AcceleratorCache &cache,
+	const tigerhash::digest_type &key, u_int *primsIndexes)
+{
+	const double start = osWallClockTime();
+	boost::iostreams::mapped_file_source entry;
+	if (!cache.Load("qbvh", key, entry))
+		return false;
+
+	const QBVHCacheHeader *header =
+		reinterpret_cast<const QBVHCacheHeader *>(entry.data());
+	if (entry.size() < sizeof(QBVHCacheHeader) ||
+		memcmp(header->magic, "QBVH", 4) ||
+		header->version != qbvhCacheVersion ||
+		header->nPrims != nPrims || header->nNodes == 0 ||
+		header->nNodes > (entry.size() - sizeof(QBVHCacheHeader)) /
+		sizeof(QBVHNode) ||
+		entry.size() != sizeof(QBVHCacheHeader) +
+		sizeof(QBVHNode) * header->nNodes +
+		sizeof(u_int) * (nPrims + 3) ||
+		// Every quad holds at least one primitive
+		header->nQuads == 0 || header->nQuads > nPrims) {
+		LOG(LUX_WARNING, LUX_CONSISTENCY) << "Ignoring invalid QBVH cache entry " << digest_string(key);
+		return false;
+	}
+	const char *data = entry.data() + sizeof(QBVHCacheHeader);
+	const QBVHNode *cachedNodes = reinterpret_cast<const QBVHNode *>(data);
+	const u_int *cachedIndexes = reinterpret_cast<const u_int *>(data +
+		sizeof(QBVHNode) * header->nNodes);
+	if (!ValidCachedTree(cachedNodes, header->nNodes, nPrims,
+		header->nQuads, cachedIndexes)) {
+		LOG(LUX_WARNING, LUX_CONSISTENCY) << "Ignoring corrupted QBVH cache entry " << digest_string(key);
+		return false;
+	}
+
+	nNodes = header->nNodes;
+	nQuads = header->nQuads;
+	if (nNodes > maxNodes) {
+		FreeAligned(nodes);
+		maxNodes = nNodes;
+		nodes = AllocAligned<QBVHNode>(maxNodes);
+	}
+	memcpy(nodes, cachedNodes, sizeof(QBVHNode) * nNodes);
+	memcpy(primsIndexes, cachedIndexes, sizeof(u_int) * (nPrims + 3));
+
+	const double elapsed = osWallClockTime() - start;
+	cache.Loaded(elapsed);
+	LOG(LUX_DEBUG, LUX_NOERROR) << "QBVH loaded from cache entry " << digest_string(key) << " in " << elapsed << "s";
+	return true;
+}
+
+void QBVHAccel::StoreToCache(AcceleratorCache &cache,
+	const tigerhash::digest_type &key, const u_int *primsIndexes) const
+{
+	QBVHCacheHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "QBVH", 4);
+	header.version = qbvhCacheVersion;
+	header.nPrims = nPrims;
+	header.nNodes = nNodes;
+	header.nQuads = nQuads;
+
+	vector<std::pair<const char *, size_t> > blocks;
+	blocks.push_back(std::make_pair(reinterpret_cast<const char *>(&header),
+		sizeof(header)));
+	blocks.push_back(std::make_pair(reinterpret_cast<const char *>(nodes),
+		sizeof(QBVHNode) * nNodes));
+	blocks.push_back(std::make_pair(reinterpret_cast<const char *>(primsIndexes),
+		sizeof(u_int) * (nPrims + 3)));
+	cache.Store("qbvh", key, blocks);
+}
+
 float QBVHAccel::CollectStatistics(const int32_t nodeIndex, const u_int depth,
 	const BBox &nodeBBox)
 {
@@ -27,6 +27,7 @@
 #include "lux.h"
 #include "memory.h"
 #include "primitive.h"
+#include "tigerhash.h"
 
 #include <xmmintrin.h>
 #include <boost/cstdint.hpp>
@@ -37,6 +38,7 @@ namespace lux
 
 class QuadRay;
 class QuadPrimitive;
+class AcceleratorCache;
 
 // This code is based on Flexray by Anthony Pajot (anthony.pajot@alumni.enseeiht.fr)
 
@@ -382,6 +384,27 @@ protected:
 	float CollectStatistics(const int32_t nodeIndex, const u_int depth,
 		const BBox &nodeBBox);
 
+	/**
+	   Load the nodes, before pre-swizzling, and the primitive indexes
+	   from the accelerator cache
+	   @param cache
+	   @param key hash of the primitive bounding boxes and build parameters
+	   @param primsIndexes
+	   @return false if there is no valid entry for key
+	*/
+	bool LoadFromCache(AcceleratorCache &cache,
+		const tigerhash::digest_type &key, u_int *primsIndexes);
+
+	/**
+	   Store the nodes, before pre-swizzling, and the primitive indexes
+	   in the accelerator cache
+	   @param cache
+	   @param key
+	   @param primsIndexes
+	*/
+	void StoreToCache(AcceleratorCache &cache,
+		const tigerhash::digest_type &key, const u_int *primsIndexes) const;
+
 	/**
 	   the actual number of quads
 	*/
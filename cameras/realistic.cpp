@@ -67,17 +67,219 @@ RealisticCamera::RealisticCamera(const MotionSystem &world2cam,
     RasterToFilm = Inverse(FilmToRaster);
     FilmToCamera = Translate(Vector(0.f, 0.f, -filmDistance - distToBack));
     RasterToCamera =  FilmToCamera * RasterToFilm;
+
+    rayCounts = boost::shared_ptr<RayCounts>(new RayCounts());
+    localRays = 0;
+    localRejected = 0;
+
+    BuildExitPupil();
 }   
 RealisticCamera::~RealisticCamera(void) {
+    FlushRayCounts();
+    if (rayCounts.unique() && rayCounts->rays > 0)
+        LOG(LUX_DEBUG, LUX_NOERROR) << "Realistic camera rejected " <<
+            100.f * GetRejectionRatio() << "% of " << rayCounts->rays <<
+            " camera rays";
+}
+
+void RealisticCamera::AddAttributes(Queryable *q) const
+{
+	Camera::AddAttributes(q);
+	AddDoubleAttribute(*q, "RejectionRatio",
+		"Fraction of camera rays vignetted by the lens system",
+		boost::bind(&RealisticCamera::GetRejectionRatio, this));
+}
+
+double RealisticCamera::GetRejectionRatio() const
+{
+	FlushRayCounts();
+	boost::mutex::scoped_lock lock(rayCounts->countMutex);
+	if (rayCounts->rays == 0)
+		return 0.;
+	return static_cast<double>(rayCounts->rejected) / rayCounts->rays;
+}
+
+void RealisticCamera::CountRay(bool rejected) const
+{
+	++localRays;
+	if (rejected)
+		++localRejected;
+	// Keep the shared lock out of the per ray path
+	if (localRays >= 65536)
+		FlushRayCounts();
+}
+
+void RealisticCamera::FlushRayCounts() const
+{
+	if (localRays == 0)
+		return;
+	boost::mutex::scoped_lock lock(rayCounts->countMutex);
+	rayCounts->rays += localRays;
+	rayCounts->rejected += localRejected;
+	localRays = 0;
+	localRejected = 0;
+}
+
+bool Lens::Intersect(const Ray &ray, float *thit, Normal *nn) const
+{
+    if (radius == 0.f) {
+        // Stop, same test as the disk shape
+        if (fabsf(ray.d.z) < 1e-7f)
+            return false;
+        const float t = (center - ray.o.z) / ray.d.z;
+        if (t < ray.mint || t > ray.maxt)
+            return false;
+        const Point phit(ray(t));
+        if (phit.x * phit.x + phit.y * phit.y > apRadius * apRadius)
+            return false;
+        *thit = t;
+        *nn = Normal(0.f, 0.f, 1.f);
+        return true;
+    }
+    // Sphere centred on the optical axis, same hit selection as
+    // the lenscomponent shape
+    const Vector oc(ray.o.x, ray.o.y, ray.o.z - center);
+    const float A = Dot(ray.d, ray.d);
+    const float B = 2.f * Dot(ray.d, oc);
+    const float C = Dot(oc, oc) - radius * radius;
+    float t0, t1;
+    if (!Quadratic(A, B, C, &t0, &t1))
+        return false;
+    if (t0 > ray.maxt || t1 < ray.mint)
+        return false;
+    float t = t0;
+    if (t0 < ray.mint) {
+        t = t1;
+        if (t > ray.maxt)
+            return false;
+    }
+    const Point phit(ray(t));
+    if (phit.x * phit.x + phit.y * phit.y > apRadius * apRadius)
+        return false;
+    *thit = t;
+    *nn = Normal(phit.x / radius, phit.y / radius,
+        (phit.z - center) / radius);
+    return true;
+}
+
+bool RealisticCamera::TraceLenses(Ray *ray) const {
+    // Iterate over the lens components from the back, and refract
+    float thit;
+    Normal nn;
+    for (int i = (int)lenses.size() -1 ; i >= 0; --i) {
+        const Lens &lens(lenses[i]);
+        if (!lens.Intersect(*ray, &thit, &nn))
+            return false;
+        // intersection, compute refracted ray
+        Normal n = lens.entering ? nn : -nn;
+        float eta = lens.eta;
+        float cos_i = Dot(-ray->d, n);
+        float sint2 = (eta * eta * (1 - cos_i*cos_i));
+        if (sint2 > 1.) // total internal reflection
+            return false;
+        // use snell's law
+        float cost = sqrtf(max(0.f, 1.f - sint2));
+        float nscale = eta * cos_i - cost;
+        Vector d(n.x * nscale + eta * ray->d.x, 
+                 n.y * nscale + eta * ray->d.y, 
+                 n.z * nscale + eta * ray->d.z);
+
+        ray->o = (*ray)(thit);
+        ray->d = Normalize(d);
+        ray->mint = 0.f;
+        ray->maxt = INFINITY;
+    }
+    return true;
+}
+
+void RealisticCamera::BuildExitPupil() {
+    // The lens system is rotationally symmetric, so the pupil only
+    // depends on the distance of the film point to the optical axis
+    const u_int nBins = 64;
+    const u_int nFilmSamples = 8;
+    const u_int nGrid = 96;
+    const float filmZ = -filmDistance - distToBack;
+    const float maxRadius = filmDiag * .5f;
+    const float cell = 2.f * backAperture / nGrid;
+    exitPupil.clear();
+    exitPupil.resize(nBins);
+    invPupilBinWidth = maxRadius > 0.f ? nBins / maxRadius : 0.f;
+    float coverage = 0.f;
+    for (u_int b = 0; b < nBins; ++b) {
+        ExitPupilBounds &bounds(exitPupil[b]);
+        for (u_int f = 0; f < nFilmSamples; ++f) {
+            // Include both ends of the bin
+            const Point pFilm(maxRadius * (b + static_cast<float>(f) /
+                (nFilmSamples - 1)) / nBins, 0.f, filmZ);
+            for (u_int i = 0; i < nGrid; ++i) {
+                const float u = -backAperture + (i + .5f) * cell;
+                for (u_int j = 0; j < nGrid; ++j) {
+                    const float v = -backAperture + (j + .5f) * cell;
+                    if (u * u + v * v > backAperture * backAperture)
+                        continue;
+                    Ray ray(pFilm, Normalize(Point(u, v, -distToBack) - pFilm));
+                    ray.mint = 0.f;
+                    ray.maxt = INFINITY;
+                    if (!TraceLenses(&ray))
+                        continue;
+                    bounds.uMin = min(bounds.uMin, u);
+                    bounds.uMax = max(bounds.uMax, u);
+                    bounds.vMin = min(bounds.vMin, v);
+                    bounds.vMax = max(bounds.vMax, v);
+                }
+            }
+        }
+        if (bounds.Empty())
+            continue;
+        // Grow by two grid cells to cover the pupil between samples
+        bounds.uMin -= 2.f * cell;
+        bounds.uMax += 2.f * cell;
+        bounds.vMin -= 2.f * cell;
+        bounds.vMax += 2.f * cell;
+        // Bounds reaching the rim of the rear element can't tell a pupil
+        // cut by the grid resolution, those bins sample the whole disk
+        if (bounds.uMin <= -backAperture || bounds.uMax >= backAperture ||
+            bounds.vMin <= -backAperture || bounds.vMax >= backAperture) {
+            bounds = ExitPupilBounds();
+            coverage += M_PI * backAperture * backAperture;
+            continue;
+        }
+        coverage += bounds.Area();
+    }
+    if (backAperture > 0.f)
+        LOG(LUX_DEBUG, LUX_NOERROR) << "Realistic camera exit pupil covers " <<
+            100.f * coverage / (nBins * M_PI * backAperture * backAperture) <<
+            "% of the rear element on average";
 }
+
 float RealisticCamera::GenerateRay(const Sample &sample, Ray *ray) const {
     // Generate raster and back lens samples
     Point Pras(sample.imageX, sample.imageY, 0.f);
     Point PCamera(RasterToCamera * Pras);
-    float lensU, lensV;
-    ConcentricSampleDisk(sample.lensU, sample.lensV, &lensU, &lensV);
-    lensU *= backAperture;
-    lensV *= backAperture;
+    float lensU, lensV, pupilScale = 1.f;
+    const float filmRadius = sqrtf(PCamera.x * PCamera.x +
+        PCamera.y * PCamera.y);
+    const u_int bin = min(Floor2UInt(filmRadius * invPupilBinWidth),
+        static_cast<u_int>(exitPupil.size() - 1));
+    const ExitPupilBounds &bounds(exitPupil[bin]);
+    if (!bounds.Empty()) {
+        // Sample the pupil bounds rotated towards the film point and
+        // rescale by their area relative to the rear element disk
+        const float u = Lerp(sample.lensU, bounds.uMin, bounds.uMax);
+        const float v = Lerp(sample.lensV, bounds.vMin, bounds.vMax);
+        float cosPhi = 1.f, sinPhi = 0.f;
+        if (filmRadius > 0.f) {
+            cosPhi = PCamera.x / filmRadius;
+            sinPhi = PCamera.y / filmRadius;
+        }
+        lensU = cosPhi * u - sinPhi * v;
+        lensV = sinPhi * u + cosPhi * v;
+        pupilScale = bounds.Area() * INV_PI / (backAperture * backAperture);
+    } else {
+        ConcentricSampleDisk(sample.lensU, sample.lensV, &lensU, &lensV);
+        lensU *= backAperture;
+        lensV *= backAperture;
+    }
     Point PBack(lensU, lensV, -distToBack);
 
     ray->o = PCamera;
@@ -90,42 +292,18 @@ float RealisticCamera::GenerateRay(const Sample &sample, Ray *ray) const {
     cos4 *= cos4;
     cos4 *= cos4;
 
-    // Iterate over the lens components, and intersect
-    DifferentialGeometry dg;
-    float thit;
-    for (int i = (int)lenses.size() -1 ; i >= 0; --i) {
-        if (lenses[i]->shape->Intersect(*ray, &thit, &dg)) {
-            // intersection, compute refracted ray
-            Normal n = (lenses[i]->entering == true) ? dg.nn : -dg.nn;
-            float eta = lenses[i]->eta;
-            float cos_i = Dot(-ray->d, n);
-            float sint2 = (eta * eta * (1 - cos_i*cos_i));
-            if (sint2 > 1.) { // total internal reflection, return dead ray
-                ray->mint = 1.f;
-                ray->maxt = 0.f;
-                return 1.f;
-            }
-            // use snell's law
-            float cost = sqrtf(max(0.f, 1.f - sint2));
-            float nscale = eta * cos_i - cost;
-            Vector d(n.x * nscale + eta * ray->d.x, 
-                     n.y * nscale + eta * ray->d.y, 
-                     n.z * nscale + eta * ray->d.z);
-
-            ray->o = (*ray)(thit);
-            ray->d = Normalize(d);
-            ray->mint = 0.f;
-            ray->maxt = INFINITY;
-        }
-        else { // no intersection, return dead ray
-            ray->mint = 1.f;
-            ray->maxt = 0.f;
-            return 1.f;
-        }
+    // Outside of the rear element or vignetted, return dead ray
+    if (lensU * lensU + lensV * lensV > backAperture * backAperture ||
+        !TraceLenses(ray)) {
+        CountRay(true);
+        ray->mint = 1.f;
+        ray->maxt = 0.f;
+        return 1.f;
     }
+    CountRay(false);
     ray->maxt = (ClipYon - ClipHither) / ray->d.z;
     *ray *= CameraToWorld;
-    return cos4 / filmDist2;
+    return pupilScale * cos4 / filmDist2;
 }
 
 float RealisticCamera::ParseLensData(const string& specfile) {
@@ -147,39 +325,24 @@ float RealisticCamera::ParseLensData(const string& specfile) {
         {
             // stop is a disc instead of a sphere
             if (r == 0.0) {
-                ParamSet paramSet;
-                float height = -accumdist;
-                float radius = apertureDiameter / 2.0f;
-                float innerradius = 0.f;
-                paramSet.AddFloat("height", &height);
-                paramSet.AddFloat("radius", &radius);
-                paramSet.AddFloat("innerradius", &innerradius);
-                boost::shared_ptr<Shape> shape = 
-                    MakeShape("disk", Transform(), false, paramSet);
-				boost::shared_ptr<Lens> o (new Lens(false, 1.f, aperture, shape));
-                lenses.push_back(o);
+                lenses.push_back(Lens(false, 1.f, aperture, -accumdist,
+                    0.f, apertureDiameter / 2.0f));
                 ni = 1.f;
             }
             else {
-                // camera to lens object transform
+                // sphere center along the optical axis
                 float radius = fabsf(r);
-                Transform lensToCam;
+                float center;
                 if (r > 0) {
-                    lensToCam = Translate(Vector(0., 0., -accumdist - radius));
+                    center = -accumdist - radius;
                     entering = false;
                 }
                 else {
-                    lensToCam = Translate(Vector(0., 0., -accumdist + radius));
+                    center = -accumdist + radius;
                     entering = true;
                 }
-                ParamSet paramSet;
-                paramSet.AddFloat("radius", &radius);
-                paramSet.AddFloat("aperture", &aperture);
-                boost::shared_ptr<Shape> shape = 
-                    MakeShape("lenscomponent", lensToCam, false, 
-                    paramSet);
-				boost::shared_ptr<Lens> o (new Lens(entering, nt/ni, aperture, shape));
-                lenses.push_back(o);
+                lenses.push_back(Lens(entering, nt/ni, aperture, center,
+                    radius, aperture / 2.0f));
                 ni = nt;
             }
             accumdist += sep;
@@ -24,17 +24,49 @@
 #include "camera.h"
 #include "dynload.h"
 
+#include <boost/thread/mutex.hpp>
+
 namespace lux
 {
 
+/**
+ * A lens element of the realistic camera: a spherical interface centred on
+ * the optical axis, or a flat stop when radius is 0.
+ */
 struct Lens {
     Lens(const bool ent, const float n, const float ap,
-        boost::shared_ptr<Shape> shape) 
-        : entering(ent), eta(n), aperture(ap), shape(shape) { }
+        const float zc, const float r, const float apr)
+        : entering(ent), eta(n), aperture(ap), center(zc), radius(r),
+        apRadius(apr) { }
+    /**
+     * Intersects the element with a camera space ray.
+     * @param ray The ray to intersect.
+     * @param thit Returns the ray parameter of the hit point.
+     * @param nn Returns the element normal at the hit point, oriented as the
+     * lenscomponent (outwards) and disk (+z) shapes would.
+     * @return True if the ray hits the element inside its aperture.
+     */
+    bool Intersect(const Ray &ray, float *thit, Normal *nn) const;
+
     bool entering;
     float eta;
     float aperture;
-    boost::shared_ptr<Shape> shape;
+    // z of the sphere center, or of the stop plane
+    float center;
+    float radius, apRadius;
+};
+
+/**
+ * Axis aligned bounds, on the rear element plane, of the lens positions
+ * reachable from a film radius on the +x axis.
+ */
+struct ExitPupilBounds {
+    ExitPupilBounds() : uMin(INFINITY), uMax(-INFINITY),
+        vMin(INFINITY), vMax(-INFINITY) { }
+    bool Empty() const { return uMin > uMax; }
+    float Area() const { return (uMax - uMin) * (vMax - vMin); }
+
+    float uMin, uMax, vMin, vMax;
 };
 
 class RealisticCamera : public Camera {
@@ -61,22 +93,51 @@ public:
 	virtual bool IsLensBased() const { return true; }
 	virtual BBox Bounds() const { return BBox(); }
 
+	virtual void AddAttributes(Queryable *q) const;
+
 	virtual RealisticCamera* Clone() const {
-		return new RealisticCamera(*this);
+		RealisticCamera *cam = new RealisticCamera(*this);
+		cam->localRays = 0;
+		cam->localRejected = 0;
+		return cam;
 	}
 
+	/**
+	 * Fraction of the generated camera rays vignetted by the lens system.
+	 */
+	double GetRejectionRatio() const;
+
 	static Camera *CreateCamera(const MotionSystem &world2cam,
 		const ParamSet &params, Film *film);
   
 private:
 	float ParseLensData(const string& specfile);
+	bool TraceLenses(Ray *ray) const;
+	void BuildExitPupil();
+	void CountRay(bool rejected) const;
+	void FlushRayCounts() const;
 
 	float filmDistance, filmDist2, filmDiag;
 	float apertureDiameter, distToBack, backAperture;
  
-	vector<boost::shared_ptr<Lens> > lenses;
+	vector<Lens> lenses;
+
+	// Exit pupil bounds per radial film bin, from the optical axis
+	// to the film corners
+	vector<ExitPupilBounds> exitPupil;
+	float invPupilBinWidth;
 
 	Transform RasterToFilm, RasterToCamera, FilmToCamera;
+
+	// Ray counts are accumulated per clone and flushed into the
+	// totals shared by all the clones of the scene camera
+	struct RayCounts {
+		RayCounts() : rays(0), rejected(0) { }
+		boost::mutex countMutex;
+		unsigned long long rays, rejected;
+	};
+	boost::shared_ptr<RayCounts> rayCounts;
+	mutable u_int localRays, localRejected;
 };
 
 }//namespace lux
@@ -57,6 +57,7 @@ SET(lux_core_generated_src
 SOURCE_GROUP("Source Files\\Core\\Generated" FILES ${lux_core_generated_src})
 
 SET(lux_core_src
+	core/acceleratorcache.cpp
 	core/api.cpp
 	core/asyncstream.cpp
 	core/camera.cpp
@@ -72,6 +73,7 @@ SET(lux_core_src
 	core/igiio.cpp
 	core/imagereader.cpp
 	core/light.cpp
+	core/lighttree.cpp
 	core/material.cpp
 	core/mc.cpp
 	core/motionsystem.cpp
@@ -80,6 +82,7 @@ SET(lux_core_src
 	core/photonmap.cpp
 	core/pngio.cpp
 	core/primitive.cpp
+	core/refinementqueue.cpp
 	core/rendererstatistics.cpp
 	core/renderfarm.cpp
 	core/renderinghints.cpp
@@ -90,9 +93,11 @@ SET(lux_core_src
 	core/spectrum.cpp
 	core/spectrumwavelengths.cpp
 	core/texture.cpp
+	core/textureprogram.cpp
 	core/tgaio.cpp
 	core/timer.cpp
 	core/tigerhash.cpp
+	core/tracer.cpp
 	core/transport.cpp
 	core/util.cpp
 	core/volume.cpp
@@ -501,6 +506,7 @@ SET(lux_core_hdr
 	core/imagereader.h
 	core/kdtree.h
 	core/light.h
+	core/lighttree.h
 	core/lux.h
 	core/material.h
 	core/mc.h
@@ -528,10 +534,12 @@ SET(lux_core_hdr
 	core/streamio.h
 	core/texture.h
 	core/texturecolor.h
+	core/textureprogram.h
 	core/tgaio.h
 	core/timer.h
 	core/tigerhash.h
 	core/tonemap.h
+	core/tracer.h
 	core/transport.h
 	core/version.h
 	core/volume.h
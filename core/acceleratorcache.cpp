@@ -0,0 +1,113 @@
+/***************************************************************************
+ *   Copyright (C) 1998-2013 by authors (see AUTHORS.txt)                  *
+ *                                                                         *
+ *   This file is part of LuxRender.                                       *
+ *                                                                         *
+ *   Lux Renderer is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   Lux Renderer is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                         *
+ *   This project is based on PBRT ; see http://www.pbrt.org               *
+ *   Lux Renderer website : http://www.luxrender.net                       *
+ ***************************************************************************/
+
+
+#include "acceleratorcache.h"
+#include "error.h"
+
+#include <boost/filesystem.hpp>
+#include <fstream>
+
+using namespace lux;
+
+AcceleratorCache::AcceleratorCache() : Queryable("accelerator_cache"),
+	directory(""), hits(0), misses(0), stores(0), loadTime(0.0)
+{
+	AddStringAttribute(*this, "directory", "Directory of the cached accelerators, empty to disable the cache", &AcceleratorCache::directory, ReadWriteAccess);
+	AddIntAttribute(*this, "hits", "Number of accelerators loaded from the cache", &AcceleratorCache::hits);
+	AddIntAttribute(*this, "misses", "Number of accelerators not found in the cache", &AcceleratorCache::misses);
+	AddIntAttribute(*this, "stores", "Number of accelerators written to the cache", &AcceleratorCache::stores);
+	AddDoubleAttribute(*this, "loadTime", "Total time spent loading accelerators from the cache in seconds", &AcceleratorCache::loadTime);
+}
+
+string AcceleratorCache::EntryPath(const string &kind,
+	const tigerhash::digest_type &key) const
+{
+	boost::filesystem::path path(directory);
+	path /= kind + "_" + digest_string(key) + ".cache";
+	return path.string();
+}
+
+bool AcceleratorCache::Load(const string &kind,
+	const tigerhash::digest_type &key,
+	boost::iostreams::mapped_file_source &entry)
+{
+	const string path(EntryPath(kind, key));
+	try {
+		if (boost::filesystem::exists(path)) {
+			entry.open(path);
+			if (entry.is_open())
+				return true;
+		}
+	} catch (std::exception &e) {
+		LOG(LUX_WARNING, LUX_SYSTEM) << "Unable to map accelerator cache entry '" << path << "': " << e.what();
+	}
+
+	boost::mutex::scoped_lock lock(statisticsMutex);
+	++misses;
+	return false;
+}
+
+void AcceleratorCache::Loaded(double seconds)
+{
+	boost::mutex::scoped_lock lock(statisticsMutex);
+	++hits;
+	loadTime += seconds;
+}
+
+void AcceleratorCache::Store(const string &kind,
+	const tigerhash::digest_type &key,
+	const vector<std::pair<const char *, size_t> > &blocks)
+{
+	const string path(EntryPath(kind, key));
+	// Write under a random temporary name and rename it, so concurrent
+	// builds and renders, in this or other processes, never see a
+	// partial entry
+	string tmpPath;
+	try {
+		tmpPath = path + "." +
+			boost::filesystem::unique_path("%%%%-%%%%-%%%%-%%%%").string() +
+			".tmp";
+		boost::filesystem::create_directories(directory);
+		{
+			std::ofstream out(tmpPath.c_str(), std::ios::out | std::ios::binary);
+			for (size_t i = 0; i < blocks.size(); ++i)
+				out.write(blocks[i].first, blocks[i].second);
+			if (!out.good()) {
+				LOG(LUX_WARNING, LUX_SYSTEM) << "Unable to write accelerator cache entry '" << path << "'";
+				out.close();
+				boost::filesystem::remove(tmpPath);
+				return;
+			}
+		}
+		boost::filesystem::rename(tmpPath, path);
+	} catch (std::exception &e) {
+		LOG(LUX_WARNING, LUX_SYSTEM) << "Unable to store accelerator cache entry '" << path << "': " << e.what();
+		boost::system::error_code ec;
+		if (!tmpPath.empty())
+			boost::filesystem::remove(tmpPath, ec);
+		return;
+	}
+
+	boost::mutex::scoped_lock lock(statisticsMutex);
+	++stores;
+}
@@ -0,0 +1,71 @@
+/***************************************************************************
+ *   Copyright (C) 1998-2013 by authors (see AUTHORS.txt)                  *
+ *                                                                         *
+ *   This file is part of LuxRender.                                       *
+ *                                                                         *
+ *   Lux Renderer is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   Lux Renderer is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                         *
+ *   This project is based on PBRT ; see http://www.pbrt.org               *
+ *   Lux Renderer website : http://www.luxrender.net                       *
+ ***************************************************************************/
+
+
+#ifndef LUX_ACCELERATORCACHE_H
+#define LUX_ACCELERATORCACHE_H
+// acceleratorcache.h*
+
+#include "lux.h"
+#include "queryable.h"
+#include "tigerhash.h"
+
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace lux
+{
+
+// Opt-in on-disk cache of built acceleration structures. Entries are keyed
+// by a tiger hash of everything the build depends on, they are written
+// once and memory mapped when a later render builds the same structure.
+// The cache is disabled as long as its directory is empty.
+class AcceleratorCache : public Queryable {
+public:
+	AcceleratorCache();
+	~AcceleratorCache() { }
+
+	bool IsEnabled() const { return directory != ""; }
+
+	// Maps the entry of the given kind and key, counts a miss if there
+	// is no such entry
+	bool Load(const string &kind, const tigerhash::digest_type &key,
+		boost::iostreams::mapped_file_source &entry);
+	// Counts a hit once the mapped entry has been decoded
+	void Loaded(double seconds);
+	// Writes the blocks as the entry of the given kind and key
+	void Store(const string &kind, const tigerhash::digest_type &key,
+		const vector<std::pair<const char *, size_t> > &blocks);
+
+private:
+	string EntryPath(const string &kind,
+		const tigerhash::digest_type &key) const;
+
+	string directory;
+	boost::mutex statisticsMutex;
+	int hits, misses, stores;
+	double loadTime;
+};
+
+}//namespace lux
+
+#endif // LUX_ACCELERATORCACHE_H
@@ -28,6 +28,7 @@
 #include "error.h"
 #include "version.h"
 #include "osfunc.h"
+#include "tracer.h"
 
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/thread/mutex.hpp>
@@ -558,7 +559,15 @@ bool parseFile(const char *filename) {
 // Parsing Global Interface
 int luxParse(const char *filename)
 {
+	// The span is closed by WorldEnd before rendering starts
+	Tracer *tracer = Tracer::GetEnabled();
+	if (tracer)
+		tracer->Begin(TRACE_PARSE, NULL);
 	bool parse_success = parseFile(filename);
+	// Parsing failures don't reach WorldEnd
+	tracer = Tracer::GetEnabled();
+	if (tracer)
+		tracer->End(TRACE_PARSE);
 
 	if (!parse_success) {
 		// syntax error
@@ -153,11 +153,44 @@ CameraResponse::CameraResponse(const string &film)
 	AdjustGamma(GreenI, GreenB, 1.f / source_gamma);
 	AdjustGamma(BlueI, BlueB, 1.f / source_gamma);
 
+	BuildLUT(RedI, RedB, &RedLUT);
+	if (color) {
+		BuildLUT(GreenI, GreenB, &GreenLUT);
+		BuildLUT(BlueI, BlueB, &BlueLUT);
+	}
+
 	validFile = true;
 }
 
+void CameraResponse::BuildLUT(const vector<float> &from,
+	const vector<float> &to, CrfLUT *lut) const
+{
+	lut->start = from.front();
+	if (!(from.back() > from.front())) {
+		lut->invStep = 0.f;
+		lut->values.assign(1, to.front());
+		return;
+	}
+	const float step = (from.back() - from.front()) / (CRF_LUT_SIZE - 1);
+	lut->invStep = 1.f / step;
+	lut->values.resize(CRF_LUT_SIZE);
+	for (u_int i = 0; i < CRF_LUT_SIZE - 1; ++i)
+		lut->values[i] = ApplyCrf(lut->start + i * step, from, to);
+	lut->values[CRF_LUT_SIZE - 1] = to.back();
+}
+
 void CameraResponse::Map(RGBColor &rgb) const
 {
+	if (!RedLUT.values.empty()) {
+		if (color) {
+			rgb.c[0] = RedLUT.Lookup(rgb.c[0]);
+			rgb.c[1] = GreenLUT.Lookup(rgb.c[1]);
+			rgb.c[2] = BlueLUT.Lookup(rgb.c[2]);
+		} else
+			rgb.c[0] = rgb.c[1] = rgb.c[2] = RedLUT.Lookup(rgb.Y());
+		return;
+	}
+	// The curves are still being set up by the constructor
 	if (color) {
 		rgb.c[0] = ApplyCrf(rgb.c[0], RedI, RedB);
 		rgb.c[1] = ApplyCrf(rgb.c[1], GreenI, GreenB);
@@ -28,6 +28,9 @@
 
 namespace lux {
 
+// Number of entries of the resampled response curves
+#define CRF_LUT_SIZE 4096
+
 class CameraResponse {
 public:
 	CameraResponse(const string &film);
@@ -36,7 +39,26 @@ public:
 	string filmName;
 	bool validFile;
 private:
+	// Response curve resampled at regular irradiance intervals so that
+	// mapping a value doesn't need a binary search
+	struct CrfLUT {
+		float Lookup(float point) const {
+			const float x = (point - start) * invStep;
+			if (!(x > 0.f))
+				return values.front();
+			if (x >= static_cast<float>(values.size() - 1))
+				return values.back();
+			const u_int i = Floor2UInt(x);
+			return Lerp(x - i, values[i], values[i + 1]);
+		}
+
+		float start, invStep;
+		vector<float> values;
+	};
+
 	float ApplyCrf(float point, const vector<float> &from, const vector<float> &to) const;
+	void BuildLUT(const vector<float> &from, const vector<float> &to,
+		CrfLUT *lut) const;
 	bool loadPreset();
 	bool loadFile();
 
@@ -47,6 +69,8 @@ private:
 	vector<float> GreenB; // measured intensity
 	vector<float> BlueI; // image irradiance (on the image plane)
 	vector<float> BlueB; // measured intensity
+	// Empty until the curves are final
+	CrfLUT RedLUT, GreenLUT, BlueLUT;
 };
 
 }
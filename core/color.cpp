@@ -35,28 +35,15 @@ XYZColor::XYZColor(const SpectrumWavelengths &sw, const SWCSpectrum &s)
 {
 	if (sw.single) {
 		const u_int j = sw.single_w;
-		SpectrumWavelengths::spd_ciex.Sample(1, sw.binsXYZ + j,
-			sw.offsetsXYZ + j, c);
-		SpectrumWavelengths::spd_ciey.Sample(1, sw.binsXYZ + j,
-			sw.offsetsXYZ + j, c + 1);
-		SpectrumWavelengths::spd_ciez.Sample(1, sw.binsXYZ + j,
-			sw.offsetsXYZ + j, c + 2);
-		c[0] *= s.c[j] * WAVELENGTH_SAMPLES;
-		c[1] *= s.c[j] * WAVELENGTH_SAMPLES;
-		c[2] *= s.c[j] * WAVELENGTH_SAMPLES;
+		c[0] = sw.cieXYZ[0][j] * (s.c[j] * WAVELENGTH_SAMPLES);
+		c[1] = sw.cieXYZ[1][j] * (s.c[j] * WAVELENGTH_SAMPLES);
+		c[2] = sw.cieXYZ[2][j] * (s.c[j] * WAVELENGTH_SAMPLES);
 	} else {
-		SWCSpectrum x, y, z;
-		SpectrumWavelengths::spd_ciex.Sample(WAVELENGTH_SAMPLES,
-			sw.binsXYZ, sw.offsetsXYZ, x.c);
-		SpectrumWavelengths::spd_ciey.Sample(WAVELENGTH_SAMPLES,
-			sw.binsXYZ, sw.offsetsXYZ, y.c);
-		SpectrumWavelengths::spd_ciez.Sample(WAVELENGTH_SAMPLES,
-			sw.binsXYZ, sw.offsetsXYZ, z.c);
 		c[0] = c[1] = c[2] = 0.f;
 		for (u_int j = 0; j < WAVELENGTH_SAMPLES; ++j) {
-			c[0] += x.c[j] * s.c[j];
-			c[1] += y.c[j] * s.c[j];
-			c[2] += z.c[j] * s.c[j];
+			c[0] += sw.cieXYZ[0][j] * s.c[j];
+			c[1] += sw.cieXYZ[1][j] * s.c[j];
+			c[2] += sw.cieXYZ[2][j] * s.c[j];
 		}
 	}
 }
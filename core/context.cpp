@@ -33,7 +33,11 @@
 #include "shape.h"
 #include "volume.h"
 #include "material.h"
+#include "textureprogram.h"
 #include "renderfarm.h"
+#include "refinementqueue.h"
+#include "acceleratorcache.h"
+#include "tracer.h"
 #include "film/fleximage.h"
 #include "luxrays/core/epsilon.h"
 using luxrays::MachineEpsilon;
@@ -132,10 +136,13 @@ void Context::Init() {
 	curTransform = lux::Transform();
 	namedCoordinateSystems.clear();
 	renderOptions = new RenderOptions;
+	refinementQueue = new RefinementQueue();
 	graphicsState = new GraphicsState;
 	pushedGraphicsStates.clear();
 	pushedTransforms.clear();
 	renderFarm = new RenderFarm();
+	acceleratorCache = new AcceleratorCache();
+	tracer = new Tracer();
 	filmOverrideParams = NULL;
 	shapeNo = 0;
 }
@@ -149,6 +156,10 @@ void Context::Free() {
 	delete luxCurrentScene;
 	luxCurrentScene = NULL;
 
+	// Stop the refinement before freeing its destinations
+	delete refinementQueue;
+	refinementQueue = NULL;
+
 	delete renderOptions;
 	renderOptions = NULL;
 
@@ -158,8 +169,15 @@ void Context::Free() {
 	delete renderFarm;
 	renderFarm = NULL;
 
+	delete acceleratorCache;
+	acceleratorCache = NULL;
+
 	delete filmOverrideParams;
 	filmOverrideParams = NULL;
+
+	// Last, so the trace covers everything freed above
+	delete tracer;
+	tracer = NULL;
 }
 
 // API Function Definitions
@@ -476,8 +494,10 @@ void Context::Texture(const string &n, const string &type,
 		}
 		boost::shared_ptr<lux::Texture<float> > ft(
 			MakeFloatTexture(texname, curTransform.StaticTransform(), params));
+		// Fold and flatten arithmetic texture graphs once, here,
+		// instead of walking them at every shading point
 		if (ft)
-			graphicsState->floatTextures[n] = ft;
+			graphicsState->floatTextures[n] = FlatFloatTexture::Flatten(ft);
 	} else if (type == "color") {
 		// Create _color_ texture and store in _colorTextures_
 		if (graphicsState->colorTextures.find(n) !=
@@ -750,11 +770,10 @@ void Context::Shape(const string &n, const ParamSet &params) {
 			renderOptions->currentLightInstance->push_back(area);*/
 		} /*else*/ {
 			renderOptions->currentInstanceSource->push_back(sh);
+			renderOptions->currentInstanceRefined->push_back(sh);
 			if (!sh->CanIntersect())
-				sh->Refine(*(renderOptions->currentInstanceRefined),
-					PrimitiveRefinementHints(false), sh);
-			else
-				renderOptions->currentInstanceRefined->push_back(sh);
+				refinementQueue->Push(sh,
+					renderOptions->currentInstanceRefined);
 		}
 	} else if (graphicsState->areaLight != "") {
 		u_int lg = GetLightGroup();
@@ -770,10 +789,15 @@ void Context::Shape(const string &n, const ParamSet &params) {
 		boost::shared_ptr<Primitive> prim(new AreaLightPrimitive(pr,
 			area));
 		renderOptions->primitives.push_back(prim);
+		renderOptions->refinedPrimitives.push_back(prim);
 		// Add area light for primitive to light vector
 		renderOptions->lights.push_back(area);
-	} else
+	} else {
 		renderOptions->primitives.push_back(sh);
+		renderOptions->refinedPrimitives.push_back(sh);
+		if (!sh->CanIntersect())
+			refinementQueue->Push(sh, &(renderOptions->refinedPrimitives));
+	}
 }
 void Context::Renderer(const string &n, const ParamSet &params) {
 	VERIFY_OPTIONS("Renderer");
@@ -834,6 +858,9 @@ void Context::ObjectBegin(const string &n) {
 			"ObjectBegin called inside of instance definition";
 		return;
 	}
+	// Pending refinements of a previous definition with the same name
+	// still point into the vectors replaced below
+	refinementQueue->Flush();
 	renderOptions->instancesSource[n] = vector<boost::shared_ptr<Primitive> >();
 	renderOptions->instancesRefined[n] = vector<boost::shared_ptr<Primitive> >();
 	renderOptions->currentInstanceSource = &renderOptions->instancesSource[n];
@@ -863,6 +890,9 @@ void Context::ObjectInstance(const string &n) {
 		return;
 	}
 
+	// The instance shapes may still be refined
+	refinementQueue->Flush();
+
 	vector<boost::shared_ptr<Primitive> > &inSource = renderOptions->instancesSource[n];
 	vector<boost::shared_ptr<Primitive> > &in = renderOptions->instancesRefined[n];
 	if (renderOptions->currentInstanceRefined == &in) {
@@ -902,8 +932,10 @@ void Context::ObjectInstance(const string &n) {
 		if (renderOptions->currentInstanceRefined) {
 			// Instance of instances case
 			renderOptions->currentInstanceRefined->push_back(o);
-		} else
+		} else {
 			renderOptions->primitives.push_back(o);
+			renderOptions->refinedPrimitives.push_back(o);
+		}
 	}
 	vector<boost::shared_ptr<Light> > &li = renderOptions->lightInstances[n];
 	for (u_int i = 0; i < li.size(); ++i) {
@@ -928,6 +960,8 @@ void Context::PortalInstance(const string &n) {
 		LOG(LUX_ERROR,LUX_BADTOKEN) << "Unable to find instance named '" << n << "'";
 		return;
 	}
+	// The instance shapes may still be refined
+	refinementQueue->Flush();
 	vector<boost::shared_ptr<Primitive> > &in = renderOptions->instancesRefined[n];
 	if (renderOptions->currentInstanceRefined == &in) {
 		LOG(LUX_ERROR,LUX_NESTING) << "PortalInstance '" << n << "' self reference";
@@ -954,6 +988,8 @@ void Context::MotionInstance(const string &n, float startTime, float endTime, co
 		LOG(LUX_ERROR,LUX_BADTOKEN) << "Unable to find instance named '" << n << "'";
 		return;
 	}
+	// The instance shapes may still be refined
+	refinementQueue->Flush();
 	vector<boost::shared_ptr<Primitive> > &in = renderOptions->instancesRefined[n];
 	if (renderOptions->currentInstanceRefined == &in) {
 		LOG(LUX_ERROR,LUX_NESTING) << "MotionInstance '" << n << "' self reference";
@@ -995,6 +1031,7 @@ void Context::MotionInstance(const string &n, float startTime, float endTime, co
 	boost::shared_ptr<Primitive> o(new MotionPrimitive(in[0], ms, graphicsState->material,
 		graphicsState->exterior, graphicsState->interior));
 	renderOptions->primitives.push_back(o);
+	renderOptions->refinedPrimitives.push_back(o);
 }
 
 void Context::WorldEnd() {
@@ -1013,6 +1050,12 @@ void Context::WorldEnd() {
 		pushedTransforms.pop_back();
 	}
 
+	// Wait for the shapes still being refined
+	refinementQueue->Flush();
+	Tracer *parseTracer = Tracer::GetEnabled();
+	if (parseTracer)
+		parseTracer->End(TRACE_PARSE);
+
 	if (!terminated) {
 		// Create scene and render
 		luxCurrentScene = renderOptions->MakeScene();
@@ -1067,11 +1110,15 @@ Scene *Context::RenderOptions::MakeScene() const {
 		surfIntegratorName, surfIntegratorParams);
 	lux::VolumeIntegrator *volumeIntegrator = MakeVolumeIntegrator(
 		volIntegratorName, volIntegratorParams);
-	boost::shared_ptr<Primitive> accelerator(MakeAccelerator(acceleratorName,
-		primitives, acceleratorParams));
-	if (!accelerator) {
-		ParamSet ps;
-		accelerator = MakeAccelerator("kdtree", primitives, ps);
+	boost::shared_ptr<Primitive> accelerator;
+	{
+		TraceSpan span(TRACE_ACCELERATOR, "scene");
+		accelerator = MakeAccelerator(acceleratorName, refinedPrimitives,
+			acceleratorParams);
+		if (!accelerator) {
+			ParamSet ps;
+			accelerator = MakeAccelerator("kdtree", refinedPrimitives, ps);
+		}
 	}
 	if (!accelerator)
 		LOG(LUX_SEVERE,LUX_BUG)<< "Unable to find \"kdtree\" accelerator";
@@ -1094,6 +1141,7 @@ Scene *Context::RenderOptions::MakeScene() const {
 		sampler, primitives, accelerator, lights, lightGroups, volumeRegion);
 	// Erase primitives, lights, volume regions and instances from _RenderOptions_
 	primitives.clear();
+	refinedPrimitives.clear();
 	lights.clear();
 	volumeRegions.clear();
 	currentInstanceSource = NULL;
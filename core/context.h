@@ -43,10 +43,14 @@ using std::map;
 
 namespace lux {
 
+class RefinementQueue;
+class AcceleratorCache;
+class Tracer;
+
 class LUX_EXPORT Context {
 public:
 
-	Context(std::string n = "Lux default context") : name(n) {}
+	Context(std::string n = "Lux default context") : name(n), tracer(NULL) {}
 
 	~Context() {
 		Free();
@@ -60,6 +64,12 @@ public:
 		activeContext = c;
 	}
 
+	static AcceleratorCache *GetActiveAcceleratorCache() {
+		return activeContext->acceleratorCache;
+	}
+	static Tracer *GetActiveTracer() {
+		return activeContext ? activeContext->tracer : NULL;
+	}
 	static map<string, boost::shared_ptr<lux::Texture<float> > > *GetActiveFloatTextures() {
 		return &(activeContext->graphicsState->floatTextures);
 	}
@@ -263,6 +273,8 @@ private:
 		MotionTransform worldToCamera;
 		mutable vector<Light *> lights;
 		mutable vector<boost::shared_ptr<Primitive> > primitives;
+		// Refined primitives, used to build the scene accelerator
+		mutable vector<boost::shared_ptr<Primitive> > refinedPrimitives;
 		mutable vector<Region *> volumeRegions;
 		// Unrefined primitives
 		mutable map<string, vector<boost::shared_ptr<Primitive> > > instancesSource;
@@ -319,10 +331,14 @@ private:
 	vector<lux::Transform> motionBlockTransforms; // holds transform for current motion block
 	map<string, lux::MotionTransform> namedCoordinateSystems;
 	RenderOptions *renderOptions;
+	// Refines shapes while the rest of the scene is parsed
+	RefinementQueue *refinementQueue;
 	GraphicsState *graphicsState;
 	vector<GraphicsState> pushedGraphicsStates;
 	vector<lux::MotionTransform> pushedTransforms;
 	RenderFarm *renderFarm;
+	AcceleratorCache *acceleratorCache;
+	Tracer *tracer;
 
 	ParamSet *filmOverrideParams;
 	
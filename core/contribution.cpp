@@ -30,7 +30,7 @@
 namespace lux
 {
 
-ContributionBuffer::Buffer::Buffer() : pos(0) {
+ContributionBuffer::Buffer::Buffer(u_int n) : pos(0), node(n) {
 	contribs = AllocAligned<Contribution>(CONTRIB_BUF_SIZE);
 }
 
@@ -39,21 +39,22 @@ ContributionBuffer::Buffer::~Buffer() {
 }
 
 
-void ContributionBuffer::Buffer::Splat(Film *film, u_int tileIndex)
+void ContributionBuffer::Buffer::Splat(Film *film, u_int tileIndex,
+	u_int splatNode)
 {
 	const u_int num_contribs = min(pos, CONTRIB_BUF_SIZE);
-	film->AddTileSamples(contribs, num_contribs, tileIndex);
+	film->AddTileSamples(contribs, num_contribs, tileIndex, splatNode);
 	pos = 0;
 }
 
-ContributionBuffer::ContributionBuffer(ContributionPool *p) :
-	sampleCount(0.f), pool(p)
+ContributionBuffer::ContributionBuffer(ContributionPool *p, u_int n) :
+	sampleCount(0.f), node(min<u_int>(n, p->CFree.size() - 1)), pool(p)
 {
 	buffers.resize(pool->CFull.size());
 	for (u_int i = 0; i < buffers.size(); ++i) {
 		buffers[i].resize(pool->CFull[i].size());
 		for (u_int j = 0; j < buffers[i].size(); ++j)
-			buffers[i][j] = new Buffer();
+			buffers[i][j] = new Buffer(node);
 	}
 }
 
@@ -65,6 +66,7 @@ ContributionBuffer::~ContributionBuffer()
 }
 
 ScopedPoolLock::ScopedPoolLock(ContributionPool* pool) : lock(pool->mainSplattingMutex) {
+	pool->MergeNodeReplicas();
 }
 
 void ScopedPoolLock::unlock() {
@@ -79,14 +81,33 @@ ContributionPool::ContributionPool(Film *f) : sampleCount(0.f), film(f)
 	for (u_int i = 0; i < CFull.size(); ++i)
 		tileSplattingMutexes.push_back(new tile_mutex);
 	splattingTile.resize(CFull.size());
-	for (u_int total = 0; total < CONTRIB_BUF_KEEPALIVE; ++total) {
-		CFree.push_back(new ContributionBuffer::Buffer());
-	}
+	// A single list until threads are bound to NUMA nodes
+	CFree.resize(1);
+	for (u_int total = 0; total < CONTRIB_BUF_KEEPALIVE; ++total)
+		CFree[0].push_back(new ContributionBuffer::Buffer(0));
 }
 
 ContributionPool::~ContributionPool() {
 }
 
+void ContributionPool::SetNodeCount(u_int count)
+{
+	fast_mutex::scoped_lock poolAction(poolMutex);
+	CFree.resize(max(count, 1U));
+}
+
+void ContributionPool::MergeNodeReplicas()
+{
+	// Called with the main splatting lock held, so only the tiles
+	// being splatted right now have to be waited for
+	if (!film->HasNodeReplicas())
+		return;
+	for (u_int tileIndex = 0; tileIndex < tileSplattingMutexes.size(); ++tileIndex) {
+		tile_mutex::scoped_lock tile_splatting_lock(tileSplattingMutexes[tileIndex]);
+		film->MergeNodeReplicas(tileIndex);
+	}
+}
+
 void ContributionPool::End(ContributionBuffer *c)
 {
 	fast_mutex::scoped_lock poolAction(poolMutex);
@@ -103,7 +124,7 @@ void ContributionPool::End(ContributionBuffer *c)
 }
 
 void ContributionPool::Next(ContributionBuffer::Buffer* volatile *b, float *sc,
-	u_int tileIndex, u_int bufferGroup)
+	u_int tileIndex, u_int bufferGroup, u_int node)
 {
 	// store the current Buffer pointer for later comparison
 	ContributionBuffer::Buffer* const buf = *b;
@@ -129,18 +150,21 @@ void ContributionPool::Next(ContributionBuffer::Buffer* volatile *b, float *sc,
 	u_int isSplattingTile = osAtomicInc(&splattingTile[tileIndex]);
 	if (isSplattingTile > 0) {
 		// Another thread is splatting this tile, so
-		// get a free buffer
-		if (!CFree.empty()) {
-			*b = CFree.back();
-			CFree.pop_back();
-			return;
+		// get a free buffer, from the local node if possible
+		for (u_int i = 0; i < CFree.size(); ++i) {
+			vector<ContributionBuffer::Buffer*> &free_buffers(CFree[(node + i) % CFree.size()]);
+			if (!free_buffers.empty()) {
+				*b = free_buffers.back();
+				free_buffers.pop_back();
+				return;
+			}
 		}
 		// No free buffers, try allocating a new one
 		// but make sure we don't allocate too many new buffers.
 		const u_int maxBufferMisses = CFull.size() * 32; // TODO less arbitrary limit
 		u_int bufferMisses = ++splattingMisses;
 		if (bufferMisses < maxBufferMisses) {
-			*b = new ContributionBuffer::Buffer();
+			*b = new ContributionBuffer::Buffer(node);
 			return;
 		} 
 		if (bufferMisses > 1000000) {
@@ -183,23 +207,34 @@ void ContributionPool::Next(ContributionBuffer::Buffer* volatile *b, float *sc,
 		// release main splatting lock
 		main_splatting_lock.unlock();
 
+		// Splat in the film buffers of this thread's node
 		for(u_int i = 0; i < splat_buffers.size(); ++i)
-			splat_buffers[i]->Splat(film, tileIndex);
+			splat_buffers[i]->Splat(film, tileIndex, node);
 
 		// indicate we're done splatting this tile
 		osAtomicWrite(&splattingTile[tileIndex], 0);
 	}
 
-	// get buffer from the now free buffers
-	*b = splat_buffers.back();
+	// get buffer from the now free buffers, preferably one
+	// allocated on the local node
+	u_int local = splat_buffers.size() - 1;
+	for (u_int i = 0; i < splat_buffers.size(); ++i) {
+		if (splat_buffers[i]->GetNode() == node) {
+			local = i;
+			break;
+		}
+	}
+	*b = splat_buffers[local];
+	splat_buffers[local] = splat_buffers.back();
 	splat_buffers.pop_back();
 
 	{
 		// reaquire pool lock
 		fast_mutex::scoped_lock pool_lock_end(poolMutex);
 
-		// put splatted buffers back
-		CFree.insert(CFree.end(), splat_buffers.begin(), splat_buffers.end());
+		// put splatted buffers back to the list of their node
+		for (u_int i = 0; i < splat_buffers.size(); ++i)
+			CFree[splat_buffers[i]->GetNode()].push_back(splat_buffers[i]);
 	}
 }
 
@@ -207,10 +242,11 @@ void ContributionPool::Flush()
 {
 	for (u_int tileIndex = 0; tileIndex < CFull.size(); ++tileIndex) {
 		for (u_int j = 0; j < CFull[tileIndex].size(); ++j) {
-			for (u_int k = 0; k < CFull[tileIndex][j].size(); ++k)
-				CFull[tileIndex][j][k]->Splat(film, tileIndex);
-			CFree.insert(CFree.end(),
-				CFull[tileIndex][j].begin(), CFull[tileIndex][j].end());
+			for (u_int k = 0; k < CFull[tileIndex][j].size(); ++k) {
+				ContributionBuffer::Buffer *buffer = CFull[tileIndex][j][k];
+				buffer->Splat(film, tileIndex);
+				CFree[buffer->GetNode()].push_back(buffer);
+			}
 			CFull[tileIndex][j].clear();
 		}
 	}
@@ -220,8 +256,11 @@ void ContributionPool::Delete()
 {
 	Flush();
 	// At this point CFull doesn't hold any buffer
-	for(u_int i = 0; i < CFree.size(); ++i)
-		delete CFree[i];
+	for (u_int node = 0; node < CFree.size(); ++node) {
+		for(u_int i = 0; i < CFree[node].size(); ++i)
+			delete CFree[node][i];
+		CFree[node].clear();
+	}
 }
 
 u_int ContributionPool::GetFilmTileIndexes(const Contribution &contrib, u_int *tileIndex0, u_int *tileIndex1) const {
@@ -69,9 +69,12 @@ class ContributionBuffer {
 	friend class ContributionPool;
 	class Buffer {
 	public:
-		Buffer();
+		Buffer(u_int n = 0);
 		~Buffer();
 
+		// NUMA node of the thread that allocated the buffer
+		u_int GetNode() const { return node; }
+
 		// Thread-safe way of adding a contribution to a buffer
 		// Returns false if the buffer is full
 		bool Add(const Contribution &c, float weight) {
@@ -87,14 +90,19 @@ class ContributionBuffer {
 			return true;
 		}
 
-		void Splat(Film *film, u_int tileIndex);
+		// Adds the contributions to the film, in the buffers of the
+		// NUMA node of the calling thread when the film replicates them
+		void Splat(Film *film, u_int tileIndex, u_int splatNode = 0);
 
 	private:
 		u_int pos;
+		u_int node;
 		Contribution *contribs;
 	};
 public:
-	ContributionBuffer(ContributionPool *p);
+	// The buffers are allocated by the calling thread, which should run
+	// on the given NUMA node so that they end up in its local memory
+	ContributionBuffer(ContributionPool *p, u_int n = 0);
 
 	~ContributionBuffer();
 
@@ -106,12 +114,15 @@ public:
 
 private:
 	float sampleCount;
+	u_int node;
 	vector<vector<Buffer *> > buffers;
 	ContributionPool *pool;
 };
 
 class ScopedPoolLock : public boost::noncopyable {
 public:
+	// Also merges the per NUMA node film buffers into the film ones,
+	// so that the lock holder sees every splatted contribution
 	ScopedPoolLock(ContributionPool* pool);
 
 	void unlock();
@@ -128,6 +139,13 @@ public:
 	ContributionPool(Film *f);
 	~ContributionPool();
 
+	/*
+	 * Keeps the free Buffers in one list per NUMA node, must be called
+	 * before any ContributionBuffer is created. The lists of the nodes
+	 * are filled by the threads of each node as they allocate Buffers.
+	 */
+	void SetNodeCount(u_int count);
+
 	void End(ContributionBuffer *c);
 
 	/*
@@ -147,9 +165,12 @@ public:
 	 * accumulated to in the Film.
 	 *
 	 * @param bufferGroup The buffer group that the contributions in the Buffer belongs to.
+	 *
+	 * @param node NUMA node of the calling thread, the empty Buffer is taken from
+	 * the Buffers allocated on this node when possible.
 	 */
 	void Next(ContributionBuffer::Buffer* volatile *b, float *sc, u_int tileIndex,
-		u_int bufferGroup);
+		u_int bufferGroup, u_int node);
 
 	// Flush() and Delete() are not thread safe,
 	// they can only be called by Scene after rendering is finished.
@@ -170,11 +191,15 @@ public:
 	u_int GetFilmTileIndexes(const Contribution &contrib, u_int *tileIndex0, u_int *tileIndex1) const;
 
 private:
+	// Adds the per node film buffers to the film ones, tile by tile
+	// under the tile splatting locks
+	void MergeNodeReplicas();
+
 	typedef boost::mutex tile_mutex;
 	//typedef fast_mutex tile_mutex;
 
 	float sampleCount;
-	vector<ContributionBuffer::Buffer*> CFree; // Emptied/available buffers
+	vector<vector<ContributionBuffer::Buffer*> > CFree; // Emptied/available buffers per NUMA node
 	vector<vector<vector<ContributionBuffer::Buffer*> > > CFull; // Full buffers
 	vector<u_int> splattingTile;
 	u_int splattingMisses;
@@ -204,7 +229,7 @@ inline void ContributionBuffer::Add(const Contribution &c, float weight)
 			// Get an empty buffer from the pool.
 			// Next() will reset sampleCount if current thread 
 			// swaps buffers.
-			pool->Next(buf, &sampleCount, tileIndex0, c.bufferGroup);
+			pool->Next(buf, &sampleCount, tileIndex0, c.bufferGroup, node);
 			// Another thread may have swapped buf before we managed to.
 			// Technically there's a chance we waited so long for the lock
 			// in Next() that the buffer we got back has already been filled
@@ -216,7 +241,7 @@ inline void ContributionBuffer::Add(const Contribution &c, float weight)
 		Buffer* volatile* const buf = &(buffers[tileIndex1][c.bufferGroup]);
 		u_int i = 0;
 		while (!((*buf)->Add(c, weight)) && (i++ < 10)) {
-			pool->Next(buf, &sampleCount, tileIndex1, c.bufferGroup);
+			pool->Next(buf, &sampleCount, tileIndex1, c.bufferGroup, node);
 		}
 	}
 
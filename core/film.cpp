@@ -33,9 +33,11 @@
 #include "osfunc.h"
 #include "streamio.h"
 #include "exrio.h"
+#include "tracer.h"
 
 #include <algorithm>
 #include <fstream>
+#include <xmmintrin.h>
 
 #include <boost/filesystem.hpp>
 #include <boost/iostreams/copy.hpp>
@@ -44,6 +46,7 @@
 #include <boost/lexical_cast.hpp>
 #include <boost/thread.hpp>
 #include <boost/math/special_functions/bessel.hpp>
+#include <boost/static_assert.hpp>
 
 #define cimg_display_type  0
 
@@ -587,25 +590,31 @@ void ApplyImagingPipeline(vector<XYZColor> &xyzpixels, u_int xResolution, u_int
 		}
 	}
 
-	// Apply tone reproduction to image
+	// Compute the tone reproduction from the whole image
+	ToneMapScale toneMapScale;
 	if (toneMapName) {
 		ToneMap *toneMap = MakeToneMap(toneMapName,
 			toneMapParams ? *toneMapParams : ParamSet());
 		if (toneMap)
-			toneMap->Map(xyzpixels, xResolution, yResolution, 100.f);
+			toneMapScale = toneMap->GetScale(xyzpixels, xResolution,
+				yResolution, 100.f);
 		delete toneMap;
 	}
 
-	// Convert to RGB
+	// Apply tone reproduction, convert to RGB and apply the camera
+	// response in a single pass over the image
 	vector<RGBColor> &rgbpixels = reinterpret_cast<vector<RGBColor> &>(xyzpixels);
-	for (u_int i = 0; i < nPix; ++i)
-		rgbpixels[i] = colorSpace.ToRGBConstrained(xyzpixels[i]);
+	const CameraResponse *crf = response && response->validFile ?
+		response : NULL;
+	for (u_int i = 0; i < nPix; ++i) {
+		XYZColor xyz(xyzpixels[i]);
+		xyz *= toneMapScale(xyz.c[1]);
+		rgbpixels[i] = colorSpace.ToRGBConstrained(xyz);
+		if (crf)
+			crf->Map(rgbpixels[i]);
+	}
 
 	// DO NOT USE xyzpixels ANYMORE AFTER THIS POINT
-	if (response && response->validFile) {
-		for (u_int i = 0; i < nPix; ++i)
-			response->Map(rgbpixels[i]);
-	}
 
 	// Add vignetting & chromatic aberration effect
 	// These are paired in 1 loop as they can share quite a few calculations
@@ -816,21 +825,22 @@ FilterLUTs::FilterLUTs(Filter *filter, const unsigned int size) {
 // OutlierData Definitions
 ColorSystem OutlierData::cs(0.63f, 0.34f, 0.31f, 0.595f, 0.155f, 0.07f, 0.314275f, 0.329411f);
 
-void BufferGroup::CreateBuffers(const vector<BufferConfig> &configs, u_int x, u_int y) {
+void BufferGroup::CreateBuffers(const vector<BufferConfig> &configs, u_int x, u_int y,
+	bool sparse) {
 	for(vector<BufferConfig>::const_iterator config = configs.begin(); config != configs.end(); ++config) {
 		Buffer *buffer;
 		switch ((*config).type) {
 		case BUF_TYPE_PER_PIXEL:
-			buffer = new PerPixelNormalizedBuffer(x, y);
+			buffer = new PerPixelNormalizedBuffer(x, y, sparse);
 			break;
 		case BUF_TYPE_PER_SCREEN:
-			buffer = new PerScreenNormalizedBuffer(x, y, &numberOfSamples);
+			buffer = new PerScreenNormalizedBuffer(x, y, &numberOfSamples, sparse);
 			break;
 		case BUF_TYPE_PER_SCREEN_SCALED:
-			buffer = new PerScreenNormalizedBufferScaled(x, y, &numberOfSamples);
+			buffer = new PerScreenNormalizedBufferScaled(x, y, &numberOfSamples, sparse);
 			break;
 		case BUF_TYPE_RAW:
-			buffer = new RawBuffer(x, y);
+			buffer = new RawBuffer(x, y, sparse);
 			break;
 		default:
 			buffer = NULL;
@@ -881,7 +891,8 @@ Film::Film(u_int xres, u_int yres, Filter *filt, u_int filtRes, const float crop
 		   const string &filename1, bool premult, bool useZbuffer,
 		   bool w_resume_FLM, bool restart_resume_FLM, bool write_FLM_direct,
 		   int haltspp, int halttime, float haltthreshold,
-		   bool debugmode, int outlierk, int tilec, const string &samplingmapfilename) :
+		   bool debugmode, int outlierk, int tilec, const string &samplingmapfilename,
+		   bool sparsebuffers, u_int outliercellcapacity) :
 	Queryable("film"),
 	xResolution(xres), yResolution(yres),
 	EV(0.f), averageLuminance(0.f),
@@ -892,10 +903,11 @@ Film::Film(u_int xres, u_int yres, Filter *filt, u_int filtRes, const float crop
 	convTest(NULL), varianceBuffer(NULL),
 	noiseAwareMap(NULL), noiseAwareMapVersion(0),
 	userSamplingMapFileName(samplingmapfilename), userSamplingMap(NULL), userSamplingMapVersion(0),
-	ZBuffer(NULL), use_Zbuf(useZbuffer),
+	ZBuffer(NULL), use_Zbuf(useZbuffer), sparseBuffers(sparsebuffers),
 	debug_mode(debugmode), premultiplyAlpha(premult),
 	writeResumeFlm(w_resume_FLM), restartResumeFlm(restart_resume_FLM), writeFlmDirect(write_FLM_direct),
-	outlierRejection_k(outlierk), haltSamplesPerPixel(haltspp),
+	outlierRejection_k(outlierk), outlierCellCapacity(outliercellcapacity),
+	haltSamplesPerPixel(haltspp),
 	haltTime(halttime), haltThreshold(haltthreshold), haltThresholdComplete(0.f),
 	histogram(NULL), enoughSamplesPerPixel(false)
 {
@@ -972,7 +984,31 @@ Film::Film(u_int xres, u_int yres, Filter *filt, u_int filtRes, const float crop
 	tileOffset = -0.5f - filter->yWidth - yPixelStart;
 	tileOffset2 = 2 * filter->yWidth * invTileHeight;
 
-	if (outlierRejection_k > 0) {
+	if (outlierRejection_k > 0 && outlierCellCapacity > 0) {
+		if (outlierRejection_k > MAX_OUTLIER_K) {
+			LOG(LUX_WARNING, LUX_BADTOKEN) << "Outlier rejection k too large for bounded cells, using " << MAX_OUTLIER_K;
+			outlierRejection_k = MAX_OUTLIER_K;
+		}
+		const u_int outliers_width = xRealWidth / outlierCellWidth;
+		const u_int outliers_height = yRealHeight / outlierCellHeight;
+		// tiles need duplicate data for row above and below tile
+		const u_int rowCount = outliers_height + 2 * tileCount;
+		const u_int cellSize = OutlierCell::dimensions * outlierCellCapacity;
+		outlierCellStorage.resize(static_cast<size_t>(rowCount) * outliers_width * cellSize);
+		LOG(LUX_INFO, LUX_NOERROR) << "Outlier rejection memory: " <<
+			(outlierCellStorage.size() * sizeof(float)) / (1024 * 1024) << "MBytes";
+
+		float *storage = outlierCellStorage.empty() ? NULL : &outlierCellStorage[0];
+		outlierCells.resize(outliers_height);
+		tileborder_outlierCells.resize(2 * tileCount);
+		for (u_int i = 0; i < rowCount; ++i) {
+			std::vector<OutlierCell> &row(i < outliers_height ?
+				outlierCells[i] : tileborder_outlierCells[i - outliers_height]);
+			row.resize(outliers_width);
+			for (u_int j = 0; j < outliers_width; ++j, storage += cellSize)
+				row[j].Init(storage, outlierCellCapacity);
+		}
+	} else if (outlierRejection_k > 0) {
 		const u_int outliers_width = xRealWidth / outlierCellWidth;
 		const u_int outliers_height = yRealHeight / outlierCellHeight;
 		outliers.resize(outliers_height);
@@ -1032,6 +1068,12 @@ Film::~Film()
 	delete varianceBuffer;
 	delete histogram;
 	delete contribPool;
+	for (u_int n = 0; n < nodeReplicas.size(); ++n) {
+		for (u_int i = 0; i < nodeReplicas[n].size(); ++i) {
+			for (u_int j = 0; j < nodeReplicas[n][i].size(); ++j)
+				delete nodeReplicas[n][i][j];
+		}
+	}
 }
 
 void Film::EnableNoiseAwareMap() {
@@ -1060,7 +1102,7 @@ void Film::CreateBuffers()
 	if (bufferGroups.size() == 0)
 		bufferGroups.push_back(BufferGroup("default"));
 	for (u_int i = 0; i < bufferGroups.size(); ++i)
-		bufferGroups[i].CreateBuffers(bufferConfigs, xPixelCount, yPixelCount);
+		bufferGroups[i].CreateBuffers(bufferConfigs, xPixelCount, yPixelCount, sparseBuffers);
 
 	// Allocate ZBuf buffer if needed
 	if (use_Zbuf)
@@ -1128,6 +1170,67 @@ void Film::ClearBuffers()
 
 		bufferGroup.numberOfSamples = 0;
 	}
+
+	for (u_int n = 0; n < nodeReplicas.size(); ++n) {
+		for (u_int i = 0; i < nodeReplicas[n].size(); ++i) {
+			for (u_int j = 0; j < nodeReplicas[n][i].size(); ++j)
+				nodeReplicas[n][i][j]->Clear();
+		}
+	}
+}
+
+void Film::CreateNodeReplicas(u_int nodeCount)
+{
+	if (nodeCount < 2 || !nodeReplicas.empty())
+		return;
+
+	// The replicas are sparse so that their blocks are allocated by the
+	// first thread splatting in them, i.e. in the memory of its node
+	nodeReplicas.resize(nodeCount - 1);
+	for (u_int n = 0; n < nodeReplicas.size(); ++n) {
+		nodeReplicas[n].resize(bufferGroups.size());
+		for (u_int i = 0; i < bufferGroups.size(); ++i) {
+			for (u_int j = 0; j < bufferConfigs.size(); ++j)
+				nodeReplicas[n][i].push_back(new RawBuffer(xPixelCount, yPixelCount, true));
+		}
+	}
+	contribPool->SetNodeCount(nodeCount);
+
+	LOG(LUX_DEBUG, LUX_NOERROR) << "Film color buffers replicated on " << nodeCount << " NUMA nodes";
+}
+
+void Film::MergeNodeReplicas(u_int tileIndex)
+{
+	int xTilePixelStart, xTilePixelEnd;
+	int yTilePixelStart, yTilePixelEnd;
+	GetTileExtent(tileIndex, &xTilePixelStart, &xTilePixelEnd, &yTilePixelStart, &yTilePixelEnd);
+	const u_int yStart = yTilePixelStart - yPixelStart;
+	const u_int yEnd = yTilePixelEnd - yPixelStart;
+
+	for (u_int n = 0; n < nodeReplicas.size(); ++n) {
+		for (u_int i = 0; i < nodeReplicas[n].size(); ++i) {
+			for (u_int j = 0; j < nodeReplicas[n][i].size(); ++j) {
+				Buffer *replica = nodeReplicas[n][i][j];
+				const Buffer *constReplica = replica;
+				Buffer *buffer = bufferGroups[i].getBuffer(j);
+				for (u_int y = yStart; y < yEnd; ++y) {
+					for (u_int x = 0; x < xPixelCount; ++x) {
+						// Reading through the const accessor doesn't
+						// allocate the blocks nothing was splatted in
+						const Pixel &pixel = constReplica->pixels(x, y);
+						if (pixel.weightSum == 0.f && pixel.alpha == 0.f &&
+							pixel.L.Black())
+							continue;
+						Pixel &target = buffer->pixels(x, y);
+						target.L += pixel.L;
+						target.alpha += pixel.alpha;
+						target.weightSum += pixel.weightSum;
+						replica->pixels(x, y) = Pixel();
+					}
+				}
+			}
+		}
+	}
 }
 
 void Film::SetGroupName(u_int index, const string& name) 
@@ -1283,6 +1386,11 @@ std::vector<Film::OutlierAccel>& Film::GetOutlierAccelRow(u_int oY, u_int tileIn
 
 void Film::RejectTileOutliers(const Contribution &contrib, u_int tileIndex, int yTilePixelStart, int yTilePixelEnd)
 {
+	if (outlierCellCapacity > 0) {
+		RejectTileOutliersBounded(contrib, tileIndex, yTilePixelStart, yTilePixelEnd);
+		return;
+	}
+
 	// outlier rejection
 	const float fnormTileStart = (yTilePixelStart + filter->yWidth) * outlierInvCellHeight;
 	const float fnormTileEnd   = (yTilePixelEnd   + filter->yWidth) * outlierInvCellHeight;
@@ -1350,6 +1458,119 @@ void Film::RejectTileOutliers(const Contribution &contrib, u_int tileIndex, int
 	// not an outlier, splat
 }
 
+u_int OutlierCell::Lookup(const OutlierData::Point_t &p, u_int k, float *dist2) const
+{
+	u_int found = 0;
+	// Like NearSetPointProcess, the search radius shrinks to the farthest
+	// kept point after every insertion, even before k points are found,
+	// so the result depends on the scan order as with the BSH lookup
+	float maxDist2 = INFINITY;
+
+	// Test 4 points at a time, the remainder is done one by one
+	__m128 q[dimensions];
+	for (u_int d = 0; d < dimensions; ++d)
+		q[d] = _mm_set1_ps(p.x[d]);
+	u_int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128 d2 = _mm_setzero_ps();
+		for (u_int d = 0; d < dimensions; ++d) {
+			const __m128 delta = _mm_sub_ps(_mm_loadu_ps(data + d * capacity + i), q[d]);
+			d2 = _mm_add_ps(d2, _mm_mul_ps(delta, delta));
+		}
+		if (!_mm_movemask_ps(_mm_cmplt_ps(d2, _mm_set1_ps(maxDist2))))
+			continue;
+
+		float dists[4];
+		_mm_storeu_ps(dists, d2);
+		for (u_int j = 0; j < 4; ++j) {
+			if (!(dists[j] < maxDist2))
+				continue;
+			if (found == k)
+				std::pop_heap(dist2, dist2 + found--);
+			dist2[found++] = dists[j];
+			std::push_heap(dist2, dist2 + found);
+			maxDist2 = dist2[0];
+		}
+	}
+	for (; i < count; ++i) {
+		float d2 = 0.f;
+		for (u_int d = 0; d < dimensions; ++d) {
+			const float delta = data[d * capacity + i] - p.x[d];
+			d2 += delta * delta;
+		}
+		if (!(d2 < maxDist2))
+			continue;
+		if (found == k)
+			std::pop_heap(dist2, dist2 + found--);
+		dist2[found++] = d2;
+		std::push_heap(dist2, dist2 + found);
+		maxDist2 = dist2[0];
+	}
+
+	return found;
+}
+
+std::vector<OutlierCell>& Film::GetOutlierCellRow(u_int oY, u_int tileIndex, u_int tileStart, u_int tileEnd)
+{
+	if (oY < tileStart) {
+		// above currrent tile
+		return tileborder_outlierCells[2 * tileIndex];
+	} else if (oY >= tileEnd) {
+		// below current tile
+		return tileborder_outlierCells[2 * tileIndex + 1];
+	}
+
+	// inside current tile
+	return outlierCells[oY];
+}
+
+// Same as RejectTileOutliers but with fixed capacity cells, the search
+// doesn't allocate and the memory used doesn't grow during the render
+void Film::RejectTileOutliersBounded(const Contribution &contrib, u_int tileIndex, int yTilePixelStart, int yTilePixelEnd)
+{
+	const int rowCount = static_cast<int>(outlierCells.size());
+	const float fnormTileStart = (yTilePixelStart + filter->yWidth) * outlierInvCellHeight;
+	const float fnormTileEnd   = (yTilePixelEnd   + filter->yWidth) * outlierInvCellHeight;
+
+	const u_int tileStart = static_cast<u_int>(max(0, min(Floor2Int(fnormTileStart), rowCount - 1)));
+	const u_int tileEnd =   static_cast<u_int>(max(0, min(Floor2Int(fnormTileEnd),   rowCount - 1)));
+
+	// filter-normalized pixel coordinates
+	const float fnormX = (contrib.imageX - 0.5f + filter->xWidth) * outlierInvCellWidth;
+	const float fnormY = (contrib.imageY - 0.5f + filter->yWidth) * outlierInvCellHeight;
+
+	OutlierData sd(fnormX, fnormY, contrib.color);
+
+	const int oY = max(0, min(Floor2Int(fnormY), rowCount - 1));
+	std::vector<OutlierCell> &cellRow = GetOutlierCellRow(oY, tileIndex, tileStart, tileEnd);
+	const int oX = max(0, min(Floor2Int(fnormX), static_cast<int>(cellRow.size() - 1)));
+
+	float closest[MAX_OUTLIER_K];
+	const u_int foundPoints = cellRow[oX].Lookup(sd.p, outlierRejection_k, closest);
+
+	float kmeandist = 0.f;
+	for (u_int i = 0; i < foundPoints; ++i)
+		kmeandist += closest[i];
+
+	if (foundPoints < 1 || kmeandist > foundPoints) {
+		// add outlier to the surrounding cells too so only
+		// one cell has to be searched for each lookup
+		const u_int oLeft = static_cast<u_int>(max(0, oX - 1));
+		const u_int oRight = static_cast<u_int>(min(static_cast<int>(outlierCells[0].size() - 1), oX + 1));
+		const u_int oTop = static_cast<u_int>(max(0, oY - 1));
+		const u_int oBottom = static_cast<u_int>(min(rowCount - 1, oY + 1));
+
+		for (u_int i = oTop; i <= oBottom; ++i) {
+			std::vector<OutlierCell> &row = GetOutlierCellRow(i, tileIndex, tileStart, tileEnd);
+			for (u_int j = oLeft; j <= oRight; ++j)
+				row[j].AddNode(sd.p);
+		}
+		// outlier, reject
+		contrib.variance = -1.f;
+	}
+	// not an outlier, splat
+}
+
 u_int Film::GetTileCount() const {
 	return tileCount;
 }
@@ -1375,8 +1596,57 @@ void Film::GetTileExtent(u_int tileIndex, int *xstart, int *xend, int *ystart, i
 	*yend = yPixelStart + min((tileIndex+1) * tileHeight, yPixelCount);
 }
 
+// The color and the alpha of a pixel are updated with a single SSE operation
+BOOST_STATIC_ASSERT(sizeof(Pixel) == 5 * sizeof(float));
+
+// Splats a sample over the filter footprint clipped to [xStart, xEnd) x
+// [yStart, yEnd), the z-buffer and variance updates are selected at
+// compile time instead of being tested for each pixel.
+// Pixels of a buffer row are contiguous within a block, so each row is
+// walked in runs of contiguous pixels.
+template <bool addZ, bool addVariance>
+static void SplatFilteredSample(Buffer *buffer,
+	PerPixelNormalizedFloatBuffer *zBuffer, VarianceBuffer *varianceBuffer,
+	const float *lut, u_int lutWidth, int x0, int y0,
+	u_int xStart, u_int xEnd, u_int yStart, u_int yEnd,
+	u_int xPixelStart, u_int yPixelStart,
+	const XYZColor &xyz, float alpha, float weight, float zdepth)
+{
+	const __m128 sample = _mm_setr_ps(xyz.c[0], xyz.c[1], xyz.c[2], alpha);
+	const u_int blockSize = buffer->pixels.BlockSize();
+
+	for (u_int y = yStart; y < yEnd; ++y) {
+		const int lutOffset = static_cast<int>((y - y0) * lutWidth) - x0;
+		const u_int yPixel = y - yPixelStart;
+		for (u_int x = xStart; x < xEnd;) {
+			const u_int xPixel = x - xPixelStart;
+			const u_int runEnd = min(xEnd,
+				x + blockSize - (xPixel & (blockSize - 1)));
+			Pixel *pixel = &(buffer->pixels(xPixel, yPixel));
+			for (; x < runEnd; ++x, ++pixel) {
+				// Evaluate filter value at $(x,y)$ pixel
+				const float w = lut[lutOffset + static_cast<int>(x)] * weight;
+
+				// Update pixel values with filtered sample contribution
+				float *L = &(pixel->L.c[0]);
+				_mm_storeu_ps(L, _mm_add_ps(_mm_loadu_ps(L),
+					_mm_mul_ps(_mm_set1_ps(w), sample)));
+				pixel->weightSum += w;
+
+				// Update ZBuffer values with filtered zdepth contribution
+				if (addZ)
+					zBuffer->Add(x - xPixelStart, yPixel, zdepth, 1.0f);
+
+				// Update variance information
+				if (addVariance)
+					varianceBuffer->Add(x - xPixelStart, yPixel, xyz, w);
+			}
+		}
+	}
+}
+
 void Film::AddTileSamples(const Contribution* const contribs, u_int num_contribs,
-		u_int tileIndex) {
+		u_int tileIndex, u_int node) {
 	int xTilePixelStart, xTilePixelEnd;
 	int yTilePixelStart, yTilePixelEnd;
 	GetTileExtent(tileIndex, &xTilePixelStart, &xTilePixelEnd, &yTilePixelStart, &yTilePixelEnd);
@@ -1423,8 +1693,10 @@ void Film::AddTileSamples(const Contribution* const contribs, u_int num_contribs
 		if (premultiplyAlpha)
 			xyz *= alpha;
 
-		BufferGroup &currentGroup = bufferGroups[contrib.bufferGroup];
-		Buffer *buffer = currentGroup.getBuffer(contrib.buffer);
+		// Node 0 and the nodes without replica use the film buffers
+		Buffer *buffer = (node > 0 && node <= nodeReplicas.size()) ?
+			nodeReplicas[node - 1][contrib.bufferGroup][contrib.buffer] :
+			bufferGroups[contrib.bufferGroup].getBuffer(contrib.buffer);
 
 		// Compute sample's raster extent
 		float dImageX = contrib.imageX - 0.5f;
@@ -1447,27 +1719,25 @@ void Film::AddTileSamples(const Contribution* const contribs, u_int num_contribs
 		const u_int xEnd = static_cast<u_int>(min(x1, xTilePixelEnd));
 		const u_int yEnd = static_cast<u_int>(min(y1, yTilePixelEnd));
 
-		for (u_int y = yStart; y < yEnd; ++y) {
-			const int yoffset = (y - y0) * filterLUT.GetWidth();
-			const u_int yPixel = y - yPixelStart;
-			for (u_int x = xStart; x < xEnd; ++x) {
-				// Evaluate filter value at $(x,y)$ pixel
-				const int xoffset = x-x0;
-				const float filterWt = lut[yoffset + xoffset];
-
-				// Update pixel values with filtered sample contribution
-				const u_int xPixel = x - xPixelStart;
-				const float w = filterWt * weight;
-				buffer->Add(xPixel, yPixel, xyz, alpha, w);
-
-				// Update ZBuffer values with filtered zdepth contribution
-				if(use_Zbuf && contrib.zdepth != 0.f)
-					ZBuffer->Add(xPixel, yPixel, contrib.zdepth, 1.0f);
-
-				// Update variance information
-				if (varianceBuffer)
-					varianceBuffer->Add(xPixel, yPixel, xyz, w);
-			}
+		const bool addZ = use_Zbuf && contrib.zdepth != 0.f;
+		if (addZ) {
+			if (varianceBuffer)
+				SplatFilteredSample<true, true>(buffer, ZBuffer, varianceBuffer,
+					lut, filterLUT.GetWidth(), x0, y0, xStart, xEnd, yStart, yEnd,
+					xPixelStart, yPixelStart, xyz, alpha, weight, contrib.zdepth);
+			else
+				SplatFilteredSample<true, false>(buffer, ZBuffer, varianceBuffer,
+					lut, filterLUT.GetWidth(), x0, y0, xStart, xEnd, yStart, yEnd,
+					xPixelStart, yPixelStart, xyz, alpha, weight, contrib.zdepth);
+		} else {
+			if (varianceBuffer)
+				SplatFilteredSample<false, true>(buffer, ZBuffer, varianceBuffer,
+					lut, filterLUT.GetWidth(), x0, y0, xStart, xEnd, yStart, yEnd,
+					xPixelStart, yPixelStart, xyz, alpha, weight, contrib.zdepth);
+			else
+				SplatFilteredSample<false, false>(buffer, ZBuffer, varianceBuffer,
+					lut, filterLUT.GetWidth(), x0, y0, xStart, xEnd, yStart, yEnd,
+					xPixelStart, yPixelStart, xyz, alpha, weight, contrib.zdepth);
 		}
 	}
 }
@@ -1976,6 +2246,7 @@ bool Film::WriteFilmToStream(
 		bool transmitParams,
 		bool directWrite)
 {
+	TraceSpan span(TRACE_FILM_WRITE, "flm");
 	bool writeSuccess;
 
 	if (!directWrite) {
@@ -2018,6 +2289,7 @@ double Film::MergeFilmFromFile(const std::string& filename)
 }
 
 double Film::MergeFilmFromStream(std::basic_istream<char> &stream) {
+	TraceSpan span(TRACE_FILM_MERGE);
 	const bool isLittleEndian = osIsLittleEndian();
 	LOG(LUX_DEBUG, LUX_NOERROR) << "Receiving film (little endian=" << boost::lexical_cast<std::string>(isLittleEndian) << ")";
 
@@ -2091,6 +2363,10 @@ double Film::MergeFilmFromStream(std::basic_istream<char> &stream) {
 				for (u_int y = 0; y < buffer->yPixelCount; ++y) {
 					for (u_int x = 0; x < buffer->xPixelCount; ++x) {
 						const Pixel &pixel = (*receivedPixels)(x, y);
+						// Keep unused parts of sparse buffers unallocated
+						if (pixel.weightSum == 0.f && pixel.alpha == 0.f &&
+							pixel.L.c[0] == 0.f && pixel.L.c[1] == 0.f && pixel.L.c[2] == 0.f)
+							continue;
 						Pixel &pixelResult = buffer->pixels(x, y);
 						pixelResult.L.c[0] += pixel.L.c[0];
 						pixelResult.L.c[1] += pixel.L.c[1];
@@ -2121,6 +2397,58 @@ double Film::MergeFilmFromStream(std::basic_istream<char> &stream) {
 	return maxTotNumberOfSamples;
 }
 
+bool Film::HasSameLayout(const Film &film) const {
+	return film.xPixelCount == xPixelCount &&
+		film.yPixelCount == yPixelCount &&
+		film.bufferGroups.size() == bufferGroups.size() &&
+		film.bufferConfigs.size() == bufferConfigs.size();
+}
+
+double Film::MergeFilm(const Film &film) {
+	if (!HasSameLayout(film)) {
+		LOG(LUX_ERROR, LUX_CONSISTENCY) << "Unable to merge films with different resolution or buffer layout";
+		return 0.;
+	}
+
+	// lock the pool
+	ScopedPoolLock poolLock(contribPool);
+
+	double maxTotNumberOfSamples = 0.;
+	for (u_int i = 0; i < bufferGroups.size(); ++i) {
+		BufferGroup &currentGroup = bufferGroups[i];
+		const BufferGroup &otherGroup = film.bufferGroups[i];
+		for (u_int j = 0; j < bufferConfigs.size(); ++j) {
+			const Buffer *otherBuffer = otherGroup.getBuffer(j);
+			Buffer *buffer = currentGroup.getBuffer(j);
+
+			for (u_int y = 0; y < buffer->yPixelCount; ++y) {
+				for (u_int x = 0; x < buffer->xPixelCount; ++x) {
+					const Pixel &pixel = otherBuffer->pixels(x, y);
+					// Keep unused parts of sparse buffers unallocated
+					if (pixel.weightSum == 0.f && pixel.alpha == 0.f &&
+						pixel.L.c[0] == 0.f && pixel.L.c[1] == 0.f && pixel.L.c[2] == 0.f)
+						continue;
+					Pixel &pixelResult = buffer->pixels(x, y);
+					pixelResult.L.c[0] += pixel.L.c[0];
+					pixelResult.L.c[1] += pixel.L.c[1];
+					pixelResult.L.c[2] += pixel.L.c[2];
+					pixelResult.alpha += pixel.alpha;
+					pixelResult.weightSum += pixel.weightSum;
+				}
+			}
+		}
+
+		currentGroup.numberOfSamples += otherGroup.numberOfSamples;
+		// Check if we have enough samples per pixel
+		if ((haltSamplesPerPixel > 0) &&
+			(currentGroup.numberOfSamples >= haltSamplesPerPixel * samplePerPass))
+			enoughSamplesPerPixel = true;
+		maxTotNumberOfSamples = max(maxTotNumberOfSamples, otherGroup.numberOfSamples);
+	}
+
+	return maxTotNumberOfSamples;
+}
+
 bool Film::WriteFilmDataToStream(
 		std::basic_ostream<char> &os,
 		bool clearBuffers,
@@ -2246,7 +2574,8 @@ bool Film::WriteFilmDataToStream(
 			Buffer* buffer = bufferGroup.getBuffer(j);
 
 			// Write pixels
-			const BlockedArray<Pixel>* pixelBuf = &(buffer->pixels);
+			// Unallocated parts of sparse buffers are written as black
+			const SparseBlockedArray<Pixel>* pixelBuf = &(buffer->pixels);
 			for (u_int y = 0; y < pixelBuf->vSize(); ++y) {
 				for (u_int x = 0; x < pixelBuf->uSize(); ++x) {
 					const Pixel &pixel = (*pixelBuf)(x, y);
@@ -105,7 +105,9 @@ struct FloatPixel {
 
 class Buffer {
 public:
-	Buffer(u_int x, u_int y) : pixels(x, y) {
+	// In sparse mode, the pixels are allocated by blocks the first time a
+	// sample is added to them, unused blocks read as black
+	Buffer(u_int x, u_int y, bool sparse) : pixels(x, y, sparse) {
 		xPixelCount = pixels.uSize();
 		yPixelCount = pixels.vSize();
 	}
@@ -127,22 +129,13 @@ public:
 	}
 
 	void Clear() {
-		for (u_int y = 0, offset = 0; y < yPixelCount; ++y) {
-			for (u_int x = 0; x < xPixelCount; ++x, ++offset) {
-				Pixel &pixel = pixels(x, y);
-				pixel.L.c[0] = 0.0f;
-				pixel.L.c[1] = 0.0f;
-				pixel.L.c[2] = 0.0f;
-				pixel.alpha = 0.0f;
-				pixel.weightSum = 0.0f;
-			}
-		}
+		pixels.Clear();
 	}
 
 	virtual void GetData(XYZColor *color, float *alpha) const = 0;
 	virtual float GetData(u_int x, u_int y, XYZColor *color, float *alpha) const = 0;
 	u_int xPixelCount, yPixelCount;
-	BlockedArray<Pixel> pixels;
+	SparseBlockedArray<Pixel> pixels;
 	float scaleFactor;
 	bool isFramebuffer;
 };
@@ -150,7 +143,7 @@ public:
 // Per pixel normalized buffer
 class RawBuffer : public Buffer {
 public:
-	RawBuffer(u_int x, u_int y) : Buffer(x, y) { }
+	RawBuffer(u_int x, u_int y, bool sparse = false) : Buffer(x, y, sparse) { }
 
 	virtual ~RawBuffer() { }
 
@@ -174,7 +167,8 @@ public:
 // Per pixel normalized XYZColor buffer
 class PerPixelNormalizedBuffer : public Buffer {
 public:
-	PerPixelNormalizedBuffer(u_int x, u_int y) : Buffer(x, y) { }
+	PerPixelNormalizedBuffer(u_int x, u_int y, bool sparse = false) :
+		Buffer(x, y, sparse) { }
 
 	virtual ~PerPixelNormalizedBuffer() { }
 
@@ -254,8 +248,9 @@ public:
 // Per screen normalized XYZColor buffer
 class PerScreenNormalizedBuffer : public Buffer {
 public:
-	PerScreenNormalizedBuffer(u_int x, u_int y, const double *samples) :
-		Buffer(x, y), numberOfSamples_(samples) { }
+	PerScreenNormalizedBuffer(u_int x, u_int y, const double *samples,
+		bool sparse = false) :
+		Buffer(x, y, sparse), numberOfSamples_(samples) { }
 
 	virtual ~PerScreenNormalizedBuffer() { }
 
@@ -293,8 +288,9 @@ private:
 // TODO scale is initialized to 1.0 but this is not correct for AMC
 class PerScreenNormalizedBufferScaled : public Buffer {
 public:
-	PerScreenNormalizedBufferScaled(u_int x, u_int y, const double *samples) :
-		Buffer(x, y), numberOfSamples_(samples), scaleUpdate(NULL), scale(1.0) { }
+	PerScreenNormalizedBufferScaled(u_int x, u_int y, const double *samples,
+		bool sparse = false) :
+		Buffer(x, y, sparse), numberOfSamples_(samples), scaleUpdate(NULL), scale(1.0) { }
 
 	virtual ~PerScreenNormalizedBufferScaled() {}
 
@@ -352,7 +348,8 @@ public:
 			delete *buffer;
 	}
 
-	void CreateBuffers(const vector<BufferConfig> &configs, u_int x, u_int y);
+	void CreateBuffers(const vector<BufferConfig> &configs, u_int x, u_int y,
+		bool sparse = false);
 
 	Buffer *getBuffer(u_int index) const {
 		return buffers[index];
@@ -596,6 +593,44 @@ public:
 //typedef OutlierDataXYRGB OutlierData;
 typedef OutlierDataXYLY OutlierData;
 
+// Largest k supported by the bounded outlier rejection,
+// the k nearest distances are kept on the stack
+#define MAX_OUTLIER_K 64
+
+// Fixed capacity store of the rejected points of an outlier cell,
+// used instead of the unbounded BSH when a cell capacity is set.
+// Points are kept in a structure of arrays layout in storage owned
+// by the film, once the cell is full the oldest point is replaced.
+class OutlierCell {
+public:
+	static const u_int dimensions = sizeof(OutlierData::Point_t) / sizeof(float);
+
+	OutlierCell() : data(NULL), capacity(0), count(0), next(0) { }
+
+	void Init(float *storage, u_int cap) {
+		data = storage;
+		capacity = cap;
+		count = 0;
+		next = 0;
+	}
+
+	void AddNode(const OutlierData::Point_t &p) {
+		for (u_int d = 0; d < dimensions; ++d)
+			data[d * capacity + next] = p.x[d];
+		next = (next + 1 == capacity) ? 0 : next + 1;
+		count = min(count + 1, capacity);
+	}
+
+	// Finds the squared distances to at most k close points with the
+	// shrinking radius rule of NearSetPointProcess, stored as a max-heap
+	// in dist2, returns the number of points found
+	u_int Lookup(const OutlierData::Point_t &p, u_int k, float *dist2) const;
+
+private:
+	float *data;
+	u_int capacity, count, next;
+};
+
 // Film Declarations
 class LUX_EXPORT Film : public Queryable {
 public:
@@ -604,7 +639,8 @@ public:
 		const string &filename1, bool premult, bool useZbuffer,
 		bool w_resume_FLM, bool restart_resume_FLM, bool write_FLM_direct,
 		int haltspp, int halttime, float haltthreshold, bool debugmode, int outlierk,
-		int tilecount, const string &samplingmapfilename);
+		int tilecount, const string &samplingmapfilename, bool sparsebuffers = false,
+		u_int outliercellcapacity = 0);
 
 	virtual ~Film();
 
@@ -619,9 +655,11 @@ public:
 	 * @param contribs Array of contributions to add
 	 * @param num_contribs Number of contributions in the contribs array
 	 * @param tileIndex Index of the tile the contributions should be added to
+	 * @param node NUMA node of the calling thread, the color buffers of
+	 * this node are used when CreateNodeReplicas() has been called
 	 */
 	virtual void AddTileSamples(const Contribution* const contribs, u_int num_contribs,
-		u_int tileIndex);
+		u_int tileIndex, u_int node = 0);
 	virtual void SetSample(const Contribution *contrib);
 	virtual void AddSampleNoFiltering(const Contribution *contrib);
 	virtual void AddSampleCount(const double count);
@@ -638,6 +676,17 @@ public:
 	virtual bool WriteFilmToStream(std::basic_ostream<char> &stream, bool clearBuffers = true, bool transmitParams = false, bool directWrite = false);
 	virtual double MergeFilmFromFile(const std::string& filename);
 	virtual double MergeFilmFromStream(std::basic_istream<char> &stream);
+	/*
+	 * Adds the buffers of another film with the same resolution and
+	 * buffer layout, avoiding the FLM serialization round trip.
+	 * @return The number of samples merged, 0 if the films don't match
+	 */
+	virtual double MergeFilm(const Film &film);
+	/**
+	 * Checks that another film has the same resolution and buffer layout,
+	 * as required by MergeFilm().
+	 */
+	bool HasSameLayout(const Film &film) const;
 	virtual bool LoadResumeFilm(const string &filename);
 
 	virtual void RequestBufferGroups(const vector<string> &bg);
@@ -649,6 +698,20 @@ public:
 	virtual u_int GetNumBufferGroups() const { return bufferGroups.size(); }
 	virtual const BufferGroup& GetBufferGroup(u_int index) const { return bufferGroups[index]; }
 	virtual void ClearBuffers();
+	/**
+	 * Gives each NUMA node after the first its own sparse copy of the
+	 * color buffers of all groups, so that threads bound to different
+	 * nodes splat in local memory. Must be called after CreateBuffers()
+	 * and before rendering starts. The Z, variance and outlier buffers
+	 * are not replicated.
+	 */
+	void CreateNodeReplicas(u_int nodeCount);
+	bool HasNodeReplicas() const { return !nodeReplicas.empty(); }
+	/**
+	 * Adds the replicated color buffers of a tile to the film buffers
+	 * and resets them. The tile splatting lock must be held.
+	 */
+	void MergeNodeReplicas(u_int tileIndex);
 
 	/**
 	 * Get the indexes that the current contribution spans.
@@ -663,6 +726,10 @@ public:
 	 * @return Total number of tiles in the film.
 	 */
 	virtual u_int GetTileCount() const;
+	/*
+	 * Gets the extents of a tile, interval is [start, end).
+	 */
+	void GetTileExtent(u_int tileIndex, int *xstart, int *xend, int *ystart, int *yend) const;
 
 	virtual void SetGroupName(u_int index, const string& name);
 	virtual string GetGroupName(u_int index) const;
@@ -725,8 +792,6 @@ protected:
 	bool WriteFilmDataToStream(std::basic_ostream<char> &stream, bool clearBuffers = true, bool transmitParams = false);
 	// Reject outliers for a tile. Rejected contributions get their variance set to -1.
 	void RejectTileOutliers(const Contribution &contrib, u_int tileIndex, int yTilePixelStart, int yTilePixelEnd);
-	// Gets the extents of a tile, interval is [start, end).
-	void GetTileExtent(u_int tileIndex, int *xstart, int *xend, int *ystart, int *yend) const;
 	void UpdateSamplingMap();
 	void UpdateConvergenceInfo(const float *frameBuffer);
 	void GenerateNoiseAwareMap();
@@ -777,6 +842,8 @@ protected: // Put it here for better data alignment
 
 	std::vector<BufferConfig> bufferConfigs;
 	std::vector<BufferGroup> bufferGroups;
+	// Color buffers of NUMA nodes 1 to n-1, [node - 1][group][config]
+	std::vector<std::vector<std::vector<Buffer *> > > nodeReplicas;
 
 	boost::mutex write_mutex; // WriteImage/ConvergenceTest (i.e. image pipeline) synchronization
 
@@ -806,6 +873,10 @@ protected: // Put it here for better data alignment
 	PerPixelNormalizedFloatBuffer *ZBuffer;
 	bool use_Zbuf;
 
+	// Light group buffers only allocate the parts of the image they
+	// receive samples for
+	bool sparseBuffers;
+
 	bool debug_mode;
 	bool premultiplyAlpha;
 
@@ -821,6 +892,11 @@ protected: // Put it here for better data alignment
 	std::vector<std::vector<OutlierAccel> > outliers;
 	// contains the outliers that lies on the overlap between tiles
 	std::vector<std::vector<OutlierAccel> > tileborder_outliers; 
+	// bounded variant, used instead of the above if outlierCellCapacity > 0
+	u_int outlierCellCapacity;
+	std::vector<float> outlierCellStorage;
+	std::vector<std::vector<OutlierCell> > outlierCells;
+	std::vector<std::vector<OutlierCell> > tileborder_outlierCells;
 
 public:
 	// Samplers will check this flag to know if we have enough samples per
@@ -844,6 +920,8 @@ private:
 
 	// Gets a reference to the appropriate outlier row data for a given position and tile index.
 	std::vector<OutlierAccel>& GetOutlierAccelRow(u_int oY, u_int tileIndex, u_int tileStart, u_int tileEnd);
+	std::vector<OutlierCell>& GetOutlierCellRow(u_int oY, u_int tileIndex, u_int tileStart, u_int tileEnd);
+	void RejectTileOutliersBounded(const Contribution &contrib, u_int tileIndex, int yTilePixelStart, int yTilePixelEnd);
 	
 	boost::mutex histMutex;
 };
@@ -27,6 +27,7 @@
 #include "camera.h"
 #include "reflection/bxdf.h"
 #include "sampling.h"
+#include "lighttree.h"
 
 using namespace lux;
 
@@ -96,6 +97,15 @@ bool InstanceLight::SampleL(const Scene &scene, const Sample &sample,
 	return true;
 }
 
+bool InstanceLight::GetBounds(LightBounds *bounds) const
+{
+	if (!light->GetBounds(bounds))
+		return false;
+	bounds->bounds = LightToWorld * bounds->bounds;
+	bounds->axis = Normalize(LightToWorld * bounds->axis);
+	return true;
+}
+
 bool MotionLight::Le(const Scene &scene, const Sample &sample, const Ray &r,
 	BSDF **bsdf, float *pdf, float *pdfDirect, SWCSpectrum *L) const
 {
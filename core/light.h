@@ -68,6 +68,13 @@ public:
 		const Point &p, float u1, float u2, float u3,
 		BSDF **bsdf, float *pdf, float *pdfDirect,
 		SWCSpectrum *L) const = 0;
+	/**
+	 * Bounds the positions and emission directions of the light, the
+	 * power is left untouched for the caller to fill.
+	 * @param bounds The bounds to fill
+	 * @return false if the light is not spatially bounded
+	 */
+	virtual bool GetBounds(LightBounds *bounds) const { return false; }
 	const LightRenderingHints *GetRenderingHints() const { return &hints; }
 
 	void AddPortalShape(boost::shared_ptr<Primitive> &shape);
@@ -94,7 +101,8 @@ public:
 	AreaLight(const Transform &light2world,
 		boost::shared_ptr<Texture<SWCSpectrum> > &Le, float g,
 		float pow, float e, SampleableSphericalFunction *ssf,
-		u_int ns, const boost::shared_ptr<Primitive> &prim);
+		u_int ns, const boost::shared_ptr<Primitive> &prim,
+		bool treeSampling = false);
 	virtual ~AreaLight();
 	virtual bool L(const Sample &sample, const Ray &ray,
 		const DifferentialGeometry &dg, BSDF **bsdf, float *pdf,
@@ -110,6 +118,7 @@ public:
 		const Point &p, float u1, float u2, float u3,
 		BSDF **bsdf, float *pdf, float *pdfDirect,
 		SWCSpectrum *Le) const;
+	virtual bool GetBounds(LightBounds *bounds) const;
 
 	Texture<SWCSpectrum> *GetTexture() { return Le.get(); }
 
@@ -154,6 +163,7 @@ public:
 		const Point &p, float u1, float u2, float u3,
 		BSDF **bsdf, float *pdf, float *pdfDirect,
 		SWCSpectrum *L) const;
+	virtual bool GetBounds(LightBounds *bounds) const;
 
 protected:
 	boost::shared_ptr<Light> light;
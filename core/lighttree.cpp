@@ -0,0 +1,244 @@
+/***************************************************************************
+ *   Copyright (C) 1998-2013 by authors (see AUTHORS.txt)                  *
+ *                                                                         *
+ *   This file is part of LuxRender.                                       *
+ *                                                                         *
+ *   Lux Renderer is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   Lux Renderer is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                         *
+ *   This project is based on PBRT ; see http://www.pbrt.org               *
+ *   Lux Renderer website : http://www.luxrender.net                       *
+ ***************************************************************************/
+
+
+// lighttree.cpp*
+#include "lighttree.h"
+#include "primitive.h"
+#include "sampling.h"
+
+using namespace lux;
+
+const u_int LightTree::NO_ITEM;
+
+LightBounds lux::Union(const LightBounds &a, const LightBounds &b)
+{
+	if (!(a.power > 0.f))
+		return b;
+	if (!(b.power > 0.f))
+		return a;
+	LightBounds r;
+	r.bounds = Union(a.bounds, b.bounds);
+	r.power = a.power + b.power;
+	r.cosThetaE = min(a.cosThetaE, b.cosThetaE);
+	if (a.cosThetaO <= -1.f || b.cosThetaO <= -1.f)
+		return r;
+
+	// Compute the cone bounding both direction cones
+	const LightBounds &wide(a.cosThetaO < b.cosThetaO ? a : b);
+	const LightBounds &narrow(a.cosThetaO < b.cosThetaO ? b : a);
+	const float thetaW = acosf(wide.cosThetaO);
+	const float thetaN = acosf(narrow.cosThetaO);
+	const float cosD = Clamp(Dot(wide.axis, narrow.axis), -1.f, 1.f);
+	const float thetaD = acosf(cosD);
+	if (min(thetaD + thetaN, M_PI) <= thetaW) {
+		r.axis = wide.axis;
+		r.cosThetaO = wide.cosThetaO;
+		return r;
+	}
+	const float thetaO = .5f * (thetaW + thetaD + thetaN);
+	if (thetaO >= M_PI)
+		return r;
+	// Rotate the wide axis towards the narrow one
+	const Vector perp(narrow.axis - wide.axis * cosD);
+	const float perpLength = perp.Length();
+	if (!(perpLength > 1e-6f))
+		return r;
+	const float thetaR = thetaO - thetaW;
+	r.axis = Normalize(wide.axis * cosf(thetaR) +
+		perp * (sinf(thetaR) / perpLength));
+	r.cosThetaO = cosf(thetaO);
+	return r;
+}
+
+float LightTree::Importance(const LightBounds &b, const Point &p)
+{
+	if (!(b.power > 0.f))
+		return 0.f;
+	const Vector extent(b.bounds.pMax - b.bounds.pMin);
+	const Point center(b.bounds.pMin + extent * .5f);
+	const float r2 = extent.LengthSquared() * .25f;
+	const Vector w(p - center);
+	const float d2 = w.LengthSquared();
+	// Don't let the distance fall below the bounds radius so that
+	// close emitters don't get an unbounded importance, the constant
+	// only matters for point emitters
+	const float distance2 = max(max(d2, r2), 1e-10f);
+	// Nothing can be culled when p is inside the bounding sphere
+	if (b.cosThetaO <= -1.f || d2 <= r2)
+		return b.power / distance2;
+
+	// Smallest angle between the emission cone and the direction to p
+	const float cosW = Clamp(Dot(b.axis, w) / sqrtf(d2), -1.f, 1.f);
+	const float thetaU = asinf(sqrtf(r2 / d2));
+	const float theta = max(0.f,
+		acosf(cosW) - acosf(b.cosThetaO) - thetaU);
+	if (theta > acosf(b.cosThetaE))
+		return 0.f;
+	// The cosine falloff is only a valid bound for emission profiles
+	// restricted to a hemisphere
+	const float falloff = b.cosThetaE >= 0.f ? cosf(theta) : 1.f;
+	return b.power * falloff / distance2;
+}
+
+class LightTreeCentroidCompare {
+public:
+	LightTreeCentroidCompare(const vector<LightBounds> &i, u_int a) :
+		items(i), axis(a) { }
+	bool operator()(u_int a, u_int b) const {
+		return items[a].bounds.pMin[axis] + items[a].bounds.pMax[axis] <
+			items[b].bounds.pMin[axis] + items[b].bounds.pMax[axis];
+	}
+private:
+	const vector<LightBounds> &items;
+	u_int axis;
+};
+
+void LightTree::Build(const vector<LightBounds> &items)
+{
+	nodes.clear();
+	itemNodes.assign(items.size(), NO_ITEM);
+
+	vector<u_int> ids;
+	ids.reserve(items.size());
+	for (u_int i = 0; i < items.size(); ++i) {
+		if (items[i].power > 0.f)
+			ids.push_back(i);
+	}
+	if (ids.empty())
+		return;
+
+	nodes.reserve(2 * ids.size() - 1);
+	BuildNode(items, ids, 0, ids.size(), NO_ITEM);
+}
+
+u_int LightTree::BuildNode(const vector<LightBounds> &items,
+	vector<u_int> &ids, u_int begin, u_int end, u_int parent)
+{
+	const u_int nodeIndex = nodes.size();
+	nodes.push_back(LightTreeNode());
+	nodes[nodeIndex].parent = parent;
+	if (end - begin == 1) {
+		LightTreeNode &leaf(nodes[nodeIndex]);
+		leaf.leaf = true;
+		leaf.index = ids[begin];
+		leaf.bounds = items[ids[begin]];
+		itemNodes[ids[begin]] = nodeIndex;
+		return nodeIndex;
+	}
+
+	// Split at the median centroid along the largest extent, this keeps
+	// the tree balanced so that the traversal depth stays logarithmic
+	BBox centroids;
+	for (u_int i = begin; i < end; ++i) {
+		const BBox &b(items[ids[i]].bounds);
+		centroids = Union(centroids, b.pMin + (b.pMax - b.pMin) * .5f);
+	}
+	const u_int middle = (begin + end) / 2;
+	std::nth_element(ids.begin() + begin, ids.begin() + middle,
+		ids.begin() + end,
+		LightTreeCentroidCompare(items, centroids.MaximumExtent()));
+
+	BuildNode(items, ids, begin, middle, nodeIndex);
+	const u_int second = BuildNode(items, ids, middle, end, nodeIndex);
+	// Children have been pushed, the reference is now stable
+	LightTreeNode &node(nodes[nodeIndex]);
+	node.leaf = false;
+	node.index = second;
+	node.bounds = Union(nodes[nodeIndex + 1].bounds, nodes[second].bounds);
+	return nodeIndex;
+}
+
+u_int LightTree::Sample(const Point &p, float *u, float *pdf) const
+{
+	if (nodes.empty())
+		return NO_ITEM;
+	u_int n = 0;
+	*pdf = 1.f;
+	while (!nodes[n].leaf) {
+		const u_int second = nodes[n].index;
+		const float i0 = Importance(nodes[n + 1].bounds, p);
+		const float i1 = Importance(nodes[second].bounds, p);
+		if (!(i0 + i1 > 0.f))
+			return NO_ITEM;
+		const float p0 = i0 / (i0 + i1);
+		if (*u < p0) {
+			*u = min(*u / p0, OneMinusEpsilon);
+			*pdf *= p0;
+			++n;
+		} else {
+			*u = min((*u - p0) / (1.f - p0), OneMinusEpsilon);
+			*pdf *= 1.f - p0;
+			n = second;
+		}
+	}
+	return nodes[n].index;
+}
+
+float LightTree::Pdf(const Point &p, u_int item) const
+{
+	if (item >= itemNodes.size() || itemNodes[item] == NO_ITEM)
+		return 0.f;
+	u_int n = itemNodes[item];
+	float pdf = 1.f;
+	while (nodes[n].parent != NO_ITEM) {
+		const u_int parent = nodes[n].parent;
+		const u_int sibling = n == parent + 1 ?
+			nodes[parent].index : parent + 1;
+		const float i = Importance(nodes[n].bounds, p);
+		if (!(i > 0.f))
+			return 0.f;
+		pdf *= i / (i + Importance(nodes[sibling].bounds, p));
+		n = parent;
+	}
+	return pdf;
+}
+
+u_int LightTree::Intersect(const vector<boost::shared_ptr<Primitive> > &prims,
+	const Ray &ray) const
+{
+	if (nodes.empty())
+		return NO_ITEM;
+	// The median split keeps the depth well below the stack size
+	u_int todo[64];
+	u_int todoCount = 0;
+	todo[todoCount++] = 0;
+	u_int hit = NO_ITEM;
+	Intersection isect;
+	while (todoCount > 0) {
+		const u_int n = todo[--todoCount];
+		const LightTreeNode &node(nodes[n]);
+		BBox bounds(node.bounds.bounds);
+		bounds.Expand(MachineEpsilon::E(bounds));
+		if (!bounds.IntersectP(ray))
+			continue;
+		if (node.leaf) {
+			// A hit shortens the ray so only closer hits follow
+			if (prims[node.index]->Intersect(ray, &isect))
+				hit = node.index;
+		} else {
+			todo[todoCount++] = node.index;
+			todo[todoCount++] = n + 1;
+		}
+	}
+	return hit;
+}
@@ -0,0 +1,116 @@
+/***************************************************************************
+ *   Copyright (C) 1998-2013 by authors (see AUTHORS.txt)                  *
+ *                                                                         *
+ *   This file is part of LuxRender.                                       *
+ *                                                                         *
+ *   Lux Renderer is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   Lux Renderer is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                         *
+ *   This project is based on PBRT ; see http://www.pbrt.org               *
+ *   Lux Renderer website : http://www.luxrender.net                       *
+ ***************************************************************************/
+
+
+#ifndef LUX_LIGHTTREE_H
+#define LUX_LIGHTTREE_H
+// lighttree.h*
+
+#include "lux.h"
+#include "geometry/transform.h"
+#include "luxrays/core/geometry/bbox.h"
+
+namespace lux
+{
+
+/**
+ * Spatial and directional bounds of an emitter. The emission directions
+ * are bounded by a cone of half angle acos(cosThetaO) around axis, widened
+ * by acos(cosThetaE) to account for the emission profile around each
+ * direction. A cosThetaO of -1 means that the emitter radiates in every
+ * direction.
+ */
+struct LightBounds {
+	LightBounds() : axis(0.f, 0.f, 1.f), cosThetaO(-1.f), cosThetaE(-1.f),
+		power(0.f) { }
+	BBox bounds;
+	Vector axis;
+	float cosThetaO, cosThetaE;
+	float power;
+};
+
+LightBounds Union(const LightBounds &a, const LightBounds &b);
+
+struct LightTreeNode {
+	LightBounds bounds;
+	u_int parent;
+	// Index of the second child for interior nodes (the first child
+	// immediately follows its parent), index of the item for leaves
+	u_int index;
+	bool leaf;
+};
+
+/**
+ * Bounding volume hierarchy over a set of emitters used to select one of
+ * them according to its estimated contribution to a given point, as
+ * described in "Importance Sampling of Many Lights with Adaptive Tree
+ * Splitting" by Conty Estevez and Kulla.
+ */
+class LightTree {
+public:
+	LightTree() { }
+	~LightTree() { }
+
+	/**
+	 * Builds the hierarchy, the items keep their index in the given
+	 * vector. Items without power are never sampled.
+	 */
+	void Build(const vector<LightBounds> &items);
+	bool Empty() const { return nodes.empty(); }
+	/**
+	 * Selects an item according to its importance for point p
+	 * @param p The receiving point
+	 * @param u A pointer to a random variable in the [0,1) range,
+	 * it is remapped to [0,1) so that it can be reused
+	 * @param pdf The probability of having selected the item
+	 * @return The index of the selected item or NO_ITEM when no item
+	 * can contribute to p
+	 */
+	u_int Sample(const Point &p, float *u, float *pdf) const;
+	/**
+	 * The probability of selecting a given item for point p
+	 */
+	float Pdf(const Point &p, u_int item) const;
+	/**
+	 * Finds the item hit by a ray among primitives built in the same
+	 * order as the tree items
+	 * @return The index of the hit item or NO_ITEM
+	 */
+	u_int Intersect(const vector<boost::shared_ptr<Primitive> > &prims,
+		const Ray &ray) const;
+
+	static float Importance(const LightBounds &b, const Point &p);
+
+	static const u_int NO_ITEM = 0xffffffffu;
+
+private:
+	u_int BuildNode(const vector<LightBounds> &items, vector<u_int> &ids,
+		u_int begin, u_int end, u_int parent);
+
+	vector<LightTreeNode> nodes;
+	// Leaf node of each item, NO_ITEM for items that are not in the tree
+	vector<u_int> itemNodes;
+};
+
+}//namespace lux
+
+#endif // LUX_LIGHTTREE_H
@@ -239,6 +239,8 @@ namespace lux
   class Volume;
   class Region;
   class Light;
+  struct LightBounds;
+  class LightTree;
   struct VisibilityTester;
   class AreaLight;
   class Shape;
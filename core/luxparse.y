@@ -111,6 +111,20 @@ ParamArray *ArrayDup(ParamArray *ra)
 	return ret;
 }
 
+// Hands the current array over without copying its elements,
+// a new one is created by the next array_init
+ParamArray *ArrayTake()
+{
+	ParamArray *ret = curArray;
+	curArray = NULL;
+	// Release the unused part of the growth allocation
+	if (ret->nelems > 0 && ret->nelems < ret->allocated) {
+		ret->array = realloc(ret->array, ret->nelems * ret->elementSize);
+		ret->allocated = ret->nelems;
+	}
+	return ret;
+}
+
 void ArrayFree(ParamArray *ra)
 {
 	free(ra->array);
@@ -120,13 +134,16 @@ void ArrayFree(ParamArray *ra)
 void FreeArgs()
 {
 	for (u_int i = 0; i < CPS; ++i) {
+		// Adopted by the ParamSet
+		if (!CPA(i))
+			continue;
 		// NOTE - Ratow - freeing up strings inside string type args
 		if (memcmp("string", CPT(i), 6) == 0 ||
 			memcmp("texture", CPT(i), 7) == 0) {
 			for (u_int j = 0; j < CPSZ(i); ++j)
 				free(static_cast<char **>(CPA(i))[j]);
 		}
-		delete[] static_cast<char *>(CPA(i));
+		free(CPA(i));
 	}
 }
 
@@ -218,7 +235,7 @@ string_array: real_string_array
 
 real_string_array: array_init LBRACK string_list RBRACK
 {
-	$$ = ArrayDup(curArray);
+	$$ = ArrayTake();
 };
 
 single_element_string_array: array_init string_list_entry
@@ -249,7 +266,7 @@ num_array: real_num_array
 
 real_num_array: array_init LBRACK num_list RBRACK
 {
-	$$ = ArrayDup(curArray);
+	$$ = ArrayTake();
 };
 
 single_element_num_array: array_init num_list_entry
@@ -287,8 +304,9 @@ paramlist_contents: paramlist_entry paramlist_contents
 
 paramlist_entry: STRING array
 {
-	void *arg = new char[$2->nelems * $2->elementSize];
-	memcpy(arg, $2->array, $2->nelems * $2->elementSize);
+	// take the array over, it may be adopted by the ParamSet
+	void *arg = $2->array;
+	$2->array = NULL;
 	if (CPS >= CPAL) {
 		CPAL = 2 * CPAL + 1;
 		CP = static_cast<ParamListElem *>(realloc(CP,
@@ -569,12 +587,11 @@ static void InitParamSet(ParamSet &ps, u_int count, ParamListElem *list) {
 		u_int nItems = list[i].size;
 		if (type == PARAM_TYPE_INT) {
 			// parser doesn't handle ints, so convert from floats
-			int *idata = new int[nItems];
+			boost::shared_array<int> idata(new int[nItems]);
 			float *fdata = static_cast<float *>(data);
 			for (u_int j = 0; j < nItems; ++j)
 				idata[j] = static_cast<int>(fdata[j]);
 			ps.AddInt(name, idata, nItems);
-			delete[] idata;
 		} else if (type == PARAM_TYPE_BOOL) {
 			// strings -> bools
 			bool *bdata = new bool[nItems];
@@ -594,15 +611,21 @@ static void InitParamSet(ParamSet &ps, u_int count, ParamListElem *list) {
 			ps.AddBool(name, bdata, nItems);
 			delete[] bdata;
 		} else if (type == PARAM_TYPE_FLOAT) {
-			ps.AddFloat(name, static_cast<float *>(data), nItems);
+			// numeric arrays are adopted by the ParamSet, see FreeArgs
+			ps.AddFloat(name, boost::shared_array<float>(static_cast<float *>(data), free), nItems);
+			list[i].arg = NULL;
 		} else if (type == PARAM_TYPE_POINT) {
-			ps.AddPoint(name, static_cast<Point *>(data), nItems / 3);
+			ps.AddPoint(name, boost::shared_array<Point>(static_cast<Point *>(data), free), nItems / 3);
+			list[i].arg = NULL;
 		} else if (type == PARAM_TYPE_VECTOR) {
-			ps.AddVector(name, static_cast<Vector *>(data), nItems / 3);
+			ps.AddVector(name, boost::shared_array<Vector>(static_cast<Vector *>(data), free), nItems / 3);
+			list[i].arg = NULL;
 		} else if (type == PARAM_TYPE_NORMAL) {
-			ps.AddNormal(name, static_cast<Normal *>(data), nItems / 3);
+			ps.AddNormal(name, boost::shared_array<Normal>(static_cast<Normal *>(data), free), nItems / 3);
+			list[i].arg = NULL;
 		} else if (type == PARAM_TYPE_COLOR) {
-			ps.AddRGBColor(name, static_cast<RGBColor *>(data), nItems / COLOR_SAMPLES);
+			ps.AddRGBColor(name, boost::shared_array<RGBColor>(static_cast<RGBColor *>(data), free), nItems / COLOR_SAMPLES);
+			list[i].arg = NULL;
 		} else if (type == PARAM_TYPE_STRING) {
 			string *strings = new string[nItems];
 			for (u_int j = 0; j < nItems; ++j)
@@ -42,6 +42,8 @@
 #include <vector>
 #include <boost/serialization/split_member.hpp>
 #include <boost/cstdint.hpp>
+#include <boost/thread/mutex.hpp>
+#include "osfunc.h"
 using boost::int8_t;
 
 namespace lux
@@ -397,5 +399,103 @@ private:
 	BOOST_SERIALIZATION_SPLIT_MEMBER()
 };
 
+// 2D array of square blocks laid out in rows, that are only allocated when
+// first written to in sparse mode. Reading a missing block returns default
+// constructed values. Accesses may run concurrently, blocks are published
+// with release/acquire ordering so a thread seeing a block pointer also sees
+// its constructed contents. Clear() must not run concurrently with accesses.
+template<class T, int logBlockSize = 5> class SparseBlockedArray {
+public:
+	SparseBlockedArray(size_t nu, size_t nv, bool sparse) :
+		uRes(nu), vRes(nv), isSparse(sparse), allocatedBlocks(0) {
+		uBlocks = RoundUp(uRes) >> logBlockSize;
+		nBlocks = uBlocks * (RoundUp(vRes) >> logBlockSize);
+		blocks = new T *[nBlocks];
+		for (size_t i = 0; i < nBlocks; ++i)
+			blocks[i] = isSparse ? NULL : AllocBlock();
+	}
+	~SparseBlockedArray() {
+		for (size_t i = 0; i < nBlocks; ++i)
+			FreeBlock(blocks[i]);
+		delete[] blocks;
+	}
+
+	size_t BlockSize() const { return 1 << logBlockSize; }
+	size_t RoundUp(size_t x) const {
+		return (x + BlockSize() - 1) & ~(BlockSize() - 1);
+	}
+	size_t uSize() const { return uRes; }
+	size_t vSize() const { return vRes; }
+	bool IsSparse() const { return isSparse; }
+	size_t AllocatedBlocks() const { return allocatedBlocks; }
+	size_t BlockMemory() const { return BlockSize() * BlockSize() * sizeof(T); }
+
+	T &operator()(size_t u, size_t v) {
+		T **slot = &blocks[BlockIndex(u, v)];
+		T *block = osAtomicLoadAcquire(slot);
+		if (!block) {
+			boost::mutex::scoped_lock lock(allocMutex);
+			block = *slot;
+			if (!block) {
+				block = AllocBlock();
+				osAtomicStoreRelease(slot, block);
+			}
+		}
+		return block[Offset(u, v)];
+	}
+	const T &operator()(size_t u, size_t v) const {
+		const T *block = osAtomicLoadAcquire(&blocks[BlockIndex(u, v)]);
+		return block ? block[Offset(u, v)] : emptyValue;
+	}
+	// Resets all values, the blocks are released in sparse mode
+	void Clear() {
+		for (size_t i = 0; i < nBlocks; ++i) {
+			if (isSparse) {
+				FreeBlock(blocks[i]);
+				blocks[i] = NULL;
+			} else {
+				for (size_t j = 0; j < BlockSize() * BlockSize(); ++j)
+					blocks[i][j] = T();
+			}
+		}
+	}
+
+private:
+	size_t BlockIndex(size_t u, size_t v) const {
+		return (v >> logBlockSize) * uBlocks + (u >> logBlockSize);
+	}
+	size_t Offset(size_t u, size_t v) const {
+		return ((v & (BlockSize() - 1)) << logBlockSize) +
+			(u & (BlockSize() - 1));
+	}
+	T *AllocBlock() {
+		const size_t n = BlockSize() * BlockSize();
+		T *block = lux::AllocAligned<T>(n);
+		for (size_t i = 0; i < n; ++i)
+			new (&block[i]) T();
+		++allocatedBlocks;
+		return block;
+	}
+	void FreeBlock(T *block) {
+		if (!block)
+			return;
+		const size_t n = BlockSize() * BlockSize();
+		for (size_t i = 0; i < n; ++i)
+			block[i].~T();
+		lux::FreeAligned(block);
+		--allocatedBlocks;
+	}
+
+	SparseBlockedArray(const SparseBlockedArray &);
+	SparseBlockedArray &operator=(const SparseBlockedArray &);
+
+	T **blocks;
+	size_t uRes, vRes, uBlocks, nBlocks;
+	bool isSparse;
+	size_t allocatedBlocks;
+	T emptyValue;
+	boost::mutex allocMutex;
+};
+
 #endif // LUX_MEMORY_H
 
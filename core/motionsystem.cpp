@@ -25,6 +25,7 @@
 #include "luxrays/core/geometry/matrix4x4.h"
 using luxrays::Matrix4x4;
 #include "error.h"
+#include "osfunc.h"
 
 #include <cstring>
 using std::memset;
@@ -33,9 +34,76 @@ using std::memset;
 #include <algorithm>
 #include <utility>
 
+#include <boost/thread/tss.hpp>
+
 
 using namespace lux;
 
+// Expands the keys b0 and b1 so that their interpolation at u contains b.
+// Both keys are moved by the same amount so that containment at
+// other interpolation values that was already established is preserved.
+static void ExpandLinearBound(BBox *b0, BBox *b1, float u, const BBox &b)
+{
+	for (u_int axis = 0; axis < 3; ++axis) {
+		const float lMin = Lerp(u, b0->pMin[axis], b1->pMin[axis]);
+		if (b.pMin[axis] < lMin) {
+			const float d = lMin - b.pMin[axis];
+			b0->pMin[axis] -= d;
+			b1->pMin[axis] -= d;
+		}
+		const float lMax = Lerp(u, b0->pMax[axis], b1->pMax[axis]);
+		if (b.pMax[axis] > lMax) {
+			const float d = b.pMax[axis] - lMax;
+			b0->pMax[axis] += d;
+			b1->pMax[axis] += d;
+		}
+	}
+}
+
+BBox MotionBBox::Sample(float time) const
+{
+	if (IsStatic() || time <= times.front())
+		return boxes.front();
+	if (time >= times.back())
+		return boxes.back();
+
+	const size_t index = std::upper_bound(times.begin(), times.end(), time) - times.begin();
+	const float le = (time - times[index - 1]) / (times[index] - times[index - 1]);
+	const BBox &b0(boxes[index - 1]);
+	const BBox &b1(boxes[index]);
+	return BBox(Point(Lerp(le, b0.pMin.x, b1.pMin.x),
+		Lerp(le, b0.pMin.y, b1.pMin.y),
+		Lerp(le, b0.pMin.z, b1.pMin.z)),
+		Point(Lerp(le, b0.pMax.x, b1.pMax.x),
+		Lerp(le, b0.pMax.y, b1.pMax.y),
+		Lerp(le, b0.pMax.z, b1.pMax.z)));
+}
+
+BBox MotionBBox::Bound() const
+{
+	BBox result;
+	for (size_t i = 0; i < boxes.size(); ++i)
+		result = Union(result, boxes[i]);
+	return result;
+}
+
+void MotionBBox::Linearize(float start, float end, BBox *b0, BBox *b1) const
+{
+	if (IsStatic() || !(end > start)) {
+		*b0 = *b1 = Bound();
+		return;
+	}
+
+	*b0 = Sample(start);
+	*b1 = Sample(end);
+	// The bound is piecewise linear, so it is enough to check the knots
+	const float invDuration = 1.f / (end - start);
+	for (size_t i = 0; i < times.size(); ++i) {
+		const float u = Clamp((times[i] - start) * invDuration, 0.f, 1.f);
+		ExpandLinearBound(b0, b1, u, boxes[i]);
+	}
+}
+
 InterpolatedTransform::InterpolatedTransform(float st, float et,
 	const Transform &s, const Transform &e) : hasRotation(false),
 	hasTranslationX(false), hasTranslationY(false), hasTranslationZ(false),
@@ -92,6 +160,28 @@ BBox InterpolatedTransform::Bound(BBox ibox) const
 	return tbox;
 }
 
+float InterpolatedTransform::LinearSampleError(const BBox &ibox, u_int n) const
+{
+	// Translation and scale are linear in time, only the rotation bends
+	// the path. A point moves as p(t) = T(t) + S(t) R(t) x, so
+	// |p''| <= (s w^2 + 2 |S'| w) |x| with w the constant slerp angular
+	// speed, and the linear interpolation error over a step h is at most
+	// h^2 / 8 |p''|
+	if (!isActive || !hasRotation || n == 0)
+		return 0.f;
+	const float angle = 2.f * acosf(min(1.f, fabsf(Dot(startQ, endQ))));
+	const float step = angle / n;
+	const float s = max(max(max(fabsf(startT.Sx), fabsf(endT.Sx)),
+		max(fabsf(startT.Sy), fabsf(endT.Sy))),
+		max(fabsf(startT.Sz), fabsf(endT.Sz)));
+	const float ds = max(max(fabsf(endT.Sx - startT.Sx),
+		fabsf(endT.Sy - startT.Sy)), fabsf(endT.Sz - startT.Sz)) / n;
+	const Vector x(max(fabsf(ibox.pMin.x), fabsf(ibox.pMax.x)),
+		max(fabsf(ibox.pMin.y), fabsf(ibox.pMax.y)),
+		max(fabsf(ibox.pMin.z), fabsf(ibox.pMax.z)));
+	return x.Length() * (s * step * step + 2.f * ds * step) * .125f;
+}
+
 Transform InterpolatedTransform::Sample(float time) const
 {
 	if (!isActive)
@@ -286,7 +376,34 @@ InterpolatedTransform::DecomposedTransform::DecomposedTransform(const Matrix4x4
 	Valid = true;
 }
 
-MotionSystem::MotionSystem(const vector<float> &t, const vector<Transform> &transforms) : times(t) {
+// Small direct mapped cache of sampled transforms
+class SampledTransformCache {
+public:
+	SampledTransformCache() {
+		for (u_int i = 0; i < SIZE; ++i)
+			entries[i].id = 0;
+	}
+
+	static const u_int SIZE_LOG2 = 6;
+	static const u_int SIZE = 1 << SIZE_LOG2;
+
+	struct Entry {
+		u_int id;
+		float time;
+		Transform t;
+	} entries[SIZE];
+};
+
+static boost::thread_specific_ptr<SampledTransformCache> sampledTransformCache;
+// Identifier 0 is reserved for empty cache entries
+static unsigned int motionSystemCount = 0;
+
+static u_int NewMotionSystemId()
+{
+	return osAtomicInc(&motionSystemCount) + 1;
+}
+
+MotionSystem::MotionSystem(const vector<float> &t, const vector<Transform> &transforms) : times(t), id(NewMotionSystemId()) {
 	typedef vector<float>::const_iterator time_cit;
 	typedef vector<Transform>::const_iterator trans_cit;
 
@@ -310,10 +427,10 @@ MotionSystem::MotionSystem(const vector<float> &t, const vector<Transform> &tran
 	interpolatedTransforms.push_back(InterpolatedTransform(*prev_time, *prev_time, *prev_trans, *prev_trans));
 }
 
-MotionSystem::MotionSystem(const Transform &t) : times(1, 0.f), interpolatedTransforms(1, InterpolatedTransform(0.f, 0.f, t, t)) {
+MotionSystem::MotionSystem(const Transform &t) : times(1, 0.f), interpolatedTransforms(1, InterpolatedTransform(0.f, 0.f, t, t)), id(NewMotionSystemId()) {
 }
 
-MotionSystem::MotionSystem() : times(1, 0.f), interpolatedTransforms(1, InterpolatedTransform(0.f, 0.f, Transform(), Transform())) {
+MotionSystem::MotionSystem() : times(1, 0.f), interpolatedTransforms(1, InterpolatedTransform(0.f, 0.f, Transform(), Transform())), id(NewMotionSystemId()) {
 }
 
 bool MotionSystem::IsStatic() const {
@@ -331,6 +448,32 @@ Transform MotionSystem::Sample(float time) const {
 	return interpolatedTransforms[index].Sample(time);
 }
 
+Transform MotionSystem::SampleCached(float time) const {
+	if (IsStatic())
+		return interpolatedTransforms.front().Sample(time);
+
+	SampledTransformCache *cache = sampledTransformCache.get();
+	if (!cache) {
+		cache = new SampledTransformCache();
+		sampledTransformCache.reset(cache);
+	}
+
+	union {
+		float f;
+		u_int i;
+	} bits;
+	bits.f = time;
+	const u_int slot = ((id ^ bits.i) * 2654435761u) >>
+		(32 - SampledTransformCache::SIZE_LOG2);
+	SampledTransformCache::Entry &entry(cache->entries[slot]);
+	if (entry.id != id || entry.time != time) {
+		entry.id = id;
+		entry.time = time;
+		entry.t = Sample(time);
+	}
+	return entry.t;
+}
+
 BBox MotionSystem::Bound(BBox ibox) const {;
 	typedef vector<InterpolatedTransform>::const_iterator msys_cit;
 
@@ -343,6 +486,43 @@ BBox MotionSystem::Bound(BBox ibox) const {;
 	return result;
 }
 
+MotionBBox MotionSystem::MotionBound(const BBox &ibox) const {
+	if (IsStatic())
+		return MotionBBox(Bound(ibox));
+
+	vector<BBox> boxes;
+	boxes.reserve(times.size());
+	for (size_t i = 0; i < times.size(); ++i)
+		boxes.push_back(Sample(times[i]) * ibox);
+
+	// Rotations don't move the bound linearly between knots,
+	// so expand the knot boxes to contain intermediate samples,
+	// then pad them by the largest deviation of the path between
+	// samples so that the bound stays conservative
+	const u_int N = 64;
+	vector<float> padding(times.size(), 0.f);
+	for (size_t i = 1; i < times.size(); ++i) {
+		const InterpolatedTransform &it(interpolatedTransforms[i]);
+		if (it.IsStatic())
+			continue;
+		for (u_int j = 1; j < N; ++j) {
+			const float u = static_cast<float>(j) / N;
+			const float t = Lerp(u, times[i - 1], times[i]);
+			ExpandLinearBound(&boxes[i - 1], &boxes[i], u,
+				it.Sample(t) * ibox);
+		}
+		const float error = it.LinearSampleError(ibox, N);
+		padding[i - 1] = max(padding[i - 1], error);
+		padding[i] = max(padding[i], error);
+	}
+	for (size_t i = 0; i < times.size(); ++i) {
+		if (padding[i] > 0.f)
+			boxes[i].Expand(padding[i]);
+	}
+
+	return MotionBBox(times, boxes);
+}
+
 // Contains one or more <time, transform> pairs (knots) representing a path
 MotionTransform::MotionTransform(const MotionTransform &other) : times(other.times), transforms(other.transforms) { }
 
@@ -35,6 +35,43 @@ using luxrays::BBox;
 namespace lux
 {
 
+// Piecewise linear bounding box over time.
+// Between two knots the bound is the component-wise linear interpolation
+// of the knot boxes, before the first and after the last knot it is constant.
+class MotionBBox {
+public:
+	MotionBBox() : times(), boxes(1, BBox()) { }
+	explicit MotionBBox(const BBox &b) : times(), boxes(1, b) { }
+	MotionBBox(const vector<float> &t, const vector<BBox> &b) :
+		times(t), boxes(b) { }
+
+	// true if the bound doesn't depend on time
+	bool IsStatic() const {
+		return times.size() <= 1;
+	}
+
+	float StartTime() const {
+		return IsStatic() ? 0.f : times.front();
+	}
+
+	float EndTime() const {
+		return IsStatic() ? 0.f : times.back();
+	}
+
+	BBox Sample(float time) const;
+
+	// Union of the bound over all times
+	BBox Bound() const;
+
+	// Computes the boxes at start and end times such that their linear
+	// interpolation contains this bound over the [start, end] interval
+	void Linearize(float start, float end, BBox *b0, BBox *b1) const;
+
+private:
+	vector<float> times;
+	vector<BBox> boxes;
+};
+
 // Interpolates between two transforms
 class InterpolatedTransform {
 public:
@@ -47,6 +84,11 @@ public:
 
 	BBox Bound(BBox ibox) const;
 
+	// Upper bound of the distance between a point of ibox moved by Sample
+	// and the linear interpolation of its positions at n + 1 evenly
+	// spaced times over the interval
+	float LinearSampleError(const BBox &ibox, u_int n) const;
+
 	// true if start and end transform or time is identical
 	bool IsStatic() const {
 		return !isActive;
@@ -110,9 +152,18 @@ public:
 
 	BBox Bound(BBox ibox) const;
 
+	// Computes a bound of ibox along the path with one key per knot
+	MotionBBox MotionBound(const BBox &ibox) const;
+
+	// Same as Sample but looks the result up in a small per-thread cache
+	// first, all rays of a given sample share the same time
+	Transform SampleCached(float time) const;
+
 private:
 	vector<float> times;
 	vector<InterpolatedTransform> interpolatedTransforms;
+	// Identifier used as cache key, shared by copies
+	u_int id;
 };
 
 // Contains one or more <time, transform> pairs (knots) representing a path
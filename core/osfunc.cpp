@@ -22,12 +22,24 @@
 
 #include "osfunc.h"
 
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <boost/filesystem.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread/once.hpp>
+#include <boost/thread/thread.hpp>
+
 #ifdef WIN32
 #include <windows.h>
 #else
 
 #ifdef __linux__
 #include <sys/sysinfo.h>
+#include <pthread.h>
+#include <sched.h>
 #elif defined(__APPLE__) || defined(__FreeBSD__)
 #include <sys/types.h>
 #include <sys/sysctl.h>
@@ -135,6 +147,134 @@ uint32_t osReadLittleEndianUInt(bool isLittleEndian,
 	return osReadLittleEndian<uint32_t>(isLittleEndian, is);
 }
 
+// Logical processors of each NUMA node, read once
+static std::vector<std::vector<unsigned int> > numaNodes;
+static boost::once_flag numaNodesFlag = BOOST_ONCE_INIT;
+
+static void osReadNumaNodes()
+{
+#if defined(__linux__)
+	// Node numbers can have holes, so list the node directories
+	std::vector<unsigned int> nodeIds;
+	boost::system::error_code ec;
+	for (boost::filesystem::directory_iterator entry("/sys/devices/system/node", ec), end;
+		!ec && entry != end; entry.increment(ec)) {
+		const std::string name(entry->path().filename().string());
+		if (name.size() <= 4 || name.compare(0, 4, "node") ||
+			name.find_first_not_of("0123456789", 4) != std::string::npos)
+			continue;
+		try {
+			nodeIds.push_back(boost::lexical_cast<unsigned int>(name.substr(4)));
+		} catch (boost::bad_lexical_cast &) {
+		}
+	}
+	std::sort(nodeIds.begin(), nodeIds.end());
+	// Lists look like "0-7,16-23"
+	for (size_t n = 0; n < nodeIds.size(); ++n) {
+		std::ifstream in(("/sys/devices/system/node/node" +
+			boost::lexical_cast<std::string>(nodeIds[n]) + "/cpulist").c_str());
+		if (!in)
+			continue;
+		std::string list;
+		std::getline(in, list);
+		std::stringstream ranges(list);
+		std::string range;
+		std::vector<unsigned int> processors;
+		while (std::getline(ranges, range, ',')) {
+			unsigned int first, last;
+			char dash;
+			std::stringstream ss(range);
+			if (!(ss >> first))
+				continue;
+			if (!(ss >> dash >> last))
+				last = first;
+			for (unsigned int p = first; p <= last; ++p)
+				processors.push_back(p);
+		}
+		if (!processors.empty())
+			numaNodes.push_back(processors);
+	}
+#elif defined(WIN32)
+	ULONG highestNode;
+	if (GetNumaHighestNodeNumber(&highestNode)) {
+		for (ULONG node = 0; node <= highestNode; ++node) {
+#if defined(_WIN32_WINNT) && (_WIN32_WINNT >= 0x0601)
+			// A node belongs to a single processor group, processors
+			// are numbered group * group size + index in the group
+			GROUP_AFFINITY affinity;
+			if (!GetNumaNodeProcessorMaskEx(static_cast<USHORT>(node), &affinity))
+				continue;
+			const unsigned int groupSize = sizeof(KAFFINITY) * 8;
+			const unsigned int base = affinity.Group * groupSize;
+			const KAFFINITY mask = affinity.Mask;
+#else
+			// Only the processors of the first group are visible
+			const unsigned int groupSize = 64;
+			const unsigned int base = 0;
+			ULONGLONG mask;
+			if (!GetNumaNodeProcessorMask(static_cast<UCHAR>(node), &mask))
+				continue;
+#endif
+			std::vector<unsigned int> processors;
+			for (unsigned int p = 0; p < groupSize; ++p) {
+				if ((mask >> p) & 1)
+					processors.push_back(base + p);
+			}
+			if (!processors.empty())
+				numaNodes.push_back(processors);
+		}
+	}
+#endif
+	// Unknown topology, a single node with all the processors
+	if (numaNodes.empty()) {
+		std::vector<unsigned int> processors;
+		const unsigned int count = std::max(boost::thread::hardware_concurrency(), 1u);
+		for (unsigned int p = 0; p < count; ++p)
+			processors.push_back(p);
+		numaNodes.push_back(processors);
+	}
+}
+
+unsigned int osNumaNodeCount()
+{
+	boost::call_once(osReadNumaNodes, numaNodesFlag);
+	return numaNodes.size();
+}
+
+const std::vector<unsigned int> &osNumaNodeProcessors(unsigned int node)
+{
+	boost::call_once(osReadNumaNodes, numaNodesFlag);
+	return numaNodes[node];
+}
+
+bool osSetThreadAffinity(unsigned int processor)
+{
+#if defined(__linux__)
+	if (processor >= CPU_SETSIZE)
+		return false;
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(processor, &set);
+	return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#elif defined(WIN32)
+#if defined(_WIN32_WINNT) && (_WIN32_WINNT >= 0x0601)
+	const unsigned int groupSize = sizeof(KAFFINITY) * 8;
+	GROUP_AFFINITY affinity;
+	memset(&affinity, 0, sizeof(affinity));
+	affinity.Group = static_cast<WORD>(processor / groupSize);
+	affinity.Mask = static_cast<KAFFINITY>(1) << (processor % groupSize);
+	return SetThreadGroupAffinity(GetCurrentThread(), &affinity, NULL) != 0;
+#else
+	if (processor >= sizeof(DWORD_PTR) * 8)
+		return false;
+	return SetThreadAffinityMask(GetCurrentThread(),
+		static_cast<DWORD_PTR>(1) << processor) != 0;
+#endif
+#else
+	return false;
+#endif
+}
+
 namespace fpdebug
 {
 
@@ -29,10 +29,15 @@ using boost::int32_t;
 using boost::uint32_t;
 #include <istream>
 #include <ostream>
+#include <vector>
 
 #if defined(__linux__) || defined(__APPLE__) || defined(__CYGWIN__)
 #include <stddef.h>
 #include <sys/time.h>
+#include <time.h>
+#if defined(__APPLE__)
+#include <mach/mach_time.h>
+#endif
 #elif defined (WIN32)
 #include <windows.h>
 #else
@@ -97,6 +102,33 @@ inline double osWallClockTime() {
 #endif
 }
 
+// Monotonic clock in nanoseconds, for timing intervals only
+inline boost::uint64_t osNanoClock() {
+#if defined(__APPLE__)
+	static mach_timebase_info_data_t timebase;
+	if (timebase.denom == 0)
+		mach_timebase_info(&timebase);
+	return mach_absolute_time() * timebase.numer / timebase.denom;
+#elif defined(__linux__) || defined(__CYGWIN__)
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+
+	return static_cast<boost::uint64_t>(t.tv_sec) * 1000000000ULL + t.tv_nsec;
+#elif defined (WIN32)
+	static LARGE_INTEGER frequency;
+	if (frequency.QuadPart == 0)
+		QueryPerformanceFrequency(&frequency);
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	// Split to avoid overflowing the 64 bits product
+	const boost::uint64_t seconds = counter.QuadPart / frequency.QuadPart;
+	const boost::uint64_t rest = counter.QuadPart % frequency.QuadPart;
+	return seconds * 1000000000ULL + rest * 1000000000ULL / frequency.QuadPart;
+#else
+#error "Unsupported Platform !!!"
+#endif
+}
+
 //------------------------------------------------------------------------------
 // Atomic ops
 //------------------------------------------------------------------------------
@@ -158,6 +190,53 @@ inline void osAtomicWrite(unsigned int *val, unsigned int newVal) {
 	atomic_write32(reinterpret_cast<boost::uint32_t*>(val), static_cast<boost::uint32_t>(newVal));
 }
 
+/**
+ * Reads a pointer with acquire ordering: the data it points to, as written
+ * before the matching osAtomicStoreRelease, is visible after the read
+ * @return Pointer read
+ */
+template <class T> inline T *osAtomicLoadAcquire(T * const *ptr) {
+#if defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7))
+	return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+#elif defined(WIN32)
+	T *val = *const_cast<T * const volatile *>(ptr);
+	MemoryBarrier();
+	return val;
+#else
+	T *val = *const_cast<T * const volatile *>(ptr);
+	__sync_synchronize();
+	return val;
+#endif
+}
+
+/**
+ * Writes a pointer with release ordering: everything written before is
+ * visible to threads reading the pointer with osAtomicLoadAcquire
+ */
+template <class T> inline void osAtomicStoreRelease(T **ptr, T *newVal) {
+#if defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7))
+	__atomic_store_n(ptr, newVal, __ATOMIC_RELEASE);
+#elif defined(WIN32)
+	MemoryBarrier();
+	*const_cast<T * volatile *>(ptr) = newVal;
+#else
+	__sync_synchronize();
+	*const_cast<T * volatile *>(ptr) = newVal;
+#endif
+}
+
+//------------------------------------------------------------------------------
+// Processor topology
+//------------------------------------------------------------------------------
+
+// Number of NUMA nodes, 1 if the topology is unknown
+extern unsigned int osNumaNodeCount();
+// Logical processors of a NUMA node
+extern const std::vector<unsigned int> &osNumaNodeProcessors(unsigned int node);
+// Binds the calling thread to a logical processor, returns false if the
+// platform doesn't support it or the binding failed
+extern bool osSetThreadAffinity(unsigned int processor);
+
 // Floating point exception debuging
 // Currently only works on linux
 // You can use disable/enable at anypoint on your code, if DEBUGFP is defined,
@@ -93,6 +93,12 @@ template <class T> inline void AddParamType(vector<ParamSetItem<T> *> &vec,
 	EraseParamType(vec, name);
 	vec.push_back(new ParamSetItem<T>(name, data, nItems));
 }
+template <class T> inline void AddParamType(vector<ParamSetItem<T> *> &vec,
+	const string &name, const boost::shared_array<T> &data, u_int nItems)
+{
+	EraseParamType(vec, name);
+	vec.push_back(new ParamSetItem<T>(name, data, nItems));
+}
 template <class T> inline const T *LookupPtr(const vector<ParamSetItem<T> *> &vec,
 	const string &name, u_int *nItems)
 {
@@ -104,6 +110,17 @@ template <class T> inline const T *LookupPtr(const vector<ParamSetItem<T> *> &ve
 		}
 	return NULL;
 }
+template <class T> inline boost::shared_array<T> LookupShared(const vector<ParamSetItem<T> *> &vec,
+	const string &name, u_int *nItems)
+{
+	for (u_int i = 0; i < vec.size(); ++i)
+		if (vec[i]->name == name) {
+			*nItems = vec[i]->nItems;
+			vec[i]->lookedUp = true;
+			return vec[i]->storage;
+		}
+	return boost::shared_array<T>();
+}
 template <class T> inline const T &LookupOne(const vector<ParamSetItem<T> *> &vec,
 	const string &name, const T &d)
 {
@@ -132,46 +149,6 @@ template <class T> inline void MarkAsUsed(const vector<ParamSetItem<T> *> &vec,
 }
 
 // ParamSet Methods
-template <> ParamSetItem<int>::~ParamSetItem()
-{
-	delete[] data;
-}
-
-template <> ParamSetItem<bool>::~ParamSetItem()
-{
-	delete[] data;
-}
-
-template <> ParamSetItem<float>::~ParamSetItem()
-{
-	delete[] data;
-}
-
-template <> ParamSetItem<Point>::~ParamSetItem()
-{
-	delete[] data;
-}
-
-template <> ParamSetItem<Vector>::~ParamSetItem()
-{
-	delete[] data;
-}
-
-template <> ParamSetItem<Normal>::~ParamSetItem()
-{
-	delete[] data;
-}
-
-template <> ParamSetItem<RGBColor>::~ParamSetItem()
-{
-	delete[] data;
-}
-
-template <> ParamSetItem<string>::~ParamSetItem()
-{
-	delete[] data;
-}
-
 ParamSet::ParamSet(const ParamSet &p2) {
 	*this = p2;
 }
@@ -673,6 +650,8 @@ ParamSet::ParamSet(u_int n, const char * pluginName, const char * const tokens[]
 			AddInt(s, (int*)(params[i]));
 		if (s == "outlierrejection_k")
 			AddInt(s, (int*)(params[i]));
+		if (s == "outlierrejection_cellcapacity")
+			AddInt(s, (int*)(params[i]));
 		if (s == "pixelsamples")
 			AddInt(s, (int*)(params[i]));
 		if (s == "power" && pn == "perspective")
@@ -773,6 +752,8 @@ ParamSet::ParamSet(u_int n, const char * pluginName, const char * const tokens[]
 			AddBool(s, (bool*)(params[i]));
 		if (s == "indirectsampleall")
 			AddBool(s, (bool*)(params[i]));
+		if (s == "lighttree")
+			AddBool(s, (bool*)(params[i]));
 		if (s == "premultiplyalpha")
 			AddBool(s, (bool*)(params[i]));
 		if (s == "refineimmediately")
@@ -1065,21 +1046,21 @@ ParamSet &ParamSet::operator=(const ParamSet &p2) {
 
 void ParamSet::Add(ParamSet &params) {
 	for (u_int i = 0; i < params.ints.size(); ++i)
-		AddInt(params.ints[i]->name, params.ints[i]->data, params.ints[i]->nItems);
+		AddParamType(ints, params.ints[i]->name, params.ints[i]->storage, params.ints[i]->nItems);
 	for (u_int i = 0; i < params.bools.size(); ++i)
-		AddBool(params.bools[i]->name, params.bools[i]->data, params.bools[i]->nItems);
+		AddParamType(bools, params.bools[i]->name, params.bools[i]->storage, params.bools[i]->nItems);
 	for (u_int i = 0; i < params.floats.size(); ++i)
-		AddFloat(params.floats[i]->name, params.floats[i]->data, params.floats[i]->nItems);
+		AddParamType(floats, params.floats[i]->name, params.floats[i]->storage, params.floats[i]->nItems);
 	for (u_int i = 0; i < params.points.size(); ++i)
-		AddPoint(params.points[i]->name, params.points[i]->data, params.points[i]->nItems);
+		AddParamType(points, params.points[i]->name, params.points[i]->storage, params.points[i]->nItems);
 	for (u_int i = 0; i < params.vectors.size(); ++i)
-		AddVector(params.vectors[i]->name, params.vectors[i]->data, params.vectors[i]->nItems);
+		AddParamType(vectors, params.vectors[i]->name, params.vectors[i]->storage, params.vectors[i]->nItems);
 	for (u_int i = 0; i < params.normals.size(); ++i)
-		AddNormal(params.normals[i]->name, params.normals[i]->data, params.normals[i]->nItems);
+		AddParamType(normals, params.normals[i]->name, params.normals[i]->storage, params.normals[i]->nItems);
 	for (u_int i = 0; i < params.spectra.size(); ++i)
-		AddRGBColor(params.spectra[i]->name, params.spectra[i]->data, params.spectra[i]->nItems);
+		AddParamType(spectra, params.spectra[i]->name, params.spectra[i]->storage, params.spectra[i]->nItems);
 	for (u_int i = 0; i < params.strings.size(); ++i)
-		AddString(params.strings[i]->name, params.strings[i]->data, params.strings[i]->nItems);
+		AddParamType(strings, params.strings[i]->name, params.strings[i]->storage, params.strings[i]->nItems);
 	for (u_int i = 0; i < params.textures.size(); ++i)
 		AddTexture(params.textures[i]->name, *(params.textures[i]->data));
 }
@@ -1120,6 +1101,30 @@ void ParamSet::AddTexture(const string &name, const string &value)
 {
 	AddParamType(textures, name, &value, 1);
 }
+void ParamSet::AddFloat(const string &name, const boost::shared_array<float> &data, u_int nItems)
+{
+	AddParamType(floats, name, data, nItems);
+}
+void ParamSet::AddInt(const string &name, const boost::shared_array<int> &data, u_int nItems)
+{
+	AddParamType(ints, name, data, nItems);
+}
+void ParamSet::AddPoint(const string &name, const boost::shared_array<Point> &data, u_int nItems)
+{
+	AddParamType(points, name, data, nItems);
+}
+void ParamSet::AddVector(const string &name, const boost::shared_array<Vector> &data, u_int nItems)
+{
+	AddParamType(vectors, name, data, nItems);
+}
+void ParamSet::AddNormal(const string &name, const boost::shared_array<Normal> &data, u_int nItems)
+{
+	AddParamType(normals, name, data, nItems);
+}
+void ParamSet::AddRGBColor(const string &name, const boost::shared_array<RGBColor> &data, u_int nItems)
+{
+	AddParamType(spectra, name, data, nItems);
+}
 bool ParamSet::EraseInt(const string &n) {
 	return EraseParamType(ints, n);
 }
@@ -1163,6 +1168,14 @@ const bool *ParamSet::FindBool(const string &name, u_int *nItems) const
 {
 	return LookupPtr(bools, name, nItems);
 }
+boost::shared_array<float> ParamSet::FindSharedFloat(const string &name, u_int *nItems) const
+{
+	return LookupShared(floats, name, nItems);
+}
+boost::shared_array<int> ParamSet::FindSharedInt(const string &name, u_int *nItems) const
+{
+	return LookupShared(ints, name, nItems);
+}
 int ParamSet::FindOneInt(const string &name, int d) const
 {
 	return LookupOne(ints, name, d);
@@ -27,6 +27,7 @@
 #include "api.h"
 
 #include <boost/serialization/split_member.hpp>
+#include <boost/shared_array.hpp>
 
 #include <map>
 using std::map;
@@ -48,18 +49,25 @@ bool LookupType(const char *token, ParamType *type, string &name);
 template <class T> struct ParamSetItem {
 	// ParamSetItem Public Methods
 	
+	// Items are never modified once created so the array is shared
 	ParamSetItem<T> *Clone() const {
-		return new ParamSetItem<T>(name, data, nItems);
+		return new ParamSetItem<T>(name, storage, nItems);
 	}
 	ParamSetItem() { data=0; }
 	// The const_cast forces a copy of the string data
 	ParamSetItem(const string &n, const T *v, u_int ni = 1) :
-		name(const_cast<string &>(n)), nItems(ni), lookedUp(false) {
-		data = new T[nItems];
+		name(const_cast<string &>(n)), nItems(ni), storage(new T[ni]),
+		lookedUp(false) {
+		data = storage.get();
 		for (u_int i = 0; i < nItems; ++i)
 			data[i] = v[i];
 	}
-	~ParamSetItem();
+	// Adopts the array without copying it
+	ParamSetItem(const string &n, const boost::shared_array<T> &v, u_int ni) :
+		name(const_cast<string &>(n)), nItems(ni), storage(v),
+		lookedUp(false) {
+		data = storage.get();
+	}
 	
 	template<class Archive>
 	void save(Archive & ar, const unsigned int version) const {
@@ -76,9 +84,8 @@ template <class T> struct ParamSetItem {
 	void load(Archive & ar, const unsigned int version) {
 		ar & name;
 		ar & nItems;
-		if(data!=0)
-			delete[] data;
-		data=new T[nItems];
+		storage.reset(new T[nItems]);
+		data = storage.get();
 		for (u_int i = 0; i < nItems; ++i)
 			ar & data[i];
 
@@ -90,6 +97,7 @@ template <class T> struct ParamSetItem {
 	string name;
 	u_int nItems;
 	T *data;
+	boost::shared_array<T> storage;
 	mutable bool lookedUp;
 };
 class LUX_EXPORT ParamSet {
@@ -113,6 +121,14 @@ public:
 	void AddRGBColor(const string &, const RGBColor *, u_int nItems = 1);
 	void AddString(const string &, const string *, u_int nItems = 1);
 	void AddTexture(const string &, const string &);
+	// Adopt the arrays instead of copying them,
+	// they must not be modified afterwards
+	void AddFloat(const string &, const boost::shared_array<float> &, u_int nItems);
+	void AddInt(const string &, const boost::shared_array<int> &, u_int nItems);
+	void AddPoint(const string &, const boost::shared_array<Point> &, u_int nItems);
+	void AddVector(const string &, const boost::shared_array<Vector> &, u_int nItems);
+	void AddNormal(const string &, const boost::shared_array<Normal> &, u_int nItems);
+	void AddRGBColor(const string &, const boost::shared_array<RGBColor> &, u_int nItems);
 	bool EraseInt(const string &);
 	bool EraseBool(const string &);
 	bool EraseFloat(const string &);
@@ -140,6 +156,10 @@ public:
 	const Normal *FindNormal(const string &, u_int *nItems) const;
 	const RGBColor *FindRGBColor(const string &, u_int *nItems) const;
 	const string *FindString(const string &, u_int *nItems) const;
+	// Same as above but share ownership of the array so that it
+	// can be kept without copying, it must not be modified
+	boost::shared_array<float> FindSharedFloat(const string &, u_int *nItems) const;
+	boost::shared_array<int> FindSharedInt(const string &, u_int *nItems) const;
 	boost::shared_ptr<Texture<SWCSpectrum> >
 		GetSWCSpectrumTexture(const string &name,
 		const RGBColor &def) const;
@@ -337,6 +337,8 @@ void PhotonMapPreprocess(const RandomGenerator &rng, const Scene &scene,
 	if (scene.lights.size() == 0)
 		return;
 
+	TraceSpan span(TRACE_PHOTONS, "photonmap");
+
 	std::stringstream ss;
 
 	// Dade - try to read the photon maps from file
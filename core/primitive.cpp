@@ -150,7 +150,14 @@ void InstancePrimitive::GetShadingGeometry(const Transform &obj2world,
 // MotionPrimitive Method Definitions
 bool MotionPrimitive::Intersect(const Ray &r, Intersection *isect) const
 {
-	Transform InstanceToWorld = motionPath.Sample(r.time);
+	// Cheap rejection against the bound at ray time before sampling
+	// the motion path
+	BBox bound(motionBound.Sample(r.time));
+	bound.Expand(MachineEpsilon::E(bound));
+	if (!bound.IntersectP(r))
+		return false;
+
+	const Transform InstanceToWorld(motionPath.SampleCached(r.time));
 
 	Ray ray(Inverse(InstanceToWorld) * r);
 	if (!instance->Intersect(ray, isect))
@@ -172,7 +179,12 @@ bool MotionPrimitive::Intersect(const Ray &r, Intersection *isect) const
 
 bool MotionPrimitive::IntersectP(const Ray &r) const
 {
-	Transform InstanceToWorld = motionPath.Sample(r.time);
+	BBox bound(motionBound.Sample(r.time));
+	bound.Expand(MachineEpsilon::E(bound));
+	if (!bound.IntersectP(r))
+		return false;
+
+	const Transform InstanceToWorld(motionPath.SampleCached(r.time));
 
 	return instance->IntersectP(Inverse(InstanceToWorld) * r);
 }
@@ -190,5 +202,5 @@ void MotionPrimitive::GetShadingGeometry(const Transform &obj2world,
 
 BBox MotionPrimitive::WorldBound() const
 {
-	return motionPath.Bound(instance->WorldBound());
+	return motionBound.Bound();
 }
@@ -47,6 +47,14 @@ public:
 	 * Returns the world bounds of this primitive.
 	 */
 	virtual BBox WorldBound() const = 0;
+	/**
+	 * Returns the world bounds of this primitive as a function of time.
+	 * Accelerators use it to reject moving primitives that can't
+	 * overlap a ray at the ray time.
+	 */
+	virtual MotionBBox WorldMotionBound() const {
+		return MotionBBox(WorldBound());
+	}
 	virtual const Volume *GetExterior() const { return NULL; }
 	virtual const Volume *GetInterior() const { return NULL; }
 	/**
@@ -247,6 +255,9 @@ public:
 	virtual ~AreaLightPrimitive() { }
 
 	virtual BBox WorldBound() const { return prim->WorldBound(); };
+	virtual MotionBBox WorldMotionBound() const {
+		return prim->WorldMotionBound();
+	}
 	virtual const Volume *GetExterior() const { return prim->GetExterior(); }
 	virtual const Volume *GetInterior() const { return prim->GetInterior(); }
 	virtual void Refine(vector<boost::shared_ptr<Primitive> > &refined,
@@ -447,11 +458,13 @@ public:
 	MotionPrimitive(boost::shared_ptr<Primitive> &i,
 		const MotionSystem &i2w, boost::shared_ptr<Material> &mat,
 		boost::shared_ptr<Volume> &ex, boost::shared_ptr<Volume> &in) :
-		instance(i), motionPath(i2w), material(mat),
+		instance(i), motionPath(i2w),
+		motionBound(i2w.MotionBound(i->WorldBound())), material(mat),
 		exterior(ex), interior(in) { }
 	virtual ~MotionPrimitive() { }
 
 	virtual BBox WorldBound() const;
+	virtual MotionBBox WorldMotionBound() const { return motionBound; }
 	virtual const Volume *GetExterior() const {
 		return exterior ? exterior.get() : instance->GetExterior();
 	}
@@ -470,7 +483,7 @@ public:
 	virtual float Area() const { return instance->Area(); }
 	virtual float Sample(float u1, float u2, float u3,
 		DifferentialGeometry *dg) const  {
-		const Transform InstanceToWorld(motionPath.Sample(dg->time));
+		const Transform InstanceToWorld(motionPath.SampleCached(dg->time));
 		float pdf = instance->Sample(u1, u2, u3, dg);
 		pdf *= dg->Volume();
 		*dg *= InstanceToWorld;
@@ -480,7 +493,7 @@ public:
 		return pdf;
 	}
 	virtual float Pdf(const PartialDifferentialGeometry &dg) const {
-		const Transform InstanceToWorld(motionPath.Sample(dg.time));
+		const Transform InstanceToWorld(motionPath.SampleCached(dg.time));
 		const PartialDifferentialGeometry dgi(Inverse(InstanceToWorld) *
 			dg);
 		const float factor = dgi.Volume() / dg.Volume();
@@ -488,7 +501,7 @@ public:
 	}
 	virtual float Sample(const Point &P, float u1, float u2, float u3,
 		DifferentialGeometry *dg) const {
-		const Transform InstanceToWorld(motionPath.Sample(dg->time));
+		const Transform InstanceToWorld(motionPath.SampleCached(dg->time));
 		float pdf = instance->Sample(Inverse(InstanceToWorld) * P,
 			u1, u2, u3, dg);
 		pdf *= dg->Volume();
@@ -499,19 +512,20 @@ public:
 		return pdf;
 	}
 	virtual float Pdf(const Point &p, const PartialDifferentialGeometry &dg) const {
-		const Transform InstanceToWorld(motionPath.Sample(dg.time));
+		const Transform InstanceToWorld(motionPath.SampleCached(dg.time));
 		const PartialDifferentialGeometry dgi(Inverse(InstanceToWorld) *
 			dg);
 		const float factor = dgi.Volume() / dg.Volume();
 		return instance->Pdf(p, dgi) * factor;
 	}
 	virtual Transform GetLocalToWorld(float time) const {
-		return motionPath.Sample(time) * instance->GetLocalToWorld(time);
+		return motionPath.SampleCached(time) * instance->GetLocalToWorld(time);
 	}
 private:
 	// MotionPrimitive Private Data
 	boost::shared_ptr<Primitive> instance;
 	MotionSystem motionPath;
+	MotionBBox motionBound;
 	boost::shared_ptr<Material> material;
 	boost::shared_ptr<Volume> exterior, interior;
 };
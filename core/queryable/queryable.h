@@ -250,6 +250,12 @@ public:
 
 		AddAttrib<QueryableDoubleAttribute>(object, name, description, get, set);
 	}
+	template<class T> friend void AddDoubleAttribute(T &object,
+		const std::string &name, const std::string &description,
+		const boost::function<double (void)> &get, const boost::function<void (double)> set = NULL) {
+
+		AddAttrib<QueryableDoubleAttribute>(object, name, description, get, set);
+	}
 
 	template<class T, class E> friend void AddIntEnumAttribute(T &object,
 		const std::string &name, const std::string &description,
@@ -286,6 +292,12 @@ public:
 		const std::string &name, const std::string &description,
 		int (T::*get)(), void (T::*set)(int) = NULL) {
 
+		AddAttrib<QueryableIntAttribute>(object, name, description, get, set);
+	}
+	template<class T> friend void AddIntAttribute(T &object,
+		const std::string &name, const std::string &description,
+		const boost::function<int (void)> &get, const boost::function<void (int)> set = NULL) {
+
 		AddAttrib<QueryableIntAttribute>(object, name, description, get, set);
 	}
 protected:
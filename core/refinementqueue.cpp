@@ -0,0 +1,155 @@
+/***************************************************************************
+ *   Copyright (C) 1998-2013 by authors (see AUTHORS.txt)                  *
+ *                                                                         *
+ *   This file is part of LuxRender.                                       *
+ *                                                                         *
+ *   Lux Renderer is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   Lux Renderer is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                         *
+ *   This project is based on PBRT ; see http://www.pbrt.org               *
+ *   Lux Renderer website : http://www.luxrender.net                       *
+ ***************************************************************************/
+
+
+#include "refinementqueue.h"
+#include "primitive.h"
+#include "error.h"
+#include "tracer.h"
+
+#include <boost/bind.hpp>
+
+#include <map>
+using std::map;
+
+using namespace lux;
+
+// Set on the worker threads of all queues
+static boost::thread_specific_ptr<bool> inRefinementWorker;
+
+RefinementQueue::RefinementQueue() : nextJob(0), jobsDone(0), stop(false)
+{
+}
+
+RefinementQueue::~RefinementQueue()
+{
+	{
+		boost::mutex::scoped_lock lock(queueMutex);
+		stop = true;
+		jobCondition.notify_all();
+	}
+	workers.join_all();
+
+	for (size_t i = 0; i < jobs.size(); ++i)
+		delete jobs[i];
+}
+
+void RefinementQueue::Push(const boost::shared_ptr<Primitive> &prim,
+	vector<boost::shared_ptr<Primitive> > *refined)
+{
+	Job *job = new Job();
+	job->prim = prim;
+	job->destination = refined;
+	job->index = refined->size() - 1;
+
+	boost::mutex::scoped_lock lock(queueMutex);
+	// Start the workers with the first job, most contexts never parse
+	// a scene with shapes to refine
+	if (workers.size() == 0) {
+		const u_int threadCount = max(1U, boost::thread::hardware_concurrency());
+		for (u_int i = 0; i < threadCount; ++i)
+			workers.create_thread(boost::bind(&RefinementQueue::Worker, this));
+	}
+	jobs.push_back(job);
+	jobCondition.notify_one();
+}
+
+void RefinementQueue::Flush()
+{
+	boost::mutex::scoped_lock lock(queueMutex);
+	if (jobs.size() == 0)
+		return;
+	while (jobsDone < jobs.size())
+		doneCondition.wait(lock);
+
+	// Jobs are in declaration order, so are the placeholders
+	// of each destination
+	map<vector<boost::shared_ptr<Primitive> > *, vector<Job *> > destinations;
+	for (size_t i = 0; i < jobs.size(); ++i)
+		destinations[jobs[i]->destination].push_back(jobs[i]);
+
+	for (map<vector<boost::shared_ptr<Primitive> > *, vector<Job *> >::iterator d = destinations.begin(); d != destinations.end(); ++d) {
+		vector<boost::shared_ptr<Primitive> > &destination(*(d->first));
+		const vector<Job *> &destinationJobs(d->second);
+		size_t count = destination.size();
+		for (size_t i = 0; i < destinationJobs.size(); ++i)
+			count += destinationJobs[i]->refined.size() - 1;
+
+		vector<boost::shared_ptr<Primitive> > result;
+		result.reserve(count);
+		size_t start = 0;
+		for (size_t i = 0; i < destinationJobs.size(); ++i) {
+			Job &job(*destinationJobs[i]);
+			result.insert(result.end(), destination.begin() + start,
+				destination.begin() + job.index);
+			result.insert(result.end(), job.refined.begin(),
+				job.refined.end());
+			start = job.index + 1;
+		}
+		result.insert(result.end(), destination.begin() + start,
+			destination.end());
+		destination.swap(result);
+	}
+
+	for (size_t i = 0; i < jobs.size(); ++i)
+		delete jobs[i];
+	jobs.clear();
+	nextJob = 0;
+	jobsDone = 0;
+}
+
+bool RefinementQueue::InWorker()
+{
+	return inRefinementWorker.get() != NULL;
+}
+
+void RefinementQueue::Worker()
+{
+	inRefinementWorker.reset(new bool(true));
+	for (;;) {
+		Job *job;
+		{
+			boost::mutex::scoped_lock lock(queueMutex);
+			while (!stop && nextJob == jobs.size())
+				jobCondition.wait(lock);
+			if (stop)
+				return;
+			job = jobs[nextJob++];
+		}
+
+		try {
+			TraceSpan span(TRACE_REFINE);
+			job->prim->Refine(job->refined,
+				PrimitiveRefinementHints(false), job->prim);
+		} catch (std::exception &e) {
+			LOG(LUX_ERROR, LUX_SYSTEM) << "Error refining a primitive: " << e.what();
+			// Leave the refinement to the accelerator
+			job->refined.clear();
+			job->refined.push_back(job->prim);
+		}
+
+		boost::mutex::scoped_lock lock(queueMutex);
+		++jobsDone;
+		if (jobsDone == jobs.size())
+			doneCondition.notify_all();
+	}
+}
@@ -0,0 +1,80 @@
+/***************************************************************************
+ *   Copyright (C) 1998-2013 by authors (see AUTHORS.txt)                  *
+ *                                                                         *
+ *   This file is part of LuxRender.                                       *
+ *                                                                         *
+ *   Lux Renderer is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   Lux Renderer is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                         *
+ *   This project is based on PBRT ; see http://www.pbrt.org               *
+ *   Lux Renderer website : http://www.luxrender.net                       *
+ ***************************************************************************/
+
+
+#ifndef LUX_REFINEMENTQUEUE_H
+#define LUX_REFINEMENTQUEUE_H
+// refinementqueue.h*
+
+#include "lux.h"
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/tss.hpp>
+#include <boost/noncopyable.hpp>
+
+namespace lux
+{
+
+// Refines primitives, including the construction of per mesh
+// accelerators, on worker threads while the scene is still being parsed.
+// The primitive being refined is stored in the destination vector as a
+// placeholder until Flush() replaces it by its refined primitives.
+class RefinementQueue : public boost::noncopyable {
+public:
+	RefinementQueue();
+	// Stops the workers, the jobs not yet refined are dropped
+	~RefinementQueue();
+
+	// Schedules the refinement of prim, which must be the last element
+	// of refined
+	void Push(const boost::shared_ptr<Primitive> &prim,
+		vector<boost::shared_ptr<Primitive> > *refined);
+	// Waits for all scheduled refinements and stores their results
+	// in place of the placeholders, keeping the declaration order
+	void Flush();
+	// Whether the calling thread is a refinement worker, refinements
+	// already running in parallel shouldn't start threads of their own
+	static bool InWorker();
+
+private:
+	struct Job {
+		boost::shared_ptr<Primitive> prim;
+		vector<boost::shared_ptr<Primitive> > *destination;
+		size_t index;
+		vector<boost::shared_ptr<Primitive> > refined;
+	};
+
+	void Worker();
+
+	boost::mutex queueMutex;
+	boost::condition_variable jobCondition, doneCondition;
+	boost::thread_group workers;
+	vector<Job *> jobs;
+	size_t nextJob, jobsDone;
+	bool stop;
+};
+
+}//namespace lux
+
+#endif // LUX_REFINEMENTQUEUE_H
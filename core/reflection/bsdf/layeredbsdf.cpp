@@ -43,6 +43,7 @@ LayeredBSDF::LayeredBSDF(const DifferentialGeometry &dgs, const Normal &ngeom,
 	nBSDFs = 0;
 	maxNumBounces = 1; // Note this gets changed when layers are added
 	probSampleSpec = .5f;
+	eyePathCache = NULL;
 }
 
 bool LayeredBSDF::SampleF(const SpectrumWavelengths &sw, const Vector &known, Vector *sampled,
@@ -201,53 +202,55 @@ SWCSpectrum LayeredBSDF::F(const SpectrumWavelengths &sw, const Vector &woW,
 		return SWCSpectrum(0.f);
 
 	// Create storage for incoming/outgoing paths
-	vector<int> eyeLayer;
-	vector<Vector> eyeVector;
-	vector<float> eyePdfForward;
-	vector<float> eyePdfBack;
-	vector<SWCSpectrum> eyeL;
-	vector<BxDFType> eyeType;
-
-	vector<int> lightLayer;
-	vector<Vector> lightVector;
-	vector<float> lightPdfForward;
-	vector<float> lightPdfBack;
-	vector<SWCSpectrum> lightL;
-	vector<BxDFType> lightType;
+	LayeredPath lightPath;
+	LayeredPath eyePathStorage;
+	const LayeredPath *eyePath = &eyePathStorage;
 
 	// now create the two paths
 	int lightIndex = (Dot(ng,woW) < 0.f) ? nBSDFs - 1 : 0;
 	int eyeIndex = (Dot(ng, wiW) < 0.f) ? nBSDFs - 1 : 0;
 
-	GetPath(sw, woW, lightIndex, &lightL, &lightVector, &lightLayer,
-		&lightPdfForward, &lightPdfBack, &lightType); //light
-	GetPath(sw, wiW, eyeIndex, &eyeL, &eyeVector, &eyeLayer,
-		&eyePdfForward, &eyePdfBack, &eyeType); //eye
+	GetPath(sw, woW, lightIndex, &lightPath); //light
+	if (eyePathCache) {
+		// Reuse the eye path of the previous evaluation if possible
+		if (!eyePathCache->valid || eyePathCache->dir.x != wiW.x ||
+			eyePathCache->dir.y != wiW.y || eyePathCache->dir.z != wiW.z ||
+			eyePathCache->single != sw.single) {
+			eyePathCache->path.length = 0;
+			GetPath(sw, wiW, eyeIndex, &eyePathCache->path);
+			eyePathCache->dir = wiW;
+			eyePathCache->single = sw.single;
+			eyePathCache->valid = true;
+		}
+		eyePath = &eyePathCache->path;
+	} else
+		GetPath(sw, wiW, eyeIndex, &eyePathStorage); //eye
 
 	// now connect them
 	SWCSpectrum L(0.f);	// this is the accumulated L value for the current path 
 	SWCSpectrum newF(0.f);
 
-	const u_int maxVertices = eyeLayer.size() + lightLayer.size() - 1;
-	float* fwdProb = new float[maxVertices];
-	float* backProb = new float[maxVertices];
-	bool* spec = new bool[maxVertices];
-	for (size_t i = 0; i < eyeLayer.size(); ++i) { // for every vertex in the eye path
-		for (size_t j = 0;j < lightLayer.size(); ++j) { // try to connect to every vert in the light path
-			if (eyeLayer[i] != lightLayer[j]) // then pass the "visibility test" so connect them
+	float fwdProb[2 * MAX_LAYERED_VERTICES];
+	float backProb[2 * MAX_LAYERED_VERTICES];
+	bool spec[2 * MAX_LAYERED_VERTICES];
+	for (size_t i = 0; i < eyePath->length; ++i) { // for every vertex in the eye path
+		for (size_t j = 0;j < lightPath.length; ++j) { // try to connect to every vert in the light path
+			if (eyePath->layer[i] != lightPath.layer[j]) // then pass the "visibility test" so connect them
 				continue;
-			int curLayer = eyeLayer[i];
+			int curLayer = eyePath->layer[i];
+			const Vector &eyeVector(eyePath->vec[i]);
+			const Vector &lightVector(lightPath.vec[j]);
 			// First calculate the total L for the path
 
-			SWCSpectrum Lpath = bsdfs[curLayer]->F(sw, eyeVector[i], lightVector[j], true, BxDFType(BSDF_ALL)) / AbsDot(eyeVector[i], bsdfs[curLayer]->dgShading.nn); // calc how much goes between them
+			SWCSpectrum Lpath = bsdfs[curLayer]->F(sw, eyeVector, lightVector, true, BxDFType(BSDF_ALL)) / AbsDot(eyeVector, bsdfs[curLayer]->dgShading.nn); // calc how much goes between them
 			// NOTE: used reverse==True to get F=f*|wo.ns| = f * cos(theta_in)
 
-			Lpath = eyeL[i] * Lpath * lightL[j];
+			Lpath = eyePath->L[i] * Lpath * lightPath.L[j];
 
 			if (Lpath.Black())	// if it is black we may have a specular connection
 				continue;
-			float pgapFwd = bsdfs[curLayer]->Pdf(sw, lightVector[j], eyeVector[i], BxDFType(BSDF_ALL)); // should be prob of sampling eye vector given light vector
-			float pgapBack = bsdfs[curLayer]->Pdf(sw, eyeVector[i], lightVector[j], BxDFType(BSDF_ALL));
+			float pgapFwd = bsdfs[curLayer]->Pdf(sw, lightVector, eyeVector, BxDFType(BSDF_ALL)); // should be prob of sampling eye vector given light vector
+			float pgapBack = bsdfs[curLayer]->Pdf(sw, eyeVector, lightVector, BxDFType(BSDF_ALL));
 
 			// Now calc the probability of sampling this path (surely there must be a better way!!!)
 			float totProb = 0.f;
@@ -255,17 +258,17 @@ SWCSpectrum LayeredBSDF::F(const SpectrumWavelengths &sw, const Vector &woW,
 
 			// construct the list of fwd/back probs
 			for (size_t k = 0; k < j; ++k) {
-				fwdProb[k] = lightPdfForward[k + 1];
-				backProb[k] = lightPdfBack[k + 1];
-				spec[k] = (BSDF_SPECULAR & lightType[k + 1]) != 0;
+				fwdProb[k] = lightPath.pdfForward[k + 1];
+				backProb[k] = lightPath.pdfBack[k + 1];
+				spec[k] = (BSDF_SPECULAR & lightPath.sampleType[k + 1]) != 0;
 			}
 			fwdProb[j] = pgapFwd;
 			backProb[j] = pgapBack;
 			spec[j] = false;		// if this is true then the bsdf above will ==0 and cancel it out anyway
 			for (size_t k = 0; k < i; ++k) {	
-				fwdProb[j + i - k] = eyePdfBack[k];
-				backProb[j + i - k] = eyePdfForward[k];
-				spec[j + i - k] = (BSDF_SPECULAR & eyeType[k]) != 0;
+				fwdProb[j + i - k] = eyePath->pdfBack[k];
+				backProb[j + i - k] = eyePath->pdfForward[k];
+				spec[j + i - k] = (BSDF_SPECULAR & eyePath->sampleType[k]) != 0;
 			}
 
 			for (size_t join = 0; join <= i + j; ++join) {
@@ -284,9 +287,6 @@ SWCSpectrum LayeredBSDF::F(const SpectrumWavelengths &sw, const Vector &woW,
 				L += Lpath * (pathProb / totProb);
 		}
 	}
-	delete[] fwdProb;
-	delete[] backProb;
-	delete[] spec;
 
 	// Apply the geometric correction factor if the result is used for
 	// a light path (reverse=false)
@@ -305,14 +305,13 @@ float LayeredBSDF::ApplyTransform(const Transform &transform)
 {
 	for (u_int i = 0; i < nBSDFs; ++i)
 		bsdfs[i]->ApplyTransform(transform);
+	if (eyePathCache)
+		eyePathCache->valid = false;
 	return this->BSDF::ApplyTransform(transform);
 }
 
 int LayeredBSDF::GetPath(const SpectrumWavelengths &sw, const Vector &vin,
-	const int startIndex, vector<SWCSpectrum> *pathL,
-	vector<Vector> *pathVec, vector<int> *pathLayer, 
-	vector<float> *pathPdfForward, vector<float> *pathPdfBack,
-	vector<BxDFType> *pathSampleType) const
+	const int startIndex, LayeredPath *path) const
 {
 	// returns the number of bounces used in this path
 	// if eye==TRUE we are calculating the eye path
@@ -333,12 +332,13 @@ int LayeredBSDF::GetPath(const SpectrumWavelengths &sw, const Vector &vin,
 			return i;
 
 		// STORE THE CURRENT PATH INFO
-		pathL->push_back(L);
-		pathVec->push_back(curVin);
-		pathLayer->push_back(curLayer);
-		pathPdfForward->push_back(pdfForward);
-		pathPdfBack->push_back(pdfBack);
-		pathSampleType->push_back(sampledType);
+		const u_int n = path->length++;
+		path->L[n] = L;
+		path->vec[n] = curVin;
+		path->layer[n] = curLayer;
+		path->pdfForward[n] = pdfForward;
+		path->pdfBack[n] = pdfBack;
+		path->sampleType[n] = sampledType;
 
 		// get the next sample
 
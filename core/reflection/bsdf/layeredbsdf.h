@@ -32,6 +32,36 @@
 
 namespace lux
 {
+#define MAX_BSDFS 8
+// A path bounces at most 3 times per layer
+#define MAX_LAYERED_VERTICES (MAX_BSDFS * 3)
+
+// Vertices of a random walk through the layers, stored in fixed size arrays
+// so that paths live on the stack
+class LayeredPath {
+public:
+	LayeredPath() : length(0) { }
+
+	u_int length;
+	SWCSpectrum L[MAX_LAYERED_VERTICES];
+	Vector vec[MAX_LAYERED_VERTICES];
+	int layer[MAX_LAYERED_VERTICES];
+	float pdfForward[MAX_LAYERED_VERTICES];
+	float pdfBack[MAX_LAYERED_VERTICES];
+	BxDFType sampleType[MAX_LAYERED_VERTICES];
+};
+
+// Last eye path of a LayeredBSDF, reused by F() while the eye direction does
+// not change, as happens when sampling several lights from the same vertex
+class LayeredPathCache {
+public:
+	LayeredPathCache() : valid(false) { }
+
+	bool valid, single;
+	Vector dir;
+	LayeredPath path;
+};
+
 // LayeredBSDF declaration
 class  LayeredBSDF : public BSDF  {
 public:
@@ -63,10 +93,11 @@ public:
 
 	bool MatchesFlags(BxDFType flags) const { return (flags&(BSDF_GLOSSY|BSDF_SPECULAR)) ? true: false;}
 
-	int GetPath(const SpectrumWavelengths &sw, const Vector &vin, const int start_index, 
-		vector<SWCSpectrum> *pathL, vector<Vector> *pathVec,
-		vector<int> *pathLayer, vector<float> *pathPdfForward,
-		vector<float> *pathPdfBack, vector<BxDFType> *pathSampleType) const;
+	int GetPath(const SpectrumWavelengths &sw, const Vector &vin, const int start_index,
+		LayeredPath *path) const;
+
+	// The cache has to be allocated with the BSDF, it is not thread safe
+	void SetPathCache(LayeredPathCache *cache) { eyePathCache = cache; }
 
 	unsigned int GetRandSeed() const;	// seed not threadsafe (won't crash but may be corrupt)
 
@@ -77,13 +108,14 @@ protected:
 	virtual ~LayeredBSDF() { }
 	
 	u_int nBSDFs;
-	#define MAX_BSDFS 8
 	BSDF *bsdfs[MAX_BSDFS];
 	float opacity[MAX_BSDFS];
 
 	int maxNumBounces;
 
 	float probSampleSpec;	// probability of sampling the specular component (vs glossy)
+
+	LayeredPathCache *eyePathCache;
 };
 // LayeredBSDF Inline Method Definitions
 inline void LayeredBSDF::Add(BSDF *b, float op)
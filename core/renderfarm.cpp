@@ -140,7 +140,7 @@ RenderFarm::CompiledFile::CompiledFile(const std::string &filename) : fname(file
 	fhash = digest_string(file_hash<tigerhash>(filename));
 }
 
-bool RenderFarm::CompiledFile::send(std::iostream &stream) const {
+bool RenderFarm::CompiledFile::send(std::iostream &stream, boost::uint64_t &bytesSent) const {
 	LOG(LUX_DEBUG,LUX_NOERROR) << "Sending file '" << filename() << "'";
 
 	std::ifstream in(filename().c_str(), std::ios::in | std::ios::binary);
@@ -160,6 +160,7 @@ bool RenderFarm::CompiledFile::send(std::iostream &stream) const {
 		// Send the file length
 		stream << filename() << "\n";
 		stream << len << "\n";
+		bytesSent += len;
 
 		// Send the file
 		vector<char> buffer(1 * 1024 * 1024, 0);
@@ -211,7 +212,7 @@ const RenderFarm::CompiledFile& RenderFarm::CompiledFiles::fromHash(filehash_t h
 	return files[it->second];
 }
 
-bool RenderFarm::CompiledFiles::send(std::iostream &stream) const {
+bool RenderFarm::CompiledFiles::send(std::iostream &stream, boost::uint64_t &bytesSent) const {
 	LOG(LUX_DEBUG,LUX_NOERROR) << "Sending files";
 
 	stream << "BEGIN FILES" << "\n";
@@ -234,7 +235,7 @@ bool RenderFarm::CompiledFiles::send(std::iostream &stream) const {
 		// TODO - catch exception in case of invalid hash
 		const CompiledFile &cf(fromHash(hash));
 
-		if (!cf.send(stream))
+		if (!cf.send(stream, bytesSent))
 			return false;
 
 		std::string response = get_response(stream);
@@ -247,7 +248,7 @@ bool RenderFarm::CompiledFiles::send(std::iostream &stream) const {
 		}
 
 		// resend file once
-		if (!cf.send(stream))
+		if (!cf.send(stream, bytesSent))
 			return false;
 	}
 
@@ -259,14 +260,16 @@ bool RenderFarm::CompiledFiles::send(std::iostream &stream) const {
 }
 
 RenderFarm::CompiledCommand::CompiledCommand(const std::string &cmd) 
-	: command(cmd), hasParams(false), paramsBuf(std::stringstream::in | std::stringstream::out  | std::stringstream::binary) 
+	: command(cmd), hasParams(false), paramsBuf(std::stringstream::in | std::stringstream::out  | std::stringstream::binary),
+	prepared(false)
 {
 	// set precision for accurate transmission of floats
 	paramsBuf << std::scientific << std::setprecision(16);
 }
 
 RenderFarm::CompiledCommand::CompiledCommand(const RenderFarm::CompiledCommand &other) 
-	: command(other.command), hasParams(other.hasParams), paramsBuf(std::stringstream::in | std::stringstream::out  | std::stringstream::binary), files(other.files)
+	: command(other.command), hasParams(other.hasParams), paramsBuf(std::stringstream::in | std::stringstream::out  | std::stringstream::binary), files(other.files),
+	prepared(false)
 {
 	// set precision for accurate transmission of floats
 	paramsBuf << std::scientific << std::setprecision(16) << other.paramsBuf.str();
@@ -281,11 +284,13 @@ RenderFarm::CompiledCommand& RenderFarm::CompiledCommand::operator=(const Render
 	paramsBuf.str(other.paramsBuf.str());
 	files.clear();
 	files.assign(other.files.begin(), other.files.end());
+	prepared = false;
 
 	return *this;
 }
 
 std::ostream& RenderFarm::CompiledCommand::buffer() {
+	prepared = false;
 	return paramsBuf;
 }
 
@@ -313,17 +318,24 @@ void RenderFarm::CompiledCommand::addParams(const ParamSet &params) {
 	// Copy the compressed parameters to the newtwork buffer
 	paramsBuf << zos.str() << "\n";
 	hasParams = true;
+	prepared = false;
+}
+
+void RenderFarm::CompiledCommand::prepare() {
+	if (prepared)
+		return;
+	payload = command + "\n" + paramsBuf.str();
+	prepared = true;
 }
 
 void RenderFarm::CompiledCommand::addFile(const std::string &paramName, const CompiledFile &cf) {
 	files.push_back(std::make_pair(paramName, cf));
 }
 
-bool RenderFarm::CompiledCommand::send(std::iostream &stream) const {
-	stream << command << "\n";
-	string buf = paramsBuf.str();
-	stream << buf;
-	string response;
+bool RenderFarm::CompiledCommand::send(std::iostream &stream, boost::uint64_t &bytesSent) const {
+	// prepare() must have been called
+	stream << payload;
+	bytesSent += payload.size();
 
 	// no params means no files
 	if (!hasParams)
@@ -365,12 +377,17 @@ RenderFarm::CompiledCommand& RenderFarm::CompiledCommands::add(const std::string
 
 RenderFarm::RenderFarm() : Queryable("render_farm"),
 		filmUpdateThread(NULL), flushThread(NULL), netBufferComplete(false), doneRendering(false),
-		isLittleEndian(osIsLittleEndian()), pollingInterval(3 * 60), defaultTcpPort(18018)
+		isLittleEndian(osIsLittleEndian()), pollingInterval(3 * 60), defaultTcpPort(18018),
+		maxConcurrentUploads(8), lastUploadTime(0.0), lastUploadBytes(0.0)
 {
 	AddIntAttribute(*this, "defaultTcpPort", "Default TCP port", &RenderFarm::defaultTcpPort, ReadWriteAccess);
 	AddIntAttribute(*this, "pollingInterval", "Polling interval", &RenderFarm::pollingInterval, ReadWriteAccess);
 	AddIntAttribute(*this, "slaveNodeCount", "Number of network slave nodes", &RenderFarm::getSlaveNodeCount);
 	AddDoubleAttribute(*this, "updateTimeRemaining", "Time remaining until next update", &RenderFarm::getUpdateTimeRemaining);
+	AddIntAttribute(*this, "maxConcurrentUploads", "Maximum number of servers receiving the scene at the same time", &RenderFarm::maxConcurrentUploads, ReadWriteAccess);
+	AddDoubleAttribute(*this, "lastUploadTime", "Duration of the last scene upload in seconds", &RenderFarm::lastUploadTime);
+	AddDoubleAttribute(*this, "lastUploadBytes", "Bytes sent to all servers during the last scene upload", &RenderFarm::lastUploadBytes);
+	AddStringAttribute(*this, "uploadStatistics", "Size, duration and bandwidth of the last scene upload of each server", &RenderFarm::getUploadStatistics);
 }
 
 RenderFarm::~RenderFarm()
@@ -743,34 +760,37 @@ bool RenderFarm::sessionReset(const string &serverName, const string &password)
 	return true;
 }
 void RenderFarm::flushImpl() {
-	//flush network buffer
+	// NOTE - requires serverListMutex to be aquired by caller
+	std::vector<size_t> pending;
 	for (size_t i = 0; i < serverInfoList.size(); i++) {
-		if(serverInfoList[i].active && !serverInfoList[i].flushed) {
-			try {
-				LOG( LUX_INFO,LUX_NOERROR) << "Sending commands to server: " <<
-						serverInfoList[i].name << ":" << serverInfoList[i].port;
-
-				tcp::iostream stream(serverInfoList[i].name, serverInfoList[i].port);
-				stream.rdbuf()->set_option(tcp::no_delay(true));
-				//stream << commands << endl;
-				for (size_t j = 0; j < compiledCommands.size(); j++) {
-					// send command
-					if (!compiledCommands[j].send(stream))
-						break;
-
-					// and then send any requested files
-					if (!compiledCommands[j].sendFiles())
-						continue;
-
-					if (!compiledFiles.send(stream))
-						break;
-				}
-
-				serverInfoList[i].flushed = true;
-			} catch (exception& e) {
-				LOG(LUX_ERROR,LUX_SYSTEM)<< e.what();
-			}
-		}
+		if(serverInfoList[i].active && !serverInfoList[i].flushed)
+			pending.push_back(i);
+	}
+
+	if (!pending.empty()) {
+		// Serialize the commands once, the uploads share them
+		for (size_t j = 0; j < compiledCommands.size(); j++)
+			compiledCommands[j].prepare();
+
+		//flush network buffer to all servers concurrently
+		const double start = osWallClockTime();
+		const size_t nWorkers = min(pending.size(),
+			static_cast<size_t>(max(1, maxConcurrentUploads)));
+		size_t next = 0;
+		boost::mutex nextMutex;
+		boost::thread_group workers;
+		for (size_t i = 0; i < nWorkers; ++i)
+			workers.create_thread(boost::bind(&RenderFarm::flushWorker,
+				this, boost::cref(pending), &next, &nextMutex));
+		workers.join_all();
+
+		lastUploadTime = osWallClockTime() - start;
+		lastUploadBytes = 0.0;
+		for (size_t i = 0; i < pending.size(); i++)
+			lastUploadBytes += serverInfoList[pending[i]].uploadedBytes;
+		LOG(LUX_INFO,LUX_NOERROR) << "Scene sent to " <<
+			pending.size() << " servers in " << lastUploadTime <<
+			"s (" << (lastUploadBytes / 1024) << " Kbytes)";
 	}
 
 	// Dade - write info only if there was the communication with some server
@@ -779,6 +799,61 @@ void RenderFarm::flushImpl() {
 	}
 }
 
+void RenderFarm::flushWorker(const std::vector<size_t> &pending, size_t *next,
+	boost::mutex *nextMutex) {
+	while (true) {
+		size_t index;
+		{
+			boost::mutex::scoped_lock lock(*nextMutex);
+			if (*next >= pending.size())
+				return;
+			index = pending[(*next)++];
+		}
+		flushServer(serverInfoList[index]);
+	}
+}
+
+void RenderFarm::flushServer(ExtRenderingServerInfo &serverInfo) {
+	// NOTE - called concurrently for different servers, only serverInfo
+	// may be modified
+	const double start = osWallClockTime();
+	boost::uint64_t bytesSent = 0;
+	try {
+		LOG( LUX_INFO,LUX_NOERROR) << "Sending commands to server: " <<
+				serverInfo.name << ":" << serverInfo.port;
+
+		tcp::iostream stream(serverInfo.name, serverInfo.port);
+		stream.rdbuf()->set_option(tcp::no_delay(true));
+		//stream << commands << endl;
+		for (size_t j = 0; j < compiledCommands.size(); j++) {
+			// send command
+			if (!compiledCommands[j].send(stream, bytesSent))
+				break;
+
+			// and then send any requested files
+			if (!compiledCommands[j].sendFiles())
+				continue;
+
+			if (!compiledFiles.send(stream, bytesSent))
+				break;
+		}
+		stream.flush();
+
+		serverInfo.flushed = true;
+	} catch (exception& e) {
+		LOG(LUX_ERROR,LUX_SYSTEM)<< e.what();
+	}
+
+	serverInfo.uploadedBytes = static_cast<double>(bytesSent);
+	serverInfo.uploadSeconds = osWallClockTime() - start;
+	LOG(LUX_INFO,LUX_NOERROR) << "Commands sent to server: " <<
+		serverInfo.name << ":" << serverInfo.port << " (" <<
+		(bytesSent / 1024) << " Kbytes in " << serverInfo.uploadSeconds <<
+		"s, " << (serverInfo.uploadSeconds > 0.0 ?
+		serverInfo.uploadedBytes / (1024 * 1024) / serverInfo.uploadSeconds : 0.0) <<
+		" Mbytes/s)";
+}
+
 void RenderFarm::flush() {
 	boost::mutex::scoped_lock lock(serverListMutex);
 
@@ -1237,6 +1312,21 @@ u_int RenderFarm::getSlaveNodeCount() {
 	return serverInfoList.size();
 }
 
+std::string RenderFarm::getUploadStatistics() {
+	boost::mutex::scoped_lock lock(serverListMutex);
+
+	// name:port bytes seconds bytes/s, one server per line
+	std::stringstream ss;
+	for (size_t i = 0; i < serverInfoList.size(); ++i) {
+		const ExtRenderingServerInfo &info(serverInfoList[i]);
+		ss << info.name << ":" << info.port << " " <<
+			info.uploadedBytes << " " << info.uploadSeconds << " " <<
+			(info.uploadSeconds > 0.0 ?
+			info.uploadedBytes / info.uploadSeconds : 0.0) << "\n";
+	}
+	return ss.str();
+}
+
 u_int RenderFarm::getServersStatus(RenderingServerInfo *info, u_int maxInfoCount) const {
 	ptime now = second_clock::local_time();
 	for (size_t i = 0; i < min<size_t>(serverInfoList.size(), maxInfoCount); ++i) {
@@ -32,6 +32,7 @@
 #include <sstream>
 
 #include <boost/thread.hpp>
+#include <boost/cstdint.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 
 namespace lux
@@ -129,6 +130,7 @@ private:
 			timeLastContact(boost::posix_time::second_clock::local_time()),
 			timeLastSamples(boost::posix_time::second_clock::local_time()),
 			numberOfSamplesReceived(0.0), calculatedSamplesPerSecond(0.0),
+			uploadedBytes(0.0), uploadSeconds(0.0),
 			name(n), port(p), sid(id), active(false), flushed(false) { }
 
 		// returns true if "other" has the same name and port
@@ -141,6 +143,9 @@ private:
 		// all buffer groups in the film
 		double numberOfSamplesReceived;
 		double calculatedSamplesPerSecond;
+		// size and duration of the last scene upload
+		double uploadedBytes;
+		double uploadSeconds;
 
 		string name;
 		string port;
@@ -166,7 +171,7 @@ private:
 			return fhash;
 		}
 
-		bool send(std::iostream &stream) const;
+		bool send(std::iostream &stream, boost::uint64_t &bytesSent) const;
 
 		bool operator<(const CompiledFile& other) const {
 			return fhash < other.fhash;
@@ -185,7 +190,7 @@ private:
 		const CompiledFile& fromFilename(std::string filename) const;
 		const CompiledFile& fromHash(filehash_t hash) const;
 
-		bool send(std::iostream &stream) const;
+		bool send(std::iostream &stream, boost::uint64_t &bytesSent) const;
 
 	private:
 		std::vector<CompiledFile> files;
@@ -197,7 +202,7 @@ private:
 
 	class CompiledCommand {
 	public:
-		CompiledCommand() { }
+		CompiledCommand() : prepared(false) { }
 		CompiledCommand(const std::string &cmd);
 		CompiledCommand(const CompiledCommand &other);
 
@@ -208,7 +213,10 @@ private:
 		void addParams(const ParamSet &params);
 		void addFile(const std::string &paramName, const CompiledFile &cf);
 
-		bool send(std::iostream &stream) const;
+		// Serializes the command once so that it can be sent
+		// concurrently to several servers
+		void prepare();
+		bool send(std::iostream &stream, boost::uint64_t &bytesSent) const;
 
 		bool sendFiles() const {
 			return hasParams && !files.empty();
@@ -219,6 +227,8 @@ private:
 		bool hasParams;
 		std::stringstream paramsBuf;
 		std::vector<std::pair<std::string, CompiledFile> > files;
+		std::string payload;
+		bool prepared;
 	};
 
 	class CompiledCommands {
@@ -250,11 +260,15 @@ private:
 	bool connect(ExtRenderingServerInfo &serverInfo);
 	reconnect_status_t reconnect(ExtRenderingServerInfo &serverInfo);
 	void flushImpl();
+	void flushWorker(const std::vector<size_t> &pending, size_t *next,
+		boost::mutex *nextMutex);
+	void flushServer(ExtRenderingServerInfo &serverInfo);
 	void disconnect(const ExtRenderingServerInfo &serverInfo);
 	void reconnectFailed();
 	void stopImpl();
 
 	u_int getSlaveNodeCount();
+	std::string getUploadStatistics();
 
 	// Any operation on servers must be synchronized via this mutex
 	mutable boost::mutex serverListMutex;
@@ -275,6 +289,10 @@ private:
 	bool isLittleEndian;
 	int pollingInterval;
 	int defaultTcpPort;
+	// Scene broadcast
+	int maxConcurrentUploads;
+	double lastUploadTime;
+	double lastUploadBytes;
 };
 
 }//namespace lux
@@ -29,6 +29,7 @@
 #include "bxdf.h"
 #include "sampling.h"
 #include "paramset.h"
+#include "lighttree.h"
 
 #include <boost/assert.hpp>
 
@@ -69,6 +70,8 @@ LightsSamplingStrategy *LightsSamplingStrategy::Create(const string &name,
 		lightStrategyType = LightsSamplingStrategy::SAMPLE_ALL_POWER_IMPORTANCE;
 	else if (st == "logpowerimp")
 		lightStrategyType = LightsSamplingStrategy::SAMPLE_ONE_LOG_POWER_IMPORTANCE;
+	else if (st == "lighttree")
+		lightStrategyType = LightsSamplingStrategy::SAMPLE_ONE_LIGHT_TREE;
 	else {
 		LOG( LUX_WARNING,LUX_BADTOKEN) << "Strategy  '" << st << "' unknown. Using \"auto\".";
 		lightStrategyType = LightsSamplingStrategy::SAMPLE_AUTOMATIC;
@@ -97,6 +100,9 @@ LightsSamplingStrategy *LightsSamplingStrategy::Create(const string &name,
 		case LightsSamplingStrategy::SAMPLE_ONE_LOG_POWER_IMPORTANCE:
 			lsStrategy = new LSSOneLogPowerImportance();
 			break;
+		case LightsSamplingStrategy::SAMPLE_ONE_LIGHT_TREE:
+			lsStrategy = new LSSOneLightTree();
+			break;
 		default:
 			BOOST_ASSERT(false);
 	}
@@ -291,6 +297,91 @@ void LSSOneLogPowerImportance::Init(const Scene &scene) {
 	delete[] lightPower;
 }
 
+//******************************************************************************
+// Light Sampling Strategies: LightStrategyOneLightTree
+//******************************************************************************
+
+void LSSOneLightTree::Init(const Scene &scene) {
+	// Power CDF for the point agnostic sampling
+	LSSOnePowerImportance::Init(scene);
+
+	const u_int nLights = scene.lights.size();
+	vector<LightBounds> items;
+	treeLights.clear();
+	unboundedLights.clear();
+	lightItems.assign(nLights, LightTree::NO_ITEM);
+	for (u_int i = 0; i < nLights; ++i) {
+		const Light *l = scene.lights[i];
+		const float power = l->GetRenderingHints()->GetImportance() *
+			l->Power(scene);
+		if (!(power > 0.f))
+			continue;
+		LightBounds b;
+		if (!l->IsEnvironmental() && l->GetBounds(&b)) {
+			b.power = power;
+			lightItems[i] = items.size();
+			treeLights.push_back(i);
+			items.push_back(b);
+		} else
+			unboundedLights.push_back(i);
+	}
+	tree.Build(items);
+
+	LOG(LUX_DEBUG, LUX_NOERROR) << "Light tree built over " <<
+		treeLights.size() << " lights, " << unboundedLights.size() <<
+		" unbounded lights";
+}
+
+const Light *LSSOneLightTree::SampleLight(const Scene &scene, const Point &p,
+	u_int index, float *u, float *pdf) const
+{
+	if (index > 0)
+		return NULL;
+	// The tree is one more choice next to the unbounded lights
+	const u_int nUnbounded = unboundedLights.size();
+	const u_int nChoices = nUnbounded + (tree.Empty() ? 0 : 1);
+	if (nChoices == 0)
+		return NULL;
+	*u *= nChoices;
+	const u_int n = min(Floor2UInt(*u), nChoices - 1);
+	*u -= n;
+	if (n < nUnbounded) {
+		*pdf = 1.f / nChoices;
+		return scene.lights[unboundedLights[n]];
+	}
+	float treePdf;
+	const u_int item = tree.Sample(p, u, &treePdf);
+	if (item == LightTree::NO_ITEM)
+		return NULL;
+	*pdf = treePdf / nChoices;
+	return scene.lights[treeLights[item]];
+}
+
+float LSSOneLightTree::Pdf(const Scene &scene, const Point &p,
+	const Light *light) const
+{
+	for (u_int i = 0; i < scene.lights.size(); ++i) {
+		if (scene.lights[i] == light)
+			return Pdf(scene, p, i);
+	}
+	return 0.f;
+}
+
+float LSSOneLightTree::Pdf(const Scene &scene, const Point &p,
+	u_int light) const
+{
+	if (light >= lightItems.size())
+		return 0.f;
+	const u_int nChoices = unboundedLights.size() + (tree.Empty() ? 0 : 1);
+	if (lightItems[light] != LightTree::NO_ITEM)
+		return tree.Pdf(p, lightItems[light]) / nChoices;
+	for (u_int i = 0; i < unboundedLights.size(); ++i) {
+		if (unboundedLights[i] == light)
+			return 1.f / nChoices;
+	}
+	return 0.f;
+}
+
 //------------------------------------------------------------------------------
 // SurfaceIntegrator Rendering Hints
 //------------------------------------------------------------------------------
@@ -377,7 +468,7 @@ u_int SurfaceIntegratorRenderingHints::SampleLights(const Scene &scene,
 							continue;
 						const float d2 = DistanceSquared(p,
 							lightBsdf->dgShading.p);
-						const float lsPdf = lsStrategy->Pdf(scene, light);
+						const float lsPdf = lsStrategy->Pdf(scene, p, light);
 						const float lightPdf2 = lightPdf *
 							lsPdf * shadowRayCount * d2 /
 							AbsDot(wi, lightBsdf->ng);
@@ -396,7 +487,7 @@ u_int SurfaceIntegratorRenderingHints::SampleLights(const Scene &scene,
 						&Li)) {
 						const float d2 = DistanceSquared(p,
 							lightBsdf->dgShading.p);
-						const float lsPdf = lsStrategy->Pdf(scene, lightIsect.arealight) * shadowRayCount;
+						const float lsPdf = lsStrategy->Pdf(scene, p, lightIsect.arealight) * shadowRayCount;
 						const float lightPdf2 = lightPdf *
 							lsPdf * d2 /
 							AbsDot(wi, lightBsdf->ng);
@@ -425,7 +516,7 @@ u_int SurfaceIntegratorRenderingHints::SampleLights(const Scene &scene,
 		const u_int offset = i * (1 + shadowRayCount * 3) + 3;
 		float lc = data[offset];
 		float lsPdf;
-		const Light *light = lsStrategy->SampleLight(scene, i, &lc,
+		const Light *light = lsStrategy->SampleLight(scene, p, i, &lc,
 			&lsPdf);
 		if (!light)
 			break;
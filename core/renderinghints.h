@@ -24,6 +24,7 @@
 #define	_RENDERINGHINTS_H
 
 #include "lux.h"
+#include "lighttree.h"
 
 namespace lux {
 
@@ -49,7 +50,7 @@ public:
 		SAMPLE_ALL_UNIFORM, SAMPLE_ONE_UNIFORM,
 		SAMPLE_AUTOMATIC, SAMPLE_ONE_IMPORTANCE,
 		SAMPLE_ONE_POWER_IMPORTANCE, SAMPLE_ALL_POWER_IMPORTANCE,
-		SAMPLE_ONE_LOG_POWER_IMPORTANCE
+		SAMPLE_ONE_LOG_POWER_IMPORTANCE, SAMPLE_ONE_LIGHT_TREE
 	};
 
 	LightsSamplingStrategy() : Strategy() { }
@@ -85,6 +86,48 @@ public:
 	 * @return The requested probability
 	 */
 	virtual float Pdf(const Scene &scene, u_int light) const = 0;
+	/**
+	 * Samples a light according to the defined strategy for a given
+	 * receiving point. Strategies that don't depend on the receiving
+	 * point use the point agnostic sampling.
+	 * @param scene The current scene
+	 * @param p The point to be illuminated
+	 * @param index The current sampling iteration
+	 * @param u A pointer to a random variable in the [0,1) range,
+	 * the value might be adjusted if needed so that it can be used
+	 * to sample the light component
+	 * @param pdf The probability of having sampled that light taking
+	 * the looping process into account
+	 * @return A pointer to the sampled Light or NULL if the looping is over
+	 */
+	virtual const Light *SampleLight(const Scene &scene, const Point &p,
+		u_int index, float *u, float *pdf) const {
+		return SampleLight(scene, index, u, pdf);
+	}
+	/**
+	 * The probability of sampling a given light for a given receiving
+	 * point according to the strategy
+	 * @param scene The current scene
+	 * @param p The point to be illuminated
+	 * @param light A pointer to the light being queried
+	 * @return The requested probability
+	 */
+	virtual float Pdf(const Scene &scene, const Point &p,
+		const Light *light) const {
+		return Pdf(scene, light);
+	}
+	/**
+	 * The probability of sampling a given light for a given receiving
+	 * point according to the strategy
+	 * @param scene The current scene
+	 * @param p The point to be illuminated
+	 * @param light The index of the light being queried in scene.lights
+	 * @return The requested probability
+	 */
+	virtual float Pdf(const Scene &scene, const Point &p,
+		u_int light) const {
+		return Pdf(scene, light);
+	}
 	/**
 	 * The maximum number of light samples in one go
 	 * The looping over SampleLight will never exceed he returned value
@@ -143,6 +186,18 @@ public:
 	virtual float Pdf(const Scene &scene, u_int light) const {
 		return strategy->Pdf(scene, light);
 	}
+	virtual const Light *SampleLight(const Scene &scene, const Point &p,
+		u_int index, float *u, float *pdf) const {
+		return strategy->SampleLight(scene, p, index, u, pdf);
+	}
+	virtual float Pdf(const Scene &scene, const Point &p,
+		const Light *light) const {
+		return strategy->Pdf(scene, p, light);
+	}
+	virtual float Pdf(const Scene &scene, const Point &p,
+		u_int light) const {
+		return strategy->Pdf(scene, p, light);
+	}
 	virtual u_int GetSamplingLimit(const Scene &scene) const {
 		return strategy->GetSamplingLimit(scene);
 	}
@@ -194,6 +249,30 @@ public:
 	virtual void Init(const Scene &scene);
 };
 
+// Without a receiving point lights are sampled according to their power
+class LSSOneLightTree : public LSSOnePowerImportance {
+public:
+	LSSOneLightTree() : LSSOnePowerImportance() { }
+	virtual ~LSSOneLightTree() { }
+	virtual void Init(const Scene &scene);
+
+	virtual const Light *SampleLight(const Scene &scene, const Point &p,
+		u_int index, float *u, float *pdf) const;
+	virtual float Pdf(const Scene &scene, const Point &p,
+		const Light *light) const;
+	virtual float Pdf(const Scene &scene, const Point &p,
+		u_int light) const;
+
+protected:
+	LightTree tree;
+	// Index in scene.lights of each tree item
+	vector<u_int> treeLights;
+	// Lights without bounds, each has the same probability as the tree
+	vector<u_int> unboundedLights;
+	// Tree item of each light, LightTree::NO_ITEM if not in the tree
+	vector<u_int> lightItems;
+};
+
 //******************************************************************************
 // Rendering Hints
 //******************************************************************************
@@ -264,6 +343,25 @@ public:
 	float Pdf(const Scene &scene, u_int light) const {
 		return lsStrategy->Pdf(scene, light);
 	}
+	/**
+	 * Samples a light according to the defined strategy for a given
+	 * receiving point.
+	 * @see LightsSamplingStrategy::SampleLight
+	 */
+	const Light *SampleLight(const Scene &scene, const Point &p,
+		u_int index, float *u, float *pdf) const {
+		return lsStrategy->SampleLight(scene, p, index, u, pdf);
+	}
+	/**
+	 * The probability of sampling a given light for a given receiving
+	 * point according to the strategy
+	 */
+	float Pdf(const Scene &scene, const Point &p, const Light *light) const {
+		return lsStrategy->Pdf(scene, p, light);
+	}
+	float Pdf(const Scene &scene, const Point &p, u_int light) const {
+		return lsStrategy->Pdf(scene, p, light);
+	}
 	/**
 	 * The maximum number of light samples in one go
 	 * The looping over SampleLight will never exceed he returned value
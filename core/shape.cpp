@@ -118,3 +118,42 @@ void PrimitiveSet::initAreas()
 		prevCDF = areaCDF[i];
 	}
 }
+
+void PrimitiveSet::InitSamplingTree()
+{
+	vector<LightBounds> items(primitives.size());
+	for (u_int i = 0; i < primitives.size(); ++i) {
+		// Emission directions are left unbounded since shading
+		// normals can make any primitive face the receiving point
+		items[i].bounds = primitives[i]->WorldBound();
+		items[i].power = primitives[i]->Area();
+	}
+	samplingTree.Build(items);
+}
+
+float PrimitiveSet::Sample(const Point &p, float u1, float u2, float u3,
+	DifferentialGeometry *dg) const
+{
+	if (samplingTree.Empty())
+		return Sample(u1, u2, u3, dg);
+	float treePdf;
+	const u_int sn = samplingTree.Sample(p, &u3, &treePdf);
+	if (sn == LightTree::NO_ITEM)
+		return 0.f;
+	return primitives[sn]->Sample(p, u1, u2, u3, dg) * treePdf;
+}
+
+float PrimitiveSet::Pdf(const Point &p,
+	const PartialDifferentialGeometry &dg) const
+{
+	if (samplingTree.Empty())
+		return Pdf(dg);
+	// Find back the primitive holding dg, the ray is restricted to the
+	// neighbourhood of dg.p so that other parts of the set are skipped
+	Ray ray(p, dg.p - p, 1.f - 1e-3f, 1.f + 1e-3f);
+	ray.time = dg.time;
+	const u_int sn = samplingTree.Intersect(primitives, ray);
+	if (sn == LightTree::NO_ITEM)
+		return 0.f;
+	return samplingTree.Pdf(p, sn) * primitives[sn]->Pdf(p, dg);
+}
@@ -26,6 +26,7 @@
 #include "lux.h"
 #include "primitive.h"
 #include "error.h"
+#include "lighttree.h"
 
 namespace lux
 {
@@ -192,10 +193,23 @@ public:
 		return (sn == 0 ? areaCDF[sn] : areaCDF[sn] - areaCDF[sn - 1]) *
 			pdf;
 	}
+	virtual float Pdf(const PartialDifferentialGeometry &dg) const {
+		return 1.f / area;
+	}
+	virtual float Sample(const Point &p, float u1, float u2, float u3,
+		DifferentialGeometry *dg) const;
+	virtual float Pdf(const Point &p,
+		const PartialDifferentialGeometry &dg) const;
 	virtual float Area() const { return area; }
 	virtual Transform GetLocalToWorld(float time) const {
 		return Transform();
 	}
+	/**
+	 * Builds a light tree over the primitives so that sampling from a
+	 * point favours the primitives closest to it instead of selecting
+	 * them by area only.
+	 */
+	void InitSamplingTree();
 private:
 	void initAreas();
 
@@ -205,6 +219,8 @@ private:
 	vector<boost::shared_ptr<Primitive> > primitives;
 	BBox worldbound;
 	boost::shared_ptr<Primitive> accelerator;
+	// Empty unless InitSamplingTree has been called
+	LightTree samplingTree;
 };
 
 }//namespace lux
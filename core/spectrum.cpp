@@ -27,6 +27,8 @@
 #include "regular.h"
 #include "memory.h"
 
+#include <xmmintrin.h>
+
 using namespace lux;
 
 namespace lux
@@ -37,15 +39,10 @@ Scalar SWCSpectrum::Y(const SpectrumWavelengths &sw) const {
 
 	if (sw.single) {
 		const u_int j = sw.single_w;
-		SpectrumWavelengths::spd_ciey.Sample(1,
-			sw.binsXYZ + j, sw.offsetsXYZ + j, &y);
-		y *= c[j] * WAVELENGTH_SAMPLES;
+		y = sw.cieXYZ[1][j] * (c[j] * WAVELENGTH_SAMPLES);
 	} else {
-		SWCSpectrum ciey;
-		SpectrumWavelengths::spd_ciey.Sample(WAVELENGTH_SAMPLES,
-			sw.binsXYZ, sw.offsetsXYZ, ciey.c);
 		for (u_int j = 0; j < WAVELENGTH_SAMPLES; ++j) {
-			y += ciey.c[j] * c[j];
+			y += sw.cieXYZ[1][j] * c[j];
 		}
 	}
 
@@ -60,62 +57,62 @@ SWCSpectrum::SWCSpectrum(const SpectrumWavelengths &sw, const RGBColor &s) {
 	const float r = s.c[0];
 	const float g = s.c[1];
 	const float b = s.c[2];
-	SWCSpectrum min, med, max;
+	// The spectrum is white * min + secondary * (med - min) +
+	// primary * (max - med), using the bases precomputed in sw
+	u_int med, max;
+	float wMin, wMed, wMax;
 
-	SpectrumWavelengths::spd_w.Sample(WAVELENGTH_SAMPLES,
-		sw.binsRGB, sw.offsetsRGB, min.c);
 	if (r <= g && r <= b) {
-		min *= r;
-
-		SpectrumWavelengths::spd_c.Sample(WAVELENGTH_SAMPLES,
-			sw.binsRGB, sw.offsetsRGB, med.c);
+		wMin = r;
+		med = SpectrumWavelengths::RGB_CYAN;
 		if (g <= b) {
-			med *= g - r;
-			SpectrumWavelengths::spd_b.Sample(WAVELENGTH_SAMPLES,
-				sw.binsRGB, sw.offsetsRGB, max.c);
-			max *= b - g;
+			wMed = g - r;
+			max = SpectrumWavelengths::RGB_BLUE;
+			wMax = b - g;
 		} else {
-			med *= b - r;
-			SpectrumWavelengths::spd_g.Sample(WAVELENGTH_SAMPLES,
-				sw.binsRGB, sw.offsetsRGB, max.c);
-			max *= g - b;
+			wMed = b - r;
+			max = SpectrumWavelengths::RGB_GREEN;
+			wMax = g - b;
 		}
 	} else if (g <= r && g <= b) {
-		min *= g;
-
-		SpectrumWavelengths::spd_m.Sample(WAVELENGTH_SAMPLES,
-			sw.binsRGB, sw.offsetsRGB, med.c);
+		wMin = g;
+		med = SpectrumWavelengths::RGB_MAGENTA;
 		if (r <= b) {
-			med *= r - g;
-			SpectrumWavelengths::spd_b.Sample(WAVELENGTH_SAMPLES,
-				sw.binsRGB, sw.offsetsRGB, max.c);
-			max *= b - r;
+			wMed = r - g;
+			max = SpectrumWavelengths::RGB_BLUE;
+			wMax = b - r;
 		} else {
-			med *= b - g;
-			SpectrumWavelengths::spd_r.Sample(WAVELENGTH_SAMPLES,
-				sw.binsRGB, sw.offsetsRGB, max.c);
-			max *= r - b;
+			wMed = b - g;
+			max = SpectrumWavelengths::RGB_RED;
+			wMax = r - b;
 		}
 	} else {	// blue <= red && blue <= green
-		min *= b;
-
-		SpectrumWavelengths::spd_y.Sample(WAVELENGTH_SAMPLES,
-			sw.binsRGB, sw.offsetsRGB, med.c);
+		wMin = b;
+		med = SpectrumWavelengths::RGB_YELLOW;
 		if (r <= g) {
-			med *= r - b;
-			SpectrumWavelengths::spd_g.Sample(WAVELENGTH_SAMPLES,
-				sw.binsRGB, sw.offsetsRGB, max.c);
-			max *= g - r;
+			wMed = r - b;
+			max = SpectrumWavelengths::RGB_GREEN;
+			wMax = g - r;
 		} else {
-			med *= g - b;
-			SpectrumWavelengths::spd_r.Sample(WAVELENGTH_SAMPLES,
-				sw.binsRGB, sw.offsetsRGB, max.c);
-			max *= r - g;
+			wMed = g - b;
+			max = SpectrumWavelengths::RGB_RED;
+			wMax = r - g;
 		}
 	}
 
+	const float *basisMin = sw.rgbBasis[SpectrumWavelengths::RGB_WHITE];
+	const float *basisMed = sw.rgbBasis[med];
+	const float *basisMax = sw.rgbBasis[max];
+#if WAVELENGTH_SAMPLES == 4
+	const __m128 vMin = _mm_mul_ps(_mm_loadu_ps(basisMin), _mm_set1_ps(wMin));
+	const __m128 vMed = _mm_mul_ps(_mm_loadu_ps(basisMed), _mm_set1_ps(wMed));
+	const __m128 vMax = _mm_mul_ps(_mm_loadu_ps(basisMax), _mm_set1_ps(wMax));
+	_mm_storeu_ps(c, _mm_add_ps(_mm_add_ps(vMin, vMed), vMax));
+#else
 	for (u_int j = 0; j < WAVELENGTH_SAMPLES; ++j)
-		c[j] = min.c[j] + med.c[j] + max.c[j];
+		c[j] = basisMin[j] * wMin + basisMed[j] * wMed +
+			basisMax[j] * wMax;
+#endif
 }
 
 std::ostream &operator<<(std::ostream &stream, const SWCSpectrum &spectrum)
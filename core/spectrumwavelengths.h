@@ -56,6 +56,26 @@ public:
 		}
 		spd_w.Offsets(WAVELENGTH_SAMPLES, w, binsRGB, offsetsRGB);
 		spd_ciex.Offsets(WAVELENGTH_SAMPLES, w, binsXYZ, offsetsXYZ);
+		spd_w.Sample(WAVELENGTH_SAMPLES, binsRGB, offsetsRGB,
+			rgbBasis[RGB_WHITE]);
+		spd_c.Sample(WAVELENGTH_SAMPLES, binsRGB, offsetsRGB,
+			rgbBasis[RGB_CYAN]);
+		spd_m.Sample(WAVELENGTH_SAMPLES, binsRGB, offsetsRGB,
+			rgbBasis[RGB_MAGENTA]);
+		spd_y.Sample(WAVELENGTH_SAMPLES, binsRGB, offsetsRGB,
+			rgbBasis[RGB_YELLOW]);
+		spd_r.Sample(WAVELENGTH_SAMPLES, binsRGB, offsetsRGB,
+			rgbBasis[RGB_RED]);
+		spd_g.Sample(WAVELENGTH_SAMPLES, binsRGB, offsetsRGB,
+			rgbBasis[RGB_GREEN]);
+		spd_b.Sample(WAVELENGTH_SAMPLES, binsRGB, offsetsRGB,
+			rgbBasis[RGB_BLUE]);
+		spd_ciex.Sample(WAVELENGTH_SAMPLES, binsXYZ, offsetsXYZ,
+			cieXYZ[0]);
+		spd_ciey.Sample(WAVELENGTH_SAMPLES, binsXYZ, offsetsXYZ,
+			cieXYZ[1]);
+		spd_ciez.Sample(WAVELENGTH_SAMPLES, binsXYZ, offsetsXYZ,
+			cieXYZ[2]);
 	}
 
 	inline float SampleSingle() const {
@@ -71,6 +91,13 @@ public:
 	int binsRGB[WAVELENGTH_SAMPLES], binsXYZ[WAVELENGTH_SAMPLES];
 	float offsetsRGB[WAVELENGTH_SAMPLES], offsetsXYZ[WAVELENGTH_SAMPLES];
 
+	// RGB to spectrum basis SPDs and CIE matching functions sampled at
+	// the current wavelengths, so that conversions don't resample them
+	enum { RGB_WHITE, RGB_CYAN, RGB_MAGENTA, RGB_YELLOW,
+		RGB_RED, RGB_GREEN, RGB_BLUE, RGB_BASES };
+	float rgbBasis[RGB_BASES][WAVELENGTH_SAMPLES];
+	float cieXYZ[3][WAVELENGTH_SAMPLES];
+
 	static const RegularSPD spd_w, spd_c, spd_m, spd_y,
 		spd_r, spd_g, spd_b, spd_ciex, spd_ciey, spd_ciez;
 };
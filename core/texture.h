@@ -208,6 +208,8 @@ public:
 	virtual void Map(float s, float t, Vector *wh, float *pdf = NULL) const;
 };
 
+template <class T> class TextureProgram;
+
 template <class T> class Texture : public Queryable {
 public:
 	Texture(const std::string &name) : Queryable(name) { }
@@ -228,6 +230,15 @@ public:
 		*minValue = -1.f;
 		*maxValue = 1.f;
 	}
+	/**
+	 * Appends the texture to a flat evaluation program.
+	 * @param program The program being built.
+	 * @param reg Returns the program register holding the texture value.
+	 * @return False if the texture has to be evaluated as a leaf.
+	 */
+	virtual bool Lower(TextureProgram<T> &program, u_int *reg) const {
+		return false;
+	}
 	virtual ~Texture() { }
 };
 
@@ -0,0 +1,197 @@
+/***************************************************************************
+ *   Copyright (C) 1998-2013 by authors (see AUTHORS.txt)                  *
+ *                                                                         *
+ *   This file is part of LuxRender.                                       *
+ *                                                                         *
+ *   Lux Renderer is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   Lux Renderer is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                         *
+ *   This project is based on PBRT ; see http://www.pbrt.org               *
+ *   Lux Renderer website : http://www.luxrender.net                       *
+ ***************************************************************************/
+
+
+// textureprogram.cpp*
+#include "textureprogram.h"
+
+using namespace lux;
+
+u_int TextureProgram<float>::Lower(const Texture<float> &tex)
+{
+	u_int reg;
+	if (tex.Lower(*this, &reg))
+		return reg;
+	return Leaf(&tex);
+}
+
+u_int TextureProgram<float>::Emit(const Op &op)
+{
+	// Share identical operations, programs are small enough for
+	// a linear search
+	for (u_int i = 0; i < ops.size(); ++i) {
+		if (ops[i] == op)
+			return i;
+	}
+	ops.push_back(op);
+	root = ops.size() - 1;
+	return root;
+}
+
+u_int TextureProgram<float>::Constant(float value)
+{
+	return Emit(Op(TEXPROG_CONSTANT, 0, 0, 0, value, NULL));
+}
+
+u_int TextureProgram<float>::Leaf(const Texture<float> *tex)
+{
+	return Emit(Op(TEXPROG_TEXTURE, 0, 0, 0, 0.f, tex));
+}
+
+u_int TextureProgram<float>::Add(u_int a, u_int b)
+{
+	if (IsConstant(a) && IsConstant(b))
+		return Constant(ops[a].value + ops[b].value);
+	if (IsConstant(a, 0.f))
+		return b;
+	if (IsConstant(b, 0.f))
+		return a;
+	// Addition is commutative, order operands to share more operations
+	if (a > b)
+		swap(a, b);
+	return Emit(Op(TEXPROG_ADD, a, b, 0, 0.f, NULL));
+}
+
+u_int TextureProgram<float>::Subtract(u_int a, u_int b)
+{
+	if (IsConstant(a) && IsConstant(b))
+		return Constant(ops[a].value - ops[b].value);
+	if (IsConstant(b, 0.f))
+		return a;
+	return Emit(Op(TEXPROG_SUBTRACT, a, b, 0, 0.f, NULL));
+}
+
+u_int TextureProgram<float>::Scale(u_int a, u_int b)
+{
+	if (IsConstant(a) && IsConstant(b))
+		return Constant(ops[a].value * ops[b].value);
+	if (IsConstant(a, 1.f))
+		return b;
+	if (IsConstant(b, 1.f))
+		return a;
+	if (a > b)
+		swap(a, b);
+	return Emit(Op(TEXPROG_SCALE, a, b, 0, 0.f, NULL));
+}
+
+u_int TextureProgram<float>::Mix(u_int a, u_int b, u_int amount)
+{
+	if (IsConstant(a) && IsConstant(b) && IsConstant(amount))
+		return Constant(Lerp(ops[amount].value, ops[a].value,
+			ops[b].value));
+	if (IsConstant(amount, 0.f))
+		return a;
+	return Emit(Op(TEXPROG_MIX, a, b, amount, 0.f, NULL));
+}
+
+u_int TextureProgram<float>::Append(const TextureProgram<float> &program)
+{
+	vector<u_int> regs(program.ops.size());
+	for (u_int i = 0; i < program.ops.size(); ++i) {
+		const Op &op(program.ops[i]);
+		switch (op.code) {
+			case TEXPROG_CONSTANT:
+				regs[i] = Constant(op.value);
+				break;
+			case TEXPROG_TEXTURE:
+				regs[i] = Leaf(op.tex);
+				break;
+			case TEXPROG_ADD:
+				regs[i] = Add(regs[op.a], regs[op.b]);
+				break;
+			case TEXPROG_SUBTRACT:
+				regs[i] = Subtract(regs[op.a], regs[op.b]);
+				break;
+			case TEXPROG_SCALE:
+				regs[i] = Scale(regs[op.a], regs[op.b]);
+				break;
+			case TEXPROG_MIX:
+				regs[i] = Mix(regs[op.a], regs[op.b], regs[op.c]);
+				break;
+		}
+	}
+	return regs[program.root];
+}
+
+void TextureProgram<float>::Finish(u_int r)
+{
+	// Operands always precede their operations, so a backward sweep
+	// from the result finds every operation it depends on
+	vector<bool> live(r + 1, false);
+	live[r] = true;
+	for (u_int i = r + 1; i-- > 0; ) {
+		if (!live[i])
+			continue;
+		switch (ops[i].code) {
+			case TEXPROG_MIX:
+				live[ops[i].c] = true;
+				// Fall through
+			case TEXPROG_ADD:
+			case TEXPROG_SUBTRACT:
+			case TEXPROG_SCALE:
+				live[ops[i].a] = true;
+				live[ops[i].b] = true;
+				break;
+			default:
+				break;
+		}
+	}
+	vector<u_int> regs(r + 1);
+	vector<Op> liveOps;
+	for (u_int i = 0; i <= r; ++i) {
+		if (!live[i])
+			continue;
+		Op op(ops[i]);
+		op.a = regs[op.a];
+		op.b = regs[op.b];
+		op.c = regs[op.c];
+		regs[i] = liveOps.size();
+		liveOps.push_back(op);
+	}
+	ops.swap(liveOps);
+	root = ops.size() - 1;
+}
+
+FlatFloatTexture::FlatFloatTexture(const boost::shared_ptr<Texture<float> > &tex,
+	const TextureProgram<float> &prog) :
+	Texture<float>("FlatFloatTexture-" + boost::lexical_cast<string>(this)),
+	source(tex), program(prog)
+{
+}
+
+boost::shared_ptr<Texture<float> > FlatFloatTexture::Flatten(
+	const boost::shared_ptr<Texture<float> > &tex)
+{
+	if (!tex || dynamic_cast<const FlatFloatTexture *>(tex.get()))
+		return tex;
+	TextureProgram<float> program;
+	program.Finish(program.Lower(*tex));
+	// A single constant or leaf costs as much as the texture itself
+	if (program.Size() > TextureProgram<float>::MAX_OPS ||
+		program.Size() == 1)
+		return tex;
+	LOG(LUX_DEBUG, LUX_NOERROR) << "Texture '" << tex->GetName() <<
+		"' flattened to " << program.Size() << " operations" <<
+		(program.IsConstant() ? " (constant)" : "");
+	return boost::shared_ptr<Texture<float> >(new FlatFloatTexture(tex,
+		program));
+}
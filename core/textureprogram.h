@@ -0,0 +1,250 @@
+/***************************************************************************
+ *   Copyright (C) 1998-2013 by authors (see AUTHORS.txt)                  *
+ *                                                                         *
+ *   This file is part of LuxRender.                                       *
+ *                                                                         *
+ *   Lux Renderer is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   Lux Renderer is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                         *
+ *   This project is based on PBRT ; see http://www.pbrt.org               *
+ *   Lux Renderer website : http://www.luxrender.net                       *
+ ***************************************************************************/
+
+
+#ifndef LUX_TEXTUREPROGRAM_H
+#define LUX_TEXTUREPROGRAM_H
+// textureprogram.h*
+
+#include "lux.h"
+#include "texture.h"
+
+namespace lux
+{
+
+/**
+ * Flat form of a float texture graph. Arithmetic nodes are lowered into a
+ * list of operations evaluated in a single loop; constant operands are
+ * folded and identical operations are shared while the program is built.
+ * Textures that can't be lowered are kept as leaves evaluated through
+ * Texture<float>::Evaluate.
+ */
+template <> class TextureProgram<float> {
+public:
+	enum OpCode { TEXPROG_CONSTANT, TEXPROG_TEXTURE, TEXPROG_ADD,
+		TEXPROG_SUBTRACT, TEXPROG_SCALE, TEXPROG_MIX };
+	// Largest program evaluated with the register file on the stack
+	static const u_int MAX_OPS = 64;
+
+	TextureProgram() : root(0) { }
+
+	/**
+	 * Lowers a texture and its inputs.
+	 * @return The register holding the texture value.
+	 */
+	u_int Lower(const Texture<float> &tex);
+	u_int Constant(float value);
+	u_int Leaf(const Texture<float> *tex);
+	u_int Add(u_int a, u_int b);
+	u_int Subtract(u_int a, u_int b);
+	u_int Scale(u_int a, u_int b);
+	u_int Mix(u_int a, u_int b, u_int amount);
+	/**
+	 * Appends a finished program.
+	 * @return The register holding the appended program value.
+	 */
+	u_int Append(const TextureProgram<float> &program);
+	/**
+	 * Removes the operations the value in register r doesn't depend on.
+	 */
+	void Finish(u_int r);
+
+	u_int Size() const { return ops.size(); }
+	bool IsConstant() const {
+		return ops[root].code == TEXPROG_CONSTANT;
+	}
+	const Texture<float> *GetLeaf() const {
+		return ops[root].code == TEXPROG_TEXTURE ? ops[root].tex : NULL;
+	}
+	float Evaluate(const SpectrumWavelengths &sw,
+		const DifferentialGeometry &dg) const {
+		float reg[MAX_OPS];
+		const u_int n = ops.size();
+		for (u_int i = 0; i < n; ++i) {
+			const Op &op(ops[i]);
+			switch (op.code) {
+				case TEXPROG_CONSTANT:
+					reg[i] = op.value;
+					break;
+				case TEXPROG_TEXTURE:
+					reg[i] = op.tex->Evaluate(sw, dg);
+					break;
+				case TEXPROG_ADD:
+					reg[i] = reg[op.a] + reg[op.b];
+					break;
+				case TEXPROG_SUBTRACT:
+					reg[i] = reg[op.a] - reg[op.b];
+					break;
+				case TEXPROG_SCALE:
+					reg[i] = reg[op.a] * reg[op.b];
+					break;
+				case TEXPROG_MIX:
+					reg[i] = Lerp(reg[op.c], reg[op.a], reg[op.b]);
+					break;
+			}
+		}
+		return reg[root];
+	}
+
+private:
+	struct Op {
+		Op(OpCode o, u_int ra, u_int rb, u_int rc, float v,
+			const Texture<float> *t) : code(o), a(ra), b(rb), c(rc),
+			value(v), tex(t) { }
+		bool operator==(const Op &op) const {
+			return code == op.code && a == op.a && b == op.b &&
+				c == op.c && value == op.value && tex == op.tex;
+		}
+		OpCode code;
+		u_int a, b, c;
+		float value;
+		const Texture<float> *tex;
+	};
+	bool IsConstant(u_int r) const {
+		return ops[r].code == TEXPROG_CONSTANT;
+	}
+	bool IsConstant(u_int r, float value) const {
+		return IsConstant(r) && ops[r].value == value;
+	}
+	u_int Emit(const Op &op);
+
+	vector<Op> ops;
+	u_int root;
+};
+
+// Arithmetic textures are only lowered when all their inputs are float
+inline bool LowerAdd(TextureProgram<float> &program,
+	const Texture<float> &tex1, const Texture<float> &tex2, u_int *reg)
+{
+	const u_int a = program.Lower(tex1);
+	*reg = program.Add(a, program.Lower(tex2));
+	return true;
+}
+template <class P, class T1, class T2> inline bool LowerAdd(P &program,
+	const T1 &tex1, const T2 &tex2, u_int *reg)
+{
+	return false;
+}
+inline bool LowerSubtract(TextureProgram<float> &program,
+	const Texture<float> &tex1, const Texture<float> &tex2, u_int *reg)
+{
+	const u_int a = program.Lower(tex1);
+	*reg = program.Subtract(a, program.Lower(tex2));
+	return true;
+}
+template <class P, class T1, class T2> inline bool LowerSubtract(P &program,
+	const T1 &tex1, const T2 &tex2, u_int *reg)
+{
+	return false;
+}
+inline bool LowerScale(TextureProgram<float> &program,
+	const Texture<float> &tex1, const Texture<float> &tex2, u_int *reg)
+{
+	const u_int a = program.Lower(tex1);
+	*reg = program.Scale(a, program.Lower(tex2));
+	return true;
+}
+template <class P, class T1, class T2> inline bool LowerScale(P &program,
+	const T1 &tex1, const T2 &tex2, u_int *reg)
+{
+	return false;
+}
+inline bool LowerMix(TextureProgram<float> &program,
+	const Texture<float> &tex1, const Texture<float> &tex2,
+	const Texture<float> &amount, u_int *reg)
+{
+	const u_int a = program.Lower(tex1);
+	const u_int b = program.Lower(tex2);
+	*reg = program.Mix(a, b, program.Lower(amount));
+	return true;
+}
+template <class P, class T> inline bool LowerMix(P &program,
+	const T &tex1, const T &tex2, const Texture<float> &amount, u_int *reg)
+{
+	return false;
+}
+inline bool LowerMultiMix(TextureProgram<float> &program,
+	const vector<float> &weights,
+	const vector<boost::shared_ptr<Texture<float> > > &tex, u_int *reg)
+{
+	u_int sum = program.Constant(0.f);
+	for (u_int i = 0; i < tex.size(); ++i)
+		sum = program.Add(sum, program.Scale(program.Constant(weights[i]),
+			program.Lower(*(tex[i]))));
+	*reg = sum;
+	return true;
+}
+template <class P, class T> inline bool LowerMultiMix(P &program,
+	const vector<float> &weights,
+	const vector<boost::shared_ptr<Texture<T> > > &tex, u_int *reg)
+{
+	return false;
+}
+
+/**
+ * Float texture evaluated through the flat program of a texture graph.
+ * Everything but Evaluate is forwarded to the original graph, which also
+ * keeps the program leaves alive.
+ */
+class FlatFloatTexture : public Texture<float> {
+public:
+	FlatFloatTexture(const boost::shared_ptr<Texture<float> > &tex,
+		const TextureProgram<float> &prog);
+	virtual ~FlatFloatTexture() { }
+	virtual float Evaluate(const SpectrumWavelengths &sw,
+		const DifferentialGeometry &dg) const {
+		return program.Evaluate(sw, dg);
+	}
+	virtual float Y() const { return source->Y(); }
+	virtual float Filter() const { return source->Filter(); }
+	virtual void SetIlluminant() { source->SetIlluminant(); }
+	virtual void GetDuv(const SpectrumWavelengths &sw,
+		const DifferentialGeometry &dg, float delta,
+		float *du, float *dv) const {
+		source->GetDuv(sw, dg, delta, du, dv);
+	}
+	virtual void GetMinMaxFloat(float *minValue, float *maxValue) const {
+		source->GetMinMaxFloat(minValue, maxValue);
+	}
+	virtual bool Lower(TextureProgram<float> &prog, u_int *reg) const {
+		*reg = prog.Append(program);
+		return true;
+	}
+
+	/**
+	 * Builds the flat program of a texture graph.
+	 * @return The flat texture, or tex itself when flattening brings
+	 * nothing or the program is too large.
+	 */
+	static boost::shared_ptr<Texture<float> > Flatten(
+		const boost::shared_ptr<Texture<float> > &tex);
+
+	const Texture<float> *GetSource() const { return source.get(); }
+
+private:
+	boost::shared_ptr<Texture<float> > source;
+	TextureProgram<float> program;
+};
+
+}//namespace lux
+
+#endif // LUX_TEXTUREPROGRAM_H
@@ -28,12 +28,32 @@
 
 namespace lux {
 
+// ToneMapScale Declarations
+// Factor applied to a pixel of luminance y by a tone mapping operator
+class ToneMapScale {
+public:
+	ToneMapScale(float s = 1.f) : scale(s), invY2(0.f), nonLinear(false) { }
+	ToneMapScale(float s, float i) : scale(s), invY2(i), nonLinear(true) { }
+	float operator()(float y) const {
+		return nonLinear ? scale * (1.f + y * invY2) / (1.f + y) : scale;
+	}
+
+	float scale, invY2;
+	bool nonLinear;
+};
+
 // ToneMap Declarations
 class ToneMap {
 public:
 	// ToneMap Interface
 	virtual ~ToneMap() { }
-	virtual void Map(vector<XYZColor> &xyz,	u_int xRes, u_int yRes, float maxDisplayY) const = 0;
+	/**
+	 * Computes the per pixel scale of the operator from image wide
+	 * statistics. The pixels are left untouched so that the scale can be
+	 * applied in the same pass as the colour conversion.
+	 */
+	virtual ToneMapScale GetScale(const vector<XYZColor> &xyz, u_int xRes,
+		u_int yRes, float maxDisplayY) const = 0;
 };
 
 }
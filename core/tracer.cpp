@@ -0,0 +1,257 @@
+/***************************************************************************
+ *   Copyright (C) 1998-2013 by authors (see AUTHORS.txt)                  *
+ *                                                                         *
+ *   This file is part of LuxRender.                                       *
+ *                                                                         *
+ *   Lux Renderer is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   Lux Renderer is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                         *
+ *   This project is based on PBRT ; see http://www.pbrt.org               *
+ *   Lux Renderer website : http://www.luxrender.net                       *
+ ***************************************************************************/
+
+
+#include "tracer.h"
+#include "context.h"
+#include "error.h"
+
+#include <boost/bind.hpp>
+#include <boost/thread/tss.hpp>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+
+using namespace lux;
+
+namespace {
+
+// Buffer of the calling thread in the tracer of the given generation
+struct TraceThreadState {
+	TraceThreadState() : generation(0), buffer(NULL) { }
+
+	u_int generation;
+	void *buffer;
+};
+
+boost::thread_specific_ptr<TraceThreadState> traceThreadState;
+boost::mutex generationMutex;
+u_int lastGeneration = 0;
+
+}
+
+Tracer::Tracer() : Queryable("tracer"), origin(osNanoClock()),
+	enabled(false), fileName(""), bufferCapacity(4096)
+{
+	{
+		boost::mutex::scoped_lock lock(generationMutex);
+		generation = ++lastGeneration;
+	}
+
+	const char *env = getenv("LUX_TRACE");
+	if (env && env[0] != '\0') {
+		enabled = true;
+		fileName = env;
+	}
+
+	AddBoolAttribute(*this, "enabled", "Record the traced phases", &Tracer::enabled, ReadWriteAccess);
+	AddStringAttribute(*this, "filename", "Chrome trace file written when the context is freed, empty to disable", &Tracer::fileName, ReadWriteAccess);
+	AddIntAttribute(*this, "bufferCapacity", "Number of spans kept per thread, used by threads starting to trace afterwards", &Tracer::bufferCapacity, ReadWriteAccess);
+	AddIntAttribute(*this, "spans", "Number of recorded spans", boost::function<int (void)>(boost::bind(&Tracer::GetSpanCount, this)));
+	AddIntAttribute(*this, "droppedSpans", "Number of spans overwritten in full buffers", boost::function<int (void)>(boost::bind(&Tracer::GetDroppedSpanCount, this)));
+	for (u_int i = 0; i < TRACE_PHASE_COUNT; ++i) {
+		const TracePhase phase = static_cast<TracePhase>(i);
+		const string name(PhaseName(phase));
+		AddIntAttribute(*this, name + "Count", "Number of recorded " + name + " spans", boost::function<int (void)>(boost::bind(&Tracer::GetPhaseCount, this, phase)));
+		AddDoubleAttribute(*this, name + "Time", "Total time of the recorded " + name + " spans in seconds", boost::function<double (void)>(boost::bind(&Tracer::GetPhaseTime, this, phase)));
+	}
+}
+
+Tracer::~Tracer()
+{
+	if (fileName != "" && GetSpanCount() > 0)
+		Write(fileName);
+}
+
+Tracer *Tracer::GetEnabled()
+{
+	Tracer *tracer = Context::GetActiveTracer();
+	return (tracer && tracer->enabled) ? tracer : NULL;
+}
+
+const char *Tracer::PhaseName(TracePhase phase)
+{
+	switch (phase) {
+		case TRACE_PARSE:
+			return "parse";
+		case TRACE_REFINE:
+			return "refine";
+		case TRACE_ACCELERATOR:
+			return "accelerator";
+		case TRACE_PREPROCESS:
+			return "preprocess";
+		case TRACE_PHOTONS:
+			return "photons";
+		case TRACE_FILM_WRITE:
+			return "filmWrite";
+		case TRACE_FILM_MERGE:
+			return "filmMerge";
+		default:
+			return "unknown";
+	}
+}
+
+Tracer::ThreadBuffer *Tracer::GetThreadBuffer()
+{
+	TraceThreadState *state = traceThreadState.get();
+	if (!state) {
+		state = new TraceThreadState();
+		traceThreadState.reset(state);
+	}
+	if (state->generation != generation) {
+		boost::mutex::scoped_lock lock(buffersMutex);
+		buffers.push_back(new ThreadBuffer(buffers.size(),
+			static_cast<u_int>(max(bufferCapacity, 1))));
+		state->generation = generation;
+		state->buffer = &buffers.back();
+	}
+	return static_cast<ThreadBuffer *>(state->buffer);
+}
+
+void Tracer::Record(TracePhase phase, const char *detail,
+	boost::uint64_t start, boost::uint64_t end)
+{
+	ThreadBuffer *buffer = GetThreadBuffer();
+	// Only contended while the spans are being written or queried
+	boost::mutex::scoped_lock lock(buffer->mutex);
+	Span &span(buffer->spans[buffer->next]);
+	span.start = start;
+	span.end = end;
+	span.detail = detail;
+	span.phase = phase;
+	if (++buffer->next == buffer->spans.size())
+		buffer->next = 0;
+	++buffer->recorded;
+	++buffer->phaseCount[phase];
+	buffer->phaseTime[phase] += end - start;
+}
+
+void Tracer::Begin(TracePhase phase, const char *detail)
+{
+	ThreadBuffer *buffer = GetThreadBuffer();
+	boost::mutex::scoped_lock lock(buffer->mutex);
+	buffer->openStart[phase] = osNanoClock();
+	buffer->openDetail[phase] = detail;
+}
+
+void Tracer::End(TracePhase phase)
+{
+	const boost::uint64_t end = osNanoClock();
+	ThreadBuffer *buffer = GetThreadBuffer();
+	boost::uint64_t start;
+	const char *detail;
+	{
+		boost::mutex::scoped_lock lock(buffer->mutex);
+		start = buffer->openStart[phase];
+		detail = buffer->openDetail[phase];
+		buffer->openStart[phase] = 0;
+	}
+	if (start != 0)
+		Record(phase, detail, start, end);
+}
+
+int Tracer::GetSpanCount()
+{
+	boost::mutex::scoped_lock lock(buffersMutex);
+	boost::uint64_t count = 0;
+	for (u_int i = 0; i < buffers.size(); ++i) {
+		boost::mutex::scoped_lock bufferLock(buffers[i].mutex);
+		count += buffers[i].recorded;
+	}
+	return static_cast<int>(count);
+}
+
+int Tracer::GetDroppedSpanCount()
+{
+	boost::mutex::scoped_lock lock(buffersMutex);
+	boost::uint64_t count = 0;
+	for (u_int i = 0; i < buffers.size(); ++i) {
+		boost::mutex::scoped_lock bufferLock(buffers[i].mutex);
+		if (buffers[i].recorded > buffers[i].spans.size())
+			count += buffers[i].recorded - buffers[i].spans.size();
+	}
+	return static_cast<int>(count);
+}
+
+int Tracer::GetPhaseCount(TracePhase phase)
+{
+	boost::mutex::scoped_lock lock(buffersMutex);
+	boost::uint64_t count = 0;
+	for (u_int i = 0; i < buffers.size(); ++i) {
+		boost::mutex::scoped_lock bufferLock(buffers[i].mutex);
+		count += buffers[i].phaseCount[phase];
+	}
+	return static_cast<int>(count);
+}
+
+double Tracer::GetPhaseTime(TracePhase phase)
+{
+	boost::mutex::scoped_lock lock(buffersMutex);
+	boost::uint64_t time = 0;
+	for (u_int i = 0; i < buffers.size(); ++i) {
+		boost::mutex::scoped_lock bufferLock(buffers[i].mutex);
+		time += buffers[i].phaseTime[phase];
+	}
+	return time * 1e-9;
+}
+
+bool Tracer::Write(const string &name)
+{
+	std::ofstream out(name.c_str());
+	if (!out) {
+		LOG(LUX_ERROR, LUX_SYSTEM) << "Unable to write trace file '" << name << "'";
+		return false;
+	}
+	// Timestamps and durations are in microseconds
+	out << std::fixed << std::setprecision(3);
+	out << "{\"traceEvents\":[\n";
+	out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"lux\"}}";
+	boost::mutex::scoped_lock lock(buffersMutex);
+	u_int count = 0;
+	for (u_int i = 0; i < buffers.size(); ++i) {
+		ThreadBuffer &buffer(buffers[i]);
+		boost::mutex::scoped_lock bufferLock(buffer.mutex);
+		const u_int size = static_cast<u_int>(min<boost::uint64_t>(buffer.recorded, buffer.spans.size()));
+		// Oldest span first
+		const u_int first = buffer.recorded > buffer.spans.size() ? buffer.next : 0;
+		for (u_int j = 0; j < size; ++j) {
+			const Span &span(buffer.spans[(first + j) % buffer.spans.size()]);
+			out << ",\n{\"name\":\"" << PhaseName(span.phase) <<
+				"\",\"cat\":\"lux\",\"ph\":\"X\",\"pid\":1,\"tid\":" <<
+				buffer.id << ",\"ts\":" <<
+				static_cast<double>(span.start - origin) * 1e-3 <<
+				",\"dur\":" <<
+				static_cast<double>(span.end - span.start) * 1e-3;
+			if (span.detail)
+				out << ",\"args\":{\"detail\":\"" << span.detail << "\"}";
+			out << "}";
+			++count;
+		}
+	}
+	out << "\n]}\n";
+	if (!out.good()) {
+		LOG(LUX_ERROR, LUX_SYSTEM) << "Error while writing trace file '" << name << "'";
+		return false;
+	}
+	LOG(LUX_INFO, LUX_NOERROR) << "Wrote " << count << " trace spans to '" << name << "'";
+	return true;
+}
@@ -0,0 +1,149 @@
+/***************************************************************************
+ *   Copyright (C) 1998-2013 by authors (see AUTHORS.txt)                  *
+ *                                                                         *
+ *   This file is part of LuxRender.                                       *
+ *                                                                         *
+ *   Lux Renderer is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   Lux Renderer is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                         *
+ *   This project is based on PBRT ; see http://www.pbrt.org               *
+ *   Lux Renderer website : http://www.luxrender.net                       *
+ ***************************************************************************/
+
+
+#ifndef LUX_TRACER_H
+#define LUX_TRACER_H
+// tracer.h*
+
+#include "lux.h"
+#include "queryable.h"
+#include "osfunc.h"
+
+#include <boost/thread/mutex.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+
+namespace lux
+{
+
+// Coarse phases of scene loading and rendering that can be traced
+enum TracePhase {
+	TRACE_PARSE,
+	TRACE_REFINE,
+	TRACE_ACCELERATOR,
+	TRACE_PREPROCESS,
+	TRACE_PHOTONS,
+	TRACE_FILM_WRITE,
+	TRACE_FILM_MERGE,
+	TRACE_PHASE_COUNT
+};
+
+// Records timed spans of the traced phases in per thread ring buffers,
+// aggregates their count and duration per phase as attributes and dumps
+// the recorded spans in the Chrome trace event format (chrome://tracing)
+// when the tracer is freed with the context.
+// Tracing is disabled by default, it is enabled either through the
+// "enabled" attribute or by setting the LUX_TRACE environment variable
+// to the name of the trace file.
+class Tracer : public Queryable {
+public:
+	Tracer();
+	~Tracer();
+
+	// Returns the tracer of the active context if it is enabled, NULL
+	// otherwise
+	static Tracer *GetEnabled();
+
+	// Records a span of the calling thread, detail must be a string
+	// literal or otherwise outlive the tracer
+	void Record(TracePhase phase, const char *detail,
+		boost::uint64_t start, boost::uint64_t end);
+	// Open and close a span of the calling thread across function
+	// boundaries, End does nothing if the phase isn't open
+	void Begin(TracePhase phase, const char *detail);
+	void End(TracePhase phase);
+
+	// Writes the recorded spans as a Chrome trace JSON file
+	bool Write(const string &fileName);
+
+	static const char *PhaseName(TracePhase phase);
+
+private:
+	struct Span {
+		boost::uint64_t start, end;
+		const char *detail;
+		TracePhase phase;
+	};
+	struct ThreadBuffer {
+		ThreadBuffer(u_int i, u_int capacity) : id(i), spans(capacity),
+			next(0), recorded(0) {
+			for (u_int j = 0; j < TRACE_PHASE_COUNT; ++j) {
+				openStart[j] = 0;
+				openDetail[j] = NULL;
+				phaseCount[j] = 0;
+				phaseTime[j] = 0;
+			}
+		}
+
+		boost::mutex mutex;
+		u_int id;
+		vector<Span> spans;
+		u_int next;
+		boost::uint64_t recorded;
+		// Spans opened with Begin, 0 when closed
+		boost::uint64_t openStart[TRACE_PHASE_COUNT];
+		const char *openDetail[TRACE_PHASE_COUNT];
+		boost::uint64_t phaseCount[TRACE_PHASE_COUNT];
+		boost::uint64_t phaseTime[TRACE_PHASE_COUNT];
+	};
+
+	ThreadBuffer *GetThreadBuffer();
+
+	int GetSpanCount();
+	int GetDroppedSpanCount();
+	int GetPhaseCount(TracePhase phase);
+	double GetPhaseTime(TracePhase phase);
+
+	// Identifies the tracer in the thread local buffer references, since
+	// a new tracer may be allocated at the address of a freed one
+	u_int generation;
+	boost::uint64_t origin;
+	bool enabled;
+	string fileName;
+	int bufferCapacity;
+
+	boost::mutex buffersMutex;
+	boost::ptr_vector<ThreadBuffer> buffers;
+};
+
+// Records a span of the given phase for the lifetime of the object, costs
+// a single test when tracing is disabled
+class TraceSpan {
+public:
+	TraceSpan(TracePhase p, const char *d = NULL) :
+		tracer(Tracer::GetEnabled()), phase(p), detail(d),
+		start(tracer ? osNanoClock() : 0) { }
+	~TraceSpan() {
+		if (tracer)
+			tracer->Record(phase, detail, start, osNanoClock());
+	}
+
+private:
+	Tracer *tracer;
+	TracePhase phase;
+	const char *detail;
+	boost::uint64_t start;
+};
+
+}//namespace lux
+
+#endif // LUX_TRACER_H
@@ -629,7 +629,7 @@ void lux_wrapped_paramset::AddBool(const char* n, const bool * v, unsigned int n
 }
 void lux_wrapped_paramset::AddPoint(const char* n, const float * v, unsigned int nItems)
 {
-	lux::Point* pts = new lux::Point[nItems/3];
+	boost::shared_array<lux::Point> pts(new lux::Point[nItems/3]);
 	for(unsigned int i=0; i<nItems; i+=3)
 	{
 		pts[i/3].x = v[i];
@@ -640,7 +640,7 @@ void lux_wrapped_paramset::AddPoint(const char* n, const float * v, unsigned int
 }
 void lux_wrapped_paramset::AddVector(const char* n, const float * v, unsigned int nItems)
 {
-	lux::Vector* vec = new lux::Vector[nItems/3];
+	boost::shared_array<lux::Vector> vec(new lux::Vector[nItems/3]);
 	for(unsigned int i=0; i<nItems; i+=3)
 	{
 		vec[i/3].x = v[i];
@@ -651,7 +651,7 @@ void lux_wrapped_paramset::AddVector(const char* n, const float * v, unsigned in
 }
 void lux_wrapped_paramset::AddNormal(const char* n, const float * v, unsigned int nItems)
 {
-	lux::Normal* nor = new lux::Normal[nItems/3];
+	boost::shared_array<lux::Normal> nor(new lux::Normal[nItems/3]);
 	for(unsigned int i=0; i<nItems; i+=3)
 	{
 		nor[i/3].x = v[i];
@@ -41,6 +41,7 @@
 #include "dynload.h"
 #include "filedata.h"
 #include "contribution.h"
+#include "tracer.h"
 
 #include <boost/thread/xtime.hpp>
 #include <boost/filesystem.hpp>
@@ -59,11 +60,15 @@ FlexImageFilm::FlexImageFilm(u_int xres, u_int yres, Filter *filt, u_int filtRes
 	float p_ReinhardBurn, float p_LinearSensitivity, float p_LinearExposure, float p_LinearFStop, float p_LinearGamma,
 	float p_ContrastYwa, const string &p_response, float p_Gamma,
 	const float cs_red[2], const float cs_green[2], const float cs_blue[2], const float whitepoint[2],
-	bool debugmode, int outlierk, int tilec, const double convstep, const string &samplingmapfilename) :
+	bool debugmode, int outlierk, int tilec, const double convstep, const string &samplingmapfilename,
+	bool sparsebuffers, u_int outliercellcapacity) :
 	Film(xres, yres, filt, filtRes, crop, filename1, premult, cw_EXR_ZBuf || cw_PNG_ZBuf || cw_TGA_ZBuf, w_resume_FLM, 
-		restart_resume_FLM, write_FLM_direct, haltspp, halttime, haltthreshold, debugmode, outlierk, tilec, samplingmapfilename), 
+		restart_resume_FLM, write_FLM_direct, haltspp, halttime, haltthreshold, debugmode, outlierk, tilec, samplingmapfilename, sparsebuffers,
+		outliercellcapacity), 
 	framebuffer(NULL), float_framebuffer(NULL), alpha_buffer(NULL), z_buffer(NULL),
-	writeInterval(wI), flmWriteInterval(fwI), displayInterval(dI), convUpdateThread(NULL), convUpdateStep(convstep)
+	writeInterval(wI), flmWriteInterval(fwI), displayInterval(dI), convUpdateThread(NULL), convUpdateStep(convstep),
+	imageWriterThread(NULL), pendingSnapshot(NULL), imageWriterStop(false),
+	imageLockTime(0.0), imageLockTimeMax(0.0)
 {
 	colorSpace = ColorSystem(cs_red[0], cs_red[1], cs_green[0], cs_green[1], cs_blue[0], cs_blue[1], whitepoint[0], whitepoint[1], 1.f);
 
@@ -107,6 +112,8 @@ FlexImageFilm::FlexImageFilm(u_int xres, u_int yres, Filter *filt, u_int filtRes
 	AddIntAttribute(*this, "displayInterval", "Display interval (seconds)", displayInterval, &FlexImageFilm::displayInterval, Queryable::ReadWriteAccess);
 	AddIntAttribute(*this, "writeInterval", "Output file write interval (seconds)", writeInterval, &FlexImageFilm::writeInterval, Queryable::ReadWriteAccess);
 	AddIntAttribute(*this, "flmWriteInterval", "Output FLM file write interval (seconds)", flmWriteInterval, &FlexImageFilm::flmWriteInterval, Queryable::ReadWriteAccess);
+	AddDoubleAttribute(*this, "imageLockTime", "Pool lock hold time of the last image snapshot (seconds)", &FlexImageFilm::imageLockTime);
+	AddDoubleAttribute(*this, "imageLockTimeMax", "Longest pool lock hold time of an image snapshot (seconds)", &FlexImageFilm::imageLockTimeMax);
 
 	// Set use and default runtime changeable parameters
 	m_TonemapKernel = d_TonemapKernel = p_TonemapKernel;
@@ -842,16 +849,16 @@ void FlexImageFilm::CheckWriteOuputInterval()
 	if (!(timeToWriteImage || timeToWriteFLM))
 		return;
 
-	if (!framebuffer) 
-		createFrameBuffer();
+	if (timeToWriteFLM && writeResumeFlm)
+		WriteFilmToFile(filename + ".flm");
 
-	ImageType output = IMAGE_NONE;
-	if (timeToWriteImage)
-		output = static_cast<ImageType>(output | IMAGE_FILEOUTPUT);
-	if (timeToWriteFLM)
-		output = static_cast<ImageType>(output | IMAGE_FLMOUTPUT);
-
-	WriteImage(output);
+	// Only the buffer copy is done here, tonemapping and encoding
+	// are left to the image writer thread
+	if (timeToWriteImage) {
+		ImageSnapshot *snapshot = TakeSnapshot(IMAGE_FILEOUTPUT);
+		if (snapshot)
+			QueueSnapshot(snapshot);
+	}
 
 	// WriteImage can take a very long time to be executed (i.e. by saving
 	// the film. It is better to refresh timestamps after the
@@ -1004,11 +1011,20 @@ void FlexImageFilm::WriteImage2(ImageType type, vector<XYZColor> &xyzcolor, vect
 
 		// Output to low dynamic range formats
 		if ((type & IMAGE_FILEOUTPUT) || (type & IMAGE_FRAMEBUFFER)) {
-			// Clamp too high values
-			// and apply gamma correction
+			// Clamp too high values, apply gamma correction and
+			// quantize to the framebuffer in a single pass
 			const float invGamma = 1.f / m_Gamma;
-			for (u_int i = 0; i < nPix; ++i) {
-				rgbcolor[i] = colorSpace.Limit(rgbcolor[i], clampMethod).Pow(invGamma);
+			const bool toFramebuffer = (type & IMAGE_FRAMEBUFFER) && framebuffer;
+			for (u_int i = 0, y = yPixelStart; y < yPixelStart + yPixelCount; ++y) {
+				for (u_int x = xPixelStart; x < xPixelStart + xPixelCount; ++x, ++i) {
+					rgbcolor[i] = colorSpace.Limit(rgbcolor[i], clampMethod).Pow(invGamma);
+					if (!toFramebuffer)
+						continue;
+					const u_int offset = 3 * (y * xResolution + x);
+					framebuffer[offset] = static_cast<unsigned char>(Clamp(256 * rgbcolor[i].c[0], 0.f, 255.f));
+					framebuffer[offset + 1] = static_cast<unsigned char>(Clamp(256 * rgbcolor[i].c[1], 0.f, 255.f));
+					framebuffer[offset + 2] = static_cast<unsigned char>(Clamp(256 * rgbcolor[i].c[2], 0.f, 255.f));
+				}
 			}
 
 			// write out tonemapped TGA
@@ -1017,25 +1033,15 @@ void FlexImageFilm::WriteImage2(ImageType type, vector<XYZColor> &xyzcolor, vect
 			if ((type & IMAGE_FILEOUTPUT) && write_PNG)
 				WritePNGImage(rgbcolor, alpha, filename + postfix + ".png");
 
-			// Copy to framebuffer pixels
+			// Framebuffer pixels have been copied above
 			if ((type & IMAGE_FRAMEBUFFER) && framebuffer) {
-				u_int i = 0;
-				for (u_int y = yPixelStart; y < yPixelStart + yPixelCount; ++y) {
-					for (u_int x = xPixelStart; x < xPixelStart + xPixelCount; ++x) {
-						const u_int offset = 3 * (y * xResolution + x);
-						framebuffer[offset] = static_cast<unsigned char>(Clamp(256 * rgbcolor[i].c[0], 0.f, 255.f));
-						framebuffer[offset + 1] = static_cast<unsigned char>(Clamp(256 * rgbcolor[i].c[1], 0.f, 255.f));
-						framebuffer[offset + 2] = static_cast<unsigned char>(Clamp(256 * rgbcolor[i].c[2], 0.f, 255.f));
-
-						// Some debug code used to show the convergence map
-						/*if (convergenceDiff.size() > 0)
-							framebuffer[3 * i] = framebuffer[3 * i + 1] = framebuffer[3 * i + 2] = convergenceDiff[i] ? 255 : 0;
-						else
-							framebuffer[3 * i] = framebuffer[3 * i + 1] = framebuffer[3 * i + 2] = 0;*/
-
-						++i;
-					}
-				}
+				// Some debug code used to show the convergence map
+				/*for (u_int i = 0; i < nPix; i++) {
+					if (convergenceDiff.size() > 0)
+						framebuffer[3 * i] = framebuffer[3 * i + 1] = framebuffer[3 * i + 2] = convergenceDiff[i] ? 255 : 0;
+					else
+						framebuffer[3 * i] = framebuffer[3 * i + 1] = framebuffer[3 * i + 2] = 0;
+				}*/
 
 				// Some debug code used to show noise-aware map
 				/*if (noiseAwareMapVersion > 0) {
@@ -1173,14 +1179,12 @@ void FlexImageFilm::WriteImage2(ImageType type, vector<XYZColor> &xyzcolor, vect
 
 void FlexImageFilm::WriteImage(ImageType type)
 {
-	// ensure we dont try to perform multiple writes at once
-	// needed since we can't put the pool lock up here
-	boost::mutex::scoped_lock(write_mutex);
-	
 	// check if film is initialized
 	if (!contribPool)
 		return;
 
+	TraceSpan span(TRACE_FILM_WRITE, "image");
+
 	// save the current status of the film if required
 	// do it here instead of in WriteImage2 to reduce
 	// memory usage
@@ -1191,19 +1195,47 @@ void FlexImageFilm::WriteImage(ImageType type)
 			WriteFilmToFile(filename + ".flm");
 	}
 
+	ImageSnapshot *snapshot = TakeSnapshot(type);
+	if (!snapshot)
+		return;
+
+	// A pending periodic write is older than this one, drop it so
+	// that it can't overwrite the output files afterwards
+	if (type & IMAGE_FILEOUTPUT) {
+		boost::mutex::scoped_lock lock(imageWriterMutex);
+		delete pendingSnapshot;
+		pendingSnapshot = NULL;
+	}
+
+	WriteSnapshot(*snapshot);
+	delete snapshot;
+}
+
+FlexImageFilm::ImageSnapshot *FlexImageFilm::TakeSnapshot(ImageType type)
+{
+	// check if film is initialized
+	if (!contribPool)
+		return NULL;
+
 	if (!framebuffer || !float_framebuffer || !alpha_buffer || !z_buffer)
 		createFrameBuffer();
 
-	ScopedPoolLock poolLock(contribPool);
-
 	const u_int nPix = xPixelCount * yPixelCount;
-	vector<XYZColor> pixels(nPix);
-	vector<float> alpha(nPix), alphaWeight(nPix, 0.f);
+	ImageSnapshot *snapshot = new ImageSnapshot();
+	snapshot->type = type;
+	vector<XYZColor> &pixels(snapshot->pixels);
+	vector<float> &alpha(snapshot->alpha);
+	pixels.resize(nPix);
+	alpha.resize(nPix);
+	vector<float> alphaWeight(nPix, 0.f);
+
+	ScopedPoolLock poolLock(contribPool);
+	const double lockStart = osWallClockTime();
 
 	// NOTE - lordcrc - separated buffer loop into two separate loops
 	// in order to eliminate one of the framebuffer copies
 
-	// write stand-alone buffers
+	// copy stand-alone buffers
 	for(u_int j = 0; j < bufferGroups.size(); ++j) {
 		if (!bufferGroups[j].enable)
 			continue;
@@ -1214,22 +1246,18 @@ void FlexImageFilm::WriteImage(ImageType type)
 			if (!(bufferConfigs[i].output & BUF_STANDALONE))
 				continue;
 
-			buffer.GetData(&(pixels[0]), &(alpha[0]));
-			WriteImage2(type, pixels, alpha, bufferConfigs[i].postfix);
+			snapshot->standalonePostfix.push_back(bufferConfigs[i].postfix);
+			snapshot->standalonePixels.push_back(vector<XYZColor>(nPix));
+			snapshot->standaloneAlpha.push_back(vector<float>(nPix));
+			buffer.GetData(&(snapshot->standalonePixels.back()[0]),
+				&(snapshot->standaloneAlpha.back()[0]));
 		}
 	}
 
-	float Y = 0.f;
-	// in order to fix bug #360
-	// ouside loop not to trash the complete picture
-	// if there are several buffer groups
-	fill(pixels.begin(), pixels.end(), XYZColor(0.f));
-	fill(alpha.begin(), alpha.end(), 0.f);
-
 	XYZColor p;
 	float a;
 
-	// write framebuffer
+	// copy framebuffer
 	for(u_int j = 0; j < bufferGroups.size(); ++j) {
 		if (!bufferGroups[j].enable)
 			continue;
@@ -1249,6 +1277,14 @@ void FlexImageFilm::WriteImage(ImageType type)
 			}
 		}
 	}
+
+	// release pool lock before any further processing
+	poolLock.unlock();
+	imageLockTime = osWallClockTime() - lockStart;
+	imageLockTimeMax = max(imageLockTimeMax, imageLockTime);
+	LOG(LUX_DEBUG, LUX_NOERROR) << "Image snapshot pool lock time: " << imageLockTime << "s";
+
+	float Y = 0.f;
 	// outside loop in order to write complete image
 	u_int pcount = 0;
 	u_int pix = 0;
@@ -1279,10 +1315,72 @@ void FlexImageFilm::WriteImage(ImageType type)
 		EV = -INFINITY;
 	}
 
-	// release pool lock before writing output
-	poolLock.unlock();
+	return snapshot;
+}
+
+void FlexImageFilm::WriteSnapshot(ImageSnapshot &snapshot)
+{
+	// ensure we dont try to perform multiple writes at once,
+	// the pipeline keeps state between invocations
+	boost::mutex::scoped_lock lock(pipelineMutex);
+
+	for (u_int i = 0; i < snapshot.standalonePostfix.size(); ++i)
+		WriteImage2(snapshot.type, snapshot.standalonePixels[i],
+			snapshot.standaloneAlpha[i], snapshot.standalonePostfix[i]);
+
+	WriteImage2(snapshot.type, snapshot.pixels, snapshot.alpha, "");
+}
+
+void FlexImageFilm::QueueSnapshot(ImageSnapshot *snapshot)
+{
+	boost::mutex::scoped_lock lock(imageWriterMutex);
+
+	// Coalesce with a write that hasn't started yet
+	if (pendingSnapshot) {
+		snapshot->type = static_cast<ImageType>(snapshot->type | pendingSnapshot->type);
+		delete pendingSnapshot;
+	}
+	pendingSnapshot = snapshot;
 
-	WriteImage2(type, pixels, alpha, "");
+	if (!imageWriterThread)
+		imageWriterThread = new boost::thread(boost::bind(FlexImageFilm::ImageWriterThreadImpl, this));
+	else
+		imageWriterCondition.notify_one();
+}
+
+void FlexImageFilm::StopImageWriter()
+{
+	{
+		boost::mutex::scoped_lock lock(imageWriterMutex);
+		imageWriterStop = true;
+		imageWriterCondition.notify_one();
+	}
+	if (imageWriterThread) {
+		// The pending write, if any, is completed before exiting
+		imageWriterThread->join();
+		delete imageWriterThread;
+		imageWriterThread = NULL;
+	}
+	delete pendingSnapshot;
+	pendingSnapshot = NULL;
+}
+
+void FlexImageFilm::ImageWriterThreadImpl(FlexImageFilm *film) {
+	for (;;) {
+		ImageSnapshot *snapshot;
+		{
+			boost::mutex::scoped_lock lock(film->imageWriterMutex);
+			while (!film->pendingSnapshot && !film->imageWriterStop)
+				film->imageWriterCondition.wait(lock);
+			if (!film->pendingSnapshot)
+				break;
+			snapshot = film->pendingSnapshot;
+			film->pendingSnapshot = NULL;
+		}
+
+		film->WriteSnapshot(*snapshot);
+		delete snapshot;
+	}
 }
 
 void FlexImageFilm::SaveEXR(const string &exrFilename, bool useHalfFloats, bool includeZBuf, int compressionType, bool tonemapped)
@@ -1291,6 +1389,8 @@ void FlexImageFilm::SaveEXR(const string &exrFilename, bool useHalfFloats, bool
 	if (!contribPool)
 		return;
 
+	// the pipeline state is shared with the image writer
+	boost::mutex::scoped_lock pipelineLock(pipelineMutex);
 	//boost::mutex::scoped_lock(write_mutex);
 	// don't need the write mutex since we're just protecting the buffers
 	ScopedPoolLock poolLock(contribPool);
@@ -1816,6 +1916,12 @@ Film* FlexImageFilm::CreateFilm(const ParamSet &params, Filter *filter)
 
 	int tilecount = params.FindOneInt("tilecount", 0);
 
+	// Allocate the light group buffers by blocks of pixels as they
+	// receive samples
+	bool sparsebuffers = params.FindOneBool("sparsebuffers", false);
+	// Max rejected points kept per outlier cell, 0 = unbounded
+	int outliercellcapacity = max(params.FindOneInt("outlierrejection_cellcapacity", 0), 0);
+
 	return new FlexImageFilm(xres, yres, filter, filtRes, crop,
 		filename, premultiplyAlpha, writeInterval, flmWriteInterval, displayInterval, clampMethod, 
 		w_EXR, w_EXR_channels, w_EXR_halftype, w_EXR_compressiontype, w_EXR_applyimaging, w_EXR_gamutclamp, w_EXR_ZBuf, w_EXR_ZBuf_normalizationtype, w_EXR_straightcolors,
@@ -1824,7 +1930,8 @@ Film* FlexImageFilm::CreateFilm(const ParamSet &params, Filter *filter)
 		w_resume_FLM, restart_resume_FLM, w_FLM_direct, haltspp, halttime, haltthreshold,
 		s_TonemapKernel, s_ReinhardPreScale, s_ReinhardPostScale, s_ReinhardBurn, s_LinearSensitivity,
 		s_LinearExposure, s_LinearFStop, s_LinearGamma, s_ContrastYwa, response, s_Gamma,
-		red, green, blue, white, debug_mode, outlierrejection_k, tilecount, convUpdateStep, samplingmapfilename);
+		red, green, blue, white, debug_mode, outlierrejection_k, tilecount, convUpdateStep, samplingmapfilename,
+		sparsebuffers, outliercellcapacity);
 }
 
 
@@ -30,6 +30,7 @@
 #include "tonemap.h"
 #include "sampling.h"
 #include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
 
 namespace lux {
 
@@ -53,13 +54,15 @@ public:
 		float p_ReinhardBurn, float p_LinearSensitivity, float p_LinearExposure, float p_LinearFStop, float p_LinearGamma,
 		float p_ContrastDisplayAdaptionY, const string &response, float p_Gamma,
 		const float cs_red[2], const float cs_green[2], const float cs_blue[2], const float whitepoint[2],
-		bool debugmode, int outlierk, int tilecount, const double convstep, const string &samplingmapfilename);
+		bool debugmode, int outlierk, int tilecount, const double convstep, const string &samplingmapfilename,
+		bool sparsebuffers = false, u_int outliercellcapacity = 0);
 
 	virtual ~FlexImageFilm() {
 		if (convUpdateThread) {
 			convUpdateThread->interrupt();
 			convUpdateThread->join();
 		}
+		StopImageWriter();
 
 		delete[] framebuffer;
 		delete[] float_framebuffer;
@@ -95,10 +98,38 @@ public:
 	 * the necessary buffers. This is currently only used for loading and tonemapping an existing FLM file.
 	 */
 	static Film *CreateFilmFromFLM(const string &flmFileName);
+	/**
+	 * Sets the base filename and image formats used by WriteImage for file
+	 * output. This is used to write images from films created by
+	 * CreateFilmFromFLM, which have file output disabled.
+	 */
+	void SetFileOutput(const string &outputFilename, bool png, bool tga,
+		bool exr) {
+		filename = outputFilename;
+		write_PNG = png;
+		write_TGA = tga;
+		write_EXR = exr;
+	}
 
 private:
 	static void GetColorspaceParam(const ParamSet &params, const string name, float values[2]);
 	static void ConvUpdateThreadImpl(FlexImageFilm *film);
+	static void ImageWriterThreadImpl(FlexImageFilm *film);
+
+	// Copy of the film buffers taken under the pool lock, so that the
+	// imaging pipeline and the file encoding can run without it
+	struct ImageSnapshot {
+		ImageType type;
+		vector<string> standalonePostfix;
+		vector<vector<XYZColor> > standalonePixels;
+		vector<vector<float> > standaloneAlpha;
+		vector<XYZColor> pixels;
+		vector<float> alpha;
+	};
+	ImageSnapshot *TakeSnapshot(ImageType type);
+	void WriteSnapshot(ImageSnapshot &snapshot);
+	void QueueSnapshot(ImageSnapshot *snapshot);
+	void StopImageWriter();
 
 	vector<RGBColor>& ApplyPipeline(const ColorSystem &colorSpace, vector<XYZColor> &color);
 	void WriteImage2(ImageType type, vector<XYZColor> &color, vector<float> &alpha, string postfix);
@@ -189,6 +220,18 @@ private:
 	// Thread dedicated to convergence test an noise-aware map update
 	boost::thread *convUpdateThread;
 	double convUpdateStep; // Number of new samples per pixel required to trigger an update
+
+	// Serializes ApplyPipeline/WriteImage2, they are not reentrant
+	boost::mutex pipelineMutex;
+	// Background writer for periodic image output, it only keeps the
+	// most recent pending snapshot so that slow writes coalesce
+	boost::mutex imageWriterMutex;
+	boost::condition_variable imageWriterCondition;
+	boost::thread *imageWriterThread;
+	ImageSnapshot *pendingSnapshot;
+	bool imageWriterStop;
+	// Pool lock hold times while taking image snapshots (seconds)
+	double imageLockTime, imageLockTimeMax;
 };
 
 }//namespace lux
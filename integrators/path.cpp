@@ -432,8 +432,8 @@ void PathIntegrator::BuildShadowRays(const Scene &scene, PathState *pathState, B
 		const u_int offset = j * (1 + shadowRaysCount * 3);
 		float lc = sampleData[offset];
 		float lightSelectionPdf;
-		const Light *light = hints.SampleLight(scene, j, &lc,
-			&lightSelectionPdf);
+		const Light *light = hints.SampleLight(scene,
+			bsdf->dgShading.p, j, &lc, &lightSelectionPdf);
 		if (!light)
 			break;
 		lightSelectionPdf *= shadowRaysCount;
@@ -603,7 +603,7 @@ bool PathIntegrator::NextState(const Scene &scene, SurfaceIntegratorState *s, lu
 					continue;
 				if (enableDirectLightSampling &&
 					!pathState->GetSpecularBounce())
-					Le *= PowerHeuristic(1, pathState->bouncePdf, 1, pdf * hints.Pdf(scene, i) * shadowRaysCount * DistanceSquared(pathState->pathRay.o, ibsdf->dgShading.p) / (AbsDot(pathState->pathRay.d, ibsdf->ng)));
+					Le *= PowerHeuristic(1, pathState->bouncePdf, 1, pdf * hints.Pdf(scene, pathState->pathRay.o, i) * shadowRaysCount * DistanceSquared(pathState->pathRay.o, ibsdf->dgShading.p) / (AbsDot(pathState->pathRay.d, ibsdf->ng)));
 				pathState->L[light->group] += Le;
 				pathState->V[light->group] += Le.Filter(sw) * pathState->VContrib;
 				++(*nrContribs);
@@ -636,7 +636,7 @@ bool PathIntegrator::NextState(const Scene &scene, SurfaceIntegratorState *s, lu
 		&Le)) {
 		if (enableDirectLightSampling &&
 			!pathState->GetSpecularBounce())
-			Le *= PowerHeuristic(1, pathState->bouncePdf, 1, pdf * hints.Pdf(scene, isect.arealight) * shadowRaysCount * DistanceSquared(pathState->pathRay.o, ibsdf->dgShading.p) / (AbsDot(pathState->pathRay.d, ibsdf->ng)));
+			Le *= PowerHeuristic(1, pathState->bouncePdf, 1, pdf * hints.Pdf(scene, pathState->pathRay.o, isect.arealight) * shadowRaysCount * DistanceSquared(pathState->pathRay.o, ibsdf->dgShading.p) / (AbsDot(pathState->pathRay.d, ibsdf->ng)));
 		pathState->L[isect.arealight->group] += Le;
 		pathState->V[isect.arealight->group] += Le.Filter(sw) * pathState->VContrib;
 		++(*nrContribs);
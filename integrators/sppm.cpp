@@ -94,6 +94,16 @@ SurfaceIntegrator *SPPMIntegrator::CreateSurfaceIntegrator(const ParamSet &param
 	sppmi->parallelHashGridSpare = params.FindOneFloat("parallelhashgridspare", 1.0f);
 	sppmi->photonPerPass = params.FindOneInt("photonperpass", 1000000);
 	sppmi->hitpointPerPass = params.FindOneInt("hitpointperpass", 0);
+	// Bound the hit points memory by rendering one image tile at a time
+	sppmi->tileSize = max(params.FindOneInt("tilesize", 0), 0);
+	if (sppmi->tileSize > 0 && sppmi->photonSamplerType == AMC) {
+		LOG(LUX_WARNING, LUX_BADTOKEN) << "SPPM tiles are not supported by the \"amc\" photon sampler, rendering the whole image at once";
+		sppmi->tileSize = 0;
+	}
+	if (sppmi->tileSize > 0 && (sppmi->hitpointPerPass > 0 ||
+		params.FindOneString("pixelsampler", "") != "")) {
+		LOG(LUX_WARNING, LUX_BADTOKEN) << "SPPM tiles use one hit point per pixel, \"hitpointperpass\" and \"pixelsampler\" are ignored";
+	}
 
 	sppmi->includeEnvironment = params.FindOneBool("includeenvironment", true);
 	sppmi->directLightSampling = params.FindOneBool("directlightsampling", true);
@@ -55,6 +55,8 @@ public:
 	u_int maxEyePathDepth;
 	u_int maxPhotonPathDepth;
 	u_int hitpointPerPass;
+	// Size in pixels of the image tiles, 0 to cover the whole image
+	u_int tileSize;
 	u_int photonPerPass;
 	u_int photonStartK;
 
@@ -34,6 +34,7 @@
 #include "sampling.h"
 #include "dynload.h"
 #include "queryable.h"
+#include "lighttree.h"
 
 using namespace lux;
 
@@ -159,7 +160,7 @@ protected:
 AreaLight::AreaLight(const Transform &light2world,
 	boost::shared_ptr<Texture<SWCSpectrum> > &le, float g, float pow,
 	float e, SampleableSphericalFunction *ssf, u_int ns,
-	const boost::shared_ptr<Primitive> &p)
+	const boost::shared_ptr<Primitive> &p, bool treeSampling)
 	: Light("AreaLight-" + boost::lexical_cast<string>(this), light2world, ns),
 		Le(le), paramGain(g), gain(g), power(pow), efficacy(e), func(ssf)
 {
@@ -175,8 +176,12 @@ AreaLight::AreaLight(const Transform &light2world,
 		p->Refine(refinedPrims, refineHints, p);
 		if (refinedPrims.size() == 1)
 			prim = refinedPrims[0];
-		else
-			prim = boost::shared_ptr<Primitive>(new PrimitiveSet(refinedPrims));
+		else {
+			PrimitiveSet *set = new PrimitiveSet(refinedPrims);
+			if (treeSampling)
+				set->InitSamplingTree();
+			prim = boost::shared_ptr<Primitive>(set);
+		}
 	}
 	area = prim->Area();
 	Le->SetIlluminant(); // Illuminant must be set before calling Le->Y()
@@ -206,6 +211,15 @@ float AreaLight::Pdf(const Point &p, const PartialDifferentialGeometry &dg) cons
 	return prim->Pdf(p, dg);
 }
 
+bool AreaLight::GetBounds(LightBounds *bounds) const
+{
+	// Gonio and shading normals prevent a tight emission cone
+	bounds->bounds = prim->WorldBound();
+	bounds->cosThetaO = -1.f;
+	bounds->cosThetaE = -1.f;
+	return true;
+}
+
 bool AreaLight::SampleL(const Scene &scene, const Sample &sample,
 	float u1, float u2, float u3, BSDF **bsdf, float *pdf,
 	SWCSpectrum *Le) const
@@ -286,8 +300,12 @@ AreaLight* AreaLight::CreateAreaLight(const Transform &light2world,
 		ssf = new SampleableSphericalFunction(sf);
 
 	int nSamples = paramSet.FindOneInt("nsamples", 1);
+	// Select the sampled primitives of a mesh according to the receiving
+	// point instead of their area
+	bool treeSampling = paramSet.FindOneBool("lighttree", false);
 
-	AreaLight *l = new AreaLight(light2world, L, g, p, e, ssf, nSamples, prim);
+	AreaLight *l = new AreaLight(light2world, L, g, p, e, ssf, nSamples,
+		prim, treeSampling);
 	l->hints.InitParam(paramSet);
 	return l;
 }
@@ -29,6 +29,7 @@
 #include "sampling.h"
 #include "paramset.h"
 #include "dynload.h"
+#include "lighttree.h"
 
 using namespace lux;
 
@@ -161,6 +162,14 @@ float PointLight::Pdf(const Point &p, const PartialDifferentialGeometry &dg) con
 	return 1.f;
 }
 
+bool PointLight::GetBounds(LightBounds *bounds) const
+{
+	bounds->bounds = BBox(lightPos);
+	bounds->cosThetaO = -1.f;
+	bounds->cosThetaE = -1.f;
+	return true;
+}
+
 bool PointLight::SampleL(const Scene &scene, const Sample &sample,
 	float u1, float u2, float u3, BSDF **bsdf, float *pdf,
 	SWCSpectrum *Le) const
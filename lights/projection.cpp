@@ -30,6 +30,7 @@
 #include "sampling.h"
 #include "paramset.h"
 #include "dynload.h"
+#include "lighttree.h"
 
 using namespace lux;
 
@@ -150,6 +151,15 @@ float ProjectionLight::Pdf(const Point &p, const PartialDifferentialGeometry &dg
 {
 	return 1.f;
 }
+
+bool ProjectionLight::GetBounds(LightBounds *bounds) const
+{
+	bounds->bounds = BBox(lightPos);
+	bounds->axis = Vector(Normalize(LightToWorld * Normal(0, 0, 1)));
+	bounds->cosThetaO = cosTotalWidth;
+	bounds->cosThetaE = 1.f;
+	return true;
+}
 bool ProjectionLight::SampleL(const Scene &scene, const Sample &sample,
 	float u1, float u2, float u3, BSDF **bsdf, float *pdf,
 	SWCSpectrum *Le) const
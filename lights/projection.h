@@ -51,6 +51,7 @@ public:
 	virtual bool SampleL(const Scene &scene, const Sample &sample,
 		const Point &p, float u1, float u2, float u3, BSDF **bsdf,
 		float *pdf, float *pdfDirect, SWCSpectrum *Le) const;
+	virtual bool GetBounds(LightBounds *bounds) const;
 	
 	static Light *CreateLight(const Transform &light2world,
 		const ParamSet &paramSet);
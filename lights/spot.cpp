@@ -30,6 +30,7 @@
 #include "sampling.h"
 #include "paramset.h"
 #include "dynload.h"
+#include "lighttree.h"
 
 using namespace lux;
 
@@ -104,6 +105,15 @@ float SpotLight::Pdf(const Point &p, const PartialDifferentialGeometry &dg) cons
 	return 1.f;
 }
 
+bool SpotLight::GetBounds(LightBounds *bounds) const
+{
+	bounds->bounds = BBox(lightPos);
+	bounds->axis = Vector(Normalize(LightToWorld * Normal(0, 0, 1)));
+	bounds->cosThetaO = cosTotalWidth;
+	bounds->cosThetaE = 1.f;
+	return true;
+}
+
 bool SpotLight::SampleL(const Scene &scene, const Sample &sample,
 	float u1, float u2, float u3, BSDF **bsdf, float *pdf,
 	SWCSpectrum *Le) const
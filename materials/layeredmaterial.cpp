@@ -73,6 +73,9 @@ BSDF *LayeredMaterial::GetBSDF(MemoryArena &arena, const SpectrumWavelengths &sw
 	
 	LayeredBSDF *bsdf=ARENA_ALLOC(arena, LayeredBSDF)(dgShading, isect.dg.nn,
 		isect.exterior, isect.interior);
+	// The BSDF belongs to a single thread, and so does its cache
+	if (cacheEyePaths)
+		bsdf->SetPathCache(ARENA_ALLOC(arena, LayeredPathCache)());
 	
 	if (mat1) { // mat1
 		addMat(arena,sw,isect,dgShading,mat1,bsdf,opacity1);
@@ -113,8 +116,11 @@ Material* LayeredMaterial::CreateMaterial(const Transform &xform,
 	boost::shared_ptr<Texture<float> > opacity2(mp.GetFloatTexture("opacity2",1.0f));
 	boost::shared_ptr<Texture<float> > opacity3(mp.GetFloatTexture("opacity3",1.0f));
 	boost::shared_ptr<Texture<float> > opacity4(mp.GetFloatTexture("opacity4",1.0f));
+
+	bool cacheEyePaths = mp.FindOneBool("cacheeyepaths", false);
 	
-	return new LayeredMaterial(mp,mat1,mat2,mat3,mat4,opacity1,opacity2,opacity3,opacity4);
+	return new LayeredMaterial(mp,mat1,mat2,mat3,mat4,opacity1,opacity2,opacity3,opacity4,
+		cacheEyePaths);
 }
 /*
 void LayeredMaterial::setMaterial(int slot, boost::shared_ptr<Material> &mat){
@@ -36,9 +36,11 @@ public:
 		 boost::shared_ptr<Material> &m2,boost::shared_ptr<Material> &m3,
 		  boost::shared_ptr<Material> &m4,
 		  boost::shared_ptr<Texture<float> > &op1, boost::shared_ptr<Texture<float> > &op2,
-		  boost::shared_ptr<Texture<float> > &op3, boost::shared_ptr<Texture<float> > &op4
+		  boost::shared_ptr<Texture<float> > &op3, boost::shared_ptr<Texture<float> > &op4,
+		  bool cacheEye = false
 		  ) : Material("LayeredMaterial-" + boost::lexical_cast<string>(this), mp), mat1(m1),mat2(m2),
-		  mat3(m3),mat4(m4), opacity1(op1),opacity2(op2),opacity3(op3),opacity4(op4) {}
+		  mat3(m3),mat4(m4), opacity1(op1),opacity2(op2),opacity3(op3),opacity4(op4),
+		  cacheEyePaths(cacheEye) {}
 
 	void addMat(MemoryArena &arena, const SpectrumWavelengths &sw, const Intersection &isect, 
 		const DifferentialGeometry &dgShading, boost::shared_ptr<Material> mat,
@@ -58,6 +60,9 @@ private:
 	// LayeredMaterial Private Data
 	boost::shared_ptr<Material> mat1,mat2,mat3,mat4;
 	boost::shared_ptr<Texture<float> > opacity1,opacity2,opacity3,opacity4;
+	// Reuse the eye path through the layers while the eye direction does
+	// not change
+	bool cacheEyePaths;
 };
 
 }//namespace lux
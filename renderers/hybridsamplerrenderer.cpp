@@ -28,6 +28,8 @@
 #include "hybridsamplerrenderer.h"
 #include "randomgen.h"
 #include "context.h"
+#include "osfunc.h"
+#include "tracer.h"
 #include "integrators/path.h"
 #include "renderers/statistics/hybridsamplerstatistics.h"
 
@@ -164,7 +166,8 @@ bool SurfaceIntegratorStateBuffer::NextState(u_int &nrContribs, u_int &nrSamples
 HybridSamplerRenderer::HybridSamplerRenderer(const int oclPlatformIndex, bool useGPUs,
 		const u_int forceGPUWorkGroupSize, const string &deviceSelection,
 		const u_int rayBufSize, const u_int stateBufCount,
-		const u_int qbvhStackSize) : HybridRenderer() {
+		const u_int qbvhStackSize, bool affinity) : HybridRenderer(),
+		threadAffinity(affinity) {
 	state = INIT;
 
 	if (!IsPowerOf2(rayBufSize)) {
@@ -281,6 +284,7 @@ HybridSamplerRenderer::HybridSamplerRenderer(const int oclPlatformIndex, bool us
 	suspendThreadsWhenDone = false;
 
 	AddStringConstant(*this, "name", "Name of current renderer", "hybridsampler");
+	AddBoolAttribute(*this, "threadAffinity", "Render threads are bound to processors", &HybridSamplerRenderer::threadAffinity);
 
 	rendererStatistics = new HSRStatistics(this);
 }
@@ -382,9 +386,16 @@ void HybridSamplerRenderer::Render(Scene *s) {
 
 		// integrator preprocessing
 		scene->sampler->SetFilm(scene->camera()->film);
-		scene->surfaceIntegrator->Preprocess(rng, *scene);
-		scene->volumeIntegrator->Preprocess(rng, *scene);
+		{
+			TraceSpan span(TRACE_PREPROCESS);
+			scene->surfaceIntegrator->Preprocess(rng, *scene);
+			scene->volumeIntegrator->Preprocess(rng, *scene);
+		}
 		scene->camera()->film->CreateBuffers();
+		// Threads bound to other NUMA nodes splat in local copies of
+		// the color buffers
+		if (threadAffinity && osNumaNodeCount() > 1)
+			scene->camera()->film->CreateNodeReplicas(osNumaNodeCount());
 
 		scene->surfaceIntegrator->RequestSamples(scene->sampler, *scene);
 		scene->volumeIntegrator->RequestSamples(scene->sampler, *scene);
@@ -503,6 +514,13 @@ void HybridSamplerRenderer::CreateRenderThread() {
 		}
 
 		RenderThread *rt = new  RenderThread(renderThreads.size(), this, idev);
+		if (threadAffinity) {
+			// Round robin over the nodes, then over their processors
+			const u_int nodeCount = osNumaNodeCount();
+			rt->node = rt->n % nodeCount;
+			const vector<u_int> &processors(osNumaNodeProcessors(rt->node));
+			rt->processor = processors[(rt->n / nodeCount) % processors.size()];
+		}
 
 		renderThreads.push_back(rt);
 		rt->thread = new boost::thread(boost::bind(RenderThread::RenderImpl, rt));
@@ -535,7 +553,8 @@ void HybridSamplerRenderer::RemoveRenderThread() {
 //------------------------------------------------------------------------------
 
 HybridSamplerRenderer::RenderThread::RenderThread(u_int index, HybridSamplerRenderer *r, luxrays::IntersectionDevice * idev) :
-	n(index), thread(NULL), renderer(r), iDevice(idev), samples(0.), blackSamples(0.), blackSamplePaths(0.) {
+	n(index), thread(NULL), renderer(r), iDevice(idev), node(0), processor(-1),
+	samples(0.), blackSamples(0.), blackSamplePaths(0.) {
 }
 
 HybridSamplerRenderer::RenderThread::~RenderThread() {
@@ -551,6 +570,15 @@ void HybridSamplerRenderer::RenderThread::RenderImpl(RenderThread *renderThread)
 	// To avoid interrupt exception
 	boost::this_thread::disable_interruption di;
 
+	// Bind before allocating anything, so the memory of the thread is
+	// allocated on its node
+	if (renderThread->processor >= 0) {
+		if (osSetThreadAffinity(renderThread->processor))
+			LOG(LUX_DEBUG, LUX_NOERROR) << "Thread " << renderThread->n << " bound to processor " << renderThread->processor << " on node " << renderThread->node;
+		else
+			LOG(LUX_WARNING, LUX_SYSTEM) << "Unable to bind thread " << renderThread->n << " to processor " << renderThread->processor;
+	}
+
 	// Dade - wait the end of the preprocessing phase
 	while (!renderer->preprocessDone) {
 		boost::this_thread::sleep(boost::posix_time::seconds(1));
@@ -559,7 +587,8 @@ void HybridSamplerRenderer::RenderThread::RenderImpl(RenderThread *renderThread)
 	// ContribBuffer has to wait until the end of the preprocessing
 	// It depends on the fact that the film buffers have been created
 	// This is done during the preprocessing phase
-	ContributionBuffer *contribBuffer = new ContributionBuffer(scene.camera()->film->contribPool);
+	ContributionBuffer *contribBuffer = new ContributionBuffer(scene.camera()->film->contribPool,
+		renderThread->node);
 
 	// initialize the thread's rangen
 	u_long seed;
@@ -699,7 +728,8 @@ Renderer *HybridSamplerRenderer::CreateRenderer(const ParamSet &params) {
 	params.MarkUsed(configParams);
 	return new HybridSamplerRenderer(platformIndex, useGPUs,
 			forceGPUWorkGroupSize, deviceSelection, rayBufferSize,
-			stateBufferCount, qbvhStackSize);
+			stateBufferCount, qbvhStackSize,
+			params.FindOneBool("threadaffinity", false));
 }
 
 static DynamicLoader::RegisterRenderer<HybridSamplerRenderer> r("hybrid");
@@ -76,7 +76,7 @@ public:
 	HybridSamplerRenderer(const int oclPlatformIndex, bool useGPUs,
 			const u_int forceGPUWorkGroupSize, const string &deviceSelection,
 			const u_int rayBufferSize, const u_int stateBufferCount,
-			const u_int qbvhStackSize);
+			const u_int qbvhStackSize, bool threadAffinity);
 	~HybridSamplerRenderer();
 
 	RendererType GetType() const;
@@ -111,6 +111,10 @@ private:
 		boost::thread *thread; // keep pointer to delete the thread object
 		HybridSamplerRenderer *renderer;
 		luxrays::IntersectionDevice * iDevice;
+		// NUMA node and logical processor the thread is bound to,
+		// the processor is negative if the thread isn't bound
+		u_int node;
+		int processor;
 
 		// Rendering statistics
 		fast_mutex statLock;
@@ -137,6 +141,9 @@ private:
 	Scene *scene;
 	u_long lastUsedSeed;
 
+	// Bind the render threads to processors, spread over the NUMA nodes
+	bool threadAffinity;
+
 	// Put them last for better data alignment
 	// used to suspend render threads until the preprocessing phase is done
 	bool preprocessDone;
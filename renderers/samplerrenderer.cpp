@@ -27,7 +27,9 @@
 #include "sampling.h"
 #include "samplerrenderer.h"
 #include "randomgen.h"
+#include "osfunc.h"
 #include "context.h"
+#include "tracer.h"
 #include "renderers/statistics/samplerstatistics.h"
 
 using namespace lux;
@@ -74,7 +76,8 @@ SRHostDescription::~SRHostDescription() {
 // SamplerRenderer
 //------------------------------------------------------------------------------
 
-SamplerRenderer::SamplerRenderer() : Renderer() {
+SamplerRenderer::SamplerRenderer(bool affinity) : Renderer(),
+	threadAffinity(affinity) {
 	state = INIT;
 
 	SRHostDescription *host = new SRHostDescription(this, "Localhost");
@@ -84,6 +87,7 @@ SamplerRenderer::SamplerRenderer() : Renderer() {
 	suspendThreadsWhenDone = false;
 
 	AddStringConstant(*this, "name", "Name of current renderer", "sampler");
+	AddBoolAttribute(*this, "threadAffinity", "Render threads are bound to processors", &SamplerRenderer::threadAffinity);
 
 	rendererStatistics = new SRStatistics(this);
 }
@@ -173,9 +177,16 @@ void SamplerRenderer::Render(Scene *s) {
 
 		// integrator preprocessing
 		scene->sampler->SetFilm(scene->camera()->film);
-		scene->surfaceIntegrator->Preprocess(rng, *scene);
-		scene->volumeIntegrator->Preprocess(rng, *scene);
+		{
+			TraceSpan span(TRACE_PREPROCESS);
+			scene->surfaceIntegrator->Preprocess(rng, *scene);
+			scene->volumeIntegrator->Preprocess(rng, *scene);
+		}
 		scene->camera()->film->CreateBuffers();
+		// Threads bound to other NUMA nodes splat in local copies of
+		// the color buffers
+		if (threadAffinity && osNumaNodeCount() > 1)
+			scene->camera()->film->CreateNodeReplicas(osNumaNodeCount());
 
 		scene->surfaceIntegrator->RequestSamples(scene->sampler, *scene);
 		scene->volumeIntegrator->RequestSamples(scene->sampler, *scene);
@@ -212,10 +223,26 @@ void SamplerRenderer::Render(Scene *s) {
 			boost::mutex::scoped_lock lock(renderThreadsMutex);
 
 			// wait for all threads to finish their job
-			for (u_int i = 0; i < renderThreads.size(); ++i) {
+			for (u_int i = 0; i < renderThreads.size(); ++i)
 				renderThreads[i]->thread->join();
-				delete renderThreads[i];
+
+			if (threadAffinity && osNumaNodeCount() > 1) {
+				const double elapsed = rendererStatistics->elapsedTime();
+				for (u_int node = 0; node < osNumaNodeCount(); ++node) {
+					double samples = 0.;
+					u_int threads = 0;
+					for (u_int i = 0; i < renderThreads.size(); ++i) {
+						if (renderThreads[i]->node == node) {
+							samples += renderThreads[i]->samples;
+							++threads;
+						}
+					}
+					LOG(LUX_INFO, LUX_NOERROR) << "NUMA node " << node << ": " << threads << " threads, " << (elapsed > 0. ? samples / elapsed : 0.) << " samples/s";
+				}
 			}
+
+			for (u_int i = 0; i < renderThreads.size(); ++i)
+				delete renderThreads[i];
 			renderThreads.clear();
 
 			// I change the current signal to exit in order to disable the creation
@@ -261,6 +288,13 @@ void SamplerRenderer::CreateRenderThread() {
 	// can happen when the rendering is done.
 	if ((state == RUN) || (state == PAUSE)) {
 		RenderThread *rt = new  RenderThread(renderThreads.size(), this);
+		if (threadAffinity) {
+			// Round robin over the nodes, then over their processors
+			const u_int nodeCount = osNumaNodeCount();
+			rt->node = rt->n % nodeCount;
+			const vector<u_int> &processors(osNumaNodeProcessors(rt->node));
+			rt->processor = processors[(rt->n / nodeCount) % processors.size()];
+		}
 
 		renderThreads.push_back(rt);
 		rt->thread = new boost::thread(boost::bind(RenderThread::RenderImpl, rt));
@@ -283,7 +317,8 @@ void SamplerRenderer::RemoveRenderThread() {
 
 
 SamplerRenderer::RenderThread::RenderThread(u_int index, SamplerRenderer *r) :
-	n(index), renderer(r), thread(NULL), samples(0.), blackSamples(0.), blackSamplePaths(0.) {
+	n(index), renderer(r), thread(NULL), node(0), processor(-1),
+	samples(0.), blackSamples(0.), blackSamplePaths(0.) {
 }
 
 SamplerRenderer::RenderThread::~RenderThread() {
@@ -299,6 +334,15 @@ void SamplerRenderer::RenderThread::RenderImpl(RenderThread *myThread) {
 	// To avoid interrupt exception
 	boost::this_thread::disable_interruption di;
 
+	// Bind before allocating anything, so the memory of the thread is
+	// allocated on its node
+	if (myThread->processor >= 0) {
+		if (osSetThreadAffinity(myThread->processor))
+			LOG(LUX_DEBUG, LUX_NOERROR) << "Thread " << myThread->n << " bound to processor " << myThread->processor << " on node " << myThread->node;
+		else
+			LOG(LUX_WARNING, LUX_SYSTEM) << "Unable to bind thread " << myThread->n << " to processor " << myThread->processor;
+	}
+
 	Sampler *sampler = scene.sampler;
 	Sample sample;
 	sampler->InitSample(&sample);
@@ -311,7 +355,8 @@ void SamplerRenderer::RenderThread::RenderImpl(RenderThread *myThread) {
 	// ContribBuffer has to wait until the end of the preprocessing
 	// It depends on the fact that the film buffers have been created
 	// This is done during the preprocessing phase
-	sample.contribBuffer = new ContributionBuffer(scene.camera()->film->contribPool);
+	sample.contribBuffer = new ContributionBuffer(scene.camera()->film->contribPool,
+		myThread->node);
 
 	// initialize the thread's rangen
 	u_long seed = scene.seedBase + myThread->n;
@@ -389,7 +434,7 @@ void SamplerRenderer::RenderThread::RenderImpl(RenderThread *myThread) {
 }
 
 Renderer *SamplerRenderer::CreateRenderer(const ParamSet &params) {
-	return new SamplerRenderer();
+	return new SamplerRenderer(params.FindOneBool("threadaffinity", false));
 }
 
 static DynamicLoader::RegisterRenderer<SamplerRenderer> r("sampler");
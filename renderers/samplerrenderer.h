@@ -92,7 +92,7 @@ private:
 
 class SamplerRenderer : public Renderer {
 public:
-	SamplerRenderer();
+	SamplerRenderer(bool affinity = false);
 	~SamplerRenderer();
 
 	RendererType GetType() const;
@@ -128,6 +128,10 @@ private:
 		u_int  n;
 		SamplerRenderer *renderer;
 		boost::thread *thread; // keep pointer to delete the thread object
+		// NUMA node and logical processor the thread is bound to,
+		// the processor is negative if the thread isn't bound
+		u_int node;
+		int processor;
 		double samples, blackSamples, blackSamplePaths;
 		fast_mutex statLock;
 	};
@@ -148,6 +152,9 @@ private:
 	fast_mutex sampPosMutex;
 	u_int sampPos;
 
+	// Bind the render threads to processors, spread over the NUMA nodes
+	bool threadAffinity;
+
 	// Put them last for better data alignment
 	// used to suspend render threads until the preprocessing phase is done
 	bool preprocessDone;
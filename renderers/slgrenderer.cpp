@@ -40,6 +40,7 @@
 #include "film.h"
 #include "sampling.h"
 #include "context.h"
+#include "tracer.h"
 #include "slgrenderer.h"
 #include "renderers/statistics/slgstatistics.h"
 #include "cameras/perspective.h"
@@ -393,6 +394,11 @@ template<class T> string GetSLGTexMapping(const T *mapping, const string &prefix
 
 template<class T> string GetSLGTexName(slg::Scene *slgScene,
 		const Texture<T> *tex) {
+	// Flattened float textures are exported through their original graph
+	const FlatFloatTexture *flatTex = dynamic_cast<const FlatFloatTexture *>(tex);
+	if (flatTex)
+		return GetSLGTexName(slgScene, flatTex->GetSource());
+
 	LOG(LUX_DEBUG, LUX_NOERROR) << "Texture type: " << ToClassName(tex);
 
 	const string texName = tex->GetName();
@@ -630,11 +636,16 @@ template<class T> string GetSLGTexName(slg::Scene *slgScene,
 					"scene.textures." + texName + ".amount = " + amountTexName + "\n";
 
 			for (u_int i = 0; i < offsets.size(); ++i) {
-				const ConstantRGBColorTexture *constRGBTex = dynamic_cast<const ConstantRGBColorTexture *>(texs[i].get());
-				const ConstantFloatTexture *constFloatTex = dynamic_cast<const ConstantFloatTexture *>(texs[i].get());
+				// Flattened float textures are checked through their original graph
+				const Texture<T> *bandEntry = texs[i].get();
+				const FlatFloatTexture *flatEntry = dynamic_cast<const FlatFloatTexture *>(bandEntry);
+				const ConstantRGBColorTexture *constRGBTex = dynamic_cast<const ConstantRGBColorTexture *>(bandEntry);
+				const ConstantFloatTexture *constFloatTex = flatEntry ?
+					dynamic_cast<const ConstantFloatTexture *>(flatEntry->GetSource()) :
+					dynamic_cast<const ConstantFloatTexture *>(bandEntry);
 				if (!constRGBTex && !constFloatTex) {
 					LOG(LUX_WARNING, LUX_UNIMPLEMENT) << "SLGRenderer supports only BandTexture with constant values (i.e. not " <<
-						ToClassName(texs[i].get()) << ").";
+						(flatEntry ? ToClassName(flatEntry->GetSource()) : ToClassName(bandEntry)) << ").";
 					texProp = "scene.textures." + texName + ".type = constfloat1\n"
 							"scene.textures." + texName + ".value = 0.7\n";
 					break;
@@ -1799,8 +1810,11 @@ void SLGRenderer::Render(Scene *s) {
 
 			// integrator preprocessing
 			scene->sampler->SetFilm(scene->camera()->film);
-			scene->surfaceIntegrator->Preprocess(rng, *scene);
-			scene->volumeIntegrator->Preprocess(rng, *scene);
+			{
+				TraceSpan span(TRACE_PREPROCESS);
+				scene->surfaceIntegrator->Preprocess(rng, *scene);
+				scene->volumeIntegrator->Preprocess(rng, *scene);
+			}
 			scene->camera()->film->CreateBuffers();
 
 			scene->surfaceIntegrator->RequestSamples(scene->sampler, *scene);
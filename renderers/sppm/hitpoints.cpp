@@ -49,6 +49,8 @@ HaltonEyeSampler::HaltonEyeSampler(int x0, int x1, int y0, int y1,
 	haltonOffset.reserve(nPixels);
 
 	offset = 0;
+	tileX = tileY = 0;
+	tileWidth = 0;
 }
 
 //------------------------------------------------------------------------------
@@ -63,34 +65,62 @@ HitPoints::HitPoints(SPPMRenderer *engine, RandomGenerator *rng)  {
 	wavelengthSampleScramble = rng->uintValue();
 	timeSampleScramble = rng->uintValue();
 	wavelengthStratPasses = RoundUpPow2(renderer->sppmi->wavelengthStratification);
-	if (wavelengthStratPasses > 0) {
+	if (wavelengthStratPasses > 0)
 		LOG(LUX_DEBUG, LUX_NOERROR) << "Non-random wavelength stratification for " << wavelengthStratPasses << " passes";
-		wavelengthSample = 0.5f; // non-randomly stratified in IncPass for first N passes
-	} else
-		wavelengthSample = Halton(0, wavelengthSampleScramble);
-	timeSample = Halton(0, timeSampleScramble);
+	PassSamples(0, &wavelengthSample, &timeSample);
 
 	// Get the count of hit points required
 	int xstart, xend, ystart, yend;
 	scene->camera()->film->GetSampleExtent(&xstart, &xend, &ystart, &yend);
+	xPixelStart = xstart;
+	yPixelStart = ystart;
+	xPixelCount = xend - xstart;
+	yPixelCount = yend - ystart;
+
+	tileSize = renderer->sppmi->tileSize;
+	if (tileSize >= max(xPixelCount, yPixelCount))
+		tileSize = 0;
+	if (tileSize > 0) {
+		xTileCount = (xPixelCount + tileSize - 1) / tileSize;
+		tileCount = xTileCount * ((yPixelCount + tileSize - 1) / tileSize);
+	} else {
+		xTileCount = 1;
+		tileCount = 1;
+	}
+	currentTile = 0;
 
-	// Set the sampler
+	// Set the sampler, the first tile is the largest one
+	int x0, y0;
+	u_int tileWidth, tileHeight;
+	GetTile(0, &x0, &y0, &tileWidth, &tileHeight);
 	eyeSampler = new HaltonEyeSampler(xstart, xend, ystart, yend,
-		renderer->sppmi->PixelSampler, renderer->sppmi->hitpointPerPass);
+		renderer->sppmi->PixelSampler,
+		tileSize > 0 ? tileWidth * tileHeight : renderer->sppmi->hitpointPerPass);
 
 	// the eyeSampler may decide that it allocates less or more hitpointPerPass
 	renderer->sppmi->hitpointPerPass = eyeSampler->GetTotalSamplePos();
 	nSamplePerPass = renderer->sppmi->hitpointPerPass;
+	hitPointCount = nSamplePerPass;
 
 	hitPoints = new std::vector<HitPoint>(nSamplePerPass);
 	LOG(LUX_DEBUG, LUX_NOERROR) << "Hit points count: " << hitPoints->size();
+	if (tileCount > 1) {
+		LOG(LUX_DEBUG, LUX_NOERROR) << "Hit points tiles: " << tileCount << " of " << tileSize << "x" << tileSize << " pixels";
+		pixelStats.resize(xPixelCount * yPixelCount);
+	}
+	eyePasses[0].resize(nSamplePerPass);
+	eyePasses[1].resize(nSamplePerPass);
 
 	// Initialize hit points field
 	for (u_int i = 0; i < (*hitPoints).size(); ++i) {
 		HitPoint *hp = &(*hitPoints)[i];
 
 		hp->InitStats();
+		eyePasses[0][i].bsdf = NULL;
+		eyePasses[1][i].bsdf = NULL;
+		hp->eyePass = &eyePasses[0][i];
 	}
+	StartEyePass(0, 0);
 
 	store_component = BxDFType(BSDF_DIFFUSE | BSDF_REFLECTION | BSDF_TRANSMISSION);
 	bounce_component = BxDFType(BSDF_SPECULAR | BSDF_REFLECTION | BSDF_TRANSMISSION);
@@ -107,6 +137,78 @@ HitPoints::~HitPoints() {
 	delete eyeSampler;
 }
 
+void HitPoints::PassSamples(const u_int pass, float *wavelength, float *time) const
+{
+	if (pass < wavelengthStratPasses) {
+		// Non-randomly stratified for the first N passes
+		const u_int i = pass + 1; // use 1-based counting
+		const u_int Nsegments = 1 << Floor2UInt(Log2(i));
+		const u_int j = (2*Nsegments - 1) - i; // reverse order seems better
+		*wavelength = static_cast<float>(2*j + 1) / (2*Nsegments);
+	} else
+		*wavelength = Halton(pass - wavelengthStratPasses, wavelengthSampleScramble);
+	*time = Halton(pass, timeSampleScramble);
+}
+
+void HitPoints::GetTile(const u_int tile, int *x0, int *y0, u_int *width, u_int *height) const
+{
+	if (tileCount == 1) {
+		*x0 = xPixelStart;
+		*y0 = yPixelStart;
+		*width = xPixelCount;
+		*height = yPixelCount;
+		return;
+	}
+
+	const u_int xOffset = (tile % xTileCount) * tileSize;
+	const u_int yOffset = (tile / xTileCount) * tileSize;
+	*x0 = xPixelStart + static_cast<int>(xOffset);
+	*y0 = yPixelStart + static_cast<int>(yOffset);
+	*width = min(tileSize, xPixelCount - xOffset);
+	*height = min(tileSize, yPixelCount - yOffset);
+}
+
+u_int HitPoints::GetPixelIndex(const u_int tile, const u_int index) const
+{
+	int x0, y0;
+	u_int width, height;
+	GetTile(tile, &x0, &y0, &width, &height);
+
+	return (y0 - yPixelStart + index / width) * xPixelCount +
+		(x0 - xPixelStart + index % width);
+}
+
+void HitPoints::StartEyePass(const u_int pass, const u_int tile)
+{
+	eyePass = pass;
+	eyeTile = tile;
+	// Consecutive tiles alternate between the buffers
+	eyeBuffer = (pass * tileCount + tile) & 1;
+	PassSamples(pass, &eyeWavelengthSample, &eyeTimeSample);
+
+	if (tileCount > 1) {
+		int x0, y0;
+		u_int width, height;
+		GetTile(tile, &x0, &y0, &width, &height);
+		dynamic_cast<HaltonEyeSampler*>(eyeSampler)->SetTile(x0, y0, width);
+		eyeHitPointCount = width * height;
+	} else
+		eyeHitPointCount = nSamplePerPass;
+}
+
+void HitPoints::StartNextEyePass()
+{
+	if (currentTile + 1 < tileCount)
+		StartEyePass(currentPass, currentTile + 1);
+	else
+		StartEyePass(currentPass + 1, 0);
+}
+
+float HitPoints::GetInvPixelPdf() const
+{
+	return dynamic_cast<HaltonEyeSampler*>(eyeSampler)->GetInvPixelPdf();
+}
+
 const double HitPoints::GetPhotonHitEfficency() {
 	u_int surfaceHitPointsCount = 0;
 	u_int hitPointsUpdatedCount = 0;
@@ -124,21 +226,76 @@ const double HitPoints::GetPhotonHitEfficency() {
 	return 100.0 * hitPointsUpdatedCount / surfaceHitPointsCount;
 }
 
+BBox HitPoints::ImageSurfaceBound() const
+{
+	const Scene &scene(*renderer->scene);
+	const u_int xCount = min(xPixelCount, 64U);
+	const u_int yCount = min(yPixelCount, 64U);
+
+	Sample sample;
+	sample.camera = scene.camera()->Clone();
+	sample.lensU = .5f;
+	sample.lensV = .5f;
+	sample.time = .5f;
+	sample.wavelengths = .5f;
+	sample.swl.Sample(sample.wavelengths);
+	sample.realTime = sample.camera->GetTime(sample.time);
+	sample.camera->SampleMotion(sample.realTime);
+
+	BBox bound;
+	for (u_int y = 0; y < yCount; ++y) {
+		for (u_int x = 0; x < xCount; ++x) {
+			sample.imageX = xPixelStart + (x + .5f) * xPixelCount / xCount;
+			sample.imageY = yPixelStart + (y + .5f) * yPixelCount / yCount;
+			Ray ray;
+			float xi, yi;
+			if (sample.camera->GenerateRay(scene, sample, &ray, &xi, &yi) > 0.f) {
+				Intersection isect;
+				if (scene.Intersect(ray, &isect))
+					bound = Union(bound, isect.dg.p);
+			}
+			sample.arena.FreeAll();
+		}
+	}
+	return bound;
+}
+
 void HitPoints::Init() {
 	// Not using UpdateBBox() because hp->accumPhotonRadius2 is not yet set
 	BBox hpBBox = BBox();
-	for (u_int i = 0; i < (*hitPoints).size(); ++i) {
-		HitPoint *hp = &(*hitPoints)[i];
+	u_int pixelCount;
+	if (tileCount > 1) {
+		// The hit points only cover the first tile, which may not see
+		// any surface at all
+		hpBBox = ImageSurfaceBound();
+		pixelCount = xPixelCount * yPixelCount;
+	} else {
+		for (u_int i = 0; i < GetSize(); ++i) {
+			HitPoint *hp = &(*hitPoints)[i];
 
-		if (hp->IsSurface())
-			hpBBox = Union(hpBBox, hp->GetPosition());
+			if (hp->IsSurface())
+				hpBBox = Union(hpBBox, hp->GetPosition());
+		}
+		pixelCount = GetSize();
 	}
 
 	// Calculate initial radius
 	Vector ssize = hpBBox.pMax - hpBBox.pMin;
+	float size = (ssize.x + ssize.y + ssize.z) / 3.f;
+	if (!(size > 0.f) || isinf(size)) {
+		// No visible surface, fall back to the scene size
+		const BBox &worldBound(renderer->scene->WorldBound());
+		ssize = worldBound.pMax - worldBound.pMin;
+		size = (ssize.x + ssize.y + ssize.z) / 3.f;
+		if (!(size > 0.f) || isinf(size))
+			size = 1.f;
+		LOG(LUX_WARNING, LUX_NOERROR) << "No surface hit by the eye pass, SPPM start radius estimated from the scene bounds";
+	}
 	initialPhotonRadius = renderer->sppmi->photonStartRadiusScale *
-		((ssize.x + ssize.y + ssize.z) / 3.f) / sqrtf(nSamplePerPass) * 2.f;
+		size / sqrtf(pixelCount) * 2.f;
 	const float photonRadius2 = initialPhotonRadius * initialPhotonRadius;
+	if (hpBBox.pMin.x > hpBBox.pMax.x)
+		hpBBox = renderer->scene->WorldBound();
 
 	// Expand the bounding box by used radius
 	hpBBox.Expand(initialPhotonRadius);
@@ -155,6 +312,10 @@ void HitPoints::Init() {
 
 		hp->accumPhotonRadius2 = photonRadius2;
 	}
+	for (u_int i = 0; i < pixelStats.size(); ++i) {
+		pixelStats[i].accumPhotonRadius2 = photonRadius2;
+		pixelStats[i].photonCount = 0;
+	}
 
 	// Allocate hit points lookup accelerator
 	switch (renderer->sppmi->lookupAccelType) {
@@ -176,53 +337,65 @@ void HitPoints::Init() {
 }
 
 void HitPoints::AccumulateFlux(scheduling::Range *range) {
+	const bool tiled = tileCount > 1;
 	for(unsigned i = range->begin(); i != range->end(); i = range->next()) {
 		HitPoint *hp = &(*hitPoints)[i];
 
-		hp->DoRadiusReduction(renderer->sppmi->photonAlpha, GetPassCount(), renderer->sppmi->useproba);
+		if (i < hitPointCount) {
+			hp->DoRadiusReduction(renderer->sppmi->photonAlpha, GetPassCount(), renderer->sppmi->useproba);
+			if (tiled)
+				hp->SaveStats(&pixelStats[GetPixelIndex(currentTile, i)]);
+		}
+		if (i < eyeHitPointCount) {
+			if (tiled)
+				hp->LoadStats(pixelStats[GetPixelIndex(eyeTile, i)]);
+			hp->eyePass = &eyePasses[eyeBuffer][i];
+		}
 	}
 }
 
 void HitPoints::SetHitPoints(scheduling::Range *range)
 {
 	SPPMRenderer::RenderThread *thread = dynamic_cast<SPPMRenderer::RenderThread*>(range->thread);
-	HitPoints *hitpoints = thread->renderer->hitPoints;
-	Sample &sample = thread->eyeSample;
+	// The memory of the eye pass traced in the other buffer is still
+	// used by the photon pass
+	Sample &sample = thread->eyeSample[eyeBuffer];
 
 	sample.arena.FreeAll();
 
-	float invPixelPdf = dynamic_cast<HaltonEyeSampler*>(hitpoints->eyeSampler)->GetInvPixelPdf();
+	const float invPixelPdf = GetInvPixelPdf();
 
 	for(unsigned i = range->begin();
 			i != range->end();
-			i = range->next()) {
-		static_cast<HaltonEyeSampler::HaltonEyeSamplerData *>(sample.samplerData)->index = i; //FIXME sampler data shouldn't be accessed directly
-		static_cast<HaltonEyeSampler::HaltonEyeSamplerData *>(sample.samplerData)->pathCount = hitpoints->currentPass; //FIXME sampler data shouldn't be accessed directly
-		sample.wavelengths = hitpoints->wavelengthSample;
-		sample.time = hitpoints->timeSample;
-		sample.swl.Sample(sample.wavelengths);
-		sample.realTime = sample.camera->GetTime(sample.time);
-		sample.camera->SampleMotion(sample.realTime);
-		// Generate the sample values
-		hitpoints->eyeSampler->GetNextSample(&sample);
-		HitPoint *hp = &(*hitpoints->hitPoints)[i];
-
-		// Trace the eye path
-		hitpoints->TraceEyePath(hp, sample, invPixelPdf);
-
-		// as sample count is a proxy for photon count which is used for 
-		// weighting the photon buffer
-		// eye buffer weighting is done per-pixel, so should work out
-		// to pre-remove the contribution weight
-		sample.contribBuffer->AddSampleCount(-1.f);
-		eyeSampler->AddSample(sample);
-	}
+			i = range->next())
+		SetHitPoint(sample, i, invPixelPdf);
 }
 
-void HitPoints::TraceEyePath(HitPoint *hp, const Sample &sample, float const invPixelPdf)
+void HitPoints::SetHitPoint(Sample &sample, const u_int index, const float invPixelPdf)
 {
-	HitPointEyePass *hpep = &hp->eyePass;
+	static_cast<HaltonEyeSampler::HaltonEyeSamplerData *>(sample.samplerData)->index = index; //FIXME sampler data shouldn't be accessed directly
+	static_cast<HaltonEyeSampler::HaltonEyeSamplerData *>(sample.samplerData)->pathCount = eyePass * tileCount + eyeTile; //FIXME sampler data shouldn't be accessed directly
+	sample.wavelengths = eyeWavelengthSample;
+	sample.time = eyeTimeSample;
+	sample.swl.Sample(sample.wavelengths);
+	sample.realTime = sample.camera->GetTime(sample.time);
+	sample.camera->SampleMotion(sample.realTime);
+	// Generate the sample values
+	eyeSampler->GetNextSample(&sample);
+
+	// Trace the eye path
+	TraceEyePath(&eyePasses[eyeBuffer][index], sample, invPixelPdf);
+
+	// as sample count is a proxy for photon count which is used for 
+	// weighting the photon buffer
+	// eye buffer weighting is done per-pixel, so should work out
+	// to pre-remove the contribution weight
+	sample.contribBuffer->AddSampleCount(-1.f);
+	eyeSampler->AddSample(sample);
+}
 
+void HitPoints::TraceEyePath(HitPointEyePass *hpep, const Sample &sample, float const invPixelPdf)
+{
 	Scene &scene(*renderer->scene);
 	const bool includeEnvironment = renderer->sppmi->includeEnvironment;
 	const u_int maxDepth = renderer->sppmi->maxEyePathDepth;
@@ -234,7 +407,7 @@ void HitPoints::TraceEyePath(HitPoint *hp, const Sample &sample, float const inv
 	// Declare common path integration variables
 	const SpectrumWavelengths &sw(sample.swl);
 	Ray ray;
-	const float rayWeight = sample.camera->GenerateRay(scene, sample, &ray, &(hp->imageX), &(hp->imageY));
+	const float rayWeight = sample.camera->GenerateRay(scene, sample, &ray, &(hpep->imageX), &(hpep->imageY));
 
 	const float nLights = scene.lights.size();
 	const u_int lightGroupCount = scene.lightGroups.size();
@@ -295,7 +468,7 @@ void HitPoints::TraceEyePath(HitPoint *hp, const Sample &sample, float const inv
 			if (vertexIndex == 0)
 				hpep->alpha = 0.f;
 
-			hp->SetConstant();
+			hpep->bsdf = NULL;
 			break;
 		}
 		sample.arena.End();
@@ -368,7 +541,6 @@ void HitPoints::TraceEyePath(HitPoint *hp, const Sample &sample, float const inv
 
 		if(store)
 		{
-			hp->SetSurface();
 			hpep->pathThroughput = pathThroughput * rayWeight / pdf_event * invPixelPdf;
 			hpep->wo = wo;
 
@@ -386,7 +558,7 @@ void HitPoints::TraceEyePath(HitPoint *hp, const Sample &sample, float const inv
 		if (pathLength == maxDepth || !bsdf->SampleF(sw, wo, &wi,
 			data[1], data[2], data[3], &f, &pdf, bounce_component, &flags,
 			NULL, true)) {
-			hp->SetConstant();
+			hpep->bsdf = NULL;
 			break;
 		}
 
@@ -399,7 +571,7 @@ void HitPoints::TraceEyePath(HitPoint *hp, const Sample &sample, float const inv
 
 		pathThroughput *= f / pdf_event;
 		if (pathThroughput.Black()) {
-			hp->SetConstant();
+			hpep->bsdf = NULL;
 			break;
 		}
 
@@ -411,8 +583,8 @@ void HitPoints::TraceEyePath(HitPoint *hp, const Sample &sample, float const inv
 	{
 		if (!L[i].Black())
 			V[i] /= L[i].Filter(sw);
-		sample.AddContribution(hp->imageX, hp->imageY,
-			XYZColor(sw, L[i]) * rayWeight, hp->eyePass.alpha, hp->eyePass.distance,
+		sample.AddContribution(hpep->imageX, hpep->imageY,
+			XYZColor(sw, L[i]) * rayWeight, hpep->alpha, hpep->distance,
 			0, renderer->sppmi->bufferEyeId, i);
 	}
 }
@@ -424,7 +596,7 @@ void HitPoints::UpdatePointsInformation() {
 	u_int minp, maxp, meanp;
 	u_int surfaceHits, constantHits, zeroHits;
 
-	assert((*hitPoints).size() > 0);
+	assert(GetSize() > 0);
 	HitPoint *hp = &(*hitPoints)[0];
 
 	if (hp->IsSurface()) {
@@ -445,7 +617,7 @@ void HitPoints::UpdatePointsInformation() {
 		minp = maxp = meanp = 0;
 	}
 
-	for (u_int i = 1; i < (*hitPoints).size(); ++i) {
+	for (u_int i = 1; i < GetSize(); ++i) {
 		hp = &(*hitPoints)[i];
 
 		if (hp->IsSurface()) {
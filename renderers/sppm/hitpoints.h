@@ -60,6 +60,8 @@ public:
 
 	Vector wo;
 	bool single;
+
+	float imageX, imageY;
 };
 
 /*
@@ -69,9 +71,19 @@ a) remove statistics if unneeded
 b) align data structure in memory
 */
 
+// Compact copy of the hit point statistics, kept per pixel while the hit
+// points are used for other tiles of the image
+class HitPointStats {
+public:
+	float accumPhotonRadius2;
+	u_int photonCount;
+};
+
 class HitPoint {
 public:
-	HitPointEyePass eyePass;
+	// Eye pass the photons are currently gathered for, the next eye
+	// pass is traced in the other buffer of HitPoints
+	HitPointEyePass *eyePass;
 
 	// photons statistics
 private:
@@ -79,26 +91,15 @@ private:
 	u_int accumPhotonCount;
 public:
 	float accumPhotonRadius2;
-	float imageX, imageY;
 
 	Point GetPosition() const
 	{
-		return eyePass.bsdf->dgShading.p;
-	}
-
-	void SetConstant()
-	{
-		eyePass.bsdf = NULL;
-	}
-	void SetSurface()
-	{
-		// the fact to set something else that NULL in bsdf field set the
-		// hitpoint as a surface
+		return eyePass->bsdf->dgShading.p;
 	}
 
 	bool IsSurface() const
 	{
-		return eyePass.bsdf != NULL;
+		return eyePass->bsdf != NULL;
 	}
 
 	void IncPhoton()
@@ -115,6 +116,17 @@ public:
 	{
 		return photonCount;
 	}
+	void SaveStats(HitPointStats *stats) const
+	{
+		stats->accumPhotonRadius2 = accumPhotonRadius2;
+		stats->photonCount = static_cast<u_int>(min<unsigned long long>(photonCount, 0xffffffffu));
+	}
+	void LoadStats(const HitPointStats &stats)
+	{
+		accumPhotonRadius2 = stats.accumPhotonRadius2;
+		photonCount = stats.photonCount;
+		accumPhotonCount = 0;
+	}
 	void DoRadiusReduction(float const alpha, float const pass, bool useproba)
 	{
 		if(useproba)
@@ -243,8 +255,14 @@ public:
 
 		// please note that offset may overflow, but it is handled by the
 		// modulo
-		osAtomicInc(&offset);
-		pixelSampler->GetNextPixel(&x, &y, offset % pixelSampler->GetTotalPixels());
+		if (tileWidth > 0) {
+			// Each hit point covers its own pixel of the tile
+			x = tileX + static_cast<int>(data->index % tileWidth);
+			y = tileY + static_cast<int>(data->index / tileWidth);
+		} else {
+			osAtomicInc(&offset);
+			pixelSampler->GetNextPixel(&x, &y, offset % pixelSampler->GetTotalPixels());
+		}
 
 		// Add an offset to the samples to avoid to start with 0.f values
 		for (int i = -4; i < static_cast<int>(data->size); ++i) {
@@ -277,8 +295,18 @@ public:
 
 	float GetInvPixelPdf()
 	{
+		if (tileWidth > 0)
+			return 1.f;
 		return ((float) pixelSampler->GetTotalPixels()) / nPixels;
 	}
+	// Restricts the samples to the tile starting at x0, y0, hit point
+	// indices are laid out in rows of the given width
+	void SetTile(int x0, int y0, u_int width)
+	{
+		tileX = x0;
+		tileY = y0;
+		tileWidth = width;
+	}
 //	virtual void AddSample(const Sample &sample);
 	PixelSampler *pixelSampler;
 private:
@@ -289,6 +317,8 @@ private:
 	mutable boost::mutex initMutex;
 
 	u_int offset;
+	int tileX, tileY;
+	u_int tileWidth;
 };
 
 class HitPoints {
@@ -304,9 +334,18 @@ public:
 		return &(*hitPoints)[index];
 	}
 
+	// Hit points of the tile photons are gathered for
 	const u_int GetSize() const {
-		return hitPoints->size();
+		return hitPointCount;
+	}
+	// Hit points of the tile of the eye pass being traced
+	const u_int GetEyeSize() const {
+		return eyeHitPointCount;
+	}
+	const u_int GetAccumulateSize() const {
+		return max(hitPointCount, eyeHitPointCount);
 	}
+	const u_int GetTileCount() const { return tileCount; }
 
 	const BBox &GetBBox() const {
 		return hitPointBBox;
@@ -316,25 +355,36 @@ public:
 
 	void UpdatePointsInformation();
 	const u_int GetPassCount() const { return currentPass; }
-	void IncPass() {
-		++currentPass;
-		if (currentPass < wavelengthStratPasses) {
-			const u_int i = currentPass + 1; // use 1-based counting
-			const u_int Nsegments = 1 << Floor2UInt(Log2(i));
-			const u_int j = (2*Nsegments - 1) - i; // reverse order seems better
-			wavelengthSample = static_cast<float>(2*j + 1) / (2*Nsegments);
-		} else
-			wavelengthSample = Halton(currentPass - wavelengthStratPasses, wavelengthSampleScramble);
-		timeSample = Halton(currentPass, timeSampleScramble);
+	// Moves on to the tile of the last traced eye pass, a pass is over
+	// once all the tiles of the image have gathered photons
+	void NextTile() {
+		currentTile = eyeTile;
+		hitPointCount = eyeHitPointCount;
+		if (currentTile == 0)
+			IncPass();
 	}
 
+	// Samples of the photon pass
 	const float GetWavelengthSample() { return wavelengthSample; }
 	const float GetTimeSample() { return timeSample; }
 
+	// Selects the buffer and the samples of the eye pass of the given
+	// pass and tile, the hit points keep gathering photons for the
+	// current one
+	void StartEyePass(const u_int pass, const u_int tile);
+	void StartNextEyePass();
+	// Render threads use one eye sample, and its memory arena, per buffer
+	u_int GetEyeBuffer() const { return eyeBuffer; }
+	float GetInvPixelPdf() const;
+	// Traces the eye path of a single hit point
+	void SetHitPoint(Sample &sample, const u_int index, const float invPixelPdf);
+
 	void AddFlux(Sample &sample, const PhotonData &photon)
 	{
 		lookUpAccel->AddFlux(sample, photon);
 	}
+	// Reduces the radius after a photon pass and moves the hit points
+	// to the last traced eye pass, possibly of another tile
 	void AccumulateFlux(scheduling::Range *range);
 	void SetHitPoints(scheduling::Range *range);
 
@@ -344,7 +394,17 @@ public:
 	}
 
 private:
-	void TraceEyePath(HitPoint *hp, const Sample &sample, float const invPixelPdf);
+	void IncPass() {
+		++currentPass;
+		PassSamples(currentPass, &wavelengthSample, &timeSample);
+	}
+	void GetTile(const u_int tile, int *x0, int *y0, u_int *width, u_int *height) const;
+	u_int GetPixelIndex(const u_int tile, const u_int index) const;
+	void PassSamples(const u_int pass, float *wavelength, float *time) const;
+	void TraceEyePath(HitPointEyePass *hpep, const Sample &sample, float const invPixelPdf);
+	// Bounds the first visible surfaces of the whole image with a coarse
+	// grid of camera rays
+	BBox ImageSurfaceBound() const;
 
 	SPPMRenderer *renderer;
 public:
@@ -359,12 +419,26 @@ private:
 	BBox hitPointBBox;
 	float maxHitPointRadius2;
 	std::vector<HitPoint> *hitPoints;
+	// Eye passes are double buffered so that the next one can be traced
+	// while photons are gathered for the current one
+	std::vector<HitPointEyePass> eyePasses[2];
 	HitPointsLookUpAccel *lookUpAccel;
 
 	u_int currentPass;
+	u_int eyePass, eyeBuffer;
+
+	// Hit points only cover one tile of the image at a time, the
+	// statistics of the other pixels are kept in pixelStats
+	int xPixelStart, yPixelStart;
+	u_int xPixelCount, yPixelCount;
+	u_int tileSize, xTileCount, tileCount;
+	u_int currentTile, hitPointCount;
+	u_int eyeTile, eyeHitPointCount;
+	std::vector<HitPointStats> pixelStats;
 
 	// Only a single set of wavelengths is sampled for each pass
 	float wavelengthSample, timeSample;
+	float eyeWavelengthSample, eyeTimeSample;
 	u_int wavelengthSampleScramble, timeSampleScramble;
 	u_int wavelengthStratPasses;
 
@@ -48,7 +48,7 @@ inline float Ekernel(const float d2, float md2) {
 using namespace lux;
 
 void HitPointsLookUpAccel::AddFluxToHitPoint(Sample &sample, HitPoint *hp, const PhotonData &photon) {
-	HitPointEyePass &hpep(hp->eyePass);
+	HitPointEyePass &hpep(*(hp->eyePass));
 
 	// Check distance
 	const float dist2 = DistanceSquared(hp->GetPosition(), photon.p);
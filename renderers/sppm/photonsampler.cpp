@@ -40,8 +40,8 @@ void PhotonSampler::AddFluxToHitPoint(const Sample *sample, const u_int lightGro
 	//XYZColor flux = XYZColor(sw, photonFlux * f) * XYZColor(hp->sample->swl, hp->eyeThroughput);
 	hp->IncPhoton();
 
-	sample->AddContribution(hp->imageX, hp->imageY,
-		flux, hp->eyePass.alpha, hp->eyePass.distance,
+	sample->AddContribution(hp->eyePass->imageX, hp->eyePass->imageY,
+		flux, hp->eyePass->alpha, hp->eyePass->distance,
 		0, renderer->sppmi->bufferPhotonId, lightGroup);
 };
 //------------------------------------------------------------------------------
@@ -181,28 +181,24 @@ void PhotonSampler::ContribSample(Sample *sample)
 	// (hence the automatic +1 of AddSample which needs to be removed by a -1.f)
 	// instead we normalize it by the number of pass, so the number of
 	// contribution is 1.0 / photonPerPass
+	// In tiled mode, each tile traces photonPerPass photons for a pass
 	//
 	// WARNING: this is link to AMCMC weighting
 	// (SPPMRenderer::ScaleUpdaterSPPM) and alpha in TracePhoton.
-	sample->contribBuffer->AddSampleCount(-1.0 + 1.0 / renderer->sppmi->photonPerPass * renderer->scene->camera()->film->GetSamplePerPass());
+	sample->contribBuffer->AddSampleCount(-1.0 + 1.0 / (renderer->sppmi->photonPerPass * renderer->hitPoints->GetTileCount()) * renderer->scene->camera()->film->GetSamplePerPass());
 	dynamic_cast<Sampler*>(this)->AddSample(*sample);
 }
 
 
-void PhotonSampler::TracePhotons(
+void PhotonSampler::TracePhotonSample(
 		Sample *sample,
-		Distribution1D *lightCDF,
-		scheduling::Range *range)
+		Distribution1D *lightCDF)
 {
-	range->begin();
-	while(range->next() != range->end())
-	{
-		GetNextSample(sample);
+	GetNextSample(sample);
 
-		TracePhoton(sample, lightCDF);
+	TracePhoton(sample, lightCDF);
 
-		ContribSample(sample);
-	}
+	ContribSample(sample);
 }
 
 //------------------------------------------------------------------------------
@@ -213,10 +209,9 @@ void PhotonSampler::TracePhotons(
 // Adaptive Markov Chain Sampler
 //------------------------------------------------------------------------------
 
-void AMCMCPhotonSampler::TracePhotons(
+void AMCMCPhotonSampler::StartPhotons(
 		Sample *sample,
-		Distribution1D *lightCDF,
-		scheduling::Range *range)
+		Distribution1D *lightCDF)
 {
 	// Sample uniform
 	do
@@ -226,41 +221,45 @@ void AMCMCPhotonSampler::TracePhotons(
 	} while(!pathCandidate->isVisible());
 
 	swap(); // Current = Candidate
+}
 
-	range->begin();
-	while(range->next() != range->end())
+void AMCMCPhotonSampler::TracePhotonSample(
+		Sample *sample,
+		Distribution1D *lightCDF)
+{
+	// Sample Uniform
+	GetNextSample(sample, true);
+	TracePhoton(sample, lightCDF);
+
+	if(pathCandidate->isVisible())
 	{
-		// Sample Uniform
-		GetNextSample(sample, true);
+		swap();
+		osAtomicInc(&renderer->uniformCount);
+	}
+	else
+	{
+		++mutated;
+
+		// Sample mutated
+		GetNextSample(sample, false);
 		TracePhoton(sample, lightCDF);
 
 		if(pathCandidate->isVisible())
 		{
+			++accepted;
 			swap();
-			osAtomicInc(&renderer->uniformCount);
 		}
-		else
-		{
-			++mutated;
 
-			// Sample mutated
-			GetNextSample(sample, false);
-			TracePhoton(sample, lightCDF);
-
-			if(pathCandidate->isVisible())
-			{
-				++accepted;
-				swap();
-			}
+		const float R = accepted / (float)mutated;
+		mutationSize += (R - 0.234f) / mutated;
 
-			const float R = accepted / (float)mutated;
-			mutationSize += (R - 0.234f) / mutated;
-
-		}
-		pathCurrent->Splat(sample, this);
-		ContribSample(sample);
 	}
+	pathCurrent->Splat(sample, this);
+	ContribSample(sample);
+}
 
+void AMCMCPhotonSampler::EndPhotons()
+{
 	LOG(LUX_DEBUG, LUX_NOERROR) << "AMCMC mutationSize " << mutationSize << " accepted " << accepted << " mutated " << mutated << " uniform " << renderer->uniformCount;
 }
 
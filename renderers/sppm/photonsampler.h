@@ -63,12 +63,21 @@ public:
 		AddFluxToHitPoint(sample, lightGroup, hp, flux);
 	}
 
-	virtual void TracePhotons(
+	// A render thread calls StartPhotons() before its first photon of a
+	// pass, TracePhotonSample() for each of them and EndPhotons() once
+	// it runs out of photons for the pass
+	virtual void StartPhotons(
 		Sample *sample,
-		Distribution1D *lightCDF,
-		scheduling::Range *range
+		Distribution1D *lightCDF
+		) { }
+
+	virtual void TracePhotonSample(
+		Sample *sample,
+		Distribution1D *lightCDF
 		);
 
+	virtual void EndPhotons() { }
+
 	void TracePhoton(
 		Sample *sample,
 		Distribution1D *lightCDF
@@ -370,12 +379,18 @@ class AMCMCPhotonSampler : public UniformPhotonSampler
 			pathCandidate->push_back(SplatNode(lightGroup, flux, hp));
 		}
 
-	virtual void TracePhotons(
+	virtual void StartPhotons(
 		Sample *sample,
-		Distribution1D *lightCDF,
-		scheduling::Range *range
+		Distribution1D *lightCDF
 		);
 
+	virtual void TracePhotonSample(
+		Sample *sample,
+		Distribution1D *lightCDF
+		);
+
+	virtual void EndPhotons();
+
 	private:
 		// TODO: try to moves thoses attributes in the sample, hence keeping
 		// only one sampler per thread
@@ -35,6 +35,7 @@
 #include "sampling.h"
 #include "randomgen.h"
 #include "context.h"
+#include "osfunc.h"
 #include "light.h"
 #include "mc.h"
 #include "mcdistribution.h"
@@ -44,6 +45,7 @@
 #include "integrators/sppm.h"
 #include "renderers/statistics/sppmstatistics.h"
 #include "samplers/random.h"
+#include "tracer.h"
 
 using namespace lux;
 
@@ -64,7 +66,8 @@ void SPPMRDeviceDescription::SetUsedUnitsCount(const unsigned int units) {
 			host->renderer->scheduler->DelThread();
 	} else if (current < target) {
 		for (unsigned int i = 0; i < target - current; ++i)
-			host->renderer->scheduler->AddThread(new SPPMRenderer::RenderThread(host->renderer));
+			host->renderer->scheduler->AddThread(new SPPMRenderer::RenderThread(
+				host->renderer->scheduler->ThreadCount(), host->renderer));
 	}
 }
 
@@ -86,7 +89,8 @@ SPPMRHostDescription::~SPPMRHostDescription() {
 // SPPMRenderer
 //------------------------------------------------------------------------------
 
-SPPMRenderer::SPPMRenderer() : Renderer() {
+SPPMRenderer::SPPMRenderer(bool affinity) : Renderer(),
+	threadAffinity(affinity) {
 	state = INIT;
 
 	SPPMRHostDescription *host = new SPPMRHostDescription(this, "Localhost");
@@ -97,7 +101,15 @@ SPPMRenderer::SPPMRenderer() : Renderer() {
 
 	hitPoints = NULL;
 
+	photonHitEfficiency = 0.0;
+	photonEyePassTime = 0.0;
+	accumulateFluxTime = 0.0;
+	accelRefreshTime = 0.0;
+	threadIdleTime = 0.0;
+	phaseBusyTime = 0.0;
+
 	AddStringConstant(*this, "name", "Name of current renderer", "sppm");
+	AddBoolAttribute(*this, "threadAffinity", "Render threads are bound to processors", &SPPMRenderer::threadAffinity);
 
 	rendererStatistics = new SPPMRStatistics(this);
 
@@ -194,8 +206,15 @@ void SPPMRenderer::Render(Scene *s) {
 
 		// integrator preprocessing
 		// sppm integrator will create film buffers
-		scene->surfaceIntegrator->Preprocess(*rng, *scene);
-		scene->volumeIntegrator->Preprocess(*rng, *scene);
+		{
+			TraceSpan span(TRACE_PREPROCESS);
+			scene->surfaceIntegrator->Preprocess(*rng, *scene);
+			scene->volumeIntegrator->Preprocess(*rng, *scene);
+		}
+		// Threads bound to other NUMA nodes splat in local copies of
+		// the color buffers
+		if (threadAffinity && osNumaNodeCount() > 1)
+			scene->camera()->film->CreateNodeReplicas(osNumaNodeCount());
 
 		// Told each Buffer how to scale things
 		for(u_int bg = 0; bg < scene->camera()->film->GetNumBufferGroups(); ++bg)
@@ -212,6 +231,10 @@ void SPPMRenderer::Render(Scene *s) {
 
 		// initialise
 		photonHitEfficiency = 0;
+		photonEyePassTime = 0.0;
+		accumulateFluxTime = 0.0;
+		accelRefreshTime = 0.0;
+		threadIdleTime = 0.0;
 
 		// For AMCMC
 		// TODO: check if it is really 1, or 0, or N-threads
@@ -224,7 +247,7 @@ void SPPMRenderer::Render(Scene *s) {
 	}
 
 	// Add the first thread // TODO: why
-	scheduler->AddThread(new RenderThread(this));
+	scheduler->AddThread(new RenderThread(scheduler->ThreadCount(), this));
 
 	// thread for checking write interval
 	boost::thread writeIntervalThread = boost::thread(boost::bind(writeIntervalCheck, scene->camera()->film));
@@ -262,8 +285,15 @@ void SPPMRenderer::Terminate() {
 // Render thread
 //------------------------------------------------------------------------------
 
-SPPMRenderer::RenderThread::RenderThread(SPPMRenderer *r) :
-	renderer(r) {
+SPPMRenderer::RenderThread::RenderThread(u_int index, SPPMRenderer *r) :
+	n(index), renderer(r), node(0), processor(-1) {
+	if (renderer->threadAffinity) {
+		// Round robin over the nodes, then over their processors
+		const u_int nodeCount = osNumaNodeCount();
+		node = n % nodeCount;
+		const vector<u_int> &processors(osNumaNodeProcessors(node));
+		processor = processors[(n / nodeCount) % processors.size()];
+	}
 
 	// Initialize the thread's rangen
 	u_long seed = renderer->rng->uintValue();
@@ -288,6 +318,15 @@ void SPPMRenderer::RenderThread::Init() {
 	// To avoid interrupt exception
 	boost::this_thread::disable_interruption di;
 
+	// Bind before allocating the samplers and buffers, so they are
+	// allocated on the node of the thread
+	if (processor >= 0) {
+		if (osSetThreadAffinity(processor))
+			LOG(LUX_DEBUG, LUX_NOERROR) << "Thread " << n << " bound to processor " << processor << " on node " << node;
+		else
+			LOG(LUX_WARNING, LUX_SYSTEM) << "Unable to bind thread " << n << " to processor " << processor;
+	}
+
 	// Dade - wait the end of the preprocessing phase
 	while (!renderer->preprocessDone) {
 		boost::this_thread::sleep(boost::posix_time::seconds(1));
@@ -309,7 +348,7 @@ void SPPMRenderer::RenderThread::Init() {
 	}
 
 	// Initialize the photon sample
-	sample.contribBuffer = new ContributionBuffer(scene.camera()->film->contribPool);
+	sample.contribBuffer = new ContributionBuffer(scene.camera()->film->contribPool, node);
 	// The RNG might be used when initializing the sampler data below
 	sample.rng = threadRng;
 //	sample.camera = scene.camera->Clone(); // Unneeded for photons
@@ -328,17 +367,20 @@ void SPPMRenderer::RenderThread::Init() {
 	renderer->scene->volumeIntegrator->RequestSamples(sampler, *(renderer->scene));
 	sampler->InitSample(&sample);
 
-	// initialise the eye sample
-	eyeSample.contribBuffer = new ContributionBuffer(scene.camera()->film->contribPool);
-	eyeSample.camera = scene.camera()->Clone();
-	eyeSample.realTime = 0.f;
-	eyeSample.rng = threadRng;
+	// initialise the eye samples
+	for (u_int i = 0; i < 2; ++i) {
+		eyeSample[i].contribBuffer = new ContributionBuffer(scene.camera()->film->contribPool, node);
+		eyeSample[i].camera = scene.camera()->Clone();
+		eyeSample[i].realTime = 0.f;
+		eyeSample[i].rng = threadRng;
 
-	renderer->hitPoints->eyeSampler->InitSample(&eyeSample);
+		renderer->hitPoints->eyeSampler->InitSample(&eyeSample[i]);
+	}
 }
 
-void SPPMRenderer::TracePhotons(scheduling::Range *range)
+void SPPMRenderer::PhotonEyePass(scheduling::Range *range)
 {
+	TraceSpan span(TRACE_PHOTONS, "sppm");
 	RenderThread* thread = dynamic_cast<RenderThread*>(range->thread);
 	Sample &sample = thread->sample;
 	PhotonSampler *sampler = thread->sampler;
@@ -349,10 +391,58 @@ void SPPMRenderer::TracePhotons(scheduling::Range *range)
 	sample.realTime = scene->camera()->GetTime(sample.time);
 //		sample.camera->SampleMotion(sample.realTime); // Unneeded for photons
 
-	//--------------------------------------------------------------
-	// Photon pass: trace photons
-	//--------------------------------------------------------------
-	sampler->TracePhotons(&sample, thread->lightCDF, range);
+	// The photons still use the memory of the other eye sample
+	Sample &eyeSample = thread->eyeSample[hitPoints->GetEyeBuffer()];
+	eyeSample.arena.FreeAll();
+	const float invPixelPdf = hitPoints->GetInvPixelPdf();
+
+	// Indices are handed out in increasing order, so threads done with
+	// the photons move on to the eye paths instead of waiting.
+	// Every photon index is traced, so a pass shoots exactly the
+	// photonPerPass photons the flux is normalized by
+	const u_int photonCount = sppmi->photonPerPass;
+	bool photonsStarted = false;
+	for (u_int i = range->begin(); i != range->end(); i = range->next()) {
+		if (i < photonCount) {
+			//--------------------------------------------------------------
+			// Photon pass: trace photons
+			//--------------------------------------------------------------
+			if (!photonsStarted) {
+				sampler->StartPhotons(&sample, thread->lightCDF);
+				photonsStarted = true;
+			}
+			sampler->TracePhotonSample(&sample, thread->lightCDF);
+		} else {
+			//--------------------------------------------------------------
+			// Next eye pass: trace eye paths in the other buffer
+			//--------------------------------------------------------------
+			hitPoints->SetHitPoint(eyeSample, i - photonCount, invPixelPdf);
+		}
+	}
+	if (photonsStarted)
+		sampler->EndPhotons();
+}
+
+void SPPMRenderer::TimedTask(const scheduling::TaskType &task, scheduling::Range *range)
+{
+	const double start = osWallClockTime();
+	task(range);
+	const double busy = osWallClockTime() - start;
+
+	boost::mutex::scoped_lock lock(phaseMutex);
+	phaseBusyTime += busy;
+}
+
+double SPPMRenderer::RunPhase(const scheduling::TaskType &task, u_int size)
+{
+	phaseBusyTime = 0.0;
+	const double start = osWallClockTime();
+	scheduler->Launch(boost::bind(&SPPMRenderer::TimedTask, this, task, _1), 0, size);
+	const double elapsed = osWallClockTime() - start;
+
+	boost::mutex::scoped_lock lock(phaseMutex);
+	threadIdleTime += max(0.0, elapsed * scheduler->ThreadCount() - phaseBusyTime);
+	return elapsed;
 }
 
 void SPPMRenderer::RenderMain(Scene *scene)
@@ -382,38 +472,48 @@ void SPPMRenderer::RenderMain(Scene *scene)
 	double eyePassStartTime = 0.0;
 	eyePassStartTime = osWallClockTime();
 
-	scheduler->Launch(boost::bind(&HitPoints::SetHitPoints, hitPoints, _1), 0, hitPoints->GetSize());
+	hitPoints->StartEyePass(0, 0);
+	RunPhase(boost::bind(&HitPoints::SetHitPoints, hitPoints, _1), hitPoints->GetEyeSize());
 
 	hitPoints->Init();
 
+	const double eyePassTime = osWallClockTime() - eyePassStartTime;
+	LOG(LUX_INFO, LUX_NOERROR) << "Eye pass time: " << eyePassTime << "secs";
+
 	// Trace rays: The main loop
 	while (!scene->camera()->film->enoughSamplesPerPixel &&
 		(scene->camera()->film->haltSamplesPerPixel <= .0f || hitPoints->GetPassCount() < scene->camera()->film->haltSamplesPerPixel) &&
 		state != TERMINATE) {
+		double refreshStartTime = 0.0;
+		refreshStartTime = osWallClockTime();
+
+		// The refresh stays a phase of its own: the photons of this
+		// pass look up the accelerator, and it depends on the eye paths
+		// and on the radii AccumulateFlux only gives at the end of the
+		// previous pass
 		hitPoints->UpdatePointsInformation();
 
 		hitPoints->RefreshAccel(scheduler);
 
-		const double eyePassTime = osWallClockTime() - eyePassStartTime;
-		LOG(LUX_INFO, LUX_NOERROR) << "Eye pass time: " << eyePassTime << "secs";
-
-		double photonPassStartTime = 0.0;
-		photonPassStartTime = osWallClockTime();
+		accelRefreshTime = osWallClockTime() - refreshStartTime;
 
-		scheduler->Launch(boost::bind(&SPPMRenderer::TracePhotons, this, _1), 0, sppmi->photonPerPass);
+		// Photons of this pass and eye paths of the next one, or of the
+		// next tile of the image, are traced in a single phase on double
+		// buffered hit points
+		hitPoints->StartNextEyePass();
+		photonEyePassTime = RunPhase(boost::bind(&SPPMRenderer::PhotonEyePass, this, _1),
+			sppmi->photonPerPass + hitPoints->GetEyeSize());
 
 		photonHitEfficiency = hitPoints->GetPhotonHitEfficency();
 
-		scheduler->Launch(boost::bind(&HitPoints::AccumulateFlux, hitPoints, _1), 0, hitPoints->GetSize());
-
-		hitPoints->IncPass();
+		accumulateFluxTime = RunPhase(boost::bind(&HitPoints::AccumulateFlux, hitPoints, _1), hitPoints->GetAccumulateSize());
 
-		const double photonPassTime = osWallClockTime() - photonPassStartTime;
-		LOG(LUX_INFO, LUX_NOERROR) << "Photon pass time: " << photonPassTime << "secs";
+		hitPoints->NextTile();
 
-		eyePassStartTime = osWallClockTime();
-
-		scheduler->Launch(boost::bind(&HitPoints::SetHitPoints, hitPoints, _1), 0, hitPoints->GetSize());
+		LOG(LUX_DEBUG, LUX_NOERROR) << "Pass times: accelerator refresh " << accelRefreshTime <<
+			"secs, photon and eye pass " << photonEyePassTime <<
+			"secs, flux accumulation " << accumulateFluxTime <<
+			"secs, total thread idle time " << threadIdleTime << "secs";
 	}
 }
 
@@ -421,18 +521,20 @@ void SPPMRenderer::RenderThread::End() {
 	Scene &scene = *renderer->scene;
 
 	scene.camera()->film->contribPool->End(sample.contribBuffer);
-	scene.camera()->film->contribPool->End(eyeSample.contribBuffer);
 	sample.contribBuffer = NULL;
-	eyeSample.contribBuffer = NULL;
+	for (u_int i = 0; i < 2; ++i) {
+		scene.camera()->film->contribPool->End(eyeSample[i].contribBuffer);
+		eyeSample[i].contribBuffer = NULL;
+		renderer->hitPoints->eyeSampler->FreeSample(&eyeSample[i]);
+	}
 
 	sampler->FreeSample(&sample);
-	renderer->hitPoints->eyeSampler->FreeSample(&eyeSample);
 
 	delete sampler;
 }
 
 Renderer *SPPMRenderer::CreateRenderer(const ParamSet &params) {
-	return new SPPMRenderer();
+	return new SPPMRenderer(params.FindOneBool("threadaffinity", false));
 }
 
 float SPPMRenderer::GetScaleFactor(const double scale) const
@@ -96,7 +96,7 @@ private:
 //------------------------------------------------------------------------------
 class SPPMRenderer : public Renderer {
 public:
-	SPPMRenderer();
+	SPPMRenderer(bool threadAffinity);
 	~SPPMRenderer();
 
 	RendererType GetType() const;
@@ -136,7 +136,13 @@ public:
 	float GetScaleFactor(double const scale) const;
 
 private:
-	void TracePhotons(scheduling::Range *range);
+	// Photon pass of the current pass followed, on the same index range,
+	// by the eye pass of the next one
+	void PhotonEyePass(scheduling::Range *range);
+	// Runs a task on the render threads, returns its duration and adds
+	// the time threads waited for the slowest one to threadIdleTime
+	double RunPhase(const scheduling::TaskType &task, u_int size);
+	void TimedTask(const scheduling::TaskType &task, scheduling::Range *range);
 
 	class ScaleUpdaterSPPM : public PerScreenNormalizedBufferScaled::ScaleUpdateInterface
 	{
@@ -156,7 +162,7 @@ private:
 
 	class RenderThread : public boost::noncopyable, public scheduling::Thread {
 	public:
-		RenderThread(SPPMRenderer *renderer);
+		RenderThread(u_int index, SPPMRenderer *renderer);
 		~RenderThread();
 
 		void TracePhotons(PhotonSampler &sampler, Sample *sample);
@@ -168,13 +174,19 @@ private:
 		void Init();
 		void End();
 
+		u_int n;
 		SPPMRenderer *renderer;
+		// NUMA node and logical processor the thread is bound to,
+		// the processor is negative if the thread isn't bound
+		u_int node;
+		int processor;
 
 		RandomGenerator *threadRng;
 		Distribution1D *lightCDF;
 		PhotonSampler* sampler;
 
-		Sample sample, eyeSample;
+		// One eye sample per eye pass buffer of HitPoints
+		Sample sample, eyeSample[2];
 	};
 
 	//--------------------------------------------------------------------------
@@ -191,6 +203,12 @@ private:
 
 	// Statistics
 	double photonHitEfficiency;
+	// Duration of the phases of the last pass
+	double photonEyePassTime, accumulateFluxTime, accelRefreshTime;
+	// Total time render threads spent waiting at the end of a phase
+	double threadIdleTime;
+	boost::mutex phaseMutex;
+	double phaseBusyTime;
 
 	friend class AMCMCPhotonSampler;
 	// Used by AMC Photon Sampler
@@ -200,6 +218,8 @@ private:
 	// used to suspend render threads until the preprocessing phase is done
 	bool preprocessDone;
 	bool suspendThreadsWhenDone;
+	// Bind the render threads to processors, spread over the NUMA nodes
+	bool threadAffinity;
 
 	scheduling::Scheduler *scheduler;
 	RandomGenerator* rng;
@@ -25,6 +25,7 @@
 #include "context.h"
 #include "film.h"
 #include "scene.h"
+#include "osfunc.h"
 
 #include <limits>
 #include <numeric>
@@ -33,6 +34,7 @@
 
 #include <boost/bind.hpp>
 #include <boost/format.hpp>
+#include <boost/lexical_cast.hpp>
 #include <boost/thread/mutex.hpp>
 
 using namespace lux;
@@ -65,6 +67,12 @@ SRStatistics::SRStatistics(SamplerRenderer* renderer)
 	AddDoubleAttribute(*this, "totalSamplesPerPixel", "Average number of samples per pixel", &SRStatistics::getTotalAverageSamplesPerPixel);
 	AddDoubleAttribute(*this, "totalSamplesPerSecond", "Average number of samples per second", &SRStatistics::getTotalAverageSamplesPerSecond);
 	AddDoubleAttribute(*this, "totalSamplesPerSecondWindow", "Average number of samples per second in current time window", &SRStatistics::getTotalAverageSamplesPerSecondWindow);
+
+	AddIntConstant(*this, "numaNodeCount", "Number of NUMA nodes of the local host", osNumaNodeCount());
+	for (u_int node = 0; node < osNumaNodeCount(); ++node) {
+		const string name("numaNode" + boost::lexical_cast<string>(node));
+		AddDoubleAttribute(*this, name + "SamplesPerSecond", "Average number of samples per second by the render threads of NUMA node " + boost::lexical_cast<string>(node), boost::function<double (void)>(boost::bind(&SRStatistics::getNodeAverageSamplesPerSecond, this, node)));
+	}
 }
 
 SRStatistics::~SRStatistics()
@@ -197,6 +205,23 @@ double SRStatistics::getAverageSamplesPerSecond() {
 	return (et == 0.0) ? 0.0 : getSampleCount() / et;
 }
 
+// Only meaningful when the render threads are bound to processors,
+// otherwise they all count as node 0
+double SRStatistics::getNodeAverageSamplesPerSecond(u_int node) {
+	double sampleCount = 0.0;
+
+	boost::mutex::scoped_lock lock(renderer->renderThreadsMutex);
+	for (u_int i = 0; i < renderer->renderThreads.size(); ++i) {
+		if (renderer->renderThreads[i]->node != node)
+			continue;
+		fast_mutex::scoped_lock lockStats(renderer->renderThreads[i]->statLock);
+		sampleCount += renderer->renderThreads[i]->samples;
+	}
+
+	double et = getElapsedTime();
+	return (et == 0.0) ? 0.0 : sampleCount / et;
+}
+
 double SRStatistics::getAverageSamplesPerSecondWindow() {
 	boost::mutex::scoped_lock window_mutex(windowMutex);
 	return exponentialMovingAverage;
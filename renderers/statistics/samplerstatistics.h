@@ -114,6 +114,7 @@ private:
 
 	double getAverageSamplesPerPixel() { return getSampleCount() / getPixelCount(); }
 	double getAverageSamplesPerSecond();
+	double getNodeAverageSamplesPerSecond(u_int node);
 	double getAverageSamplesPerSecondWindow();
 	double getAverageContributionsPerSecond() { return getAverageSamplesPerSecond() * (getEfficiency() / 100.0); }
 	double getAverageContributionsPerSecondWindow() { return getAverageSamplesPerSecondWindow() * (getEfficiency() / 100.0); }
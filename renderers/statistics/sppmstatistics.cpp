@@ -57,6 +57,12 @@ SPPMRStatistics::SPPMRStatistics(SPPMRenderer* renderer)
 	AddDoubleAttribute(*this, "photonCount", "Current photon count", &SPPMRStatistics::getPhotonCount);
 	AddDoubleAttribute(*this, "photonsPerSecond", "Average number of photons per second", &SPPMRStatistics::getAveragePhotonsPerSecond);
 	AddDoubleAttribute(*this, "photonsPerSecondWindow", "Average number of photons per second in current time window", &SPPMRStatistics::getAveragePhotonsPerSecondWindow);
+
+	AddDoubleAttribute(*this, "photonEyePassTime", "Duration of the last photon pass and next eye pass in seconds", &SPPMRStatistics::getPhotonEyePassTime);
+	AddDoubleAttribute(*this, "accumulateFluxTime", "Duration of the last flux accumulation in seconds", &SPPMRStatistics::getAccumulateFluxTime);
+	AddDoubleAttribute(*this, "accelRefreshTime", "Duration of the last hit points lookup accelerator refresh in seconds", &SPPMRStatistics::getAccelRefreshTime);
+	AddDoubleAttribute(*this, "threadIdleTime", "Total time render threads waited at the end of a phase in seconds", &SPPMRStatistics::getThreadIdleTime);
+	AddDoubleAttribute(*this, "percentThreadIdle", "Percent of the render threads time spent waiting at the end of a phase", &SPPMRStatistics::getPercentThreadIdle);
 }
 
 SPPMRStatistics::~SPPMRStatistics()
@@ -132,6 +138,11 @@ double SPPMRStatistics::getAveragePhotonsPerSecondWindow() {
 	return exponentialMovingAveragePhotons;
 }
 
+double SPPMRStatistics::getPercentThreadIdle() {
+	const double threadTime = getElapsedTime() * getThreadCount();
+	return (threadTime == 0.0) ? 0.0 : 100.0 * getThreadIdleTime() / threadTime;
+}
+
 SPPMRStatistics::FormattedLong::FormattedLong(SPPMRStatistics* rs)
 	: RendererStatistics::FormattedLong(rs), rs(rs)
 {
@@ -269,6 +280,8 @@ double SPPMRStatistics::getPhotonCount() {
 	if (filmRegistry)
 		sampleCount = (*filmRegistry)["numberOfLocalSamples"].DoubleValue();
 
-	// The amount of photon is stored "by pass"
-	return sampleCount * (renderer->sppmi->photonPerPass) / renderer->scene->camera()->film->GetSamplePerPass();
+	// The amount of photon is stored "by pass", each tile of the image
+	// traces its own photons
+	const u_int tileCount = renderer->hitPoints ? renderer->hitPoints->GetTileCount() : 1;
+	return sampleCount * (renderer->sppmi->photonPerPass) * tileCount / renderer->scene->camera()->film->GetSamplePerPass();
 }
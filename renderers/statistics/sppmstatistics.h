@@ -108,6 +108,12 @@ private:
 	double getPhotonCount();
 	double getAveragePhotonsPerSecond();
 	double getAveragePhotonsPerSecondWindow();
+
+	double getPhotonEyePassTime() { return renderer->photonEyePassTime; }
+	double getAccumulateFluxTime() { return renderer->accumulateFluxTime; }
+	double getAccelRefreshTime() { return renderer->accelRefreshTime; }
+	double getThreadIdleTime() { return renderer->threadIdleTime; }
+	double getPercentThreadIdle();
 };
 
 }//namespace lux
@@ -904,12 +904,23 @@ void cmd_luxGetFilm(bool isLittleEndian, NetworkRenderServerThread *serverThread
 			return;
 		}
 
+		// The scene may still be uploaded on another connection
+		if (!luxStatistics("sceneIsReady")) {
+			LOG( LUX_WARNING,LUX_NOERROR)<< "Received a GetFilm command before the scene is ready";
+			stream.close();
+			return;
+		}
+
 		LOG( LUX_INFO,LUX_NOERROR)<< "Transmitting film samples";
 
 		if (serverThread->renderServer->getWriteFlmFile()) {
 			string file = "server_resume";
-			if (tmpFileList.size())
-				file += "_" + tmpFileList[0];
+			{
+				// scene commands may append to the list
+				boost::mutex::scoped_lock lock(serverThread->sceneMutex);
+				if (tmpFileList.size())
+					file += "_" + tmpFileList[0];
+			}
 			file += ".flm";
 
 			writeTransmitFilm(stream, file);
@@ -974,6 +985,12 @@ void cmd_luxSetUserSamplingMap(bool isLittleEndian, NetworkRenderServerThread *s
 			return;
 		}
 
+		if (!luxStatistics("sceneIsReady")) {
+			LOG( LUX_WARNING,LUX_NOERROR)<< "Received a SetUserSamplingMap command before the scene is ready";
+			stream.close();
+			return;
+		}
+
 		LOG( LUX_DEBUG,LUX_NOERROR)<< "Receiving user sampling map";
 
 		{
@@ -1002,6 +1019,91 @@ void cmd_luxSetUserSamplingMap(bool isLittleEndian, NetworkRenderServerThread *s
 	}
 }
 
+typedef boost::function<void (socket_stream_t&)> cmdfunc_t;
+
+// Locking required by each command, see NetworkRenderServerThread
+enum CommandLock { LOCK_SESSION_EXCLUSIVE, LOCK_SESSION, LOCK_SCENE };
+
+static CommandLock commandLock(const string &command)
+{
+	if (command == "ServerConnect" || command == "ServerDisconnect" ||
+		command == "ServerReset")
+		return LOCK_SESSION_EXCLUSIVE;
+	if (command == "" || command == " " || command == "ServerReconnect" ||
+		command == "luxGetFilm" || command == "luxGetLog" ||
+		command == "luxSetUserSamplingMap")
+		return LOCK_SESSION;
+	return LOCK_SCENE;
+}
+
+static void processConnection(NetworkRenderServerThread *serverThread,
+	socket_stream_t &stream, const map<string, cmdfunc_t> &cmds,
+	vector<string> &tmpFileList)
+{
+	stream.setf(ios::scientific, ios::floatfield);
+	stream.precision(16);
+
+	//reading the command
+	string command;
+	LOG( LUX_DEBUG,LUX_NOERROR) << "Server receiving commands...";
+	try {
+		while (getline(stream, command)) {
+
+			if ((command != "") && (command != " ")) {
+				LOG(LUX_DEBUG,LUX_NOERROR) << "... processing command: '" << command << "'";
+			}
+
+			map<string, cmdfunc_t>::const_iterator cmd = cmds.find(command);
+			if (cmd == cmds.end())
+				throw std::runtime_error("Unknown command");
+
+			switch (commandLock(command)) {
+				case LOCK_SESSION_EXCLUSIVE: {
+					boost::unique_lock<boost::shared_mutex> lock(serverThread->sessionMutex);
+					cmd->second(stream);
+					break;
+				}
+				case LOCK_SESSION: {
+					boost::shared_lock<boost::shared_mutex> lock(serverThread->sessionMutex);
+					cmd->second(stream);
+					break;
+				}
+				case LOCK_SCENE:
+				default: {
+					boost::shared_lock<boost::shared_mutex> lock(serverThread->sessionMutex);
+					boost::mutex::scoped_lock sceneLock(serverThread->sceneMutex);
+					cmd->second(stream);
+					break;
+				}
+			}
+
+			//END OF COMMAND PROCESSING
+		}
+	} catch (std::runtime_error& e) {
+		LOG(LUX_SEVERE,LUX_BUG) << "Exception processing command '" << command << "': " << e.what();
+		LOG(LUX_INFO,LUX_NOERROR) << "Ending session, cleaning up";
+
+		boost::unique_lock<boost::shared_mutex> lock(serverThread->sessionMutex);
+		cleanupSession(serverThread, tmpFileList);
+	} catch (std::exception& e) {
+		LOG(LUX_ERROR,LUX_SYSTEM) << "Error processing command '" << command << "': " << e.what();
+	}
+}
+
+#ifndef USE_SOCKET_DEVICE
+static void connectionThread(NetworkRenderServerThread *serverThread,
+	socket_stream_t *stream, const map<string, cmdfunc_t> *cmds,
+	vector<string> *tmpFileList)
+{
+	processConnection(serverThread, *stream, *cmds, *tmpFileList);
+	delete stream;
+
+	boost::mutex::scoped_lock lock(serverThread->connectionMutex);
+	--(serverThread->activeConnections);
+	serverThread->connectionCondition.notify_all();
+}
+#endif
+
 // Dade - TODO: support signals
 void NetworkRenderServerThread::run(int ipversion, NetworkRenderServerThread *serverThread)
 {
@@ -1012,7 +1114,6 @@ void NetworkRenderServerThread::run(int ipversion, NetworkRenderServerThread *se
 
 	vector<string> tmpFileList;
 
-	typedef boost::function<void (socket_stream_t&)> cmdfunc_t;
 	#define INSERT_CMD(CmdName) cmds.insert(std::pair<string, cmdfunc_t>(#CmdName, boost::bind(cmd_##CmdName, isLittleEndian, serverThread, _1, boost::ref(tmpFileList))))
 
 	map<string, cmdfunc_t> cmds;
@@ -1114,39 +1215,33 @@ void NetworkRenderServerThread::run(int ipversion, NetworkRenderServerThread *se
 
 			stream->timeout(boost::posix_time::seconds(30));
 			stream->get_socket().set_option(boost::asio::ip::tcp::no_delay(true));
+
+			processConnection(serverThread, stream, cmds, tmpFileList);
 #else
-			tcp::iostream stream;
-			acceptor.accept(*stream.rdbuf());
-			stream.rdbuf()->set_option(boost::asio::ip::tcp::no_delay(true));
-#endif
-			stream.setf(ios::scientific, ios::floatfield);
-			stream.precision(16);
+			// Wait for a free connection slot
+			{
+				boost::mutex::scoped_lock lock(serverThread->connectionMutex);
+				while (serverThread->activeConnections >= maxConnections)
+					serverThread->connectionCondition.wait(lock);
+			}
 
-			//reading the command
-			string command;
-			LOG( LUX_DEBUG,LUX_NOERROR) << "Server receiving commands...";
+			tcp::iostream *stream = new tcp::iostream();
 			try {
-				while (getline(stream, command)) {
-
-					if ((command != "") && (command != " ")) {
-						LOG(LUX_DEBUG,LUX_NOERROR) << "... processing command: '" << command << "'";
-					}
-
-					if (cmds.find(command) != cmds.end()) {
-						cmdfunc_t cmdhandler = cmds.find(command)->second;
-						cmdhandler(stream);
-					} else {
-						throw std::runtime_error("Unknown command");
-					}
-
-					//END OF COMMAND PROCESSING
-				}
-			} catch (std::runtime_error& e) {
-				LOG(LUX_SEVERE,LUX_BUG) << "Exception processing command '" << command << "': " << e.what();
-				LOG(LUX_INFO,LUX_NOERROR) << "Ending session, cleaning up";
+				acceptor.accept(*stream->rdbuf());
+				stream->rdbuf()->set_option(boost::asio::ip::tcp::no_delay(true));
+			} catch (...) {
+				delete stream;
+				throw;
+			}
 
-				cleanupSession(serverThread, tmpFileList);
+			// Serve the connection while accepting the next one
+			{
+				boost::mutex::scoped_lock lock(serverThread->connectionMutex);
+				++(serverThread->activeConnections);
 			}
+			boost::thread(boost::bind(connectionThread, serverThread,
+				stream, &cmds, &tmpFileList)).detach();
+#endif
 		}
 	} catch (boost::system::system_error& e) {
 		if (e.code() != boost::asio::error::address_family_not_supported)
@@ -1156,4 +1251,9 @@ void NetworkRenderServerThread::run(int ipversion, NetworkRenderServerThread *se
 	} catch (exception& e) {
 		LOG(LUX_SEVERE,LUX_BUG) << "Internal error: " << e.what();
 	}
+
+	// The connections still being served use cmds and tmpFileList
+	boost::mutex::scoped_lock lock(serverThread->connectionMutex);
+	while (serverThread->activeConnections > 0)
+		serverThread->connectionCondition.wait(lock);
 }
@@ -45,7 +45,7 @@ class NetworkRenderServerThread : public boost::noncopyable {
 public:
 	NetworkRenderServerThread(RenderServer *server) :
 		renderServer(server), serverThread4(NULL), serverThread6(NULL), engineThread(NULL),
-		infoThread(NULL), signal(SIG_NONE) { }
+		infoThread(NULL), activeConnections(0), signal(SIG_NONE) { }
 
 	~NetworkRenderServerThread() {
 		if (engineThread)
@@ -81,6 +81,19 @@ public:
 	// used to prevent simultaneous initialization
 	boost::mutex initMutex;
 
+	// Connections are served concurrently, commands starting or ending
+	// a session are exclusive, scene commands are serialized among
+	// themselves while film, log and sampling map transfers only
+	// need the session to stay alive
+	boost::shared_mutex sessionMutex;
+	boost::mutex sceneMutex;
+
+	// Bounds the number of connections served at the same time
+	static const u_int maxConnections = 8;
+	boost::mutex connectionMutex;
+	boost::condition_variable connectionCondition;
+	u_int activeConnections;
+
 
 	// Dade - used to send signals to the thread
 	enum ThreadSignal { SIG_NONE, SIG_EXIT };
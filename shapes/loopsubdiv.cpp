@@ -25,8 +25,11 @@
 #include "spectrumwavelengths.h"
 #include "geometry/raydifferential.h"
 #include "shape.h"
+#include "scheduler.h"
+#include "refinementqueue.h"
+#include "osfunc.h"
 
-#include <boost/pool/object_pool.hpp>
+#include <boost/bind.hpp>
 
 using namespace lux;
 
@@ -137,6 +140,40 @@ LoopSubdiv::~LoopSubdiv() {
 	delete[] faces[0];
 }
 
+// Storage of one subdivision level, faces and vertices are contiguous so
+// that neighbours and children can be addressed by index
+struct LoopSubdiv::RefineLevel {
+	SDVertex *vertices;
+	SDFace *faces;
+	u_int nVertices, nFaces;
+	// Next level, even vertices first followed by the odd vertices
+	SDVertex *childVertices;
+	SDFace *childFaces;
+	// Bit k is set if face edge k creates an odd vertex
+	vector<u_char> edgeFlags;
+	// First odd vertex created by each face
+	vector<u_int> edgeOffsets;
+
+	u_int FaceIndex(const SDFace *f) const {
+		return static_cast<u_int>(f - faces);
+	}
+	SDVertex *OddVertex(u_int face, u_int edge) const {
+		u_int index = nVertices + edgeOffsets[face];
+		for (u_int k = 0; k < edge; ++k)
+			index += (edgeFlags[face] >> k) & 1;
+		return &childVertices[index];
+	}
+};
+
+// Check whether the UVs of edge v0-v1 differ on face f2
+static bool UVSplit(const SDFace *f2, const SDVertex *v0, const SDVertex *v1)
+{
+	const SDVertex *o0 = f2->v[f2->vnum(v0->P)];
+	const SDVertex *o1 = f2->v[f2->vnum(v1->P)];
+	return o0->u != v0->u || o0->v != v0->v ||
+		o1->u != v1->u || o1->v != v1->v;
+}
+
 boost::shared_ptr<LoopSubdiv::SubdivResult> LoopSubdiv::Refine() const {
 
 	// check that we should do any subdivision
@@ -146,161 +183,78 @@ boost::shared_ptr<LoopSubdiv::SubdivResult> LoopSubdiv::Refine() const {
 
 	SHAPE_LOG(name, LUX_INFO,LUX_NOERROR) << "Applying " << nLevels << " levels of loop subdivision to " << faces.size() << " triangles";
 
-	vector<SDFace *> f = faces;
-	vector<SDVertex *> v = vertices;
-	boost::object_pool<SDVertex> vertexArena;
-	boost::object_pool<SDFace> faceArena;
+	// Start the workers, each pass below is a barrier. The refinement
+	// queue already runs one refinement per core, a single worker keeps
+	// the passes serial there instead of oversubscribing the machine
+	scheduling::Scheduler scheduler(1024);
+	vector<scheduling::Thread *> workers(RefinementQueue::InWorker() ? 1U :
+		max(1U, boost::thread::hardware_concurrency()));
+	for (u_int i = 0; i < workers.size(); ++i) {
+		workers[i] = new scheduling::Thread();
+		scheduler.AddThread(workers[i]);
+	}
+
+	RefineLevel level;
+	level.vertices = vertices[0];
+	level.faces = faces[0];
+	level.nVertices = vertices.size();
+	level.nFaces = faces.size();
 
 	for (u_int i = 0; i < nLevels; ++i) {
-		// Update _f_ and _v_ for next level of subdivision
-		vector<SDFace *> newFaces;
-		vector<SDVertex *> newVertices;
-
-		// Allocate next level of children in mesh tree
-		newVertices.reserve(v.size());
-		for (u_int j = 0; j < v.size(); ++j) {
-			v[j]->child = vertexArena.construct();//new (vertexArena) SDVertex;
-			v[j]->child->regular = v[j]->regular;
-			v[j]->child->boundary = v[j]->boundary;
-			newVertices.push_back(v[j]->child);
-		}
-		newFaces.reserve(f.size());
-		for (u_int j = 0; j < f.size(); ++j) {
-			for (u_int k = 0; k < 4; ++k) {
-				f[j]->children[k] = faceArena.construct();//new (faceArena) SDFace;
-				newFaces.push_back(f[j]->children[k]);
-			}
+		const double start = osWallClockTime();
+
+		// Allocate next level of faces and count the odd vertices
+		level.childFaces = new SDFace[4 * level.nFaces];
+		level.edgeFlags.resize(level.nFaces);
+		level.edgeOffsets.resize(level.nFaces);
+		scheduler.Launch(boost::bind(&LoopSubdiv::SplitFaces, this,
+			_1, &level), 0, level.nFaces);
+		u_int nOdd = 0;
+		for (u_int j = 0; j < level.nFaces; ++j) {
+			level.edgeOffsets[j] = nOdd;
+			for (u_int k = 0; k < 3; ++k)
+				nOdd += (level.edgeFlags[j] >> k) & 1;
 		}
+		level.childVertices = new SDVertex[level.nVertices + nOdd];
 
 		// Update vertex positions and create new edge vertices
-		// Update vertex positions for even vertices
-		for (u_int j = 0; j < v.size(); ++j) {
-			SDVertex *vert = v[j];
-			if (!vert->boundary) {
-				// Apply one-ring rule for even vertex
-				if (vert->regular)
-					weightOneRing(vert->child, vert, 1.f/16.f);
-				else
-					weightOneRing(vert->child, vert, beta(vert->valence()));
-			} else {
-				// Apply boundary rule for even vertex
-				weightBoundary(vert->child, vert, 1.f/8.f);
-			}
-			// Update even vertex face pointers
-			const SDFace *sf = vert->startFace;
-			vert->child->startFace = sf->children[sf->vnum(vert->P)];
-		}
-
-		// Compute new odd edge vertices
+		scheduler.Launch(boost::bind(&LoopSubdiv::UpdateEvenVertices,
+			this, _1, &level), 0, level.nVertices);
+		scheduler.Launch(boost::bind(&LoopSubdiv::ComputeOddVertices,
+			this, _1, &level), 0, level.nFaces);
 		// Update new mesh topology
-		map<SDEdge, SDVertex *> edgeVerts;
-		for (u_int j = 0; j < f.size(); ++j) {
-			SDFace *face = f[j];
-			for (u_int k = 0; k < 3; ++k) {
-				// Update face neighbor pointers
-				// Update children _f_ pointers for siblings
-				face->children[3]->f[k] = face->children[NEXT(k)];
-				face->children[k]->f[NEXT(k)] = face->children[3];
-				// Update children _f_ pointers for neighbor children
-				SDFace *f2 = face->f[PREV(k)];
-				face->children[k]->f[PREV(k)] =
-					f2 ? f2->children[f2->vnum(face->v[k]->P)] : NULL;
-				f2 = face->f[k];
-				face->children[k]->f[k] =
-					f2 ? f2->children[f2->vnum(face->v[k]->P)] : NULL;
-				// Update child vertex pointer to new even vertex
-				face->children[k]->v[k] = face->v[k]->child;
-				// Compute odd vertex on _k_th edge
-				SDVertex *v0 = face->v[k], *v1 = face->v[NEXT(k)];
-				SDEdge edge(v0, v1);
-				SDVertex *vert = edgeVerts[edge];
-				if (!vert) {
-					edge.f[0] = face;
-					edge.f0edgeNum = k;
-					// Create and initialize new odd vertex
-					vert = vertexArena.construct();//new (vertexArena) SDVertex;
-					newVertices.push_back(vert);
-					vert->regular = true;
-					vert->boundary = (f2 == NULL);
-					vert->startFace = face->children[3];
-					// Apply edge rules to compute new vertex position
-					if (vert->boundary) {
-						vert->P =  0.5f * (v0->P + v1->P);
-
-						vert->u = 0.5f * (v0->u + v1->u);
-						vert->v = 0.5f * (v0->v + v1->v);
-						vert->n = 0.5f * (v0->n + v1->n);
-					} else {
-						SDVertex *ov1 = face->v[PREV(k)];
-						SDVertex *ov2 = f2->otherVert(edge.v[0]->P, edge.v[1]->P);
-						vert->P =  3.f/8.f * (v0->P + v1->P);
-						vert->P += 1.f/8.f * (ov1->P + ov2->P);
-
-						// If UV are different on each side of the edge interpolate as boundary
-						if (f2->v[f2->vnum(v0->P)]->u == v0->u &&
-							f2->v[f2->vnum(v0->P)]->v == v0->v &&
-							f2->v[f2->vnum(v1->P)]->u == v1->u &&
-							f2->v[f2->vnum(v1->P)]->v == v1->v) {
-							vert->u = 3.f/8.f * (v0->u + v1->u);
-							vert->u += 1.f/8.f * (ov1->u + ov2->u);
-
-							vert->v = 3.f/8.f * (v0->v + v1->v);
-							vert->v += 1.f/8.f * (ov1->v + ov2->v);
-						} else {
-							vert->u = 0.5f * (v0->u + v1->u);
-							vert->v = 0.5f * (v0->v + v1->v);
-						}
-						vert->n =  3.f/8.f * (v0->n + v1->n);
-						vert->n += 1.f/8.f * (ov1->n + ov2->n);
-					}
-					edgeVerts[edge] = vert;
-				} else {
-					// If UV are different on each side of the edge create a new vertex
-					if (!vert->boundary &&
-						(f2->v[f2->vnum(v0->P)]->u != v0->u ||
-						f2->v[f2->vnum(v0->P)]->v != v0->v ||
-						f2->v[f2->vnum(v1->P)]->u != v1->u ||
-						f2->v[f2->vnum(v1->P)]->v != v1->v)) {
-						const Point &P(vert->P);
-						const Normal &N(vert->n);
-						SDFace *startFace = vert->startFace;
-						vert = vertexArena.construct();//new (vertexArena) SDVertex;
-						newVertices.push_back(vert);
-						vert->regular = true;
-						vert->boundary = false;
-						vert->startFace = startFace;
-						// Standard point interpolation
-						vert->P = P;
-						// Boundary interpolation for UV
-						vert->u = 0.5f * (v0->u + v1->u);
-						vert->v = 0.5f * (v0->v + v1->v);
-						vert->n = N;
-					}
-					edgeVerts.erase(edge);
-				}
-				// Update face vertex pointers
-				// Update child vertex pointer to new odd vertex
-				face->children[k]->v[NEXT(k)] = vert;
-				face->children[NEXT(k)]->v[k] = vert;
-				face->children[3]->v[k] = vert;
-			}
+		scheduler.Launch(boost::bind(&LoopSubdiv::LinkChildFaces,
+			this, _1, &level), 0, level.nFaces);
+
+		// Prepare for next level of subdivision,
+		// the base level is owned by the LoopSubdiv
+		if (i > 0) {
+			delete[] level.vertices;
+			delete[] level.faces;
 		}
-		edgeVerts.clear();
-
-		// Prepare for next level of subdivision
-		f = newFaces;
-		v = newVertices;
+		level.vertices = level.childVertices;
+		level.faces = level.childFaces;
+		level.nVertices += nOdd;
+		level.nFaces *= 4;
+
+		const size_t bytes = level.nVertices * sizeof(SDVertex) +
+			level.nFaces * sizeof(SDFace);
+		SHAPE_LOG(name, LUX_INFO,LUX_NOERROR) << "Subdivision level " << i + 1 << ": " << level.nFaces << " triangles, " << level.nVertices << " vertices, " << bytes / (1024 * 1024) << "MB in " << (osWallClockTime() - start) << "s";
 	}
+	level.edgeFlags.clear();
+	level.edgeOffsets.clear();
 
 	// Push vertices to limit surface
-	SDVertex *Vlimit = new SDVertex[v.size()];
-	for (u_int i = 0; i < v.size(); ++i) {
-		if (v[i]->boundary)
-			weightBoundary(&Vlimit[i], v[i], 1.f/5.f);
-		else
-			weightOneRing(&Vlimit[i], v[i], gamma(v[i]->valence()));
-	}
+	SDVertex *Vlimit = new SDVertex[level.nVertices];
+	scheduler.Launch(boost::bind(&LoopSubdiv::PushToLimit, this, _1,
+		level.vertices, Vlimit), 0, level.nVertices);
+	scheduler.Done();
+	for (u_int i = 0; i < workers.size(); ++i)
+		delete workers[i];
+
+	vector<SDVertex *> v(level.nVertices);
 	for (u_int i = 0; i < v.size(); ++i) {
+		v[i] = &level.vertices[i];
 		v[i]->P = Vlimit[i].P;
 		v[i]->u = Vlimit[i].u;
 		v[i]->v = Vlimit[i].v;
@@ -309,16 +263,13 @@ boost::shared_ptr<LoopSubdiv::SubdivResult> LoopSubdiv::Refine() const {
 	delete[] Vlimit;
 
 	// Create _TriangleMesh_ from subdivision mesh
-	u_int ntris = f.size();
-	u_int nverts = v.size();
+	u_int ntris = level.nFaces;
+	u_int nverts = level.nVertices;
 	int *verts = new int[3*ntris];
 	int *vp = verts;
-	map<SDVertex *, int> usedVerts;
-	for (u_int i = 0; i < nverts; ++i)
-		usedVerts[v[i]] = i;
 	for (u_int i = 0; i < ntris; ++i) {
 		for (u_int j = 0; j < 3; ++j) {
-			*vp = usedVerts[f[i]->v[j]];
+			*vp = static_cast<int>(level.faces[i].v[j] - level.vertices);
 			++vp;
 		}
 	}
@@ -359,10 +310,168 @@ boost::shared_ptr<LoopSubdiv::SubdivResult> LoopSubdiv::Refine() const {
 		for (u_int i = 0; i < nverts; ++i)
 			Ns[i] = v[i]->n;
 	}
+	delete[] level.vertices;
+	delete[] level.faces;
 
 	return boost::shared_ptr<SubdivResult>(new SubdivResult(ntris, nverts, verts, Plimit, Ns, UVlimit));
 }
 
+void LoopSubdiv::SplitFaces(scheduling::Range *range,
+	RefineLevel *level) const
+{
+	for (u_int j = range->begin(); j != range->end(); j = range->next()) {
+		SDFace *face = &level->faces[j];
+		for (u_int k = 0; k < 4; ++k)
+			face->children[k] = &level->childFaces[4 * j + k];
+		// The face with the lowest index owns the odd vertex of a
+		// shared edge, the other face only needs its own vertex
+		// when the UVs differ on each side of the edge
+		u_char flags = 0;
+		for (u_int k = 0; k < 3; ++k) {
+			const SDFace *f2 = face->f[k];
+			if (!f2 || level->FaceIndex(f2) > j ||
+				UVSplit(f2, face->v[k], face->v[NEXT(k)]))
+				flags |= 1 << k;
+		}
+		level->edgeFlags[j] = flags;
+	}
+}
+
+void LoopSubdiv::UpdateEvenVertices(scheduling::Range *range,
+	RefineLevel *level) const
+{
+	// valence() only rewrites the start face of the UV split copies
+	// of a vertex and those already agree since the constructor,
+	// so the one ring walks below do not write to shared data
+	for (u_int j = range->begin(); j != range->end(); j = range->next()) {
+		SDVertex *vert = &level->vertices[j];
+		vert->child = &level->childVertices[j];
+		vert->child->regular = vert->regular;
+		vert->child->boundary = vert->boundary;
+		if (!vert->boundary) {
+			// Apply one-ring rule for even vertex
+			if (vert->regular)
+				weightOneRing(vert->child, vert, 1.f/16.f);
+			else
+				weightOneRing(vert->child, vert, beta(vert->valence()));
+		} else {
+			// Apply boundary rule for even vertex
+			weightBoundary(vert->child, vert, 1.f/8.f);
+		}
+		// Update even vertex face pointers
+		const SDFace *sf = vert->startFace;
+		vert->child->startFace = sf->children[sf->vnum(vert->P)];
+	}
+}
+
+void LoopSubdiv::ComputeOddVertices(scheduling::Range *range,
+	RefineLevel *level) const
+{
+	for (u_int j = range->begin(); j != range->end(); j = range->next()) {
+		SDFace *face = &level->faces[j];
+		for (u_int k = 0; k < 3; ++k) {
+			SDFace *f2 = face->f[k];
+			if (f2 && level->FaceIndex(f2) < j)
+				continue;
+			// Create and initialize new odd vertex
+			SDVertex *v0 = face->v[k], *v1 = face->v[NEXT(k)];
+			SDVertex *vert = level->OddVertex(j, k);
+			vert->regular = true;
+			vert->boundary = (f2 == NULL);
+			vert->startFace = face->children[3];
+			// Apply edge rules to compute new vertex position
+			if (vert->boundary) {
+				vert->P =  0.5f * (v0->P + v1->P);
+
+				vert->u = 0.5f * (v0->u + v1->u);
+				vert->v = 0.5f * (v0->v + v1->v);
+				vert->n = 0.5f * (v0->n + v1->n);
+			} else {
+				SDVertex *ov1 = face->v[PREV(k)];
+				SDVertex *ov2 = f2->otherVert(v0->P, v1->P);
+				vert->P =  3.f/8.f * (v0->P + v1->P);
+				vert->P += 1.f/8.f * (ov1->P + ov2->P);
+
+				// If UV are different on each side of the edge interpolate as boundary
+				if (!UVSplit(f2, v0, v1)) {
+					vert->u = 3.f/8.f * (v0->u + v1->u);
+					vert->u += 1.f/8.f * (ov1->u + ov2->u);
+
+					vert->v = 3.f/8.f * (v0->v + v1->v);
+					vert->v += 1.f/8.f * (ov1->v + ov2->v);
+				} else {
+					vert->u = 0.5f * (v0->u + v1->u);
+					vert->v = 0.5f * (v0->v + v1->v);
+				}
+				vert->n =  3.f/8.f * (v0->n + v1->n);
+				vert->n += 1.f/8.f * (ov1->n + ov2->n);
+			}
+		}
+	}
+}
+
+void LoopSubdiv::LinkChildFaces(scheduling::Range *range,
+	RefineLevel *level) const
+{
+	for (u_int j = range->begin(); j != range->end(); j = range->next()) {
+		SDFace *face = &level->faces[j];
+		for (u_int k = 0; k < 3; ++k) {
+			// Update face neighbor pointers
+			// Update children _f_ pointers for siblings
+			face->children[3]->f[k] = face->children[NEXT(k)];
+			face->children[k]->f[NEXT(k)] = face->children[3];
+			// Update children _f_ pointers for neighbor children
+			SDFace *f2 = face->f[PREV(k)];
+			face->children[k]->f[PREV(k)] =
+				f2 ? f2->children[f2->vnum(face->v[k]->P)] : NULL;
+			f2 = face->f[k];
+			face->children[k]->f[k] =
+				f2 ? f2->children[f2->vnum(face->v[k]->P)] : NULL;
+			// Update child vertex pointer to new even vertex
+			face->children[k]->v[k] = face->v[k]->child;
+			// Fetch odd vertex on _k_th edge
+			SDVertex *v0 = face->v[k], *v1 = face->v[NEXT(k)];
+			SDVertex *vert;
+			if (f2 && level->FaceIndex(f2) < j) {
+				// The edge runs from v1 to v0 on the owner face
+				vert = level->OddVertex(level->FaceIndex(f2),
+					f2->vnum(v1->P));
+				// If UV are different on each side of the edge create a new vertex
+				if (level->edgeFlags[j] & (1 << k)) {
+					SDVertex *owned = vert;
+					vert = level->OddVertex(j, k);
+					vert->regular = true;
+					vert->boundary = false;
+					vert->startFace = owned->startFace;
+					// Standard point interpolation
+					vert->P = owned->P;
+					// Boundary interpolation for UV
+					vert->u = 0.5f * (v0->u + v1->u);
+					vert->v = 0.5f * (v0->v + v1->v);
+					vert->n = owned->n;
+				}
+			} else
+				vert = level->OddVertex(j, k);
+			// Update face vertex pointers
+			// Update child vertex pointer to new odd vertex
+			face->children[k]->v[NEXT(k)] = vert;
+			face->children[NEXT(k)]->v[k] = vert;
+			face->children[3]->v[k] = vert;
+		}
+	}
+}
+
+void LoopSubdiv::PushToLimit(scheduling::Range *range, SDVertex *v,
+	SDVertex *Vlimit) const
+{
+	for (u_int i = range->begin(); i != range->end(); i = range->next()) {
+		if (v[i].boundary)
+			weightBoundary(&Vlimit[i], &v[i], 1.f/5.f);
+		else
+			weightOneRing(&Vlimit[i], &v[i], gamma(v[i].valence()));
+	}
+}
+
 void LoopSubdiv::GenerateNormals(const vector<SDVertex *> v) {
 	// Compute vertex tangents on limit surface
 	u_int ringSize = 16;
@@ -31,6 +31,11 @@ using std::map;
 #define NEXT(i) (((i)+1)%3)
 #define PREV(i) (((i)+2)%3)
 
+namespace scheduling
+{
+class Range;
+}
+
 namespace lux
 {
 
@@ -151,8 +156,8 @@ public:
 
 	class SubdivResult {
 	public:
-		SubdivResult(u_int aNtris, u_int aNverts, const int* aIndices,
-			const Point *aP, const Normal *aN, const float *aUv)
+		SubdivResult(u_int aNtris, u_int aNverts, int* aIndices,
+			Point *aP, Normal *aN, float *aUv)
 			: ntris(aNtris), nverts(aNverts), indices(aIndices),
 			P(aP), N(aN), uv(aUv)
 		{
@@ -167,10 +172,12 @@ public:
 		const u_int ntris;
 		const u_int nverts;
 
-		const int * const indices;
-		const Point * const P;
-		const Normal * const N;
-		const float * const uv;
+		// The arrays may be taken over by the caller, it then has
+		// to reset the pointer to NULL
+		int *indices;
+		Point *P;
+		Normal *N;
+		float *uv;
 	};
 	boost::shared_ptr<SubdivResult> Refine() const;
 
@@ -189,6 +196,17 @@ private:
 
 	void ApplyDisplacementMap(const vector<SDVertex *> verts) const;
 
+	// Parallel refinement passes, one level is stored in flat arrays
+	struct RefineLevel;
+	void SplitFaces(scheduling::Range *range, RefineLevel *level) const;
+	void UpdateEvenVertices(scheduling::Range *range,
+		RefineLevel *level) const;
+	void ComputeOddVertices(scheduling::Range *range,
+		RefineLevel *level) const;
+	void LinkChildFaces(scheduling::Range *range, RefineLevel *level) const;
+	void PushToLimit(scheduling::Range *range, SDVertex *v,
+		SDVertex *Vlimit) const;
+
 	// LoopSubdiv Private Data
 	u_int nLevels;
 	vector<SDVertex *> vertices;
@@ -34,8 +34,10 @@ using namespace lux;
 
 Mesh::Mesh(const Transform &o2w, bool ro, const string &name,
 	MeshAccelType acceltype,
-	u_int nv, const Point *P, const Normal *N, const float *UV,
-	MeshTriangleType tritype, u_int trisCount, const int *tris,
+	u_int nv, const Point *P, const Normal *N,
+	const boost::shared_array<float> &UV,
+	MeshTriangleType tritype, u_int trisCount,
+	const boost::shared_array<int> &tris,
 	MeshQuadType quadtype, u_int nquadsCount, const int *quads,
 	MeshSubdivType subdivtype, u_int nsubdivlevels,
 	boost::shared_ptr<Texture<float> > &dmMap, float dmScale, float dmOffset,
@@ -63,12 +65,10 @@ Mesh::Mesh(const Transform &o2w, bool ro, const string &name,
 	for (u_int i  = 0; i < nverts; ++i)
 		p[i] = ObjectToWorld * P[i];
 
-	// Dade - copy UV and N vertex data, if present
-	if (UV) {
-		uvs = new float[2 * nverts];
-		memcpy(uvs, UV, 2 * nverts*sizeof(float));
-	} else
-		uvs = NULL;
+	// Dade - copy N vertex data, if present
+	// UVs are never modified in place so they are shared
+	uvsStorage = UV;
+	uvs = uvsStorage.get();
 
 	if (N) {
 		n = new Normal[nverts];
@@ -154,9 +154,14 @@ Mesh::Mesh(const Transform &o2w, bool ro, const string &name,
 	ntris += 2 * nquadsToSplit;
 	if (ntris == 0)
 		triVertexIndex = NULL;
-	else {
-		triVertexIndex = new int[3 * ntris];
-		memcpy(triVertexIndex, tris, 3 * trisCount * sizeof(int));
+	else if (nquadsToSplit == 0) {
+		// shared until Refine
+		triVertexIndexStorage = tris;
+		triVertexIndex = triVertexIndexStorage.get();
+	} else {
+		triVertexIndexStorage.reset(new int[3 * ntris]);
+		triVertexIndex = triVertexIndexStorage.get();
+		memcpy(triVertexIndex, tris.get(), 3 * trisCount * sizeof(int));
 
 		for (size_t i = 0; i < nquadsToSplit; ++i) {
 			const size_t qidx = 4 * i;
@@ -211,11 +216,9 @@ Mesh::Mesh(const Transform &o2w, bool ro, const string &name,
 
 Mesh::~Mesh()
 {
-	delete[] triVertexIndex;
 	delete[] quadVertexIndex;
 	delete[] p;
 	delete[] n;
-	delete[] uvs;
 	delete[] t;
 	delete[] btsign;
 }
@@ -276,27 +279,20 @@ void Mesh::Refine(vector<boost::shared_ptr<Primitive> > &refined,
 				// Remove the old mesh data
 				delete[] p;
 				delete[] n;
-				delete[] uvs;
-				delete[] triVertexIndex;
 
-				// Copy the new mesh data
+				// Take over the new mesh data
 				nverts = res->nverts;
 				ntris = res->ntris;
-				triVertexIndex = new int[3 * ntris];
-				memcpy(triVertexIndex, res->indices, 3 * ntris * sizeof(int));
-				p = new Point[nverts];
-				memcpy(p, res->P, nverts * sizeof(Point));
-				if (res->uv) {
-					uvs = new float[2 * nverts];
-					memcpy(uvs, res->uv, 2 * nverts * sizeof(float));
-				} else
-					uvs = NULL;
-
-				if (res->N) {
-					n = new Normal[nverts];
-					memcpy(n, res->N, nverts * sizeof(Normal));
-				} else
-					n = NULL;
+				triVertexIndexStorage.reset(res->indices);
+				triVertexIndex = res->indices;
+				res->indices = NULL;
+				p = res->P;
+				res->P = NULL;
+				uvsStorage.reset(res->uv);
+				uvs = res->uv;
+				res->uv = NULL;
+				n = res->N;
+				res->N = NULL;
 
 				break;
 			}
@@ -329,6 +325,15 @@ void Mesh::Refine(vector<boost::shared_ptr<Primitive> > &refined,
 		GenerateTangentSpace();
 	}
 
+	// Triangles reorder their vertex indices in place, copy them
+	// if they are still shared with a ParamSet
+	if (triVertexIndexStorage && !triVertexIndexStorage.unique()) {
+		int *indices = new int[3 * ntris];
+		memcpy(indices, triVertexIndex, 3 * ntris * sizeof(int));
+		triVertexIndexStorage.reset(indices);
+		triVertexIndex = indices;
+	}
+
 
 
 	vector<boost::shared_ptr<Primitive> > refinedPrims;
@@ -381,6 +386,9 @@ void Mesh::Refine(vector<boost::shared_ptr<Primitive> > &refined,
 			}
 			break;
 		case TRI_MICRODISPLACEMENT:
+			if (!displacementCache)
+				displacementCache.reset(new MicroDisplacementCache(ntris,
+					nSubdivLevels, 16 * 1024 * 1024));
 			for (u_int i = 0; i < ntris; ++i) {
 				MeshMicroDisplacementTriangle *currTri;
 				if (refinedPrims.size() > 0)
@@ -864,19 +872,21 @@ void Mesh::GenerateTangentSpace() {
 	}
 
 	// safe to free mesh data
-	delete[] triVertexIndex;
+	triVertexIndexStorage.reset();
 	delete[] p;
 	delete[] n;
-	delete[] uvs;
+	uvsStorage.reset();
 
 	// perform the weld
 	nverts = WeldMesh(remapTable, vertDataOut, vertDataIn, 3 * ntris, floatsPerVert);
 	delete[] vertDataIn;	
 
+	triVertexIndexStorage.reset(remapTable);
 	triVertexIndex = remapTable;
 	p = new Point[nverts];
 	n = new Normal[nverts];
-	uvs = new float[2*nverts];
+	uvsStorage.reset(new float[2*nverts]);
+	uvs = uvsStorage.get();
 	t = new Vector[nverts];
 	btsign = new bool[nverts];
 
@@ -897,9 +907,9 @@ void Mesh::GenerateTangentSpace() {
 
 static Shape *CreateShape( const Transform &o2w, bool reverseOrientation, const ParamSet &params,
 						   const string& accelTypeStr, const string& triTypeStr, const string& quadTypeStr,
-						   const int* triIndices, u_int triIndicesCount,
+						   boost::shared_array<int> triIndices, u_int triIndicesCount,
 						   const int* quadIndices, u_int quadIndicesCount,
-						   const float* UV, u_int UVCount,
+						   boost::shared_array<float> UV, u_int UVCount,
 						   const string& subdivSchemeStr, u_int nSubdivLevels,
 						   const Point* P, u_int npi,
 						   const Normal* N, u_int nni) {
@@ -927,7 +937,7 @@ static Shape *CreateShape( const Transform &o2w, bool reverseOrientation, const
 	// NOTE - lordcrc - Bugfix, pbrt tracker id 0000085: check for correct number of uvs
 	if (UV && (UVCount != npi * 2)) {
 		SHAPE_LOG(name, LUX_ERROR,LUX_CONSISTENCY)<< "Number of \"UV\"s for mesh must match \"P\"s";
-		UV = NULL;
+		UV.reset();
 	}
 	if (!P)
 		return NULL;
@@ -1041,17 +1051,17 @@ static Shape *CreateShape( const Transform &o2w, bool reverseOrientation, const
 	const Normal *N = params.FindNormal("N", &nni);
 	
 	u_int UVCount;
-	const float *UV = params.FindFloat("uv", &UVCount);
-	if (UV == NULL) {
-		UV = params.FindFloat("st", &UVCount);
+	boost::shared_array<float> UV(params.FindSharedFloat("uv", &UVCount));
+	if (!UV) {
+		UV = params.FindSharedFloat("st", &UVCount);
 	}
 
 	// Triangles
 	u_int triIndicesCount;
-	const int *triIndices = params.FindInt("triindices", &triIndicesCount);
-	if(triIndices == NULL)
+	boost::shared_array<int> triIndices(params.FindSharedInt("triindices", &triIndicesCount));
+	if(!triIndices)
 	{
-		triIndices = params.FindInt("indices", &triIndicesCount);
+		triIndices = params.FindSharedInt("indices", &triIndicesCount);
 	}
  
 	triTypeStr = params.FindOneString("tritype", triTypeStr);
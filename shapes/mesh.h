@@ -24,10 +24,63 @@
 #include "paramset.h"
 
 #include "luxrays/luxrays.h"
+#include "fastmutex.h"
+
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_array.hpp>
 
 namespace lux
 {
 
+class MeshMicroDisplacementTriangle;
+
+// Bounded cache of the displaced vertices of microdisplacement triangles,
+// so that the displacement map is evaluated once per micro vertex
+// instead of once per micro vertex per ray
+class MicroDisplacementCache {
+public:
+	// Displaced micro vertices of a triangle subdivided in N segments
+	// along each edge
+	class Grid {
+	public:
+		Grid(u_int n) : N(n), P((n + 1) * (n + 2) / 2) { }
+
+		// Vertex with barycentric coordinates (1 - j/N - k/N, j/N, k/N)
+		const Point &GetP(u_int j, u_int k) const {
+			return P[Index(j, k)];
+		}
+		u_int Index(u_int j, u_int k) const {
+			return k * (2 * N + 3 - k) / 2 + j;
+		}
+
+		u_int N;
+		vector<Point> P;
+		// Bound of the displaced surface
+		BBox bound;
+	};
+
+	MicroDisplacementCache(u_int nTriangles, u_int nSubdivLevels,
+		size_t maxSize);
+
+	// Returns the displaced vertices of the triangle, computing them
+	// if needed. Thread safe.
+	boost::shared_ptr<const Grid> Get(const MeshMicroDisplacementTriangle &tri,
+		u_int index) const;
+
+private:
+	struct Slot {
+		Slot() : index(~0U) { }
+		u_int index;
+		boost::shared_ptr<const Grid> grid;
+	};
+
+	static const u_int LOCK_COUNT = 64;
+
+	u_int N;
+	mutable vector<Slot> slots;
+	mutable fast_mutex locks[LOCK_COUNT];
+};
+
 class Mesh : public Shape {
 public:
 	enum MeshTriangleType { TRI_WALD, TRI_BARY, TRI_MICRODISPLACEMENT, TRI_AUTO };
@@ -37,8 +90,10 @@ public:
 
 	Mesh(const Transform &o2w, bool ro, const string &name,
 		MeshAccelType acceltype,
-		u_int nv, const Point *P, const Normal *N, const float *UV,
-		MeshTriangleType tritype, u_int trisCount, const int *tris,
+		u_int nv, const Point *P, const Normal *N,
+		const boost::shared_array<float> &UV,
+		MeshTriangleType tritype, u_int trisCount,
+		const boost::shared_array<int> &tris,
 		MeshQuadType quadtype, u_int nquadsCount, const int *quads,
 		MeshSubdivType subdivType, u_int nsubdivlevels,
 		boost::shared_ptr<Texture<float> > &displacementMap,
@@ -91,6 +146,8 @@ protected:
 	Point *p; // in world space if no subdivision is needed, object space otherwise
 	Normal *n; // in object space
 	float *uvs;
+	// Owner of uvs, may be shared with the ParamSet of the mesh
+	boost::shared_array<float> uvsStorage;
 	Vector *t;
 	bool *btsign; // bitangent sign, true if positive
 
@@ -98,6 +155,9 @@ protected:
 	MeshTriangleType triType;
 	u_int ntris;
 	int *triVertexIndex;
+	// Owner of triVertexIndex, may be shared with the ParamSet of the
+	// mesh until Refine, where triangles reorder the indices in place
+	boost::shared_array<int> triVertexIndexStorage;
 
 	// Dade - quad data
 	MeshQuadType quadType;
@@ -115,6 +175,7 @@ protected:
 	float displacementMapMin, displacementMapMax;
 	bool displacementMapNormalSmooth, displacementMapSharpBoundary;
 	bool normalSplit;
+	boost::scoped_ptr<MicroDisplacementCache> displacementCache;
 
 	// Generate tangent space for mesh
 	bool generateTangents;
@@ -268,6 +329,8 @@ public:
 	const Point &GetP(u_int i) const { return mesh->p[v[i]]; }
 	Point GetDisplacedP(const Point &pbase, const Vector &n, const float u, const float v, const float w) const;
 	Vector GetN(u_int i) const;
+	// Computes all displaced micro vertices and their bound
+	void GetDisplacedGrid(MicroDisplacementCache::Grid *grid) const;
 
 	// BaryTriangle Data
 	const Mesh *mesh;
@@ -275,6 +338,11 @@ public:
 	Vector dpdu, dpdv, normalizedNormal;
 	float uvs[3][2];
 	bool is_Degenerate;
+
+private:
+	// Traverses the micro triangles, if isect is NULL only tests
+	// for occlusion
+	bool IntersectDisplaced(const Ray &ray, Intersection *isect) const;
 };
 
 //------------------------------------------------------------------------------
@@ -223,6 +223,71 @@ Point MeshMicroDisplacementTriangle::GetDisplacedP(const Point &pbase, const Vec
 		return pbase + displacement;
 }
 
+void MeshMicroDisplacementTriangle::GetDisplacedGrid(MicroDisplacementCache::Grid *grid) const
+{
+	const Point &p1 = mesh->p[v[0]];
+	const Point &p2 = mesh->p[v[1]];
+	const Point &p3 = mesh->p[v[2]];
+
+	const Vector n1(GetN(0));
+	const Vector n2(GetN(1));
+	const Vector n3(GetN(2));
+
+	const u_int N = grid->N;
+	const float delta = 1.f / N;
+
+	grid->bound = BBox();
+	u_int index = 0;
+	for (u_int k = 0; k <= N; ++k) {
+		for (u_int j = 0; j <= N - k; ++j, ++index) {
+			const float vc = j * delta;
+			const float wc = k * delta;
+			const float uc = 1.f - vc - wc;
+
+			// point in macrotriangle
+			const Point pc(p1 * uc + p2 * vc + p3 * wc);
+			// interpolated normal
+			const Vector nc(Normalize(n1 * uc + n2 * vc + n3 * wc));
+
+			grid->P[index] = GetDisplacedP(pc, nc, uc, vc, wc);
+			grid->bound = Union(grid->bound, grid->P[index]);
+		}
+	}
+	grid->bound.Expand(MachineEpsilon::E(grid->bound));
+}
+
+MicroDisplacementCache::MicroDisplacementCache(u_int nTriangles,
+	u_int nSubdivLevels, size_t maxSize) : N(nSubdivLevels)
+{
+	const size_t gridSize = sizeof(Grid) +
+		(N + 1) * (N + 2) / 2 * sizeof(Point);
+	slots.resize(max<size_t>(1, min<size_t>(nTriangles, maxSize / gridSize)));
+}
+
+boost::shared_ptr<const MicroDisplacementCache::Grid> MicroDisplacementCache::Get(
+	const MeshMicroDisplacementTriangle &tri, u_int index) const
+{
+	const u_int slotIndex = index % slots.size();
+	Slot &slot(slots[slotIndex]);
+	fast_mutex &lock(locks[slotIndex % LOCK_COUNT]);
+	{
+		fast_mutex::scoped_lock l(lock);
+		if (slot.index == index)
+			return slot.grid;
+	}
+
+	// Evaluate the displacement outside of the lock, if another
+	// thread does the same one of the results is simply dropped
+	Grid *grid = new Grid(N);
+	tri.GetDisplacedGrid(grid);
+	boost::shared_ptr<const Grid> result(grid);
+
+	fast_mutex::scoped_lock l(lock);
+	slot.index = index;
+	slot.grid = result;
+	return result;
+}
+
 static bool intersectPlane(const Ray &ray, const Point &p, const Vector &n, float *t)
 {
 	const float num = Dot(n, ray.d);
@@ -239,6 +304,19 @@ enum LastChange { iplus, jminus, kplus, iminus, jplus, kminus };
 
 bool MeshMicroDisplacementTriangle::Intersect(const Ray &ray, Intersection* isect) const
 {
+	return IntersectDisplaced(ray, isect);
+}
+
+bool MeshMicroDisplacementTriangle::IntersectDisplaced(const Ray &ray, Intersection* isect) const
+{
+	// Fetch the displaced micro vertices and reject rays missing
+	// the actual displaced surface
+	const boost::shared_ptr<const MicroDisplacementCache::Grid> grid(
+		mesh->displacementCache->Get(*this,
+		static_cast<u_int>((v - mesh->triVertexIndex) / 3)));
+	if (!grid->bound.IntersectP(ray))
+		return false;
+
 	// Compute $\VEC{s}_1$
 	// Get triangle vertices in _p1_, _p2_, and _p3_
 	const Point &p1 = mesh->p[v[0]];
@@ -462,19 +540,19 @@ bool MeshMicroDisplacementTriangle::Intersect(const Ray &ray, Intersection* isec
 
 	Point a, b, c; // vertices of generated microtriangle
 	{
-		// point in macrotriangle
-		const Point pa = p1 * ua + p2 * va + p3 * wa;
-		const Point pb = p1 * ub + p2 * vb + p3 * wb;
-		const Point pc = p1 * uc + p2 * vc + p3 * wc;
-
-		a = GetDisplacedP(pa, na, ua, va, wa);
-		b = GetDisplacedP(pb, nb, ub, vb, wb);
-		c = GetDisplacedP(pc, nc, uc, vc, wc);
+		a = grid->GetP(Round2Int(va * N), Round2Int(wa * N));
+		b = grid->GetP(Round2Int(vb * N), Round2Int(wb * N));
+		c = grid->GetP(Round2Int(vc * N), Round2Int(wc * N));
 
 		if (enterSide < 0) {
 			// ray enters through one of the caps, and possibly exits through one side
 			// check entry cell to figure out correct entry side
 
+			// points in macrotriangle, only needed to find the entry side
+			const Point pa = p1 * ua + p2 * va + p3 * wa;
+			const Point pb = p1 * ub + p2 * vb + p3 * wb;
+			const Point pc = p1 * uc + p2 * vc + p3 * wc;
+
 			float tt;
 			float ttmin = 1e30;
 
@@ -582,6 +660,10 @@ bool MeshMicroDisplacementTriangle::Intersect(const Ray &ray, Intersection* isec
 
 		if (intersectTri(ray, a, e1, e2, &b0, &b1, &b2, &t)) {
 			if (t >= ray.mint && t <= ray.maxt) {
+				// occlusion test only, skip the shading data
+				if (!isect)
+					return true;
+
 				// interpolate microtriangle even if it is very small
 				// otherwise selfshadowing will occur
 				const Point pp(a * b0 + b * b1 + c * b2);
@@ -685,12 +767,10 @@ bool MeshMicroDisplacementTriangle::Intersect(const Ray &ray, Intersection* isec
 
 		const float uc = (1.f - vc - wc);
 
-		// point in macrotriangle
-		const Point pc(p1 * uc + p2 * vc + p3 * wc);
 		// interpolated normal
 		nc = Normalize(n1 * uc + n2 * vc + n3 * wc);
 
-		c = GetDisplacedP(pc, nc, uc, vc, wc);
+		c = grid->GetP(Round2Int(vc * N), Round2Int(wc * N));
 	}
 
 	// something went wrong
@@ -699,10 +779,7 @@ bool MeshMicroDisplacementTriangle::Intersect(const Ray &ray, Intersection* isec
 
 bool MeshMicroDisplacementTriangle::IntersectP(const Ray &ray) const
 {
-	// TODO - optimized implementation
-
-	Intersection isect;
-	return Intersect(ray, &isect);
+	return IntersectDisplaced(ray, NULL);
 }
 
 float MeshMicroDisplacementTriangle::Area() const
@@ -320,7 +320,12 @@ Shape* PlyMesh::CreateShape(const Transform &o2w,
 		}
 	}
 
-	const int *triVerts = plyNbTris > 0 ? &faceData.triVerts[0] : NULL;
+	boost::shared_array<int> triVerts;
+	if (plyNbTris > 0) {
+		triVerts.reset(new int[faceData.triVerts.size()]);
+		std::copy(faceData.triVerts.begin(), faceData.triVerts.end(),
+			triVerts.get());
+	}
 	const int *quadVerts = plyNbQuads > 0 ? &faceData.quadVerts[0] : NULL;
 
 	// subdiv and displacement params
@@ -361,14 +366,14 @@ Shape* PlyMesh::CreateShape(const Transform &o2w,
 
 	boost::shared_ptr<Texture<float> > dummytex;
 	Mesh *mesh = new Mesh(o2w, reverseOrientation, name, Mesh::ACCEL_AUTO,
-		plyNbVerts, p, n, uv, Mesh::TRI_AUTO, plyNbTris, triVerts,
+		plyNbVerts, p, n, boost::shared_array<float>(uv),
+		Mesh::TRI_AUTO, plyNbTris, triVerts,
 		Mesh::QUAD_QUADRILATERAL, plyNbQuads, quadVerts, subdivType,
 		nsubdivlevels, displacementMap, displacementMapScale,
 		displacementMapOffset, displacementMapNormalSmooth,
 		displacementMapSharpBoundary, normalSplit, genTangents);
 	delete[] p;
 	delete[] n;
-	delete[] uv;
 	return mesh;
 }
 
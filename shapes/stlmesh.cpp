@@ -236,7 +236,7 @@ Shape* StlMesh::CreateShape(const Transform &o2w,
 	}
 
 	// Filling face indices
-	vector<int> Faces(uNFaces * 3);
+	boost::shared_array<int> Faces(new int[uNFaces * 3]);
 
 	for(uint32_t i = 0 ; i < uNFaces ; i++)
 	{
@@ -248,8 +248,9 @@ Shape* StlMesh::CreateShape(const Transform &o2w,
 	boost::shared_ptr<Texture<float> > displacementMap;
 
 	return new Mesh(o2w, reverseOrientation, name, Mesh::ACCEL_AUTO,
-					Vertices.size(), &Vertices[0], NULL, NULL,
-					Mesh::TRI_AUTO, uNFaces, &Faces[0],
+					Vertices.size(), &Vertices[0], NULL,
+					boost::shared_array<float>(),
+					Mesh::TRI_AUTO, uNFaces, Faces,
 					Mesh::QUAD_QUADRILATERAL, 0, NULL,
 					subdivType, nsubdivlevels, displacementMap, 0.1f, 0.0f, true, false,
 					false, false);
@@ -30,6 +30,7 @@
 #include "context.h"
 #include "spectrum.h"
 #include "texture.h"
+#include "textureprogram.h"
 #include "color.h"
 #include "paramset.h"
 
@@ -93,6 +94,10 @@ public:
 		tex2->SetIlluminant();
 	}
 
+	virtual bool Lower(TextureProgram<T2> &program, u_int *reg) const {
+		return LowerAdd(program, *tex1, *tex2, reg);
+	}
+
 	const Texture<T1> *GetTex1() const { return tex1.get(); }
 	const Texture<T2> *GetTex2() const { return tex2.get(); }
 
@@ -32,6 +32,7 @@
  */
 
 #include <math.h>
+#include <emmintrin.h>
 
 #include "blender_noiselib.h"
 
@@ -212,6 +213,40 @@ static float grad(int hash, float x, float y, float z)
 	return ((h&1) == 0 ? u : -u) + ((h&2) == 0 ? v : -v);
 }
 
+static inline __m128 lerp4(__m128 t, __m128 a, __m128 b)
+{
+	return _mm_add_ps(a, _mm_mul_ps(t, _mm_sub_ps(b, a)));
+}
+
+static inline __m128 npfade4(__m128 t)
+{
+	const __m128 t3 = _mm_mul_ps(_mm_mul_ps(t, t), t);
+	const __m128 p = _mm_sub_ps(_mm_mul_ps(t, _mm_set1_ps(6.f)), _mm_set1_ps(15.f));
+	return _mm_mul_ps(t3, _mm_add_ps(_mm_mul_ps(t, p), _mm_set1_ps(10.f)));
+}
+
+static inline __m128 select4(__m128 mask, __m128 a, __m128 b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+/* 4 wide version of grad(), the sign flips are applied on the sign bit */
+static inline __m128 grad4(const int *hash4, __m128 x, __m128 y, __m128 z)
+{
+	const __m128i h = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(hash4)), _mm_set1_epi32(15));
+	const __m128 lt8 = _mm_castsi128_ps(_mm_cmplt_epi32(h, _mm_set1_epi32(8)));
+	const __m128 lt4 = _mm_castsi128_ps(_mm_cmplt_epi32(h, _mm_set1_epi32(4)));
+	const __m128 is12or14 = _mm_castsi128_ps(_mm_or_si128(
+		_mm_cmpeq_epi32(h, _mm_set1_epi32(12)),
+		_mm_cmpeq_epi32(h, _mm_set1_epi32(14))));
+	const __m128 signBit = _mm_castsi128_ps(_mm_set1_epi32(0x80000000));
+	__m128 u = select4(lt8, x, y);
+	__m128 v = select4(lt4, y, select4(is12or14, x, z));
+	u = _mm_xor_ps(u, _mm_and_ps(_mm_castsi128_ps(_mm_slli_epi32(h, 31)), signBit));
+	v = _mm_xor_ps(v, _mm_and_ps(_mm_castsi128_ps(_mm_slli_epi32(h, 30)), signBit));
+	return _mm_add_ps(u, v);
+}
+
 /* instead of adding another permutation array, just use hash table defined above */
 float newPerlin(float x, float y, float z)
 {
@@ -242,6 +277,46 @@ static float newPerlinU(float x, float y, float z)
 	return (0.5+0.5*newPerlin(x, y, z));
 }
 
+/* 4 wide version of newPerlin(), the hashing is done per point, the
+ * gradients and blending use the same operations in the same order as
+ * newPerlin() so the results are identical */
+static void newPerlin4(const float *px, const float *py, const float *pz, float *out)
+{
+	float fx[4], fy[4], fz[4];
+	int h[8][4];
+	for (int i = 0; i < 4; ++i) {
+		float u=floor(px[i]), v=floor(py[i]), w=floor(pz[i]);
+		int X=((int)u) & 255, Y=((int)v) & 255, Z=((int)w) & 255;
+		fx[i] = px[i] - u;
+		fy[i] = py[i] - v;
+		fz[i] = pz[i] - w;
+		int A = hash[X  ]+Y, AA = hash[A]+Z, AB = hash[A+1]+Z;
+		int B = hash[X+1]+Y, BA = hash[B]+Z, BB = hash[B+1]+Z;
+		h[0][i] = hash[AA  ]; h[1][i] = hash[BA  ];
+		h[2][i] = hash[AB  ]; h[3][i] = hash[BB  ];
+		h[4][i] = hash[AA+1]; h[5][i] = hash[BA+1];
+		h[6][i] = hash[AB+1]; h[7][i] = hash[BB+1];
+	}
+	const __m128 one = _mm_set1_ps(1.f);
+	const __m128 x = _mm_loadu_ps(fx), y = _mm_loadu_ps(fy), z = _mm_loadu_ps(fz);
+	const __m128 x1 = _mm_sub_ps(x, one), y1 = _mm_sub_ps(y, one), z1 = _mm_sub_ps(z, one);
+	const __m128 u = npfade4(x), v = npfade4(y), w = npfade4(z);
+	const __m128 g0 = grad4(h[0], x , y , z ), g1 = grad4(h[1], x1, y , z );
+	const __m128 g2 = grad4(h[2], x , y1, z ), g3 = grad4(h[3], x1, y1, z );
+	const __m128 g4 = grad4(h[4], x , y , z1), g5 = grad4(h[5], x1, y , z1);
+	const __m128 g6 = grad4(h[6], x , y1, z1), g7 = grad4(h[7], x1, y1, z1);
+	_mm_storeu_ps(out, lerp4(w, lerp4(v, lerp4(u, g0, g1), lerp4(u, g2, g3)),
+		lerp4(v, lerp4(u, g4, g5), lerp4(u, g6, g7))));
+}
+
+/* 4 wide version of newPerlinU() */
+static void newPerlinU4(const float *px, const float *py, const float *pz, float *out)
+{
+	newPerlin4(px, py, pz, out);
+	for (int i = 0; i < 4; ++i)
+		out[i] = (0.5+0.5*out[i]);
+}
+
 
 /**************************/
 /* END OF IMPROVED PERLIN */
@@ -323,6 +398,91 @@ static float orgBlenderNoiseS(float x, float y, float z)
 	return (2.0*orgBlenderNoise(x, y, z)-1.0);
 }
 
+/* The orgBlenderNoise() weights, computed in double precision as the
+ * scalar version does, cn = 1.0-3.0*c+/-2.0*c*o with c=o*o */
+static inline __m128 orgBlenderWeight4(__m128 o, bool negate)
+{
+	const __m128 c = _mm_mul_ps(o, o);
+	const __m128d one = _mm_set1_pd(1.0), three = _mm_set1_pd(3.0), two = _mm_set1_pd(2.0);
+	__m128d r[2];
+	for (int i = 0; i < 2; ++i) {
+		const __m128 cs = i == 0 ? c : _mm_movehl_ps(c, c);
+		const __m128 os = i == 0 ? o : _mm_movehl_ps(o, o);
+		const __m128d cd = _mm_cvtps_pd(cs), od = _mm_cvtps_pd(os);
+		const __m128d a = _mm_sub_pd(one, _mm_mul_pd(three, cd));
+		const __m128d b = _mm_mul_pd(_mm_mul_pd(two, cd), od);
+		r[i] = negate ? _mm_sub_pd(a, b) : _mm_add_pd(a, b);
+	}
+	return _mm_movelh_ps(_mm_cvtpd_ps(r[0]), _mm_cvtpd_ps(r[1]));
+}
+
+/* 4 wide version of orgBlenderNoise(), same operations in the same order */
+static void orgBlenderNoise4(const float *px, const float *py, const float *pz, float *out)
+{
+	int ix[4], iy[4], iz[4];
+	float h[8][3][4];
+	for (int i = 0; i < 4; ++i) {
+		ix[i] = (int)floor(px[i]);
+		iy[i] = (int)floor(py[i]);
+		iz[i] = (int)floor(pz[i]);
+
+		const int b00= hash[ hash[ix[i] & 255]+(iy[i] & 255)];
+		const int b10= hash[ hash[(ix[i]+1) & 255]+(iy[i] & 255)];
+		const int b01= hash[ hash[ix[i] & 255]+((iy[i]+1) & 255)];
+		const int b11= hash[ hash[(ix[i]+1) & 255]+((iy[i]+1) & 255)];
+		const int b20=iz[i] & 255, b21= (iz[i]+1) & 255;
+		const int corner[8] = { b20+b00, b21+b00, b20+b01, b21+b01,
+			b20+b10, b21+b10, b20+b11, b21+b11 };
+		for (int c = 0; c < 8; ++c) {
+			const float *hv = hashvectf+ 3*hash[corner[c]];
+			h[c][0][i] = hv[0];
+			h[c][1][i] = hv[1];
+			h[c][2][i] = hv[2];
+		}
+	}
+	const __m128 one = _mm_set1_ps(1.f);
+	const __m128 ox = _mm_sub_ps(_mm_loadu_ps(px), _mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(ix))));
+	const __m128 oy = _mm_sub_ps(_mm_loadu_ps(py), _mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(iy))));
+	const __m128 oz = _mm_sub_ps(_mm_loadu_ps(pz), _mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(iz))));
+	const __m128 jx = _mm_sub_ps(ox, one), jy = _mm_sub_ps(oy, one), jz = _mm_sub_ps(oz, one);
+	const __m128 cn1 = orgBlenderWeight4(ox, false);
+	const __m128 cn2 = orgBlenderWeight4(oy, false);
+	const __m128 cn3 = orgBlenderWeight4(oz, false);
+	const __m128 cn4 = orgBlenderWeight4(jx, true);
+	const __m128 cn5 = orgBlenderWeight4(jy, true);
+	const __m128 cn6 = orgBlenderWeight4(jz, true);
+
+	/* corner order and weights as in orgBlenderNoise() */
+	const __m128 wx[8] = { cn1, cn1, cn1, cn1, cn4, cn4, cn4, cn4 };
+	const __m128 wy[8] = { cn2, cn2, cn5, cn5, cn2, cn2, cn5, cn5 };
+	const __m128 wz[8] = { cn3, cn6, cn3, cn6, cn3, cn6, cn3, cn6 };
+	const __m128 dx[8] = { ox, ox, ox, ox, jx, jx, jx, jx };
+	const __m128 dy[8] = { oy, oy, jy, jy, oy, oy, jy, jy };
+	const __m128 dz[8] = { oz, jz, oz, jz, oz, jz, oz, jz };
+	__m128 n = _mm_set1_ps(0.5f);
+	for (int c = 0; c < 8; ++c) {
+		const __m128 i = _mm_mul_ps(_mm_mul_ps(wx[c], wy[c]), wz[c]);
+		const __m128 d = _mm_add_ps(_mm_add_ps(
+			_mm_mul_ps(_mm_loadu_ps(h[c][0]), dx[c]),
+			_mm_mul_ps(_mm_loadu_ps(h[c][1]), dy[c])),
+			_mm_mul_ps(_mm_loadu_ps(h[c][2]), dz[c]));
+		n = _mm_add_ps(n, _mm_mul_ps(i, d));
+	}
+
+	/* if(n<0.0) n=0.0; else if(n>1.0) n=1.0; */
+	n = _mm_andnot_ps(_mm_cmplt_ps(n, _mm_setzero_ps()), n);
+	n = select4(_mm_cmpgt_ps(n, one), one, n);
+	_mm_storeu_ps(out, n);
+}
+
+/* 4 wide version of orgBlenderNoiseS() */
+static void orgBlenderNoiseS4(const float *px, const float *py, const float *pz, float *out)
+{
+	orgBlenderNoise4(px, py, pz, out);
+	for (int i = 0; i < 4; ++i)
+		out[i] = (2.0*out[i]-1.0);
+}
+
 /* separated from orgBlenderNoise above, with scaling */
 float BLI_hnoise(float noisesize, float x, float y, float z)
 {
@@ -1288,6 +1448,57 @@ void cellNoiseV(float x, float y, float z, float *ca)
 /* end cellnoise */
 /*****************/
 
+/* 4 wide noise basis, NULL when the basis only has a scalar version */
+typedef void (*NoiseFunc4)(const float *, const float *, const float *, float *);
+
+/* Evaluates a noise basis at successive octaves, the coordinates being
+ * multiplied by lacunarity after each octave exactly as in the scalar
+ * loops, 4 octaves at a time when the basis has a 4 wide version.
+ * Lanes past the last of the at most "octaves" octaves requested are fed
+ * 0 coordinates, scaling further could overflow the integer lattice
+ * conversions of the 4 wide kernels */
+class OctaveNoise
+{
+public:
+	OctaveNoise(float (*f)(float, float, float), NoiseFunc4 f4,
+		float x, float y, float z, float lacunarity, int octaves) :
+		noisefunc(f), noisefunc4(f4), px(x), py(y), pz(z), lacu(lacunarity),
+		remaining(octaves), current(0), count(0) { }
+
+	float Next()
+	{
+		if (current == count) {
+			count = noisefunc4 ? 4 : 1;
+			const int active = remaining < 1 ? 1 :
+				(remaining < count ? remaining : count);
+			for (int i = 0; i < active; ++i) {
+				x[i] = px;
+				y[i] = py;
+				z[i] = pz;
+				px *= lacu;
+				py *= lacu;
+				pz *= lacu;
+			}
+			for (int i = active; i < count; ++i)
+				x[i] = y[i] = z[i] = 0.f;
+			remaining -= active;
+			if (noisefunc4)
+				noisefunc4(x, y, z, values);
+			else
+				values[0] = noisefunc(x[0], y[0], z[0]);
+			current = 0;
+		}
+		return values[current++];
+	}
+
+private:
+	float (*noisefunc)(float, float, float);
+	NoiseFunc4 noisefunc4;
+	float px, py, pz, lacu;
+	float x[4], y[4], z[4], values[4];
+	int remaining, current, count;
+};
+
 /* newnoise: generic noise function for use with different noisebases */
 float BLI_gNoise(float noisesize, float x, float y, float z, int hard, int noisebasis)
 {
@@ -1346,7 +1557,8 @@ float BLI_gNoise(float noisesize, float x, float y, float z, int hard, int noise
 float BLI_gTurbulence(float noisesize, float x, float y, float z, int oct, int hard, int noisebasis)
 {
 	float (*noisefunc)(float, float, float);
-	float sum, t, amp=1, fscale=1;
+	NoiseFunc4 noisefunc4 = NULL;
+	float sum, t, amp=1;
 	int i;
 	
 	switch (noisebasis) {
@@ -1355,6 +1567,7 @@ float BLI_gTurbulence(float noisesize, float x, float y, float z, int oct, int h
 			break;
 		case 2:
 			noisefunc = newPerlinU;
+			noisefunc4 = newPerlinU4;
 			break;
 		case 3:
 			noisefunc = voronoi_F1;
@@ -1380,6 +1593,7 @@ float BLI_gTurbulence(float noisesize, float x, float y, float z, int oct, int h
 		case 0:
 		default:
 			noisefunc = orgBlenderNoise;
+			noisefunc4 = orgBlenderNoise4;
 			x += 1;
 			y += 1;
 			z += 1;
@@ -1393,8 +1607,10 @@ float BLI_gTurbulence(float noisesize, float x, float y, float z, int oct, int h
 	}
 
 	sum = 0;
-	for (i=0;i<=oct;i++, amp*=0.5, fscale*=2) {
-		t = noisefunc(fscale*x, fscale*y, fscale*z);
+	/* scaling by 2 is exact, same coordinates as fscale*x */
+	OctaveNoise octave(noisefunc, noisefunc4, x, y, z, 2.f, oct + 1);
+	for (i=0;i<=oct;i++, amp*=0.5) {
+		t = octave.Next();
 		if (hard) t = fabs(2.0*t-1.0);
 		sum += t * amp;
 	}
@@ -1425,12 +1641,14 @@ float mg_fBm(float x, float y, float z, float H, float lacunarity, float octaves
 	int	i;
 
 	float (*noisefunc)(float, float, float);
+	NoiseFunc4 noisefunc4 = NULL;
 	switch (noisebasis) {
 		case 1:
 			noisefunc = orgPerlinNoise;
 			break;
 		case 2:
 			noisefunc = newPerlin;
+			noisefunc4 = newPerlin4;
 			break;
 		case 3:
 			noisefunc = voronoi_F1S;
@@ -1456,19 +1674,19 @@ float mg_fBm(float x, float y, float z, float H, float lacunarity, float octaves
 		case 0:
 		default: {
 			noisefunc = orgBlenderNoiseS;
+			noisefunc4 = orgBlenderNoiseS4;
 		}
 	}
 	
+	OctaveNoise octave(noisefunc, noisefunc4, x, y, z, lacunarity,
+		(int)ceil(octaves));
 	for (i=0; i<(int)octaves; i++) {
-		value += noisefunc(x, y, z) * pwr;
+		value += octave.Next() * pwr;
 		pwr *= pwHL;
-		x *= lacunarity;
-		y *= lacunarity;
-		z *= lacunarity;
 	}
 
 	rmd = octaves - floor(octaves);
-	if (rmd!=0.f) value += rmd * noisefunc(x, y, z) * pwr;
+	if (rmd!=0.f) value += rmd * octave.Next() * pwr;
 
 	return value;
 
@@ -1494,12 +1712,14 @@ float mg_MultiFractal(float x, float y, float z, float H, float lacunarity, floa
 	int i;
 	
 	float (*noisefunc)(float, float, float);
+	NoiseFunc4 noisefunc4 = NULL;
 	switch (noisebasis) {
 		case 1:
 			noisefunc = orgPerlinNoise;
 			break;
 		case 2:
 			noisefunc = newPerlin;
+			noisefunc4 = newPerlin4;
 			break;
 		case 3:
 			noisefunc = voronoi_F1S;
@@ -1525,18 +1745,18 @@ float mg_MultiFractal(float x, float y, float z, float H, float lacunarity, floa
 		case 0:
 		default: {
 			noisefunc = orgBlenderNoiseS;
+			noisefunc4 = orgBlenderNoiseS4;
 		}
 	}
 
+	OctaveNoise octave(noisefunc, noisefunc4, x, y, z, lacunarity,
+		(int)ceil(octaves));
 	for (i=0; i<(int)octaves; i++) {
-		value *= (pwr * noisefunc(x, y, z) + 1.0);
+		value *= (pwr * octave.Next() + 1.0);
 		pwr *= pwHL;
-		x *= lacunarity;
-		y *= lacunarity;
-		z *= lacunarity;
 	}
 	rmd = octaves - floor(octaves);
-	if (rmd!=0.0) value *= (rmd * noisefunc(x, y, z) * pwr + 1.0);
+	if (rmd!=0.0) value *= (rmd * octave.Next() * pwr + 1.0);
 
 	return value;
 
@@ -1560,12 +1780,14 @@ float mg_HeteroTerrain(float x, float y, float z, float H, float lacunarity, flo
 	float pwr = pwHL;	/* starts with i=1 instead of 0 */
 
 	float (*noisefunc)(float, float, float);
+	NoiseFunc4 noisefunc4 = NULL;
 	switch (noisebasis) {
 		case 1:
 			noisefunc = orgPerlinNoise;
 			break;
 		case 2:
 			noisefunc = newPerlin;
+			noisefunc4 = newPerlin4;
 			break;
 		case 3:
 			noisefunc = voronoi_F1S;
@@ -1591,27 +1813,24 @@ float mg_HeteroTerrain(float x, float y, float z, float H, float lacunarity, flo
 		case 0:
 		default: {
 			noisefunc = orgBlenderNoiseS;
+			noisefunc4 = orgBlenderNoiseS4;
 		}
 	}
 
 	/* first unscaled octave of function; later octaves are scaled */
-	value = offset + noisefunc(x, y, z);
-	x *= lacunarity;
-	y *= lacunarity;
-	z *= lacunarity;
+	OctaveNoise octave(noisefunc, noisefunc4, x, y, z, lacunarity,
+		(int)ceil(octaves));
+	value = offset + octave.Next();
 
 	for (i=1; i<(int)octaves; i++) {
-		increment = (noisefunc(x, y, z) + offset) * pwr * value;
+		increment = (octave.Next() + offset) * pwr * value;
 		value += increment;
 		pwr *= pwHL;
-		x *= lacunarity;
-		y *= lacunarity;
-		z *= lacunarity;
 	}
 
 	rmd = octaves - floor(octaves);
 	if (rmd!=0.0) {
-		increment = (noisefunc(x, y, z) + offset) * pwr * value;
+		increment = (octave.Next() + offset) * pwr * value;
 		value += rmd * increment;
 	}
 	return value;
@@ -1632,6 +1851,7 @@ float mg_HybridMultiFractal(float x, float y, float z, float H, float lacunarity
 	float pwHL = pow(lacunarity, -H);
 	float pwr = pwHL;	/* starts with i=1 instead of 0 */
 	float (*noisefunc)(float, float, float);
+	NoiseFunc4 noisefunc4 = NULL;
 
 	switch (noisebasis) {
 		case 1:
@@ -1639,6 +1859,7 @@ float mg_HybridMultiFractal(float x, float y, float z, float H, float lacunarity
 			break;
 		case 2:
 			noisefunc = newPerlin;
+			noisefunc4 = newPerlin4;
 			break;
 		case 3:
 			noisefunc = voronoi_F1S;
@@ -1664,28 +1885,25 @@ float mg_HybridMultiFractal(float x, float y, float z, float H, float lacunarity
 		case 0:
 		default: {
 			noisefunc = orgBlenderNoiseS;
+			noisefunc4 = orgBlenderNoiseS4;
 		}
 	}
 
-	result = noisefunc(x, y, z) + offset;
+	OctaveNoise octave(noisefunc, noisefunc4, x, y, z, lacunarity,
+		(int)ceil(octaves));
+	result = octave.Next() + offset;
 	weight = gain * result;
-	x *= lacunarity;
-	y *= lacunarity;
-	z *= lacunarity;
 
 	for (i=1; (weight>0.001) && (i<(int)octaves); i++) {
 		if (weight>1.0)  weight=1.0;
-		signal = (noisefunc(x, y, z) + offset) * pwr;
+		signal = (octave.Next() + offset) * pwr;
 		pwr *= pwHL;
 		result += weight * signal;
 		weight *= gain * signal;
-		x *= lacunarity;
-		y *= lacunarity;
-		z *= lacunarity;
 	}
 
 	rmd = octaves - floor(octaves);
-	if (rmd!=0.f) result += rmd * ((noisefunc(x, y, z) + offset) * pwr);
+	if (rmd!=0.f) result += rmd * ((octave.Next() + offset) * pwr);
 
 	return result;
 
@@ -1708,12 +1926,14 @@ float mg_RidgedMultiFractal(float x, float y, float z, float H, float lacunarity
 	float pwr = pwHL;	/* starts with i=1 instead of 0 */
 	
 	float (*noisefunc)(float, float, float);
+	NoiseFunc4 noisefunc4 = NULL;
 	switch (noisebasis) {
 		case 1:
 			noisefunc = orgPerlinNoise;
 			break;
 		case 2:
 			noisefunc = newPerlin;
+			noisefunc4 = newPerlin4;
 			break;
 		case 3:
 			noisefunc = voronoi_F1S;
@@ -1739,21 +1959,21 @@ float mg_RidgedMultiFractal(float x, float y, float z, float H, float lacunarity
 		case 0:
 		default: {
 			noisefunc = orgBlenderNoiseS;
+			noisefunc4 = orgBlenderNoiseS4;
 		}
 	}
 
-	signal = offset - fabs(noisefunc(x, y, z));
+	OctaveNoise octave(noisefunc, noisefunc4, x, y, z, lacunarity,
+		(int)octaves);
+	signal = offset - fabs(octave.Next());
 	signal *= signal;
 	result = signal;
 	weight = 1.f;
 
 	for( i=1; i<(int)octaves; i++ ) {
-		x *= lacunarity;
-		y *= lacunarity;
-		z *= lacunarity;
 		weight = signal * gain;
 		if (weight>1.0) weight=1.0; else if (weight<0.0) weight=0.0;
-		signal = offset - fabs(noisefunc(x, y, z));
+		signal = offset - fabs(octave.Next());
 		signal *= signal;
 		signal *= weight;
 		result += signal * pwr;
@@ -1768,8 +1988,9 @@ float mg_RidgedMultiFractal(float x, float y, float z, float H, float lacunarity
  */
 float mg_VLNoise(float x, float y, float z, float distortion, int nbas1, int nbas2)
 {
-	float rv[3];
+	float rv[4];
 	float (*noisefunc1)(float, float, float);
+	NoiseFunc4 noisefunc1_4 = NULL;
 	float (*noisefunc2)(float, float, float);
 
 	switch (nbas1) {
@@ -1778,6 +1999,7 @@ float mg_VLNoise(float x, float y, float z, float distortion, int nbas1, int nba
 			break;
 		case 2:
 			noisefunc1 = newPerlin;
+			noisefunc1_4 = newPerlin4;
 			break;
 		case 3:
 			noisefunc1 = voronoi_F1S;
@@ -1803,6 +2025,7 @@ float mg_VLNoise(float x, float y, float z, float distortion, int nbas1, int nba
 		case 0:
 		default: {
 			noisefunc1 = orgBlenderNoiseS;
+			noisefunc1_4 = orgBlenderNoiseS4;
 		}
 	}
 
@@ -1841,9 +2064,19 @@ float mg_VLNoise(float x, float y, float z, float distortion, int nbas1, int nba
 	}
 
 	/* get a random vector and scale the randomization */
-	rv[0] = noisefunc1(x+13.5, y+13.5, z+13.5) * distortion;
-	rv[1] = noisefunc1(x, y, z) * distortion;
-	rv[2] = noisefunc1(x-13.5, y-13.5, z-13.5) * distortion;
+	if (noisefunc1_4) {
+		const float px[4] = { x+13.5, x, x-13.5, x };
+		const float py[4] = { y+13.5, y, y-13.5, y };
+		const float pz[4] = { z+13.5, z, z-13.5, z };
+		noisefunc1_4(px, py, pz, rv);
+		rv[0] *= distortion;
+		rv[1] *= distortion;
+		rv[2] *= distortion;
+	} else {
+		rv[0] = noisefunc1(x+13.5, y+13.5, z+13.5) * distortion;
+		rv[1] = noisefunc1(x, y, z) * distortion;
+		rv[2] = noisefunc1(x-13.5, y-13.5, z-13.5) * distortion;
+	}
 	return noisefunc2(x+rv[0], y+rv[1], z+rv[2]);	/* distorted-domain noise */
 }
 
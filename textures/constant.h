@@ -23,6 +23,7 @@
 // constant.cpp*
 #include "lux.h"
 #include "texture.h"
+#include "textureprogram.h"
 #include "rgbrefl.h"
 #include "rgbillum.h"
 #include "fresnelgeneral.h"
@@ -52,6 +53,10 @@ public:
 		*minValue = value;
 		*maxValue = value;
 	}
+	virtual bool Lower(TextureProgram<float> &program, u_int *reg) const {
+		*reg = program.Constant(value);
+		return true;
+	}
 private:
 	float value;
 };
@@ -24,6 +24,7 @@
 #include "lux.h"
 #include "spectrum.h"
 #include "texture.h"
+#include "textureprogram.h"
 #include "color.h"
 #include "fresnelgeneral.h"
 #include "paramset.h"
@@ -79,6 +80,9 @@ public:
 		tex1->SetIlluminant();
 		tex2->SetIlluminant();
 	}
+	virtual bool Lower(TextureProgram<T> &program, u_int *reg) const {
+		return LowerMix(program, *tex1, *tex2, *amount, reg);
+	}
 
 	const Texture<float> *GetAmountTex() const { return amount.get(); }
 	const Texture<T> *GetTex1() const { return tex1.get(); }
@@ -24,6 +24,7 @@
 #include "lux.h"
 #include "spectrum.h"
 #include "texture.h"
+#include "textureprogram.h"
 #include "color.h"
 #include "fresnelgeneral.h"
 #include "paramset.h"
@@ -111,6 +112,10 @@ public:
 		for (u_int i = 0; i < tex.size(); ++i)
 			tex[i]->SetIlluminant();
 	}
+	virtual bool Lower(TextureProgram<T> &program, u_int *reg) const
+	{
+		return LowerMultiMix(program, weights, tex, reg);
+	}
 	static Texture<float> * CreateFloatTexture(const Transform &tex2world, const ParamSet &tp);
 	static Texture<SWCSpectrum> * CreateSWCSpectrumTexture(const Transform &tex2world, const ParamSet &tp);
 	static Texture<FresnelGeneral> * CreateFresnelTexture(const Transform &tex2world, const ParamSet &tp);
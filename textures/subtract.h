@@ -29,6 +29,7 @@
 #include "context.h"
 #include "spectrum.h"
 #include "texture.h"
+#include "textureprogram.h"
 #include "color.h"
 #include "paramset.h"
 
@@ -91,6 +92,10 @@ public:
 		tex1->SetIlluminant();
 		tex2->SetIlluminant();
 	}
+
+	virtual bool Lower(TextureProgram<T2> &program, u_int *reg) const {
+		return LowerSubtract(program, *tex1, *tex2, reg);
+	}
 	
 	static Texture<float> * CreateFloatTexture(const Transform &tex2world, const ParamSet &tp);
 	
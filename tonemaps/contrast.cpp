@@ -28,7 +28,8 @@
 using namespace lux;
 
 // ContrastOp Method Definitions
-void ContrastOp::Map(vector<XYZColor> &xyz, u_int xRes, u_int yRes,	float maxDisplayY) const 
+ToneMapScale ContrastOp::GetScale(const vector<XYZColor> &xyz, u_int xRes,
+	u_int yRes, float maxDisplayY) const
 {
 	// Compute world adaptation luminance, _Ywa_
 	float Ywa = 0.f;
@@ -43,8 +44,7 @@ void ContrastOp::Map(vector<XYZColor> &xyz, u_int xRes, u_int yRes,	float maxDis
 	// Compute contrast-preserving scalefactor, _s_
 	float s = powf((1.219f + powf(displayAdaptationY, 0.4f)) /
 		(1.219f + powf(Ywa, 0.4f)), 2.5f) / maxDisplayY;
-	for (u_int i = 0; i < xRes*yRes; ++i)
-		xyz[i] *= s;
+	return ToneMapScale(s);
 }
 ToneMap * ContrastOp::CreateToneMap(const ParamSet &ps) {
 	float day = ps.FindOneFloat("ywa", 50.f);
@@ -28,7 +28,8 @@
 using namespace lux;
 
 // EVOp Method Definitions
-void EVOp::Map(vector<XYZColor> &xyz, u_int xRes, u_int yRes, float maxDisplayY) const 
+ToneMapScale EVOp::GetScale(const vector<XYZColor> &xyz, u_int xRes,
+	u_int yRes, float maxDisplayY) const
 {
 	// read data from film
 	const float gamma = luxGetParameterValue(LUX_FILM, LUX_FILM_TORGB_GAMMA);
@@ -46,7 +47,7 @@ void EVOp::Map(vector<XYZColor> &xyz, u_int xRes, u_int yRes, float maxDisplayY)
 	Y = Y / max(1U, nPixels);
 
 	if (Y <= 0.f)
-		return;
+		return ToneMapScale();
 
 	/*
 	(fstop * fstop) / exposure = Y*sensitivity/K
@@ -65,19 +66,17 @@ void EVOp::Map(vector<XYZColor> &xyz, u_int xRes, u_int yRes, float maxDisplayY)
 	// substitute exposure, fstop and sensitivity cancel out; collect constants
 	const float factor = (1.25f / Y * powf(118.f / 255.f, gamma));
 
-	for (u_int i = 0; i < numPixels; ++i)
-		xyz[i] *= factor;
+	return ToneMapScale(factor);
 }
 ToneMap * EVOp::CreateToneMap(const ParamSet &ps) {
 	return new EVOp();
 }
 
 // LinearOp Method Definitions
-void LinearOp::Map(vector<XYZColor> &xyz, u_int xRes, u_int yRes, float maxDisplayY) const
+ToneMapScale LinearOp::GetScale(const vector<XYZColor> &xyz, u_int xRes,
+	u_int yRes, float maxDisplayY) const
 {
-	const u_int numPixels = xRes * yRes;
-	for (u_int i = 0; i < numPixels; ++i)
-		xyz[i] *= factor;
+	return ToneMapScale(factor);
 }
 ToneMap * LinearOp::CreateToneMap(const ParamSet &ps) {
 	float sensitivity = ps.FindOneFloat("sensitivity", 100.f);
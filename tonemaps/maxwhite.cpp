@@ -27,7 +27,8 @@
 using namespace lux;
 
 // MaxWhiteOp Method Definitions
-void MaxWhiteOp::Map(vector<XYZColor> &xyz, u_int xRes, u_int yRes, float maxDisplayY) const 
+ToneMapScale MaxWhiteOp::GetScale(const vector<XYZColor> &xyz, u_int xRes,
+	u_int yRes, float maxDisplayY) const
 {
 	const u_int numPixels = xRes * yRes;
 	// Compute maximum luminance of all pixels
@@ -35,9 +36,7 @@ void MaxWhiteOp::Map(vector<XYZColor> &xyz, u_int xRes, u_int yRes, float maxDis
 	for (u_int i = 0; i < numPixels; ++i) {
 		maxY = max(maxY, xyz[i].Y());
 	}
-	const float s = 1.f / maxY;
-	for (u_int i = 0; i < numPixels; ++i)
-		xyz[i] *= s;
+	return ToneMapScale(1.f / maxY);
 }
 ToneMap * MaxWhiteOp::CreateToneMap(const ParamSet &ps) {
 	return new MaxWhiteOp;
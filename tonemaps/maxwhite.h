@@ -33,7 +33,8 @@ class MaxWhiteOp : public ToneMap {
 public:
 	// MaxWhiteOp Public Methods
 	virtual ~MaxWhiteOp() { }
-	virtual void Map(vector<XYZColor> &xyz, u_int xRes, u_int yRes, float maxDisplayY) const;
+	virtual ToneMapScale GetScale(const vector<XYZColor> &xyz, u_int xRes,
+		u_int yRes, float maxDisplayY) const;
 	
 	static ToneMap *CreateToneMap(const ParamSet &ps);
 };
@@ -27,9 +27,9 @@
 using namespace lux;
 
 // NonLinearOp Method Definitions
-void NonLinearOp::Map(vector<XYZColor> &xyz, u_int xRes, u_int yRes, float maxDisplayY) const 
+ToneMapScale NonLinearOp::GetScale(const vector<XYZColor> &xyz, u_int xRes,
+	u_int yRes, float maxDisplayY) const
 {
-	const u_int numPixels = xRes * yRes;
 	float invY2;
 	if (maxY <= 0.f) {
 		// Compute world adaptation luminance, _Ywa_
@@ -45,10 +45,7 @@ void NonLinearOp::Map(vector<XYZColor> &xyz, u_int xRes, u_int yRes, float maxDi
 		invY2 = 1.f / (Ywa * Ywa);
 	} else
 		invY2 = 1.f / (maxY * maxY);
-	for (u_int i = 0; i < numPixels; ++i) {
-		const float ys = xyz[i].c[1];
-		xyz[i] *= (1.f + ys * invY2) / (1.f + ys);
-	}
+	return ToneMapScale(1.f, invY2);
 }
 ToneMap* NonLinearOp::CreateToneMap(const ParamSet &ps) {
 	float maxy = ps.FindOneFloat("maxY", 0.f);
@@ -34,7 +34,8 @@ public:
 	// NonLinearOp Public Methods
 	NonLinearOp(float my) { maxY = my; }
 	virtual ~NonLinearOp() { }
-	virtual void Map(vector<XYZColor> &xyz, u_int xRes, u_int yRes, float maxDisplayY) const;
+	virtual ToneMapScale GetScale(const vector<XYZColor> &xyz, u_int xRes,
+		u_int yRes, float maxDisplayY) const;
 	
 	static ToneMap *CreateToneMap(const ParamSet &ps);
 private:
@@ -41,10 +41,10 @@ ReinhardOp::ReinhardOp(float prS, float poS, float b)
 
 // This is the implementation of equation (4) of this paper: http://www.cs.utah.edu/~reinhard/cdrom/tonemap.pdf
 // TODO implement the local operator of equation (9) with reasonable speed
-void ReinhardOp::Map(vector<XYZColor> &xyz,	u_int xRes, u_int yRes, float maxDisplayY) const
+ToneMapScale ReinhardOp::GetScale(const vector<XYZColor> &xyz, u_int xRes,
+	u_int yRes, float maxDisplayY) const
 {
 	const float a = .1f; // alpha parameter
-	const u_int numPixels = xRes * yRes;
 
 	float Ywa = 0.f;
 	// Compute world adaptation luminance, _Ywa_
@@ -61,10 +61,7 @@ void ReinhardOp::Map(vector<XYZColor> &xyz,	u_int xRes, u_int yRes, float maxDis
 	const float invY2 = Yw > 0.f ? 1.f / (Yw * Yw) : 1e5f;
 	const float pScale = post_scale * pre_scale * a / Ywa;
 
-	for (u_int i = 0; i < numPixels; ++i) {
-		const float ys = xyz[i].c[1];
-		xyz[i] *= pScale * (1.f + ys * invY2) / (1.f + ys);
-	}
+	return ToneMapScale(pScale, invY2);
 }
 
 ToneMap * ReinhardOp::CreateToneMap(const ParamSet &ps) {
@@ -31,7 +31,8 @@ class ReinhardOp : public ToneMap {
 public:
 	ReinhardOp(float prS, float poS, float b);
 	virtual ~ReinhardOp() { }
-	virtual void Map(vector<XYZColor> &xyz, u_int xRes, u_int yRes, float maxDisplayY) const;
+	virtual ToneMapScale GetScale(const vector<XYZColor> &xyz, u_int xRes,
+		u_int yRes, float maxDisplayY) const;
 	static ToneMap *CreateToneMap(const ParamSet &ps);
 	
 private:
@@ -0,0 +1,962 @@
+/***************************************************************************
+ *   Copyright (C) 1998-2013 by authors (see AUTHORS.txt)                  *
+ *                                                                         *
+ *   This file is part of LuxRender.                                       *
+ *                                                                         *
+ *   Lux Renderer is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 3 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   Lux Renderer is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ *                                                                         *
+ *   This project is based on PBRT ; see http://www.pbrt.org               *
+ *   Lux Renderer website : http://www.luxrender.net                       *
+ ***************************************************************************/
+
+
+#define NDEBUG 1
+
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <sstream>
+#include <exception>
+#include <iostream>
+#include <set>
+
+#include "api.h"
+#include "dynload.h"
+#include "paramset.h"
+#include "primitive.h"
+#include "shape.h"
+#include "film.h"
+#include "contribution.h"
+#include "randomgen.h"
+#include "mc.h"
+#include "spectrumwavelengths.h"
+#include "textureprogram.h"
+#include "textures/constant.h"
+#include "textures/scale.h"
+#include "textures/mix.h"
+#include "osfunc.h"
+
+#include <boost/program_options.hpp>
+#include <boost/thread.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/bind.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+
+using namespace lux;
+namespace po = boost::program_options;
+
+// One measurement, written as a JSON object or a CSV row
+struct BenchResult {
+	BenchResult(const string &s, const string &n, const string &m,
+		double v, const string &u) :
+		suite(s), name(n), metric(m), value(v), unit(u) { }
+
+	string suite, name, metric;
+	double value;
+	string unit;
+};
+
+static vector<BenchResult> results;
+
+static void Report(const string &suite, const string &name,
+	const string &metric, double value, const string &unit)
+{
+	LOG(LUX_INFO, LUX_NOERROR) << suite << " " << name << " " << metric <<
+		": " << value << " " << unit;
+	results.push_back(BenchResult(suite, name, metric, value, unit));
+}
+
+static vector<string> SplitList(const string &list)
+{
+	vector<string> items;
+	std::stringstream ss(list);
+	string item;
+	while (std::getline(ss, item, ','))
+		if (!item.empty())
+			items.push_back(item);
+	return items;
+}
+
+static string JSONString(const string &s)
+{
+	string escaped("\"");
+	for (u_int i = 0; i < s.size(); ++i) {
+		if (s[i] == '"' || s[i] == '\\')
+			escaped += '\\';
+		escaped += s[i];
+	}
+	return escaped + "\"";
+}
+
+static void WriteResults(std::ostream &os, const string &format,
+	u_int threadCount)
+{
+	os << std::setprecision(9);
+	if (format == "csv") {
+		os << "suite,name,metric,value,unit\n";
+		for (u_int i = 0; i < results.size(); ++i) {
+			const BenchResult &r(results[i]);
+			os << r.suite << "," << r.name << "," << r.metric << "," <<
+				r.value << "," << r.unit << "\n";
+		}
+		return;
+	}
+	os << "{\n";
+	os << "  \"version\": " << JSONString(luxVersion()) << ",\n";
+	os << "  \"threads\": " << threadCount << ",\n";
+	os << "  \"results\": [";
+	for (u_int i = 0; i < results.size(); ++i) {
+		const BenchResult &r(results[i]);
+		os << (i ? ",\n" : "\n") << "    {\"suite\": " <<
+			JSONString(r.suite) << ", \"name\": " << JSONString(r.name) <<
+			", \"metric\": " << JSONString(r.metric) << ", \"value\": " <<
+			r.value << ", \"unit\": " << JSONString(r.unit) << "}";
+	}
+	os << "\n  ]\n}\n";
+}
+
+//------------------------------------------------------------------------------
+// Synthetic geometry
+//------------------------------------------------------------------------------
+
+// Triangle soup of small random triangles inside [-1,1]^3, always the same
+// for a given seed so that results can be compared between versions
+static boost::shared_ptr<Shape> MakeTriangleSoup(u_int nTris, u_int seed)
+{
+	RandomGenerator rng(seed);
+	vector<Point> P(3 * nTris);
+	vector<int> indices(3 * nTris);
+	const float size = .1f;
+	for (u_int i = 0; i < nTris; ++i) {
+		const Point c(2.f * rng.floatValue() - 1.f,
+			2.f * rng.floatValue() - 1.f, 2.f * rng.floatValue() - 1.f);
+		for (u_int j = 0; j < 3; ++j) {
+			P[3 * i + j] = c + size * Vector(rng.floatValue() - .5f,
+				rng.floatValue() - .5f, rng.floatValue() - .5f);
+			indices[3 * i + j] = 3 * i + j;
+		}
+	}
+	ParamSet paramSet;
+	paramSet.AddInt("indices", &indices[0], indices.size());
+	paramSet.AddPoint("P", &P[0], P.size());
+	return MakeShape("trianglemesh", Transform(), false, paramSet);
+}
+
+// Rays from a sphere around the soup towards points inside it
+static void MakeRays(vector<Ray> *rays, u_int nRays, u_int seed, bool shadow)
+{
+	RandomGenerator rng(seed);
+	rays->reserve(nRays);
+	for (u_int i = 0; i < nRays; ++i) {
+		const Vector w(UniformSampleSphere(rng.floatValue(),
+			rng.floatValue()));
+		const Point o(Point(0.f, 0.f, 0.f) + 3.f * w);
+		const Point target(rng.floatValue() - .5f,
+			rng.floatValue() - .5f, rng.floatValue() - .5f);
+		if (shadow) {
+			// Unnormalized direction, the segment ends at the target
+			Ray ray(o, target - o);
+			ray.maxt = 1.f;
+			rays->push_back(ray);
+		} else
+			rays->push_back(Ray(o, Normalize(target - o)));
+	}
+}
+
+//------------------------------------------------------------------------------
+// Accelerator build and ray casting
+//------------------------------------------------------------------------------
+
+class RayWorker {
+public:
+	RayWorker(const Primitive &a, const vector<Ray> &r, u_int first,
+		u_int last) : accel(a), rays(r), begin(first), end(last),
+		hits(0) { }
+
+	void Intersect() {
+		for (u_int i = begin; i < end; ++i) {
+			Ray ray(rays[i]);
+			Intersection isect;
+			if (accel.Intersect(ray, &isect))
+				++hits;
+		}
+	}
+	void IntersectP() {
+		for (u_int i = begin; i < end; ++i) {
+			if (accel.IntersectP(rays[i]))
+				++hits;
+		}
+	}
+
+	const Primitive &accel;
+	const vector<Ray> &rays;
+	u_int begin, end;
+	u_int hits;
+};
+
+static double TraceRays(const Primitive &accel, const vector<Ray> &rays,
+	u_int threadCount, bool shadow, u_int *hits)
+{
+	boost::ptr_vector<RayWorker> workers;
+	for (u_int i = 0; i < threadCount; ++i)
+		workers.push_back(new RayWorker(accel, rays,
+			static_cast<u_int>((static_cast<boost::uint64_t>(rays.size()) * i) / threadCount),
+			static_cast<u_int>((static_cast<boost::uint64_t>(rays.size()) * (i + 1)) / threadCount)));
+	const double start = osWallClockTime();
+	boost::thread_group threads;
+	for (u_int i = 0; i < threadCount; ++i)
+		threads.create_thread(boost::bind(shadow ? &RayWorker::IntersectP :
+			&RayWorker::Intersect, &workers[i]));
+	threads.join_all();
+	const double elapsed = max(osWallClockTime() - start, 1e-9);
+	*hits = 0;
+	for (u_int i = 0; i < threadCount; ++i)
+		*hits += workers[i].hits;
+	return elapsed;
+}
+
+static void BenchAccelerators(const vector<string> &accelerators,
+	u_int nTris, u_int nRays, u_int seed, u_int threadCount)
+{
+	boost::shared_ptr<Shape> soup(MakeTriangleSoup(nTris, seed));
+	if (!soup) {
+		LOG(LUX_ERROR, LUX_BUG) << "Unable to create the benchmark mesh";
+		return;
+	}
+	// Refine once so that only the accelerators are timed
+	vector<boost::shared_ptr<Primitive> > prims;
+	soup->Refine(prims, PrimitiveRefinementHints(false), soup);
+
+	vector<Ray> rays, shadowRays;
+	MakeRays(&rays, nRays, seed + 1, false);
+	MakeRays(&shadowRays, nRays, seed + 2, true);
+
+	for (u_int i = 0; i < accelerators.size(); ++i) {
+		const string &name(accelerators[i]);
+		const double start = osWallClockTime();
+		boost::shared_ptr<Aggregate> accel(MakeAccelerator(name, prims,
+			ParamSet()));
+		const double buildTime = osWallClockTime() - start;
+		if (!accel) {
+			LOG(LUX_ERROR, LUX_BADTOKEN) << "Unknown accelerator '" << name << "'";
+			continue;
+		}
+		Report("accelerator", name, "build_time", buildTime, "s");
+		Report("accelerator", name, "triangles", prims.size(), "count");
+
+		u_int hits;
+		double elapsed = TraceRays(*accel, rays, threadCount, false, &hits);
+		Report("rays", name, "intersect", rays.size() / elapsed, "rays/s");
+		Report("rays", name, "intersect_hit_ratio",
+			static_cast<double>(hits) / max<size_t>(rays.size(), 1), "ratio");
+		elapsed = TraceRays(*accel, shadowRays, threadCount, true, &hits);
+		Report("rays", name, "intersectp", shadowRays.size() / elapsed,
+			"rays/s");
+		Report("rays", name, "intersectp_hit_ratio",
+			static_cast<double>(hits) / max<size_t>(shadowRays.size(), 1),
+			"ratio");
+	}
+}
+
+//------------------------------------------------------------------------------
+// Film splatting and FLM serialization
+//------------------------------------------------------------------------------
+
+class SplatWorker {
+public:
+	SplatWorker(ContributionPool *p, u_int n, u_int s, u_int x, u_int y) :
+		pool(p), count(n), seed(s), xRes(x), yRes(y) { }
+
+	void Splat() {
+		RandomGenerator rng(seed);
+		ContributionBuffer *buffer = new ContributionBuffer(pool);
+		for (u_int i = 0; i < count; ++i) {
+			const XYZColor c(rng.floatValue(), rng.floatValue(),
+				rng.floatValue());
+			buffer->Add(Contribution(rng.floatValue() * xRes,
+				rng.floatValue() * yRes, c, 1.f, 0.f, 0.f, 0, 0), 1.f);
+			buffer->AddSampleCount(1.f);
+		}
+		// The pool keeps references to the buffer, don't delete it
+		pool->End(buffer);
+	}
+
+	ContributionPool *pool;
+	u_int count, seed, xRes, yRes;
+};
+
+// Film with a single per pixel buffer and the default gaussian filter
+static Film *MakeBenchFilm(u_int resolution)
+{
+	ParamSet filmParams;
+	const int res = static_cast<int>(resolution);
+	const bool no = false;
+	const int never = 1 << 30;
+	filmParams.AddInt("xresolution", &res);
+	filmParams.AddInt("yresolution", &res);
+	filmParams.AddBool("write_png", &no);
+	filmParams.AddBool("write_exr", &no);
+	filmParams.AddBool("write_tga", &no);
+	filmParams.AddBool("write_resume_flm", &no);
+	filmParams.AddInt("writeinterval", &never);
+	filmParams.AddInt("flmwriteinterval", &never);
+	filmParams.AddInt("displayinterval", &never);
+	Film *film = MakeFilm("fleximage", filmParams,
+		MakeFilter("gaussian", ParamSet()));
+	if (!film) {
+		LOG(LUX_ERROR, LUX_BUG) << "Unable to create the benchmark film";
+		return NULL;
+	}
+	film->RequestBuffer(BUF_TYPE_PER_PIXEL, BUF_FRAMEBUFFER, "eye");
+	film->CreateBuffers();
+	return film;
+}
+
+// Splat loop of Film::AddTileSamples before it was vectorized, kept as
+// the baseline of the splat kernel: one Buffer::Add per pixel, with the
+// z-buffer and variance tests evaluated for every pixel
+static void SplatTileBaseline(Film &film, const FilterLUTs &filterLUTs,
+	float xWidth, float yWidth, Buffer *buffer,
+	PerPixelNormalizedFloatBuffer *zBuffer, VarianceBuffer *varianceBuffer,
+	const Contribution *contribs, u_int num_contribs, u_int tileIndex)
+{
+	int xTilePixelStart, xTilePixelEnd;
+	int yTilePixelStart, yTilePixelEnd;
+	film.GetTileExtent(tileIndex, &xTilePixelStart, &xTilePixelEnd, &yTilePixelStart, &yTilePixelEnd);
+	const u_int xPixelStart = film.GetXPixelStart();
+	const u_int yPixelStart = film.GetYPixelStart();
+
+	for (u_int ci = 0; ci < num_contribs; ci++) {
+		const Contribution &contrib(contribs[ci]);
+
+		const XYZColor xyz = contrib.color;
+		const float alpha = contrib.alpha;
+		if (!(xyz.Y() >= 0.f) || isinf(xyz.Y()) ||
+			!(alpha >= 0.f) || isinf(alpha))
+			continue;
+		const float weight = contrib.variance;
+		if (!(weight >= 0.f) || isinf(weight))
+			continue;
+
+		// Compute sample's raster extent
+		float dImageX = contrib.imageX - 0.5f;
+		float dImageY = contrib.imageY - 0.5f;
+
+		// Get filter coefficients
+		const FilterLUT &filterLUT = 
+			filterLUTs.GetLUT(dImageX - Floor2Int(contrib.imageX), dImageY - Floor2Int(contrib.imageY));
+		const float *lut = filterLUT.GetLUT();
+
+		int x0 = Ceil2Int (dImageX - xWidth);
+		int x1 = x0 + filterLUT.GetWidth();
+		int y0 = Ceil2Int (dImageY - yWidth);
+		int y1 = y0 + filterLUT.GetHeight();
+		if (x1 < x0 || y1 < y0 || x1 < 0 || y1 < 0)
+			continue;
+
+		const u_int xStart = static_cast<u_int>(max(x0, xTilePixelStart));
+		const u_int yStart = static_cast<u_int>(max(y0, yTilePixelStart));
+		const u_int xEnd = static_cast<u_int>(min(x1, xTilePixelEnd));
+		const u_int yEnd = static_cast<u_int>(min(y1, yTilePixelEnd));
+
+		for (u_int y = yStart; y < yEnd; ++y) {
+			const int yoffset = (y - y0) * filterLUT.GetWidth();
+			const u_int yPixel = y - yPixelStart;
+			for (u_int x = xStart; x < xEnd; ++x) {
+				// Evaluate filter value at $(x,y)$ pixel
+				const int xoffset = x-x0;
+				const float filterWt = lut[yoffset + xoffset];
+
+				// Update pixel values with filtered sample contribution
+				const u_int xPixel = x - xPixelStart;
+				const float w = filterWt * weight;
+				buffer->Add(xPixel, yPixel, xyz, alpha, w);
+
+				// Update ZBuffer values with filtered zdepth contribution
+				if(zBuffer && contrib.zdepth != 0.f)
+					zBuffer->Add(xPixel, yPixel, contrib.zdepth, 1.0f);
+
+				// Update variance information
+				if (varianceBuffer)
+					varianceBuffer->Add(xPixel, yPixel, xyz, w);
+			}
+		}
+	}
+}
+
+// Splats the same contributions, single threaded and without the
+// contribution pool, with Film::AddTileSamples and with the baseline loop
+static void BenchSplatKernel(u_int resolution, u_int nSplats, u_int seed)
+{
+	// The LUTs of the baseline are built before the film exists, the
+	// filter is a queryable object and only one may be registered
+	const u_int filterQuality = 1 << 4; // Default of fleximage
+	Filter *filter = MakeFilter("gaussian", ParamSet());
+	if (!filter)
+		return;
+	const FilterLUTs filterLUTs(filter, filterQuality);
+	const float xWidth = filter->xWidth, yWidth = filter->yWidth;
+	delete filter;
+
+	boost::scoped_ptr<Film> film(MakeBenchFilm(resolution));
+	if (!film)
+		return;
+
+	// Contributions of each tile, those on a tile border go in both
+	vector<vector<Contribution> > tiles(film->GetTileCount());
+	RandomGenerator rng(seed);
+	for (u_int i = 0; i < nSplats; ++i) {
+		const XYZColor c(rng.floatValue(), rng.floatValue(),
+			rng.floatValue());
+		const Contribution contrib(rng.floatValue() * resolution,
+			rng.floatValue() * resolution, c, 1.f, 0.f, 1.f, 0, 0);
+		u_int tile0, tile1;
+		if (film->GetTileIndexes(contrib, &tile0, &tile1) > 1)
+			tiles[tile1].push_back(contrib);
+		tiles[tile0].push_back(contrib);
+	}
+
+	double start = osWallClockTime();
+	for (u_int i = 0; i < tiles.size(); ++i) {
+		if (!tiles[i].empty())
+			film->AddTileSamples(&tiles[i][0], tiles[i].size(), i);
+	}
+	const double kernelTime = max(osWallClockTime() - start, 1e-9);
+	Report("film", "splatkernel", "splat", nSplats / kernelTime,
+		"contributions/s");
+
+	film->ClearBuffers();
+	Buffer *buffer = film->GetBufferGroup(0).getBuffer(0);
+	start = osWallClockTime();
+	for (u_int i = 0; i < tiles.size(); ++i) {
+		if (!tiles[i].empty())
+			SplatTileBaseline(*film, filterLUTs, xWidth, yWidth, buffer,
+				NULL, NULL, &tiles[i][0], tiles[i].size(), i);
+	}
+	const double baselineTime = max(osWallClockTime() - start, 1e-9);
+	Report("film", "splatbaseline", "splat", nSplats / baselineTime,
+		"contributions/s");
+	Report("film", "splatkernel", "speedup", baselineTime / kernelTime, "x");
+}
+
+static void BenchFilm(u_int resolution, u_int nSplats, u_int seed,
+	u_int threadCount, bool splat, bool flm)
+{
+	boost::scoped_ptr<Film> film(MakeBenchFilm(resolution));
+	if (!film)
+		return;
+
+	const u_int perThread = max(1U, nSplats / threadCount);
+	boost::ptr_vector<SplatWorker> workers;
+	for (u_int i = 0; i < threadCount; ++i)
+		workers.push_back(new SplatWorker(film->contribPool, perThread,
+			seed + i, resolution, resolution));
+	const double start = osWallClockTime();
+	boost::thread_group threads;
+	for (u_int i = 0; i < threadCount; ++i)
+		threads.create_thread(boost::bind(&SplatWorker::Splat, &workers[i]));
+	threads.join_all();
+	film->contribPool->Flush();
+	film->contribPool->Delete();
+	const double elapsed = max(osWallClockTime() - start, 1e-9);
+	if (splat)
+		Report("film", "contributionpool", "splat",
+			perThread * threadCount / elapsed, "contributions/s");
+
+	if (!flm)
+		return;
+	std::stringstream stream(std::ios_base::in | std::ios_base::out |
+		std::ios_base::binary);
+	double t0 = osWallClockTime();
+	if (!film->WriteFilmToStream(stream, false, true)) {
+		LOG(LUX_ERROR, LUX_SYSTEM) << "Unable to serialize the benchmark film";
+		return;
+	}
+	const double writeTime = max(osWallClockTime() - t0, 1e-9);
+	const double size = stream.str().size() / (1024. * 1024.);
+	Report("flm", "fleximage", "size", size, "MB");
+	Report("flm", "fleximage", "write", size / writeTime, "MB/s");
+	stream.seekg(0);
+	t0 = osWallClockTime();
+	if (film->MergeFilmFromStream(stream) <= 0.) {
+		LOG(LUX_ERROR, LUX_SYSTEM) << "Unable to read back the benchmark film";
+		return;
+	}
+	const double readTime = max(osWallClockTime() - t0, 1e-9);
+	Report("flm", "fleximage", "read", size / readTime, "MB/s");
+}
+
+//------------------------------------------------------------------------------
+// Texture lookups
+//------------------------------------------------------------------------------
+
+static void BenchTexture(const string &name, const Texture<float> &tex,
+	u_int nLookups, u_int seed)
+{
+	RandomGenerator rng(seed);
+	SpectrumWavelengths sw;
+	sw.Sample(rng.floatValue());
+	vector<DifferentialGeometry> dgs;
+	dgs.reserve(1024);
+	for (u_int i = 0; i < 1024; ++i) {
+		const Point p(2.f * rng.floatValue() - 1.f,
+			2.f * rng.floatValue() - 1.f, 2.f * rng.floatValue() - 1.f);
+		dgs.push_back(DifferentialGeometry(p, Normal(0, 0, 1),
+			Vector(1, 0, 0), Vector(0, 1, 0), Normal(0, 0, 0),
+			Normal(0, 0, 0), rng.floatValue(), rng.floatValue(), NULL));
+	}
+	// Accumulate so that the lookups can't be optimized away
+	float sum = 0.f;
+	const double start = osWallClockTime();
+	for (u_int i = 0; i < nLookups; ++i)
+		sum += tex.Evaluate(sw, dgs[i & 1023]);
+	const double elapsed = max(osWallClockTime() - start, 1e-9);
+	LOG(LUX_DEBUG, LUX_NOERROR) << "Texture " << name << " checksum " << sum;
+	Report("texture", name, "lookup", nLookups / elapsed, "lookups/s");
+}
+
+static void BenchTextures(u_int nLookups, u_int seed)
+{
+	const char *procedurals[] = { "fbm", "wrinkled", "marble", "windy",
+		"blender_clouds", "blender_musgrave" };
+	for (u_int i = 0; i < sizeof(procedurals) / sizeof(procedurals[0]); ++i) {
+		boost::shared_ptr<Texture<float> > tex(MakeFloatTexture(procedurals[i],
+			Transform(), ParamSet()));
+		if (tex)
+			BenchTexture(procedurals[i], *tex, nLookups, seed);
+	}
+
+	// Arithmetic graph over a procedural, evaluated node by node and
+	// through its flat program
+	boost::shared_ptr<Texture<float> > fbm(MakeFloatTexture("fbm",
+		Transform(), ParamSet()));
+	if (!fbm)
+		return;
+	boost::shared_ptr<Texture<float> > half(new ConstantFloatTexture(.5f));
+	boost::shared_ptr<Texture<float> > one(new ConstantFloatTexture(1.f));
+	boost::shared_ptr<Texture<float> > two(new ConstantFloatTexture(2.f));
+	boost::shared_ptr<Texture<float> > constScale(new ScaleTexture<float, float>(half, two));
+	boost::shared_ptr<Texture<float> > scaled(new ScaleTexture<float, float>(fbm, constScale));
+	boost::shared_ptr<Texture<float> > scaled1(new ScaleTexture<float, float>(scaled, one));
+	boost::shared_ptr<Texture<float> > graph(new MixTexture<float>(scaled1, half, half));
+	BenchTexture("graph", *graph, nLookups, seed);
+	BenchTexture("graph_flat", *FlatFloatTexture::Flatten(graph), nLookups, seed);
+}
+
+//------------------------------------------------------------------------------
+// Rendering
+//------------------------------------------------------------------------------
+
+static bool parseError;
+
+static void EngineThread(const string &sceneFileName)
+{
+	luxParse(sceneFileName.c_str());
+	if (luxStatistics("sceneIsReady") == 0.)
+		parseError = true;
+}
+
+// Renders a scene file until it halts or for the given time, and reports
+// the scene build time and the rendering throughput. The tonemapped RGB
+// framebuffer is copied to image when given. Returns the rendering time,
+// 0 if the scene couldn't be rendered.
+static double RenderScene(const string &suite, const string &name,
+	const string &sceneFileName, u_int threadCount, double timeLimit,
+	vector<float> *image = NULL)
+{
+	const boost::filesystem::path cwd(boost::filesystem::current_path());
+	const boost::filesystem::path scenePath(boost::filesystem::system_complete(sceneFileName));
+	try {
+		boost::filesystem::current_path(scenePath.parent_path());
+	} catch (boost::filesystem::filesystem_error &) {
+		LOG(LUX_SEVERE, LUX_NOFILE) << "Unable to change to directory '" << scenePath.parent_path().string() << "'";
+		return 0.;
+	}
+
+	parseError = false;
+	const double start = osWallClockTime();
+	boost::thread engine(boost::bind(EngineThread, scenePath.string()));
+	while (!luxStatistics("sceneIsReady") && !parseError)
+		boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+	if (parseError) {
+		LOG(LUX_SEVERE, LUX_BADFILE) << "Skipping invalid scene file '" << sceneFileName << "'";
+		engine.join();
+		luxCleanup();
+		boost::filesystem::current_path(cwd);
+		return 0.;
+	}
+	const double ready = osWallClockTime();
+	Report(suite, name, "scene_build_time", ready - start, "s");
+
+	for (u_int i = 1; i < threadCount; ++i)
+		luxAddThread();
+	if (timeLimit > 0.) {
+		boost::this_thread::sleep(boost::posix_time::milliseconds(
+			static_cast<long>(timeLimit * 1000.)));
+		luxExit();
+	}
+	luxWait();
+	const double renderTime = max(osWallClockTime() - ready, 1e-9);
+
+	if (luxHasAttribute("renderer_statistics", "samplesPerSecond"))
+		Report(suite, name, "samples_per_second",
+			luxGetDoubleAttribute("renderer_statistics", "samplesPerSecond"),
+			"samples/s");
+	Report(suite, name, "render_time", renderTime, "s");
+
+	if (image) {
+		luxUpdateFramebuffer();
+		const float *fb = luxFloatFramebuffer();
+		image->assign(fb, fb + 3 * luxGetIntAttribute("film", "xResolution") *
+			luxGetIntAttribute("film", "yResolution"));
+	}
+
+	luxExit();
+	engine.join();
+	luxCleanup();
+	boost::filesystem::current_path(cwd);
+	return renderTime;
+}
+
+static void WriteSyntheticScene(const string &fileName, const string &imageName,
+	const string &integrator, const string &sampler, u_int resolution,
+	u_int spp, u_int nTris, u_int seed)
+{
+	std::ofstream os(fileName.c_str());
+	os << "LookAt 0 -4 1.5 0 0 0 0 0 1\n";
+	os << "Camera \"perspective\" \"float fov\" [40]\n";
+	os << "Film \"fleximage\" \"integer xresolution\" [" << resolution <<
+		"] \"integer yresolution\" [" << resolution <<
+		"] \"integer haltspp\" [" << spp << "]" <<
+		" \"bool write_png\" [\"false\"] \"bool write_exr\" [\"false\"]" <<
+		" \"bool write_tga\" [\"false\"] \"bool write_resume_flm\" [\"false\"]" <<
+		" \"integer writeinterval\" [1000000] \"integer displayinterval\" [1000000]" <<
+		" \"string filename\" [\"" << imageName << "\"]\n";
+	os << "Sampler \"" << sampler << "\"\n";
+	os << "SurfaceIntegrator \"" << integrator << "\"\n";
+	os << "WorldBegin\n";
+	os << "LightSource \"infinite\" \"color L\" [0.3 0.3 0.3]\n";
+	os << "AttributeBegin\n";
+	os << "AreaLightSource \"area\" \"color L\" [8 8 8]\n";
+	os << "Shape \"trianglemesh\" \"integer indices\" [0 1 2 0 2 3]" <<
+		" \"point P\" [-0.5 -0.5 2.5 0.5 -0.5 2.5 0.5 0.5 2.5 -0.5 0.5 2.5]\n";
+	os << "AttributeEnd\n";
+	os << "Material \"matte\" \"color Kd\" [0.6 0.6 0.6]\n";
+	os << "Shape \"trianglemesh\" \"integer indices\" [0 1 2 0 2 3]" <<
+		" \"point P\" [-4 -4 -1 4 -4 -1 4 4 -1 -4 4 -1]\n";
+	// Same triangle soup as the accelerator suite
+	RandomGenerator rng(seed);
+	os << "Shape \"trianglemesh\" \"integer indices\" [";
+	for (u_int i = 0; i < 3 * nTris; ++i)
+		os << (i ? " " : "") << i;
+	os << "] \"point P\" [";
+	const float size = .1f;
+	for (u_int i = 0; i < nTris; ++i) {
+		const Point c(2.f * rng.floatValue() - 1.f,
+			2.f * rng.floatValue() - 1.f, 2.f * rng.floatValue() - 1.f);
+		for (u_int j = 0; j < 3; ++j) {
+			const Point p(c + size * Vector(rng.floatValue() - .5f,
+				rng.floatValue() - .5f, rng.floatValue() - .5f));
+			os << (i || j ? " " : "") << p.x << " " << p.y << " " << p.z;
+		}
+	}
+	os << "]\n";
+	os << "WorldEnd\n";
+}
+
+// Floor lit by many point lights of very different intensities, with part
+// of the accelerator triangle soup casting shadows. Rendered with a fixed
+// linear tone mapping so that images of different strategies compare.
+static void WriteManyLightScene(const string &fileName, const string &imageName,
+	const string &strategy, u_int resolution, u_int spp, u_int nLights,
+	u_int seed)
+{
+	std::ofstream os(fileName.c_str());
+	os << "LookAt 0 -3 4 0 0 -1 0 0 1\n";
+	os << "Camera \"perspective\" \"float fov\" [60]\n";
+	os << "Film \"fleximage\" \"integer xresolution\" [" << resolution <<
+		"] \"integer yresolution\" [" << resolution <<
+		"] \"integer haltspp\" [" << spp << "]" <<
+		" \"string tonemapkernel\" [\"linear\"] \"float linear_sensitivity\" [100]" <<
+		" \"float linear_exposure\" [1] \"float linear_fstop\" [1]" <<
+		" \"float linear_gamma\" [1] \"float gamma\" [1]" <<
+		" \"bool write_png\" [\"false\"] \"bool write_exr\" [\"false\"]" <<
+		" \"bool write_tga\" [\"false\"] \"bool write_resume_flm\" [\"false\"]" <<
+		" \"integer writeinterval\" [1000000] \"integer displayinterval\" [1000000]" <<
+		" \"string filename\" [\"" << imageName << "\"]\n";
+	os << "Sampler \"lowdiscrepancy\"\n";
+	os << "SurfaceIntegrator \"directlighting\" \"string lightstrategy\" [\"" <<
+		strategy << "\"]\n";
+	os << "WorldBegin\n";
+	// Most of the power comes from a few lights, the total power doesn't
+	// depend on the light count
+	RandomGenerator rng(seed);
+	const float gain = 1.f / nLights;
+	for (u_int i = 0; i < nLights; ++i) {
+		const float u = rng.floatValue();
+		const float power = gain * (.05f + 20.f * u * u * u * u);
+		os << "LightSource \"point\" \"color L\" [" <<
+			power * (.5f + rng.floatValue()) << " " <<
+			power * (.5f + rng.floatValue()) << " " <<
+			power * (.5f + rng.floatValue()) << "] \"point from\" [" <<
+			8.f * rng.floatValue() - 4.f << " " <<
+			8.f * rng.floatValue() - 4.f << " " <<
+			1.5f * rng.floatValue() - .8f << "]\n";
+	}
+	os << "Material \"matte\" \"color Kd\" [0.6 0.6 0.6]\n";
+	os << "Shape \"trianglemesh\" \"integer indices\" [0 1 2 0 2 3]" <<
+		" \"point P\" [-4 -4 -1 4 -4 -1 4 4 -1 -4 4 -1]\n";
+	const u_int nTris = 2000;
+	os << "Shape \"trianglemesh\" \"integer indices\" [";
+	for (u_int i = 0; i < 3 * nTris; ++i)
+		os << (i ? " " : "") << i;
+	os << "] \"point P\" [";
+	const float size = .1f;
+	for (u_int i = 0; i < nTris; ++i) {
+		const Point c(2.f * rng.floatValue() - 1.f,
+			2.f * rng.floatValue() - 1.f, rng.floatValue() - 1.f);
+		for (u_int j = 0; j < 3; ++j) {
+			const Point p(c + size * Vector(rng.floatValue() - .5f,
+				rng.floatValue() - .5f, rng.floatValue() - .5f));
+			os << (i || j ? " " : "") << p.x << " " << p.y << " " << p.z;
+		}
+	}
+	os << "]\n";
+	os << "WorldEnd\n";
+}
+
+// Renders the many-light scene with each light strategy at the same
+// sample count, and compares the images to a reference rendered with
+// more samples and the "all" strategy, which samples every light
+static void BenchLightStrategies(const vector<string> &strategies,
+	u_int resolution, u_int spp, u_int referenceSpp, u_int nLights,
+	u_int seed, u_int threadCount)
+{
+	const boost::filesystem::path sceneDir(boost::filesystem::temp_directory_path() /
+		boost::filesystem::unique_path("luxbench-%%%%-%%%%"));
+	boost::filesystem::create_directories(sceneDir);
+	const string sceneFile((sceneDir / "manylights.lxs").string());
+	const string imageName((sceneDir / "manylights").string());
+
+	vector<float> reference;
+	WriteManyLightScene(sceneFile, imageName, "all", resolution,
+		referenceSpp, nLights, seed);
+	if (RenderScene("lights", "reference", sceneFile, threadCount, 0.,
+		&reference) > 0.) {
+		double mean = 0.;
+		for (u_int i = 0; i < reference.size(); ++i)
+			mean += reference[i];
+		mean /= max<size_t>(reference.size(), 1);
+
+		for (u_int i = 0; i < strategies.size(); ++i) {
+			vector<float> image;
+			WriteManyLightScene(sceneFile, imageName, strategies[i],
+				resolution, spp, nLights, seed);
+			const double renderTime = RenderScene("lights", strategies[i],
+				sceneFile, threadCount, 0., &image);
+			if (renderTime <= 0. || image.size() != reference.size())
+				continue;
+			double error = 0.;
+			for (u_int j = 0; j < image.size(); ++j) {
+				const double d = image[j] - reference[j];
+				error += d * d;
+			}
+			// Relative to the mean of the reference, so that the
+			// exposure doesn't matter
+			const double rmse = sqrt(error / max<size_t>(image.size(), 1)) /
+				max(mean, 1e-9);
+			Report("lights", strategies[i], "relative_rmse", rmse, "");
+			// Lower error in less time is better, independent of spp
+			Report("lights", strategies[i], "efficiency",
+				1. / max(rmse * rmse * renderTime, 1e-12), "1/s");
+		}
+	}
+
+	boost::system::error_code ec;
+	boost::filesystem::remove_all(sceneDir, ec);
+}
+
+int main(int ac, char *av[]) {
+
+	try {
+		// Declare a group of options that will be
+		// allowed only on command line
+		po::options_description generic("Generic options");
+		generic.add_options()
+				("version,v", "Print version string")
+				("help,h", "Produce help message")
+				("output,o", po::value< std::string >(), "Write the results to a file instead of the standard output")
+				("format,f", po::value< std::string >()->default_value("json"), "Results format (json, csv)")
+				("threads,t", po::value < int >(), "Specify the number of threads")
+				("suites,s", po::value< std::string >()->default_value("accelerator,film,flm,texture,render,lights,scene"), "Comma separated list of suites to run")
+				("seed", po::value < int >()->default_value(1), "Seed of the synthetic data")
+				("triangles", po::value < int >()->default_value(200000), "Number of triangles of the accelerator suite")
+				("rays", po::value < int >()->default_value(1 << 20), "Number of rays per accelerator and ray type")
+				("accelerators", po::value< std::string >()->default_value("qbvh,sqbvh,bvh,kdtree,unsafekdtree"), "Comma separated list of accelerators")
+				("splats", po::value < int >()->default_value(1 << 23), "Number of film contributions")
+				("filmresolution", po::value < int >()->default_value(1024), "Film resolution of the film and FLM suites")
+				("lookups", po::value < int >()->default_value(1 << 22), "Number of lookups per texture")
+				("integrators", po::value< std::string >()->default_value("path,bidirectional,directlighting,distributedpath"), "Comma separated list of surface integrators")
+				("samplers", po::value< std::string >()->default_value("random,lowdiscrepancy,metropolis"), "Comma separated list of samplers")
+				("resolution", po::value < int >()->default_value(256), "Image resolution of the synthetic render scene")
+				("spp", po::value < int >()->default_value(16), "Samples per pixel of the synthetic render scene")
+				("scenetriangles", po::value < int >()->default_value(20000), "Number of triangles of the synthetic render scene")
+				("lightstrategies", po::value< std::string >()->default_value("one,powerimp,logpowerimp,lighttree"), "Comma separated list of light strategies of the lights suite")
+				("lights", po::value < int >()->default_value(512), "Number of lights of the lights suite")
+				("lightsresolution", po::value < int >()->default_value(128), "Image resolution of the lights suite")
+				("lightsspp", po::value < int >()->default_value(16), "Samples per pixel of each light strategy")
+				("lightsreferencespp", po::value < int >()->default_value(64), "Samples per pixel of the lights suite reference")
+				("time", po::value < double >()->default_value(30.), "Rendering time of each scene file (seconds)")
+				("verbose,V", "Increase output verbosity (show DEBUG messages)")
+				("quiet,q", "Reduce output verbosity (hide INFO messages)")
+				;
+
+		// Hidden options, will be allowed both on command line and
+		// in config file, but will not be shown to the user.
+		po::options_description hidden("Hidden options");
+		hidden.add_options()
+				("input-file", po::value< vector<string> >(), "input file")
+				;
+
+		po::options_description cmdline_options;
+		cmdline_options.add(generic).add(hidden);
+
+		po::options_description visible("Allowed options");
+		visible.add(generic);
+
+		po::positional_options_description p;
+
+		p.add("input-file", -1);
+
+		po::variables_map vm;
+		store(po::command_line_parser(ac, av).
+				options(cmdline_options).positional(p).run(), vm);
+
+		if (vm.count("help")) {
+			LOG( LUX_ERROR,LUX_SYSTEM) << "Usage: luxbench [options] [scene file...]\n" << visible;
+			return 0;
+		}
+
+		LOG(LUX_INFO,LUX_NOERROR) << "Lux version " << luxVersion() << " of " << __DATE__ << " at " << __TIME__;
+		if (vm.count("version"))
+			return 0;
+
+		if (vm.count("verbose")) {
+			luxErrorFilter(LUX_DEBUG);
+		}
+
+		if (vm.count("quiet")) {
+			luxErrorFilter(LUX_WARNING);
+		}
+
+		const string format = vm["format"].as<string>();
+		if (format != "json" && format != "csv") {
+			LOG( LUX_ERROR,LUX_SYSTEM) << "Unknown results format '" << format << "'";
+			return 1;
+		}
+
+		u_int threadCount = boost::thread::hardware_concurrency();
+		if (vm.count("threads"))
+			threadCount = static_cast<u_int>(max(1, vm["threads"].as<int>()));
+		threadCount = max(1U, threadCount);
+
+		const vector<string> suiteList(SplitList(vm["suites"].as<string>()));
+		std::set<string> suites(suiteList.begin(), suiteList.end());
+		const u_int seed = static_cast<u_int>(vm["seed"].as<int>());
+
+		// Synthetic suites run outside of any scene so that their
+		// queryable objects don't clash with the rendering ones
+		luxInit();
+		luxDisableRandomMode();
+
+		if (suites.count("accelerator"))
+			BenchAccelerators(SplitList(vm["accelerators"].as<string>()),
+				max(1, vm["triangles"].as<int>()),
+				max(1, vm["rays"].as<int>()), seed, threadCount);
+
+		if (suites.count("film"))
+			BenchSplatKernel(max(1, vm["filmresolution"].as<int>()),
+				max(1, vm["splats"].as<int>()), seed);
+
+		if (suites.count("film") || suites.count("flm"))
+			BenchFilm(max(1, vm["filmresolution"].as<int>()),
+				max(1, vm["splats"].as<int>()), seed, threadCount,
+				suites.count("film") > 0, suites.count("flm") > 0);
+
+		if (suites.count("texture"))
+			BenchTextures(max(1, vm["lookups"].as<int>()), seed);
+
+		if (suites.count("render")) {
+			const boost::filesystem::path sceneDir(boost::filesystem::temp_directory_path() /
+				boost::filesystem::unique_path("luxbench-%%%%-%%%%"));
+			boost::filesystem::create_directories(sceneDir);
+			const string sceneFile((sceneDir / "synthetic.lxs").string());
+			const vector<string> integrators(SplitList(vm["integrators"].as<string>()));
+			const vector<string> samplers(SplitList(vm["samplers"].as<string>()));
+			for (u_int i = 0; i < integrators.size(); ++i) {
+				for (u_int j = 0; j < samplers.size(); ++j) {
+					WriteSyntheticScene(sceneFile,
+						(sceneDir / "synthetic").string(),
+						integrators[i], samplers[j],
+						max(1, vm["resolution"].as<int>()),
+						max(1, vm["spp"].as<int>()),
+						max(1, vm["scenetriangles"].as<int>()), seed);
+					RenderScene("render", integrators[i] + "/" + samplers[j],
+						sceneFile, threadCount, 0.);
+				}
+			}
+			boost::system::error_code ec;
+			boost::filesystem::remove_all(sceneDir, ec);
+		}
+
+		if (suites.count("lights"))
+			BenchLightStrategies(SplitList(vm["lightstrategies"].as<string>()),
+				max(1, vm["lightsresolution"].as<int>()),
+				max(1, vm["lightsspp"].as<int>()),
+				max(1, vm["lightsreferencespp"].as<int>()),
+				max(1, vm["lights"].as<int>()), seed, threadCount);
+
+		if (suites.count("scene") && vm.count("input-file")) {
+			const vector<string> &v = vm["input-file"].as < vector<string> > ();
+			for (u_int i = 0; i < v.size(); ++i) {
+				if (!boost::filesystem::exists(v[i])) {
+					LOG(LUX_SEVERE,LUX_NOFILE) << "Unable to open file '" << v[i] << "'";
+					continue;
+				}
+				RenderScene("scene", boost::filesystem::path(v[i]).filename().string(),
+					v[i], threadCount, vm["time"].as<double>());
+			}
+		}
+
+		if (vm.count("output")) {
+			const string outputFileName = vm["output"].as<string>();
+			std::ofstream os(outputFileName.c_str());
+			if (!os) {
+				LOG( LUX_ERROR,LUX_NOFILE) << "Unable to write results to '" << outputFileName << "'";
+				return 1;
+			}
+			WriteResults(os, format, threadCount);
+		} else
+			WriteResults(std::cout, format, threadCount);
+
+	} catch (std::exception & e) {
+		LOG( LUX_SEVERE,LUX_SYNTAX)
+			<< "Command line argument parsing failed with error '" << e.what()
+			<< "', please use the --help option to view the allowed syntax.";
+		return 1;
+	}
+	return 0;
+}
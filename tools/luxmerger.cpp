@@ -22,6 +22,7 @@
 
 #define NDEBUG 1
 
+#include <algorithm>
 #include <iomanip>
 #include <fstream>
 #include <string>
@@ -30,13 +31,17 @@
 #include <iostream>
 
 #include "api.h"
+#include "context.h"
 #include "film/fleximage.h"
+#include "osfunc.h"
 
 #include <boost/program_options.hpp>
 #include <boost/thread.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/scoped_ptr.hpp>
+#include <boost/bind.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
 
 #if defined(WIN32) && !defined(__CYGWIN__) /* We need the following two to set stdout to binary */
 #include <io.h>
@@ -46,6 +51,112 @@
 using namespace lux;
 namespace po = boost::program_options;
 
+// Merges a contiguous block of the input files into its own film, so that
+// decompression and parsing of the inputs run concurrently. Blocks are
+// static so that the result only depends on the number of threads.
+// Films and their filters register themselves in the active context
+// under fixed names, which isn't thread safe, so each worker film lives
+// in its own context and is only created and freed by the main thread.
+class MergeWorker {
+public:
+	MergeWorker(const vector<string> &files, u_int first, u_int last) :
+		fileNames(files), begin(first), end(last), context(NULL),
+		mergedCount(0), bytesRead(0) { }
+
+	// Creates the film from the first readable file of the block,
+	// to be called from the main thread
+	void CreateFilm() {
+		Context *active = Context::GetActive();
+		context = new Context("luxmerger worker");
+		Context::SetActive(context);
+		context->Init();
+		for (; begin < end && !film; ++begin) {
+			const string &flmFileName = fileNames[begin];
+			film.reset((FlexImageFilm*)FlexImageFilm::CreateFilmFromFLM(flmFileName));
+			if (!film)
+				LOG( LUX_SEVERE,LUX_NOFILE) << "Error reading FLM file '" << flmFileName << "'";
+			else
+				Count(flmFileName);
+		}
+		Context::SetActive(active);
+	}
+
+	// Merges the rest of the block into the film
+	void Merge() {
+		if (!film)
+			return;
+		for (u_int i = begin; i < end; ++i) {
+			const string &flmFileName = fileNames[i];
+
+			{
+				// additional flm file
+				std::ifstream ifs(flmFileName.c_str(), std::ios_base::in | std::ios_base::binary);
+
+				if(ifs.good()) {
+					// read the data
+					LOG( LUX_INFO,LUX_NOERROR)<< "Merging FLM file " << flmFileName;
+					float newSamples = film->MergeFilmFromStream(ifs);
+					if (newSamples <= 0) {
+						LOG( LUX_SEVERE,LUX_NOFILE) << "Error reading FLM file '" << flmFileName << "'";
+						ifs.close();
+						continue;
+					} else {
+						LOG( LUX_DEBUG,LUX_NOERROR) << "Merged " << newSamples << " samples from FLM file";
+					}
+				}
+
+				ifs.close();
+			}
+
+			Count(flmFileName);
+		}
+	}
+
+	// Merges the film of another worker into this one, the other film
+	// is freed later by the main thread
+	void Reduce(MergeWorker &other) {
+		if (other.film) {
+			if (!film) {
+				film.swap(other.film);
+				std::swap(context, other.context);
+			} else if (!film->HasSameLayout(*(other.film)))
+				LOG( LUX_SEVERE,LUX_CONSISTENCY) << "Unable to merge films, some FLM files have a different resolution or buffer layout";
+			else
+				film->MergeFilm(*(other.film));
+		}
+		mergedCount += other.mergedCount;
+		bytesRead += other.bytesRead;
+	}
+
+	// Frees the film and its context, to be called from the main thread
+	void FreeFilm() {
+		if (!context)
+			return;
+		Context *active = Context::GetActive();
+		Context::SetActive(context);
+		film.reset();
+		delete context;
+		context = NULL;
+		Context::SetActive(active);
+	}
+
+	const vector<string> &fileNames;
+	u_int begin, end;
+	Context *context;
+	boost::scoped_ptr<FlexImageFilm> film;
+	u_int mergedCount;
+	boost::uintmax_t bytesRead;
+
+private:
+	void Count(const string &flmFileName) {
+		++mergedCount;
+		boost::system::error_code ec;
+		const boost::uintmax_t size = boost::filesystem::file_size(flmFileName, ec);
+		if (!ec)
+			bytesRead += size;
+	}
+};
+
 int main(int ac, char *av[]) {
 
 	try {
@@ -59,6 +170,9 @@ int main(int ac, char *av[]) {
 				("help,h", "Produce help message")
 				("debug,d", "Enable debug mode")
 				("output,o", po::value< std::string >()->default_value("merged.flm"), "Output file")
+				("threads,t", po::value < int >(), "Specify the number of threads used to read and merge the input files")
+				("image,i", po::value< std::string >(), "Also write the merged image, comma separated list of formats (png, tga, exr)")
+				("noflm,n", "Don't write the merged FLM file")
 				("verbose,V", "Increase output verbosity (show DEBUG messages)")
 				("quiet,q", "Reduce output verbosity (hide INFO messages)") // (give once for WARNING only, twice for ERROR only)")
 				;
@@ -108,13 +222,34 @@ int main(int ac, char *av[]) {
 
 		string outputFileName = vm["output"].as<string>();
 
-		boost::scoped_ptr<FlexImageFilm> film;
-		int mergedCount = 0;
+		bool writePNG = false, writeTGA = false, writeEXR = false;
+		if (vm.count("image")) {
+			std::stringstream formats(vm["image"].as<string>());
+			string format;
+			while (std::getline(formats, format, ',')) {
+				if (format == "png")
+					writePNG = true;
+				else if (format == "tga")
+					writeTGA = true;
+				else if (format == "exr")
+					writeEXR = true;
+				else {
+					LOG( LUX_ERROR,LUX_SYSTEM) << "Unknown image format '" << format << "'";
+					return 1;
+				}
+			}
+		}
+
+		u_int threadCount = boost::thread::hardware_concurrency();
+		if (vm.count("threads"))
+			threadCount = static_cast<u_int>(max(1, vm["threads"].as<int>()));
+		threadCount = max(1U, threadCount);
 
 		luxInit();
 
 		if (vm.count("input-file")) {
 			const std::vector<std::string> &v = vm["input-file"].as < vector<string> > ();
+			vector<string> flmFileNames;
 			for (unsigned int i = 0; i < v.size(); i++) {
 				boost::filesystem::path fullPath(boost::filesystem::system_complete(v[i]));
 
@@ -123,48 +258,78 @@ int main(int ac, char *av[]) {
 					continue;
 				}
 
-				std::string flmFileName = fullPath.string();
+				flmFileNames.push_back(fullPath.string());
+			}
 
-				if (!film) {
-					// initial flm file
-					film.reset((FlexImageFilm*)FlexImageFilm::CreateFilmFromFLM(flmFileName));
-					if (!film) {
-						LOG( LUX_SEVERE,LUX_NOFILE) << "Error reading FLM file '" << flmFileName << "'";
-						continue;
-					}
-				} else {
-					// additional flm file
-					std::ifstream ifs(flmFileName.c_str(), std::ios_base::in | std::ios_base::binary);
-
-					if(ifs.good()) {
-						// read the data
-						LOG( LUX_INFO,LUX_NOERROR)<< "Merging FLM file " << flmFileName;
-						float newSamples = film->MergeFilmFromStream(ifs);
-						if (newSamples <= 0) {
-							LOG( LUX_SEVERE,LUX_NOFILE) << "Error reading FLM file '" << flmFileName << "'";
-							ifs.close();
-							continue;
-						} else {
-							LOG( LUX_DEBUG,LUX_NOERROR) << "Merged " << newSamples << " samples from FLM file";
-						}
-					}
+			const double startTime = osWallClockTime();
 
-					ifs.close();
-				}
+			// Each worker keeps a full film in memory, so don't
+			// start more workers than there are files
+			threadCount = min(threadCount, max(1U, static_cast<u_int>(flmFileNames.size())));
+			boost::ptr_vector<MergeWorker> workers;
+			for (u_int i = 0; i < threadCount; ++i) {
+				const u_int first = static_cast<u_int>((static_cast<boost::uint64_t>(flmFileNames.size()) * i) / threadCount);
+				const u_int last = static_cast<u_int>((static_cast<boost::uint64_t>(flmFileNames.size()) * (i + 1)) / threadCount);
+				workers.push_back(new MergeWorker(flmFileNames, first, last));
+			}
+
+			LOG( LUX_INFO,LUX_NOERROR) << "Merging " << flmFileNames.size() << " FLM files using " << threadCount << " threads";
 
-				mergedCount++;
+			for (u_int i = 0; i < threadCount; ++i)
+				workers[i].CreateFilm();
+
+			boost::thread_group readThreads;
+			for (u_int i = 0; i < threadCount; ++i)
+				readThreads.create_thread(boost::bind(&MergeWorker::Merge, &workers[i]));
+			readThreads.join_all();
+
+			const double readTime = osWallClockTime();
+
+			// Reduce the per worker films in a parallel tree
+			for (u_int stride = 1; stride < threadCount; stride *= 2) {
+				boost::thread_group reduceThreads;
+				for (u_int i = 0; i + stride < threadCount; i += 2 * stride)
+					reduceThreads.create_thread(boost::bind(&MergeWorker::Reduce, &workers[i], boost::ref(workers[i + stride])));
+				reduceThreads.join_all();
 			}
 
+			const double mergeTime = osWallClockTime();
+
+			for (u_int i = 1; i < threadCount; ++i)
+				workers[i].FreeFilm();
+
 			luxCleanup();
 
-			if (!film) {
+			MergeWorker &result(workers[0]);
+			if (!result.film) {
 				LOG( LUX_WARNING,LUX_NOERROR) << "No files merged";
+				result.FreeFilm();
 				return 2;
 			}
 
-			LOG( LUX_INFO,LUX_NOERROR) << "Merged " << mergedCount << " FLM files, writing merged FLM to " << outputFileName;
+			const double elapsed = max(mergeTime - startTime, 1e-6);
+			LOG( LUX_INFO,LUX_NOERROR) << "Merged " << result.mergedCount << " FLM files in " <<
+				std::setprecision(3) << elapsed << "s (reading " << (readTime - startTime) <<
+				"s, reduction " << (mergeTime - readTime) << "s), " <<
+				(result.mergedCount / elapsed) << " files/s, " <<
+				(result.bytesRead / (1024. * 1024.) / elapsed) << " MB/s";
+
+			if (!vm.count("noflm")) {
+				LOG( LUX_INFO,LUX_NOERROR) << "Writing merged FLM to " << outputFileName;
+				result.film->WriteFilmToFile(outputFileName);
+			}
+
+			if (writePNG || writeTGA || writeEXR) {
+				// Remove the .flm extension, the image writers add their own
+				boost::filesystem::path imagePath(outputFileName);
+				if (imagePath.extension() == ".flm")
+					imagePath.replace_extension("");
+				LOG( LUX_INFO,LUX_NOERROR) << "Writing merged image to " << imagePath.string();
+				result.film->SetFileOutput(imagePath.string(), writePNG, writeTGA, writeEXR);
+				result.film->WriteImage(IMAGE_FILEOUTPUT);
+			}
 
-			film->WriteFilmToFile(outputFileName);
+			result.FreeFilm();
 		} else {
 			LOG( LUX_ERROR,LUX_SYSTEM) << "luxmerger: no input file";
 		}